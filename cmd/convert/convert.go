@@ -0,0 +1,78 @@
+// Entry point for 'pgcenter convert' command.
+
+package convert
+
+import (
+	"fmt"
+	"github.com/lesovsky/pgcenter/convert"
+	"github.com/spf13/cobra"
+	"time"
+)
+
+// options defines all user-requested startup options.
+type options struct {
+	outputDir       string        // Directory where converted files are written
+	keyframe        int           // Number of snapshots in a segment
+	workers         int           // Number of workers encoding segments
+	downsampleAfter time.Duration // Age of snapshots which are downsampled
+	downsampleRate  time.Duration // Interval between downsampled snapshots
+}
+
+var (
+	opts options
+
+	// CommandDefinition is the definition of 'convert' CLI sub-command
+	CommandDefinition = &cobra.Command{
+		Use:   "convert",
+		Short: "convert recorded stats to binary format",
+		Long:  `'pgcenter convert' rewrites files with recorded statistics into indexed binary format.`,
+		RunE: func(command *cobra.Command, args []string) error {
+			config, err := opts.validate(args, time.Now())
+			if err != nil {
+				return err
+			}
+
+			return convert.RunMain(config)
+		},
+	}
+)
+
+func init() {
+	CommandDefinition.Flags().StringVarP(&opts.outputDir, "output-dir", "o", "", "write converted files into specified directory (default: directory of input file)")
+	CommandDefinition.Flags().IntVar(&opts.keyframe, "keyframe", 60, "number of snapshots between complete snapshots (default: 60)")
+	CommandDefinition.Flags().IntVar(&opts.workers, "workers", 0, "number of workers converting files and segments (default: number of CPUs)")
+	CommandDefinition.Flags().DurationVar(&opts.downsampleAfter, "downsample-after", 0, "downsample statistics older than specified age, e.g. 168h (default: 0, disabled)")
+	CommandDefinition.Flags().DurationVar(&opts.downsampleRate, "downsample-rate", time.Minute, "interval between downsampled statistics snapshots (default: 1m)")
+}
+
+// validate validates options passed by user and returns options ready for 'pgcenter convert'. Age of downsampled stats
+// is counted from passed time.
+func (opts options) validate(files []string, now time.Time) (convert.Config, error) {
+	if len(files) == 0 {
+		return convert.Config{}, fmt.Errorf("files to convert are not specified")
+	}
+
+	if opts.keyframe <= 0 {
+		return convert.Config{}, fmt.Errorf("keyframe should be greater than zero")
+	}
+
+	var before time.Time
+	if opts.downsampleAfter < 0 {
+		return convert.Config{}, fmt.Errorf("downsampling age should not be negative")
+	}
+	if opts.downsampleAfter > 0 {
+		if opts.downsampleRate < time.Second {
+			return convert.Config{}, fmt.Errorf("downsampling rate should not be less than 1 second")
+		}
+		before = now.Add(-opts.downsampleAfter)
+	}
+
+	return convert.Config{
+		InputFiles:       files,
+		OutputDir:        opts.outputDir,
+		Keyframe:         opts.keyframe,
+		Workers:          opts.workers,
+		DownsampleBefore: before,
+		DownsampleRate:   opts.downsampleRate,
+	}, nil
+}
@@ -0,0 +1,39 @@
+package convert
+
+import (
+	"github.com/stretchr/testify/assert"
+	"testing"
+	"time"
+)
+
+func Test_options_validate(t *testing.T) {
+	now := time.Date(2021, 1, 30, 12, 0, 0, 0, time.Local)
+
+	testcases := []struct {
+		valid bool
+		opts  options
+		files []string
+	}{
+		{valid: true, opts: options{keyframe: 60}, files: []string{"pgcenter.stat.tar"}},
+		{valid: true, opts: options{keyframe: 60, downsampleAfter: 7 * 24 * time.Hour, downsampleRate: time.Minute}, files: []string{"a.tar", "b.tar"}},
+		{valid: false, opts: options{keyframe: 60}},                                                                                                 // no files
+		{valid: false, opts: options{keyframe: 0}, files: []string{"pgcenter.stat.tar"}},                                                            // empty segments
+		{valid: false, opts: options{keyframe: 60, downsampleAfter: -time.Hour, downsampleRate: time.Minute}, files: []string{"pgcenter.stat.tar"}}, // negative age
+		{valid: false, opts: options{keyframe: 60, downsampleAfter: time.Hour}, files: []string{"pgcenter.stat.tar"}},                               // no rate
+	}
+
+	for _, tc := range testcases {
+		got, err := tc.opts.validate(tc.files, now)
+		if tc.valid {
+			assert.NoError(t, err)
+			assert.Equal(t, tc.files, got.InputFiles)
+			if tc.opts.downsampleAfter > 0 {
+				assert.Equal(t, time.Date(2021, 1, 23, 12, 0, 0, 0, time.Local), got.DownsampleBefore)
+			} else {
+				assert.True(t, got.DownsampleBefore.IsZero())
+			}
+		} else {
+			assert.Error(t, err)
+		}
+	}
+}
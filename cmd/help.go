@@ -5,6 +5,7 @@ package main
 import (
 	"fmt"
 	"github.com/lesovsky/pgcenter/cmd/config"
+	"github.com/lesovsky/pgcenter/cmd/convert"
 	"github.com/lesovsky/pgcenter/cmd/profile"
 	"github.com/lesovsky/pgcenter/cmd/record"
 	"github.com/lesovsky/pgcenter/cmd/report"
@@ -20,6 +21,7 @@ Usage:
 
 Available commands:
   config	%s
+  convert	%s
   profile	%s
   record	%s
   report	%s
@@ -35,6 +37,7 @@ Report bugs to <%s>.
 `,
 		pgcenter.Long,
 		config.CommandDefinition.Short,
+		convert.CommandDefinition.Short,
 		profile.CommandDefinition.Short,
 		record.CommandDefinition.Short,
 		report.CommandDefinition.Short,
@@ -65,6 +68,28 @@ Report bugs to <%s>.
 		programIssuesURL)
 }
 
+func printConvertHelp() string {
+	return fmt.Sprintf(`%s
+
+Usage:
+ pgcenter convert [OPTIONS]... FILE...
+
+Options:
+ -o, --output-dir DIR		write converted files into directory (default: directory of input file)
+     --keyframe INT		number of snapshots between complete snapshots (default: 60)
+     --workers INT		number of workers converting files and segments (default: number of CPUs)
+     --downsample-after DURATION	downsample statistics older than DURATION, e.g. 168h (default: disabled)
+     --downsample-rate DURATION	interval between downsampled snapshots (default: 1m)
+
+General options:
+ -?, --help		show this help and exit
+
+Report bugs to <%s>.
+`,
+		convert.CommandDefinition.Long,
+		programIssuesURL)
+}
+
 func printProfileHelp() string {
 	return fmt.Sprintf(`%s
 
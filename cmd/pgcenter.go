@@ -3,6 +3,7 @@ package main
 import (
 	"fmt"
 	"github.com/lesovsky/pgcenter/cmd/config"
+	"github.com/lesovsky/pgcenter/cmd/convert"
 	"github.com/lesovsky/pgcenter/cmd/profile"
 	"github.com/lesovsky/pgcenter/cmd/record"
 	"github.com/lesovsky/pgcenter/cmd/report"
@@ -33,6 +34,12 @@ func init() {
 	config.CommandDefinition.SetHelpTemplate(printConfigHelp())
 	config.CommandDefinition.SetUsageTemplate(printConfigHelp())
 
+	// Setup 'convert' sub-command
+	pgcenter.AddCommand(convert.CommandDefinition)
+	convert.CommandDefinition.SetVersionTemplate(printVersion())
+	convert.CommandDefinition.SetHelpTemplate(printConvertHelp())
+	convert.CommandDefinition.SetUsageTemplate(printConvertHelp())
+
 	// Setup 'profile' sub-command
 	pgcenter.AddCommand(profile.CommandDefinition)
 	profile.CommandDefinition.SetVersionTemplate(printVersion())
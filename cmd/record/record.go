@@ -55,5 +55,9 @@ func init() {
 	CommandDefinition.Flags().StringVarP(&recordConfig.OutputFile, "file", "f", defaultRecordFile, "file where statistics are saved")
 	CommandDefinition.Flags().BoolVarP(&recordConfig.AppendFile, "append", "a", false, "append statistics to file (default: true)")
 	CommandDefinition.Flags().IntVarP(&recordConfig.StringLimit, "strlimit", "t", 0, "maximum query length to record (default: 0, no limit)")
+	CommandDefinition.Flags().DurationVar(&recordConfig.SyncInterval, "sync-interval", 10*time.Second, "how often recorded statistics are synced to disk (default: 10 seconds)")
+	CommandDefinition.Flags().StringVar(&recordConfig.Format, "format", record.FormatTar, "format of statistics file: tar, binary (default: tar)")
+	CommandDefinition.Flags().BoolVar(&recordConfig.Delta, "delta", false, "store differences between consecutive snapshots, binary format only")
+	CommandDefinition.Flags().IntVar(&recordConfig.Keyframe, "keyframe", 60, "number of snapshots between complete snapshots, binary format only (default: 60)")
 	CommandDefinition.Flags().BoolVarP(&oneshot, "oneshot", "1", false, "append single statistics snapshot to file and exit")
 }
@@ -4,8 +4,10 @@ package report
 
 import (
 	"fmt"
+	"github.com/lesovsky/pgcenter/internal/stat"
 	"github.com/lesovsky/pgcenter/report"
 	"github.com/spf13/cobra"
+	"path/filepath"
 	"regexp"
 	"strings"
 	"time"
@@ -22,18 +24,29 @@ type options struct {
 	showIndexes     bool   // Show stats from pg_stat_user_indexes, pg_statio_user_indexes
 	showSizes       bool   // Show tables sizes
 	showFunctions   bool   // Show stats from pg_stat_user_functions
+	showCpustat     bool   // Show per-CPU stats
 	showStatements  string // Show stats from pg_stat_statements
 	showProgress    string // Show stats from pg_stat_progress_* stats
 
-	inputFile      string        // Input file with statistics
+	inputFiles     []string      // Input files with statistics, optionally labeled as 'label=file'
 	tsStart, tsEnd string        // Show stats within an interval
 	orderColName   string        // Name of the column used for sorting
 	orderDesc      bool          // Specify to use descendant order
 	orderAsc       bool          // Specify to use ascendant order
 	filter         string        // Perform filtering
+	where          string        // Filter expression
 	rowLimit       int           // Number of rows per timestamp
 	strLimit       int           // Trim all strings longer than this limit
 	rate           time.Duration // Stats rate
+	workers        int           // Number of workers decoding and formatting stats
+	outputDir      string        // Directory where reports are written into separate files
+	follow         bool          // Keep reading stats appended by recorder
+	rollup         time.Duration // Length of time windows where deltas are aggregated
+	top            int           // Number of rows with the largest totals
+	topBy          string        // Name of the column used for ranking rows by totals
+	format         string        // Output format
+	compare        []string      // Compared windows
+	compareFile    string        // File with stats of the second compared window
 }
 
 var (
@@ -44,7 +57,12 @@ var (
 		Use:   "report",
 		Short: "make report based on previously saved statistics",
 		Long:  `'pgcenter report' reads statistics from file and prints reports.`,
-		RunE: func(command *cobra.Command, _ []string) error {
+		RunE: func(command *cobra.Command, args []string) error {
+			// The second compared window could be passed as argument: --compare start1..end1 start2..end2
+			if len(opts.compare) > 0 {
+				opts.compare = append(opts.compare, args...)
+			}
+
 			reportOpts, err := opts.validate()
 			if err != nil {
 				return err
@@ -64,26 +82,37 @@ func init() {
 	CommandDefinition.Flags().BoolVarP(&opts.showIndexes, "indexes", "I", false, "show pg_stat_user_indexes and pg_statio_user_indexes report")
 	CommandDefinition.Flags().BoolVarP(&opts.showSizes, "sizes", "S", false, "show tables sizes report")
 	CommandDefinition.Flags().BoolVarP(&opts.showFunctions, "functions", "F", false, "show pg_stat_user_functions report")
+	CommandDefinition.Flags().BoolVarP(&opts.showCpustat, "cpustat", "U", false, "show per-CPU stats report")
 	CommandDefinition.Flags().StringVarP(&opts.showStatements, "statements", "X", "", "show pg_stat_statements report")
 	CommandDefinition.Flags().StringVarP(&opts.showProgress, "progress", "P", "", "show pg_stat_progress_* report")
 
-	CommandDefinition.Flags().StringVarP(&opts.inputFile, "file", "f", "pgcenter.stat.tar", "read stats from file")
+	CommandDefinition.Flags().StringArrayVarP(&opts.inputFiles, "file", "f", []string{"pgcenter.stat.tar"}, "read stats from file, repeat to merge files of several hosts (format: [label=]file)")
 	CommandDefinition.Flags().StringVarP(&opts.tsStart, "start", "s", "", "starting time of the report")
 	CommandDefinition.Flags().StringVarP(&opts.tsEnd, "end", "e", "", "ending time of the report")
 	CommandDefinition.Flags().StringVarP(&opts.orderColName, "order", "o", "", "sort values by column using descendant order")
 	CommandDefinition.Flags().BoolVarP(&opts.orderDesc, "desc", "", true, "sort values by column using descendant order")
 	CommandDefinition.Flags().BoolVarP(&opts.orderAsc, "asc", "", false, "sort values by column using ascendant order")
 	CommandDefinition.Flags().StringVarP(&opts.filter, "grep", "g", "", "grep values in specified column (format: colname:filter_pattern)")
+	CommandDefinition.Flags().StringVarP(&opts.where, "where", "w", "", "filter rows using expression (e.g. \"datname = app AND calls > 100\")")
 	CommandDefinition.Flags().IntVarP(&opts.rowLimit, "limit", "l", 0, "print only limited number of rows per sample")
 	CommandDefinition.Flags().IntVarP(&opts.strLimit, "strlimit", "t", 32, "maximum string size for long lines to print (default: 32)")
 	CommandDefinition.Flags().DurationVarP(&opts.rate, "rate", "r", time.Second, "statistics changes rate interval (default: 1s)")
+	CommandDefinition.Flags().StringVarP(&opts.outputDir, "output-dir", "", "", "write reports into separate files in specified directory")
+	CommandDefinition.Flags().BoolVarP(&opts.follow, "follow", "", false, "keep reading statistics appended to the file by running recorder")
+	CommandDefinition.Flags().DurationVarP(&opts.rollup, "rollup", "", 0, "aggregate deltas in time windows of specified length and print min, max, avg and percentiles")
+	CommandDefinition.Flags().IntVarP(&opts.top, "top", "", 0, "print only specified number of rows with the largest totals over the whole interval (requires --by)")
+	CommandDefinition.Flags().StringVarP(&opts.topBy, "by", "", "", "name of the column which totals are used for --top ranking")
+	CommandDefinition.Flags().StringVarP(&opts.format, "format", "", "table", "output format: table, csv or jsonl")
+	CommandDefinition.Flags().StringArrayVarP(&opts.compare, "compare", "", nil, "compare rates in two windows (format: start1..end1 start2..end2)")
+	CommandDefinition.Flags().StringVarP(&opts.compareFile, "compare-file", "", "", "read stats of the second compared window from specified file")
+	CommandDefinition.Flags().IntVarP(&opts.workers, "workers", "", 0, "number of workers decoding and formatting statistics (default: number of CPUs)")
 }
 
 // validate parses and validates options passed by user and returns options ready for 'pgcenter report'.
 func (opts options) validate() (report.Config, error) {
-	// Select report type
-	r := selectReport(opts)
-	if r == "" {
+	// Select report types
+	reports := selectReports(opts)
+	if len(reports) == 0 {
 		return report.Config{}, fmt.Errorf("report type is not specified, quit")
 	}
 
@@ -98,8 +127,68 @@ func (opts options) validate() (report.Config, error) {
 		return report.Config{}, err
 	}
 
-	// Compile regexp if specified.
-	colname, re, err := parseFilterString(opts.filter)
+	// Rollup windows shorter than rate would contain single delta.
+	if opts.rollup < 0 || (opts.rollup > 0 && opts.rollup < opts.rate) {
+		return report.Config{}, fmt.Errorf("rollup interval should not be less than rate interval")
+	}
+
+	// Totals are printed when all stats are read.
+	if opts.top < 0 || (opts.top > 0) != (opts.topBy != "") {
+		return report.Config{}, fmt.Errorf("--top and --by should be specified together")
+	}
+	if opts.top > 0 && (opts.follow || opts.rollup > 0) {
+		return report.Config{}, fmt.Errorf("--top can't be used with --follow or --rollup")
+	}
+
+	// Exported reports are not aligned, reports of several types can't be exported at once.
+	format, err := parseFormat(opts.format)
+	if err != nil {
+		return report.Config{}, err
+	}
+	if format != "" && len(reports) > 1 && opts.outputDir == "" {
+		return report.Config{}, fmt.Errorf("exporting several reports requires --output-dir")
+	}
+
+	// Compared windows are printed when all stats are read.
+	compare, err := parseCompareWindows(opts.compare, opts.compareFile)
+	if err != nil {
+		return report.Config{}, err
+	}
+	if compare != nil {
+		if opts.follow || opts.rollup > 0 || opts.top > 0 {
+			return report.Config{}, fmt.Errorf("--compare can't be used with --follow, --rollup or --top")
+		}
+		tsStart, tsEnd = compare[0].Start, compare[1].End
+		if opts.compareFile == "" && compare[1].Start.Before(compare[0].Start) {
+			tsStart, tsEnd = compare[1].Start, compare[0].End
+		}
+	}
+
+	// When following, reports of several types can't be printed at once, and stats are not limited by current time.
+	if opts.follow {
+		if len(reports) > 1 && opts.outputDir == "" {
+			return report.Config{}, fmt.Errorf("following several reports requires --output-dir")
+		}
+		if opts.tsEnd == "" {
+			tsEnd = time.Date(9999, 12, 31, 23, 59, 59, 0, time.Local)
+		}
+	}
+
+	// Files of several hosts are merged by time, stats of every host are diffed separately.
+	files, hosts, err := parseInputFiles(opts.inputFiles)
+	if err != nil {
+		return report.Config{}, err
+	}
+	if len(files) > 1 && (opts.follow || opts.rollup > 0 || opts.top > 0 || compare != nil) {
+		return report.Config{}, fmt.Errorf("several --file can't be used with --follow, --rollup, --top or --compare")
+	}
+	var inputFile string
+	if len(files) > 0 {
+		inputFile = files[0]
+	}
+
+	// Parse filters if specified.
+	filter, err := parseFilters(opts.filter, opts.where)
 	if err != nil {
 		return report.Config{}, err
 	}
@@ -111,63 +200,89 @@ func (opts options) validate() (report.Config, error) {
 	}
 
 	return report.Config{
-		Describe:      opts.describe,
-		ReportType:    r,
-		InputFile:     opts.inputFile,
-		TsStart:       tsStart,
-		TsEnd:         tsEnd,
-		OrderColName:  opts.orderColName,
-		OrderDesc:     desc,
-		FilterColName: colname,
-		FilterRE:      re,
-		RowLimit:      opts.rowLimit,
-		TruncLimit:    opts.strLimit,
-		Rate:          opts.rate,
+		Describe:     opts.describe,
+		ReportType:   reports[0],
+		ReportTypes:  reports,
+		OutputDir:    opts.outputDir,
+		InputFile:    inputFile,
+		InputFiles:   files,
+		Hosts:        hosts,
+		TsStart:      tsStart,
+		TsEnd:        tsEnd,
+		OrderColName: opts.orderColName,
+		OrderDesc:    desc,
+		Filter:       filter,
+		RowLimit:     opts.rowLimit,
+		TruncLimit:   opts.strLimit,
+		Rate:         opts.rate,
+		Workers:      opts.workers,
+		Follow:       opts.follow,
+		Rollup:       opts.rollup,
+		Top:          opts.top,
+		TopBy:        opts.topBy,
+		Format:       format,
+		Compare:      compare,
+		CompareFile:  opts.compareFile,
 	}, nil
 }
 
-// selectReport selects appropriate type of the report depending on user's choice.
-func selectReport(opts options) string {
-	switch {
-	case opts.showActivity:
-		return "activity"
-	case opts.showReplication:
-		return "replication"
-	case opts.showDatabases:
-		return "databases"
-	case opts.showTables:
-		return "tables"
-	case opts.showIndexes:
-		return "indexes"
-	case opts.showFunctions:
-		return "functions"
-	case opts.showSizes:
-		return "sizes"
-	case opts.showStatements != "":
-		switch opts.showStatements {
-		case "m":
-			return "statements_timings"
-		case "g":
-			return "statements_general"
-		case "i":
-			return "statements_io"
-		case "t":
-			return "statements_temp"
-		case "l":
-			return "statements_local"
+// selectReports selects types of reports depending on user's choice. Several types of statements reports could be
+// selected using several letters.
+func selectReports(opts options) []string {
+	var reports []string
+
+	if opts.showActivity {
+		reports = append(reports, "activity")
+	}
+	if opts.showReplication {
+		reports = append(reports, "replication")
+	}
+	if opts.showDatabases {
+		reports = append(reports, "databases")
+	}
+	if opts.showTables {
+		reports = append(reports, "tables")
+	}
+	if opts.showIndexes {
+		reports = append(reports, "indexes")
+	}
+	if opts.showFunctions {
+		reports = append(reports, "functions")
+	}
+	if opts.showSizes {
+		reports = append(reports, "sizes")
+	}
+	if opts.showCpustat {
+		reports = append(reports, "cpustat")
+	}
+
+	for _, c := range opts.showStatements {
+		switch c {
+		case 'm':
+			reports = append(reports, "statements_timings")
+		case 'g':
+			reports = append(reports, "statements_general")
+		case 'i':
+			reports = append(reports, "statements_io")
+		case 't':
+			reports = append(reports, "statements_temp")
+		case 'l':
+			reports = append(reports, "statements_local")
 		}
-	case opts.showProgress != "":
-		switch opts.showProgress {
-		case "v":
-			return "progress_vacuum"
-		case "c":
-			return "progress_cluster"
-		case "i":
-			return "progress_index"
+	}
+
+	for _, c := range opts.showProgress {
+		switch c {
+		case 'v':
+			reports = append(reports, "progress_vacuum")
+		case 'c':
+			reports = append(reports, "progress_cluster")
+		case 'i':
+			reports = append(reports, "progress_index")
 		}
 	}
 
-	return ""
+	return reports
 }
 
 // setReportInterval parses user-defined timestamp and returns start/end time.Times for report.
@@ -253,6 +368,121 @@ func parseTimepart(s string) (time.Time, error) {
 	return time.Time{}, fmt.Errorf("invalid date/time: %s", s)
 }
 
+// parseCompareWindows parses compared windows in format 'start..end'. Windows read from the same file should not
+// overlap.
+func parseCompareWindows(values []string, file string) ([]report.Window, error) {
+	if len(values) == 0 {
+		if file != "" {
+			return nil, fmt.Errorf("--compare-file requires --compare")
+		}
+		return nil, nil
+	}
+
+	if len(values) != 2 {
+		return nil, fmt.Errorf("--compare requires two windows")
+	}
+
+	windows := make([]report.Window, 2)
+	for i, value := range values {
+		parts := strings.Split(value, "..")
+		if len(parts) != 2 {
+			return nil, fmt.Errorf("invalid window '%s', use format start..end", value)
+		}
+
+		start, err := parseTimestamp(parts[0])
+		if err != nil {
+			return nil, err
+		}
+		end, err := parseTimestamp(parts[1])
+		if err != nil {
+			return nil, err
+		}
+		if !start.Before(end) {
+			return nil, fmt.Errorf("invalid window '%s', start should be before end", value)
+		}
+
+		windows[i] = report.Window{Start: start, End: end}
+	}
+
+	if file == "" && !windows[0].End.Before(windows[1].Start) && !windows[1].End.Before(windows[0].Start) {
+		return nil, fmt.Errorf("compared windows overlap")
+	}
+
+	return windows, nil
+}
+
+// parseInputFiles parses input files in format '[label=]file' and returns files and labels of their hosts. When label
+// is not specified, the name of the file up to the first dot is used.
+func parseInputFiles(values []string) ([]string, []string, error) {
+	if len(values) == 0 {
+		return nil, nil, nil
+	}
+
+	files := make([]string, len(values))
+	hosts := make([]string, len(values))
+	seen := map[string]bool{}
+
+	for i, value := range values {
+		label, file := "", value
+		if parts := strings.SplitN(value, "=", 2); len(parts) == 2 {
+			label, file = parts[0], parts[1]
+			if label == "" {
+				return nil, nil, fmt.Errorf("invalid input file '%s', empty label", value)
+			}
+		}
+		if file == "" {
+			return nil, nil, fmt.Errorf("invalid input file '%s', empty file name", value)
+		}
+
+		if label == "" {
+			label = strings.SplitN(filepath.Base(file), ".", 2)[0]
+		}
+		if seen[label] {
+			return nil, nil, fmt.Errorf("duplicate label '%s' of input file '%s', specify labels explicitly", label, value)
+		}
+		seen[label] = true
+
+		files[i], hosts[i] = file, label
+	}
+
+	return files, hosts, nil
+}
+
+// parseFormat validates output format, aligned table is defined by empty string.
+func parseFormat(format string) (string, error) {
+	switch format {
+	case "", "table":
+		return "", nil
+	case "csv", "jsonl":
+		return format, nil
+	default:
+		return "", fmt.Errorf("unknown output format '%s', use table, csv or jsonl", format)
+	}
+}
+
+// parseFilters parses grep pattern and filter expression, and joins them into single filter expression.
+func parseFilters(grep string, where string) (*stat.FilterExpr, error) {
+	colname, re, err := parseFilterString(grep)
+	if err != nil {
+		return nil, err
+	}
+
+	var filter *stat.FilterExpr
+	if colname != "" {
+		filter = stat.NewMatchFilter(colname, re)
+	}
+
+	if where != "" {
+		expr, err := stat.ParseFilter(where)
+		if err != nil {
+			return nil, err
+		}
+		filter = filter.And(expr)
+	}
+
+	return filter, nil
+}
+
 // parseFilterString parses and defines filtering options. Split a value entered by user to column name and filter pattern.
 func parseFilterString(filter string) (string, *regexp.Regexp, error) {
 	if filter == "" {
@@ -18,6 +18,25 @@ func Test_options_validate(t *testing.T) {
 		{valid: false, opts: options{tsStart: "2021-01-01 12:00:00", tsEnd: "2021-01-01 13:00:00", rate: time.Second}}, // no report type specified
 		{valid: false, opts: options{showActivity: true, tsStart: "2021-01-32", rate: time.Second}},                    // invalid report start timestamp
 		{valid: false, opts: options{showActivity: true, filter: `colname:"["`, rate: time.Second}},                    // invalid regexp
+		{valid: false, opts: options{showActivity: true, where: `state = active AND`, rate: time.Second}},              // invalid filter expression
+		{valid: true, opts: options{showActivity: true, follow: true, rate: time.Second}},
+		{valid: true, opts: options{showActivity: true, showTables: true, follow: true, outputDir: "/tmp", rate: time.Second}},
+		{valid: false, opts: options{showActivity: true, showTables: true, follow: true, rate: time.Second}}, // several reports to stdout
+		{valid: true, opts: options{showDatabases: true, rollup: 5 * time.Minute, rate: time.Second}},
+		{valid: false, opts: options{showDatabases: true, rollup: 500 * time.Millisecond, rate: time.Second}}, // rollup shorter than rate
+		{valid: true, opts: options{showTables: true, top: 10, topBy: "seq_scan", rate: time.Second}},
+		{valid: false, opts: options{showTables: true, top: 10, rate: time.Second}},                                  // no ranking column
+		{valid: false, opts: options{showTables: true, topBy: "seq_scan", rate: time.Second}},                        // no number of rows
+		{valid: false, opts: options{showTables: true, top: 10, topBy: "seq_scan", follow: true, rate: time.Second}}, // totals can't be followed
+		{valid: true, opts: options{showTables: true, format: "csv", rate: time.Second}},
+		{valid: true, opts: options{showTables: true, showIndexes: true, format: "jsonl", outputDir: "/tmp", rate: time.Second}},
+		{valid: false, opts: options{showTables: true, format: "xml", rate: time.Second}},                    // unknown format
+		{valid: false, opts: options{showTables: true, showIndexes: true, format: "csv", rate: time.Second}}, // several reports to stdout
+		{valid: true, opts: options{showTables: true, compare: []string{"2021-01-01 12:00:00..2021-01-01 13:00:00", "2021-01-02 12:00:00..2021-01-02 13:00:00"}, rate: time.Second}},
+		{valid: false, opts: options{showTables: true, compare: []string{"2021-01-01 12:00:00..2021-01-01 13:00:00", "2021-01-02 12:00:00..2021-01-02 13:00:00"}, top: 5, topBy: "seq_scan", rate: time.Second}},
+		{valid: true, opts: options{showDatabases: true, inputFiles: []string{"primary.stat.tar", "replica.stat.tar"}, rate: time.Second}},
+		{valid: false, opts: options{showDatabases: true, inputFiles: []string{"primary.stat.tar", "replica.stat.tar"}, follow: true, rate: time.Second}}, // several files can't be followed
+		{valid: false, opts: options{showDatabases: true, inputFiles: []string{"a/host.stat.tar", "b/host.stat.tar"}, rate: time.Second}},                 // duplicate labels
 	}
 
 	for _, tc := range testcases {
@@ -31,31 +50,37 @@ func Test_options_validate(t *testing.T) {
 	}
 }
 
-func Test_selectReport(t *testing.T) {
+func Test_selectReports(t *testing.T) {
 	testcases := []struct {
 		opts options
-		want string
+		want []string
 	}{
-		{opts: options{showActivity: true}, want: "activity"},
-		{opts: options{showReplication: true}, want: "replication"},
-		{opts: options{showDatabases: true}, want: "databases"},
-		{opts: options{showTables: true}, want: "tables"},
-		{opts: options{showIndexes: true}, want: "indexes"},
-		{opts: options{showFunctions: true}, want: "functions"},
-		{opts: options{showSizes: true}, want: "sizes"},
-		{opts: options{showStatements: "m"}, want: "statements_timings"},
-		{opts: options{showStatements: "g"}, want: "statements_general"},
-		{opts: options{showStatements: "i"}, want: "statements_io"},
-		{opts: options{showStatements: "t"}, want: "statements_temp"},
-		{opts: options{showStatements: "l"}, want: "statements_local"},
-		{opts: options{showProgress: "v"}, want: "progress_vacuum"},
-		{opts: options{showProgress: "c"}, want: "progress_cluster"},
-		{opts: options{showProgress: "i"}, want: "progress_index"},
-		{opts: options{}, want: ""},
+		{opts: options{showActivity: true}, want: []string{"activity"}},
+		{opts: options{showReplication: true}, want: []string{"replication"}},
+		{opts: options{showDatabases: true}, want: []string{"databases"}},
+		{opts: options{showTables: true}, want: []string{"tables"}},
+		{opts: options{showIndexes: true}, want: []string{"indexes"}},
+		{opts: options{showFunctions: true}, want: []string{"functions"}},
+		{opts: options{showSizes: true}, want: []string{"sizes"}},
+		{opts: options{showCpustat: true}, want: []string{"cpustat"}},
+		{opts: options{showStatements: "m"}, want: []string{"statements_timings"}},
+		{opts: options{showStatements: "g"}, want: []string{"statements_general"}},
+		{opts: options{showStatements: "i"}, want: []string{"statements_io"}},
+		{opts: options{showStatements: "t"}, want: []string{"statements_temp"}},
+		{opts: options{showStatements: "l"}, want: []string{"statements_local"}},
+		{opts: options{showProgress: "v"}, want: []string{"progress_vacuum"}},
+		{opts: options{showProgress: "c"}, want: []string{"progress_cluster"}},
+		{opts: options{showProgress: "i"}, want: []string{"progress_index"}},
+		{
+			opts: options{showDatabases: true, showTables: true, showStatements: "mg", showProgress: "v"},
+			want: []string{"databases", "tables", "statements_timings", "statements_general", "progress_vacuum"},
+		},
+		{opts: options{showStatements: "x"}, want: nil},
+		{opts: options{}, want: nil},
 	}
 
 	for _, tc := range testcases {
-		assert.Equal(t, tc.want, selectReport(tc.opts))
+		assert.Equal(t, tc.want, selectReports(tc.opts))
 	}
 }
 
@@ -179,6 +204,91 @@ func Test_parseTimepart(t *testing.T) {
 	}
 }
 
+func Test_parseFilters(t *testing.T) {
+	testcases := []struct {
+		valid  bool
+		grep   string
+		where  string
+		isNull bool
+	}{
+		{valid: true, isNull: true},
+		{valid: true, grep: "query:UPDATE"},
+		{valid: true, where: "state = active"},
+		{valid: true, grep: "query:UPDATE", where: "state = active"},
+		{valid: false, grep: "query:["},
+		{valid: false, where: "state active"},
+	}
+
+	for _, tc := range testcases {
+		got, err := parseFilters(tc.grep, tc.where)
+		if tc.valid {
+			assert.NoError(t, err)
+			assert.Equal(t, tc.isNull, got == nil)
+		} else {
+			assert.Error(t, err)
+		}
+	}
+}
+
+func Test_parseCompareWindows(t *testing.T) {
+	testcases := []struct {
+		valid  bool
+		values []string
+		file   string
+	}{
+		{valid: true},
+		{valid: true, values: []string{"2021-01-01 12:00:00..2021-01-01 13:00:00", "2021-01-02 12:00:00..2021-01-02 13:00:00"}},
+		{valid: true, values: []string{"2021-01-02 12:00:00..2021-01-02 13:00:00", "2021-01-01 12:00:00..2021-01-01 13:00:00"}},
+		{valid: true, values: []string{"2021-01-01 12:00:00..2021-01-01 13:00:00", "2021-01-01 12:30:00..2021-01-01 13:30:00"}, file: "second.stat"},
+		{valid: false, values: []string{"2021-01-01 12:00:00..2021-01-01 13:00:00", "2021-01-01 12:30:00..2021-01-01 13:30:00"}}, // overlapping windows
+		{valid: false, values: []string{"2021-01-01 12:00:00..2021-01-01 13:00:00"}},                                             // single window
+		{valid: false, values: []string{"2021-01-01 12:00:00", "2021-01-02 12:00:00..2021-01-02 13:00:00"}},                      // no end
+		{valid: false, values: []string{"2021-01-01 13:00:00..2021-01-01 12:00:00", "2021-01-02 12:00:00..2021-01-02 13:00:00"}}, // end before start
+		{valid: false, values: []string{"2021-01-01 12:00:00..invalid", "2021-01-02 12:00:00..2021-01-02 13:00:00"}},
+		{valid: false, file: "second.stat"},
+	}
+
+	for _, tc := range testcases {
+		got, err := parseCompareWindows(tc.values, tc.file)
+		if tc.valid {
+			assert.NoError(t, err)
+			assert.Equal(t, len(tc.values), len(got))
+		} else {
+			assert.Error(t, err)
+		}
+	}
+}
+
+func Test_parseInputFiles(t *testing.T) {
+	testcases := []struct {
+		valid  bool
+		values []string
+		files  []string
+		hosts  []string
+	}{
+		{valid: true, values: []string{"pgcenter.stat.tar"}, files: []string{"pgcenter.stat.tar"}, hosts: []string{"pgcenter"}},
+		{
+			valid: true, values: []string{"/tmp/primary.stat.tar", "replica=/tmp/standby.stat.tar"},
+			files: []string{"/tmp/primary.stat.tar", "/tmp/standby.stat.tar"}, hosts: []string{"primary", "replica"},
+		},
+		{valid: false, values: []string{"a/host.stat.tar", "b/host.stat.tar"}}, // duplicate labels
+		{valid: false, values: []string{"=host.stat.tar"}},                     // empty label
+		{valid: false, values: []string{"host="}},                              // empty file
+		{valid: true},
+	}
+
+	for _, tc := range testcases {
+		files, hosts, err := parseInputFiles(tc.values)
+		if tc.valid {
+			assert.NoError(t, err)
+			assert.Equal(t, tc.files, files)
+			assert.Equal(t, tc.hosts, hosts)
+		} else {
+			assert.Error(t, err)
+		}
+	}
+}
+
 func Test_parseFilterString(t *testing.T) {
 	testcases := []struct {
 		valid       bool
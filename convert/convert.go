@@ -0,0 +1,315 @@
+// 'pgcenter convert' - rewrites recorded statistics into binary snapshot format.
+
+package convert
+
+import (
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/index"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
+	"github.com/lesovsky/pgcenter/internal/view"
+	"io"
+	"os"
+	"path/filepath"
+	"runtime"
+	"strings"
+	"sync"
+	"time"
+)
+
+// Config defines config container for configuring 'pgcenter convert'.
+type Config struct {
+	InputFiles       []string      // Files with recorded statistics
+	OutputDir        string        // Directory where converted files are written, directory of input file if empty
+	Keyframe         int           // Number of snapshots in a segment of converted file
+	Workers          int           // Number of workers encoding segments
+	DownsampleBefore time.Time     // Snapshots recorded before this time are downsampled, disabled if zero
+	DownsampleRate   time.Duration // Interval between downsampled snapshots
+}
+
+// defaultKeyframe defines default number of snapshots in a segment, the same as used by recorder.
+const defaultKeyframe = 60
+
+// outputExt defines extension of converted files.
+const outputExt = ".bin"
+
+// RunMain is the 'pgcenter convert' main entry point.
+func RunMain(c Config) error {
+	if c.Keyframe <= 0 {
+		c.Keyframe = defaultKeyframe
+	}
+	if c.Workers <= 0 {
+		c.Workers = runtime.NumCPU()
+	}
+
+	results := convertFiles(c)
+
+	var failed int
+	for i, r := range results {
+		if r.err != nil {
+			fmt.Printf("ERROR: convert %s failed: %s\n", c.InputFiles[i], r.err)
+			failed++
+			continue
+		}
+
+		fmt.Printf("INFO: converted %s to %s: %d snapshots, %d rows, %d snapshots dropped by downsampling, %d -> %d bytes\n",
+			c.InputFiles[i], r.output, r.totals.snapshots, r.totals.rows, r.dropped, r.inputSize, r.outputSize,
+		)
+	}
+
+	if failed > 0 {
+		return fmt.Errorf("%d of %d files failed", failed, len(results))
+	}
+
+	return nil
+}
+
+// convertResult describes result of converting a single file.
+type convertResult struct {
+	output     string // name of converted file
+	totals     totals // totals of written snapshots, verified by reading converted file
+	dropped    int    // number of snapshots dropped by downsampling
+	inputSize  int64
+	outputSize int64 // size of converted file and its index
+	err        error
+}
+
+// convertFiles converts files in parallel. Segments of all files are encoded by the shared pool of workers, number of
+// files converted at once is limited by the number of workers.
+func convertFiles(c Config) []convertResult {
+	jobs := make(chan *segment)
+	var wg sync.WaitGroup
+	for i := 0; i < c.Workers; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			encodeSegments(jobs)
+		}()
+	}
+
+	results := make([]convertResult, len(c.InputFiles))
+	sem := make(chan struct{}, c.Workers)
+	var fwg sync.WaitGroup
+	for i := range c.InputFiles {
+		fwg.Add(1)
+		sem <- struct{}{}
+		go func(i int) {
+			defer func() { <-sem; fwg.Done() }()
+			results[i] = convertFile(c.InputFiles[i], outputName(c.InputFiles[i], c.OutputDir), c, jobs)
+		}(i)
+	}
+
+	fwg.Wait()
+	close(jobs)
+	wg.Wait()
+
+	return results
+}
+
+// outputName returns name of converted file: '.tar' extension of input file is replaced with '.bin'.
+func outputName(input string, dir string) string {
+	name := strings.TrimSuffix(input, ".tar") + outputExt
+	if dir != "" {
+		name = filepath.Join(dir, filepath.Base(name))
+	}
+	return name
+}
+
+// convertFile reads snapshots of input file, splits them into segments, sends segments to encoding workers and writes
+// encoded segments into output file in order of reading. When all segments are written, output file is read again
+// and its snapshots are verified against snapshots of the input file. Output file is removed if conversion fails.
+func convertFile(input, output string, c Config, jobs chan<- *segment) (r convertResult) {
+	r.output = output
+
+	in, err := os.Open(filepath.Clean(input))
+	if err != nil {
+		r.err = err
+		return r
+	}
+	defer func() { _ = in.Close() }()
+
+	st, err := in.Stat()
+	if err != nil {
+		r.err = err
+		return r
+	}
+	r.inputSize = st.Size()
+
+	src, err := newSource(in)
+	if err != nil {
+		r.err = fmt.Errorf("%s: %s", input, err)
+		return r
+	}
+
+	// Existing files are never overwritten.
+	out, err := os.OpenFile(filepath.Clean(output), os.O_CREATE|os.O_EXCL|os.O_WRONLY, 0600)
+	if err != nil {
+		r.err = err
+		return r
+	}
+
+	defer func() {
+		if r.err != nil {
+			_ = os.Remove(output)
+			_ = os.Remove(index.Filename(output))
+		}
+	}()
+
+	idx, err := index.Open(index.Filename(output), 0, false)
+	if err != nil {
+		_ = out.Close()
+		r.err = err
+		return r
+	}
+
+	want, err := writeSegments(src, out, idx, c, jobs, &r.dropped)
+
+	if cerr := idx.Close(); err == nil {
+		err = cerr
+	}
+	if cerr := out.Sync(); err == nil {
+		err = cerr
+	}
+	if cerr := out.Close(); err == nil {
+		err = cerr
+	}
+	if err != nil {
+		r.err = err
+		return r
+	}
+
+	r.totals, r.err = verifyFile(output, want)
+	if r.err != nil {
+		return r
+	}
+
+	for _, name := range []string{output, index.Filename(output)} {
+		st, err := os.Stat(name)
+		if err != nil {
+			r.err = err
+			return r
+		}
+		r.outputSize += st.Size()
+	}
+
+	return r
+}
+
+// writeSegments reads snapshots from the source in segments and writes encoded segments into output file and its time
+// index. Returns totals of written snapshots.
+func writeSegments(src source, out *os.File, idx *index.Writer, c Config, jobs chan<- *segment, dropped *int) (totals, error) {
+	_, err := out.Write([]byte(snapshot.Magic))
+	if err != nil {
+		return totals{}, err
+	}
+	offset := int64(len(snapshot.Magic))
+
+	// Segments are queued in order of reading, the queue limits number of segments kept in memory.
+	queue := make(chan *segment, 2*c.Workers)
+	done := make(chan struct{})
+	errc := make(chan error, 1)
+	go func() {
+		defer close(queue)
+		errc <- readSegments(src, c, queue, jobs, done, dropped)
+	}()
+
+	defer func() {
+		close(done)
+		for range queue {
+		}
+	}()
+
+	var sum totals
+	for s := range queue {
+		<-s.done
+		if s.err != nil {
+			return totals{}, s.err
+		}
+
+		for _, e := range s.index {
+			e.Offset += offset
+			err = idx.Add(e)
+			if err != nil {
+				return totals{}, err
+			}
+		}
+
+		n, err := out.Write(s.buf.Bytes())
+		if err != nil {
+			return totals{}, err
+		}
+		offset += int64(n)
+		sum.add(s.totals)
+	}
+
+	err = <-errc
+	if err != nil {
+		return totals{}, err
+	}
+
+	return sum, nil
+}
+
+// readSegments reads snapshots from the source, drops snapshots which should be downsampled and groups snapshots into
+// segments of configured number of distinct timestamps. Every segment is sent into the queue and then to workers.
+func readSegments(src source, c Config, queue chan<- *segment, jobs chan<- *segment, done <-chan struct{}, dropped *int) error {
+	ukeys := map[string]int{}
+	for name, v := range view.New() {
+		ukeys[name] = v.UniqueKey
+	}
+
+	kept := map[string]time.Time{} // the last downsampling interval where snapshot of the view has been kept
+	var s *segment
+	var last time.Time
+	var stamps int
+
+	send := func() bool {
+		if s == nil {
+			return true
+		}
+		for _, ch := range []chan<- *segment{queue, jobs} {
+			select {
+			case ch <- s:
+			case <-done:
+				return false
+			}
+		}
+		s = nil
+		return true
+	}
+
+	for {
+		e, err := src.next()
+		if err == io.EOF {
+			send()
+			return nil
+		}
+		if err != nil {
+			return err
+		}
+
+		if !c.DownsampleBefore.IsZero() && e.ts.Before(c.DownsampleBefore) {
+			bucket := e.ts.Truncate(c.DownsampleRate)
+			if k, ok := kept[e.name]; ok && k.Equal(bucket) {
+				*dropped++
+				continue
+			}
+			kept[e.name] = bucket
+		}
+
+		if !e.ts.Equal(last) {
+			last = e.ts
+			stamps++
+			if stamps > c.Keyframe {
+				if !send() {
+					return nil
+				}
+				stamps = 1
+			}
+		}
+
+		if s == nil {
+			s = newSegment(ukeys)
+		}
+		s.entries = append(s.entries, e)
+	}
+}
@@ -0,0 +1,209 @@
+package convert
+
+import (
+	"archive/tar"
+	"bytes"
+	"database/sql"
+	"encoding/json"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/index"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"strconv"
+	"testing"
+	"time"
+)
+
+// testStart defines time of the first snapshot of test archive.
+var testStart = time.Date(2021, 1, 23, 15, 31, 0, 0, time.Local)
+
+// newTestResult creates snapshot of the view recorded with passed number.
+func newTestResult(name string, n int) stat.PGresult {
+	values := make([][]sql.NullString, 3)
+	for i := range values {
+		values[i] = []sql.NullString{
+			{String: name + strconv.Itoa(i), Valid: true},
+			{String: strconv.Itoa(n * (i + 1) * 10), Valid: true},
+			{String: strconv.FormatFloat(float64(n)/4, 'f', 2, 64), Valid: i != 1},
+		}
+	}
+	return stat.NewPGresultFromValues([]string{"name", "calls", "time"}, values)
+}
+
+// writeTestArchive writes tar archive with snapshots of two views recorded every second, the same way as recorder does.
+func writeTestArchive(t *testing.T, filename string, count int) {
+	f, err := os.Create(filename)
+	assert.NoError(t, err)
+
+	w := tar.NewWriter(f)
+	for n := 0; n < count; n++ {
+		ts := testStart.Add(time.Duration(n) * time.Second)
+		for _, name := range []string{"databases", "functions"} {
+			data, err := json.Marshal(newTestResult(name, n))
+			assert.NoError(t, err)
+			filename := fmt.Sprintf("%s.%s.json", name, ts.Format("20060102T150405"))
+			assert.NoError(t, w.WriteHeader(&tar.Header{Name: filename, Mode: 0644, Size: int64(len(data)), ModTime: ts}))
+			_, err = w.Write(data)
+			assert.NoError(t, err)
+		}
+	}
+	assert.NoError(t, w.Close())
+	assert.NoError(t, f.Close())
+}
+
+// readTestSnapshots reads all snapshots of converted file.
+func readTestSnapshots(t *testing.T, filename string) ([]string, []time.Time, []stat.PGresult) {
+	f, err := os.Open(filename)
+	assert.NoError(t, err)
+	defer func() { _ = f.Close() }()
+
+	r, err := snapshot.NewReader(f)
+	assert.NoError(t, err)
+
+	var names []string
+	var stamps []time.Time
+	var results []stat.PGresult
+	for {
+		name, ts, err := r.Next()
+		if err == io.EOF {
+			break
+		}
+		assert.NoError(t, err)
+
+		var res stat.PGresult
+		assert.NoError(t, r.Read(&res))
+		names, stamps, results = append(names, name), append(stamps, ts), append(results, res)
+	}
+
+	return names, stamps, results
+}
+
+func Test_convertFiles(t *testing.T) {
+	dir, err := ioutil.TempDir("", "pgcenter-convert-testing")
+	assert.NoError(t, err)
+	defer func() { _ = os.RemoveAll(dir) }()
+
+	input := filepath.Join(dir, "pgcenter.stat.tar")
+	writeTestArchive(t, input, 10)
+
+	// Segments are encoded by several workers.
+	c := Config{InputFiles: []string{input}, Keyframe: 3, Workers: 4}
+	results := convertFiles(c)
+	assert.Len(t, results, 1)
+	assert.NoError(t, results[0].err)
+
+	output := filepath.Join(dir, "pgcenter.stat.bin")
+	assert.Equal(t, output, results[0].output)
+	assert.Equal(t, totals{snapshots: 20, rows: 60, sum: results[0].totals.sum}, results[0].totals)
+	assert.Greater(t, results[0].outputSize, int64(0))
+
+	// Converted snapshots are the same as recorded ones, and are in the same order.
+	names, stamps, got := readTestSnapshots(t, output)
+	assert.Len(t, got, 20)
+	for i := range got {
+		n := i / 2
+		assert.Equal(t, testStart.Add(time.Duration(n)*time.Second).UnixNano(), stamps[i].UnixNano())
+
+		want := newTestResult(names[i], n)
+		assert.Equal(t, want.Cols, got[i].Cols)
+		assert.Equal(t, want.Nrows, got[i].Nrows)
+		for row := 0; row < want.Nrows; row++ {
+			for col := range want.Cols {
+				assert.Equal(t, want.Value(row, col), got[i].Value(row, col))
+			}
+		}
+	}
+
+	// Time index refers to beginning of segments.
+	st, err := os.Stat(output)
+	assert.NoError(t, err)
+	offset, err := index.Lookup(index.Filename(output), "functions", testStart.Add(4*time.Second), st.Size())
+	assert.NoError(t, err)
+	assert.Greater(t, offset, int64(len(snapshot.Magic)))
+
+	// Output doesn't depend on number of workers.
+	dir2, err := ioutil.TempDir("", "pgcenter-convert-testing")
+	assert.NoError(t, err)
+	defer func() { _ = os.RemoveAll(dir2) }()
+
+	c.Workers, c.OutputDir = 1, dir2
+	results = convertFiles(c)
+	assert.NoError(t, results[0].err)
+	want, err := ioutil.ReadFile(output)
+	assert.NoError(t, err)
+	data, err := ioutil.ReadFile(filepath.Join(dir2, "pgcenter.stat.bin"))
+	assert.NoError(t, err)
+	assert.True(t, bytes.Equal(want, data))
+
+	// Existing files are not overwritten.
+	results = convertFiles(c)
+	assert.Error(t, results[0].err)
+	_, err = os.Stat(filepath.Join(dir2, "pgcenter.stat.bin"))
+	assert.NoError(t, err)
+
+	// Converted file could be converted again.
+	results = convertFiles(Config{InputFiles: []string{output}, Keyframe: 5, Workers: 2})
+	assert.NoError(t, results[0].err)
+	assert.Equal(t, 20, results[0].totals.snapshots)
+
+	// Missing and damaged files.
+	assert.NoError(t, ioutil.WriteFile(filepath.Join(dir, "damaged.tar"), []byte("damaged"), 0600))
+	results = convertFiles(Config{InputFiles: []string{filepath.Join(dir, "missing.tar"), filepath.Join(dir, "damaged.tar")}, Keyframe: 5, Workers: 2})
+	for _, r := range results {
+		assert.Error(t, r.err)
+	}
+	_, err = os.Stat(filepath.Join(dir, "damaged.bin"))
+	assert.True(t, os.IsNotExist(err))
+}
+
+func Test_convertFiles_downsample(t *testing.T) {
+	dir, err := ioutil.TempDir("", "pgcenter-convert-testing")
+	assert.NoError(t, err)
+	defer func() { _ = os.RemoveAll(dir) }()
+
+	input := filepath.Join(dir, "pgcenter.stat.tar")
+	writeTestArchive(t, input, 12)
+
+	// Snapshots recorded within the first 6 seconds are kept every 3 seconds.
+	c := Config{InputFiles: []string{input}, Keyframe: 4, Workers: 2, DownsampleBefore: testStart.Add(6 * time.Second), DownsampleRate: 3 * time.Second}
+	results := convertFiles(c)
+	assert.NoError(t, results[0].err)
+	assert.Equal(t, 8, results[0].dropped)
+	assert.Equal(t, 16, results[0].totals.snapshots)
+
+	names, stamps, _ := readTestSnapshots(t, results[0].output)
+	var got []int
+	for i := range names {
+		if names[i] == "databases" {
+			got = append(got, int(stamps[i].Sub(testStart)/time.Second))
+		}
+	}
+	assert.Equal(t, []int{0, 3, 6, 7, 8, 9, 10, 11}, got)
+}
+
+func Test_verifyFile(t *testing.T) {
+	dir, err := ioutil.TempDir("", "pgcenter-convert-testing")
+	assert.NoError(t, err)
+	defer func() { _ = os.RemoveAll(dir) }()
+
+	input := filepath.Join(dir, "pgcenter.stat.tar")
+	writeTestArchive(t, input, 3)
+
+	results := convertFiles(Config{InputFiles: []string{input}, Keyframe: 2, Workers: 2})
+	assert.NoError(t, results[0].err)
+
+	got, err := verifyFile(results[0].output, results[0].totals)
+	assert.NoError(t, err)
+	assert.Equal(t, results[0].totals, got)
+
+	// Changed snapshots are detected.
+	want := results[0].totals
+	want.sum++
+	_, err = verifyFile(results[0].output, want)
+	assert.Error(t, err)
+}
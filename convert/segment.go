@@ -0,0 +1,287 @@
+package convert
+
+import (
+	"archive/tar"
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"encoding/json"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/index"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"hash/fnv"
+	"io"
+	"math"
+	"os"
+	"path/filepath"
+	"strings"
+	"time"
+)
+
+// entry is a stats snapshot read from input file. Snapshots read from tar archives are kept as raw JSON data and
+// decoded by workers.
+type entry struct {
+	name string        // name of the view
+	ts   time.Time     // time when snapshot has been recorded
+	data []byte        // raw JSON data of snapshot, nil if snapshot has been decoded
+	res  stat.PGresult // decoded snapshot
+}
+
+// source reads stats snapshots from input file in order of recording.
+type source interface {
+	// next returns next stats snapshot, io.EOF is returned when no more snapshots.
+	next() (entry, error)
+}
+
+// newSource creates reader of input file. Format of the file is detected using its header, files in binary snapshot
+// format and tar archives with JSON files are supported.
+func newSource(r io.Reader) (source, error) {
+	br := bufio.NewReaderSize(r, 64*1024)
+
+	header, err := br.Peek(len(snapshot.Magic))
+	if err != nil && err != io.EOF {
+		return nil, err
+	}
+
+	if snapshot.IsSnapshotFile(header) {
+		sr, err := snapshot.NewReader(br)
+		if err != nil {
+			return nil, err
+		}
+		return &binarySource{r: sr}, nil
+	}
+
+	return &tarSource{r: tar.NewReader(br)}, nil
+}
+
+// tarSource reads stats snapshots from tar archive with JSON files.
+type tarSource struct {
+	r *tar.Reader
+}
+
+// next reads files of the archive, files which names are not in the format 'view.timestamp.json' are skipped.
+func (s *tarSource) next() (entry, error) {
+	for {
+		hdr, err := s.r.Next()
+		if err == io.EOF {
+			return entry{}, err
+		} else if err != nil {
+			return entry{}, fmt.Errorf("advance read position failed: %s", err)
+		}
+
+		parts := strings.Split(hdr.Name, ".")
+		if len(parts) != 3 || parts[2] != "json" {
+			continue
+		}
+
+		ts, err := time.ParseInLocation("20060102T150405", parts[1], time.Now().Location())
+		if err != nil {
+			continue
+		}
+
+		data := make([]byte, hdr.Size)
+		_, err = io.ReadFull(s.r, data)
+		if err != nil {
+			return entry{}, err
+		}
+
+		return entry{name: parts[0], ts: ts, data: data}, nil
+	}
+}
+
+// binarySource reads stats snapshots from file in binary snapshot format.
+type binarySource struct {
+	r *snapshot.Reader
+}
+
+// next reads and decodes the next snapshot.
+func (s *binarySource) next() (entry, error) {
+	name, ts, err := s.r.Next()
+	if err == io.EOF {
+		return entry{}, err
+	} else if err != nil {
+		return entry{}, fmt.Errorf("advance read position failed: %s", err)
+	}
+
+	e := entry{name: name, ts: ts}
+	err = s.r.Read(&e.res)
+	if err != nil {
+		return entry{}, err
+	}
+
+	return e, nil
+}
+
+// totals describes snapshots written into converted file, they are compared with snapshots read from converted file.
+type totals struct {
+	snapshots int
+	rows      int
+	sum       uint64 // sum of checksums of snapshots
+}
+
+// add adds passed totals.
+func (t *totals) add(o totals) {
+	t.snapshots += o.snapshots
+	t.rows += o.rows
+	t.sum += o.sum
+}
+
+// segment is a sequence of snapshots encoded into a single segment of binary snapshot format. Segment could be decoded
+// without preceding segments, hence segments are encoded by workers independently.
+type segment struct {
+	entries []entry
+	ukeys   map[string]int // unique keys of delta-encoded views
+	buf     bytes.Buffer   // encoded segment
+	index   []index.Entry  // entries of time index, offsets are relative to the beginning of the segment
+	totals  totals         // totals of encoded snapshots
+	err     error
+	done    chan struct{} // closed when segment is encoded
+}
+
+// newSegment creates new segment, snapshots of views with passed unique keys are delta-encoded.
+func newSegment(ukeys map[string]int) *segment {
+	return &segment{ukeys: ukeys, done: make(chan struct{})}
+}
+
+// encodeSegments encodes received segments until channel is closed.
+func encodeSegments(jobs <-chan *segment) {
+	for s := range jobs {
+		s.err = s.encode()
+		s.entries = nil
+		close(s.done)
+	}
+}
+
+// encode decodes snapshots of the segment if necessary and writes them in binary snapshot format. Reading of the
+// segment could be started at its beginning, hence time index refers to the beginning of the segment for every view.
+func (s *segment) encode() error {
+	w := snapshot.NewWriter(&s.buf)
+	w.EnableDelta(s.ukeys)
+
+	err := w.StartSegment()
+	if err != nil {
+		return err
+	}
+
+	seen := map[string]bool{}
+	var buf []byte
+	for i := range s.entries {
+		e := &s.entries[i]
+		if e.data != nil {
+			err = json.Unmarshal(e.data, &e.res)
+			if err != nil {
+				return fmt.Errorf("decode %s snapshot recorded at %s failed: %s", e.name, e.ts.Format("2006-01-02 15:04:05"), err)
+			}
+			e.data = nil
+		}
+
+		err = w.Write(e.name, e.ts, e.res)
+		if err != nil {
+			return err
+		}
+
+		if !seen[e.name] {
+			seen[e.name] = true
+			s.index = append(s.index, index.Entry{Ts: e.ts, Name: e.name})
+		}
+
+		var sum uint64
+		buf, sum = checksum(buf[:0], e.name, e.ts, &e.res)
+		s.totals.add(totals{snapshots: 1, rows: e.res.Nrows, sum: sum})
+
+		// Decoded snapshot is not needed anymore.
+		e.res = stat.PGresult{}
+	}
+
+	return nil
+}
+
+// checksum returns FNV-1a checksum of the name, timestamp, columns and values of the snapshot. Passed buffer is used
+// for serializing the snapshot.
+func checksum(buf []byte, name string, ts time.Time, res *stat.PGresult) ([]byte, uint64) {
+	var b [8]byte
+	putUint64 := func(v uint64) {
+		binary.LittleEndian.PutUint64(b[:], v)
+		buf = append(buf, b[:]...)
+	}
+
+	buf = append(buf, name...)
+	putUint64(uint64(ts.UnixNano()))
+	putUint64(uint64(res.Nrows))
+
+	for i := range res.Columns {
+		c := &res.Columns[i]
+		if i < len(res.Cols) {
+			buf = append(buf, res.Cols[i]...)
+		}
+		buf = append(buf, byte(c.Type))
+
+		for row := 0; row < res.Nrows; row++ {
+			if c.IsNull(row) {
+				buf = append(buf, 0)
+				continue
+			}
+			buf = append(buf, 1)
+
+			switch c.Type {
+			case stat.IntColumn:
+				putUint64(uint64(c.Int[row]))
+			case stat.FloatColumn:
+				putUint64(math.Float64bits(c.Float[row]))
+			default:
+				putUint64(uint64(len(c.Text[row])))
+				buf = append(buf, c.Text[row]...)
+			}
+		}
+	}
+
+	h := fnv.New64a()
+	_, _ = h.Write(buf)
+	return buf, h.Sum64()
+}
+
+// verifyFile reads all snapshots of converted file and compares their totals with totals of written snapshots.
+func verifyFile(filename string, want totals) (totals, error) {
+	f, err := os.Open(filepath.Clean(filename))
+	if err != nil {
+		return totals{}, err
+	}
+	defer func() { _ = f.Close() }()
+
+	r, err := snapshot.NewReader(f)
+	if err != nil {
+		return totals{}, err
+	}
+
+	var got totals
+	var res stat.PGresult
+	var buf []byte
+	for {
+		name, ts, err := r.Next()
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return totals{}, fmt.Errorf("verify failed: %s", err)
+		}
+
+		err = r.Read(&res)
+		if err != nil {
+			return totals{}, fmt.Errorf("verify failed: %s", err)
+		}
+
+		var sum uint64
+		buf, sum = checksum(buf[:0], name, ts, &res)
+		got.add(totals{snapshots: 1, rows: res.Nrows, sum: sum})
+	}
+
+	if got != want {
+		return totals{}, fmt.Errorf(
+			"verify failed: written %d snapshots, %d rows, checksum %x; read %d snapshots, %d rows, checksum %x",
+			want.snapshots, want.rows, want.sum, got.snapshots, got.rows, got.sum,
+		)
+	}
+
+	return got, nil
+}
@@ -10,7 +10,8 @@ const (
 	colsTruncMinLimit = 1
 )
 
-// SetAlign method aligns length of values depending of the columns width
+// SetAlign method calculates width of columns depending of the length of values. Values longer than the width are
+// truncated when printed.
 func SetAlign(r stat.PGresult, truncLimit int, dynamic bool) (map[int]int, []string) {
 	lastColMaxWidthDefault := 8
 	lastColTruncLimit := math.Max(truncLimit, colsTruncMinLimit)
@@ -18,7 +19,7 @@ func SetAlign(r stat.PGresult, truncLimit int, dynamic bool) (map[int]int, []str
 	widthes := make(map[int]int)
 
 	// no rows in result, set width using length of a column name and return with error (because not aligned using result's values)
-	if len(r.Values) == 0 {
+	if r.Nrows == 0 {
 		for colidx, colname := range r.Cols { // walk per-column
 			widthes[colidx] = math.Max(len(colname), colsTruncMinLimit)
 		}
@@ -28,9 +29,9 @@ func SetAlign(r stat.PGresult, truncLimit int, dynamic bool) (map[int]int, []str
 	/* calculate max length of columns based on the longest value of the column */
 	var valuelen, colnamelen int
 	for colidx, colname := range r.Cols { // walk per-column
-		for rownum := 0; rownum < len(r.Values); rownum++ { // walk through rows
+		for rownum := 0; rownum < r.Nrows; rownum++ { // walk through rows
 			// Minimum possible value length is 1 (colsTruncMinLimit)
-			valuelen = math.Max(len(r.Values[rownum][colidx].String), colsTruncMinLimit)
+			valuelen = math.Max(r.ValueLen(rownum, colidx), colsTruncMinLimit)
 
 			// Minimum possible length for columns is 8
 			colnamelen = math.Max(len(colname), 8) // eight is a minimal colname length, if column name too short.
@@ -66,9 +67,8 @@ func SetAlign(r stat.PGresult, truncLimit int, dynamic bool) (map[int]int, []str
 			// do nothing if length of value or column is less (or equal) than already specified width
 			case aligningIsLengthLessOrEqualWidth(valuelen, colnamelen, widthes[colidx]):
 
-			// for very long values, truncate value and set length limited by truncLimit value,
+			// for very long values, set length limited by truncLimit value, value is truncated when printed
 			case valuelen >= truncLimit:
-				r.Values[rownum][colidx].String = r.Values[rownum][colidx].String[:truncLimit-1] + "~"
 				widthes[colidx] = truncLimit
 				//default:	// default case is used for debug purposes for catching cases that don't meet upper conditions
 				//	fmt.Printf("*** DEBUG %s -- %s, %d:%d:%d ***", colname, r.Result[rownum][colnum].String, widthes[colidx], colnamelen, valuelen)
@@ -0,0 +1,126 @@
+package align
+
+import (
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"io"
+)
+
+// padding is used for padding values to width of columns.
+const padding = "                                                                "
+
+// Table renders aligned rows of stats into reusable buffer. Values are padded to widths of columns, values longer
+// than width of the column are truncated in place and marked with '~'. Rendered rows are flushed at once.
+type Table struct {
+	buf     []byte
+	widths  []int // widths of columns
+	limit   int   // truncation limit used for aligning, 0 if not set
+	padLast bool  // values of the last column are padded too
+}
+
+// NewTable creates new table. If padLast is false, values of the last column are not padded.
+func NewTable(padLast bool) *Table {
+	return &Table{padLast: padLast}
+}
+
+// SetWidths sets widths of columns calculated by SetAlign. Layout is rebuilt only when widths are changed.
+func (t *Table) SetWidths(widths map[int]int, ncols int) {
+	if len(t.widths) == ncols {
+		changed := false
+		for i, w := range t.widths {
+			if widths[i] != w {
+				changed = true
+				break
+			}
+		}
+		if !changed {
+			return
+		}
+	}
+
+	t.widths = t.widths[:0]
+	for i := 0; i < ncols; i++ {
+		t.widths = append(t.widths, widths[i])
+	}
+}
+
+// SetTruncLimit sets truncation limit used by SetAlign. Values not shorter than the limit are truncated even if they
+// fit width of the column, except values of the last column.
+func (t *Table) SetTruncLimit(limit int) {
+	t.limit = limit
+}
+
+// Reset discards rendered rows, memory of the buffer is kept for reusing.
+func (t *Table) Reset() {
+	t.buf = t.buf[:0]
+}
+
+// Len returns length of rendered rows.
+func (t *Table) Len() int {
+	return len(t.buf)
+}
+
+// Bytes returns rendered rows, returned slice is valid until next modification of the table.
+func (t *Table) Bytes() []byte {
+	return t.buf
+}
+
+// WriteTo writes rendered rows to the writer.
+func (t *Table) WriteTo(w io.Writer) (int64, error) {
+	n, err := w.Write(t.buf)
+	return int64(n), err
+}
+
+// AppendString appends string as is.
+func (t *Table) AppendString(s string) {
+	t.buf = append(t.buf, s...)
+}
+
+// AppendFunc appends data rendered by passed function into the buffer, used for rows rendered in other formats.
+func (t *Table) AppendFunc(fn func(buf []byte) []byte) {
+	t.buf = fn(t.buf)
+}
+
+// AppendHeader appends name of the column padded to width of the column, names are not truncated.
+func (t *Table) AppendHeader(col int, name string) {
+	t.buf = append(t.buf, name...)
+	t.pad(t.widths[col] + 2 - len(name))
+}
+
+// AppendValue appends value of the column's cell. Value is truncated to width of the column and padded.
+func (t *Table) AppendValue(col int, c *stat.Column, row int) {
+	start := len(t.buf)
+	t.buf = c.AppendString(t.buf, row)
+
+	// truncate value up to column width and replace last character with '~' symbol, width is unknown if widths have
+	// been calculated for other columns, e.g. when columns are added to stats
+	width, n := t.widths[col], len(t.buf)-start
+	if width < 1 {
+		width = n
+	}
+	if n > width || (n == width && width == t.limit && t.limit > colsTruncMinLimit && col < len(t.widths)-1) {
+		t.buf = append(t.buf[:start+width-1], '~')
+	}
+
+	if col < len(t.widths)-1 || t.padLast {
+		t.pad(width + 2 - (len(t.buf) - start))
+	}
+}
+
+// AppendRow appends values of all columns of the row followed by newline.
+func (t *Table) AppendRow(res *stat.PGresult, row int) {
+	for i := range t.widths {
+		t.AppendValue(i, &res.Columns[i], row)
+	}
+	t.buf = append(t.buf, '\n')
+}
+
+// pad appends n spaces.
+func (t *Table) pad(n int) {
+	for n > len(padding) {
+		t.buf = append(t.buf, padding...)
+		n -= len(padding)
+	}
+	if n > 0 {
+		t.buf = append(t.buf, padding[:n]...)
+	}
+}
@@ -0,0 +1,142 @@
+package align
+
+import (
+	"bytes"
+	"database/sql"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"io/ioutil"
+	"strconv"
+	"testing"
+)
+
+func TestTable(t *testing.T) {
+	res := stat.NewPGresultFromValues(
+		[]string{"name", "value", "ratio"},
+		[][]sql.NullString{
+			{{String: "short", Valid: true}, {String: "12", Valid: true}, {String: "0.5", Valid: true}},
+			{{String: "very_long_value", Valid: true}, {String: "", Valid: false}, {String: "1.25", Valid: true}},
+		},
+	)
+
+	testcases := []struct {
+		padLast bool
+		want    string
+	}{
+		{padLast: false, want: "name    value  ratio  \nshort   12     0.50\nvery_~         1.25\n"},
+		{padLast: true, want: "name    value  ratio  \nshort   12     0.50   \nvery_~         1.25   \n"},
+	}
+
+	for _, tc := range testcases {
+		table := NewTable(tc.padLast)
+		table.SetWidths(map[int]int{0: 6, 1: 5, 2: 5}, res.Ncols)
+
+		// Rendering is repeated to check buffer reusing.
+		for i := 0; i < 2; i++ {
+			table.Reset()
+			for j, name := range res.Cols {
+				table.AppendHeader(j, name)
+			}
+			table.AppendString("\n")
+			for j := 0; j < res.Nrows; j++ {
+				table.AppendRow(&res, j)
+			}
+
+			var buf bytes.Buffer
+			n, err := table.WriteTo(&buf)
+			assert.NoError(t, err)
+			assert.Equal(t, int64(table.Len()), n)
+			assert.Equal(t, tc.want, buf.String())
+		}
+	}
+
+	// Changed widths rebuild layout.
+	table := NewTable(false)
+	table.SetWidths(map[int]int{0: 6, 1: 5, 2: 5}, res.Ncols)
+	table.SetWidths(map[int]int{0: 100, 1: 5, 2: 5}, res.Ncols)
+	table.AppendRow(&res, 1)
+	assert.Equal(t, "very_long_value"+fmt.Sprintf("%*s", 87, "")+"       1.25\n", string(table.Bytes()))
+
+	// Values not shorter than truncation limit are truncated, except values of the last column.
+	table = NewTable(false)
+	table.SetWidths(map[int]int{0: 5, 1: 5, 2: 4}, res.Ncols)
+	table.SetTruncLimit(4)
+	table.AppendRow(&res, 0)
+	table.SetTruncLimit(5)
+	table.AppendRow(&res, 0)
+	assert.Equal(t, "short  12     0.50\nshor~  12     0.50\n", string(table.Bytes()))
+
+	// Values of columns with unknown width are not truncated.
+	table = NewTable(false)
+	table.SetWidths(map[int]int{0: 6}, res.Ncols)
+	table.AppendRow(&res, 1)
+	assert.Equal(t, "very_~    1.25\n", string(table.Bytes()))
+
+	// Data rendered in other formats.
+	table.Reset()
+	table.AppendFunc(func(buf []byte) []byte { return res.Columns[2].AppendString(buf, 1) })
+	assert.Equal(t, "1.25", string(table.Bytes()))
+}
+
+// newBenchmarkResult creates result with 10k rows of text, integer and float values.
+func newBenchmarkResult() (stat.PGresult, map[int]int) {
+	cols := []string{"datname", "relname", "seq_scan", "idx_scan", "n_tup_ins", "n_tup_upd", "n_tup_del", "ratio"}
+	values := make([][]sql.NullString, 10000)
+	for i := range values {
+		n := strconv.Itoa(i * 7919)
+		values[i] = []sql.NullString{
+			{String: "postgres", Valid: true}, {String: "public.table_with_long_name_" + n, Valid: true},
+			{String: n, Valid: true}, {String: n, Valid: true}, {String: n, Valid: true}, {String: "0", Valid: true},
+			{String: n, Valid: i%2 == 0}, {String: "0.75", Valid: true},
+		}
+	}
+	res := stat.NewPGresultFromValues(cols, values)
+	widths, _ := SetAlign(res, 32, false)
+	return res, widths
+}
+
+// BenchmarkTable renders 10k rows through reusable table.
+func BenchmarkTable(b *testing.B) {
+	res, widths := newBenchmarkResult()
+	table := NewTable(false)
+	b.ReportAllocs()
+	b.ResetTimer()
+
+	for i := 0; i < b.N; i++ {
+		table.Reset()
+		table.SetWidths(widths, res.Ncols)
+		for j := 0; j < res.Nrows; j++ {
+			table.AppendString("         ")
+			table.AppendRow(&res, j)
+		}
+		_, _ = table.WriteTo(ioutil.Discard)
+	}
+}
+
+// BenchmarkFprintf renders 10k rows formatting every value with fmt, as it was done before table.
+func BenchmarkFprintf(b *testing.B) {
+	res, widths := newBenchmarkResult()
+	b.ReportAllocs()
+	b.ResetTimer()
+
+	for i := 0; i < b.N; i++ {
+		var buf bytes.Buffer
+		for j := 0; j < res.Nrows; j++ {
+			_, _ = fmt.Fprintf(&buf, "         ")
+			for k := range res.Cols {
+				value := res.Value(j, k)
+				if len(value) > widths[k] {
+					value = value[:widths[k]-1] + "~"
+				}
+				if k != len(res.Cols)-1 {
+					_, _ = fmt.Fprintf(&buf, "%-*s", widths[k]+2, value)
+				} else {
+					_, _ = fmt.Fprintf(&buf, "%s", value)
+				}
+			}
+			_, _ = fmt.Fprintf(&buf, "\n")
+		}
+		_, _ = buf.WriteTo(ioutil.Discard)
+	}
+}
@@ -0,0 +1,227 @@
+// Package index implements time index of files with recorded stats. Index is stored in a sidecar file next to the
+// stats file and allows to find position of stats recorded at particular time without reading the whole stats file.
+//
+// Index file starts with magic header followed by fixed-size entries. Each entry consists of timestamp, offset in the
+// stats file and name of the view: reading of snapshots of the view recorded since the timestamp could be started at
+// the offset. Entries are appended in chronological order, hence they could be searched using binary search.
+package index
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"sort"
+	"time"
+)
+
+const (
+	// Magic is the header of index files.
+	Magic = "PGCTIDX\x01"
+	// Suffix is appended to name of the stats file to get name of its index file.
+	Suffix = ".idx"
+	// maxNameLen defines max length of view name which could be stored in index entry.
+	maxNameLen = 32
+	// entrySize defines size of index entry: timestamp, offset and name.
+	entrySize = 8 + 8 + maxNameLen
+)
+
+// Entry describes position in the stats file where reading of snapshots of the view recorded since the timestamp could
+// be started.
+type Entry struct {
+	Ts     time.Time
+	Name   string
+	Offset int64
+}
+
+// Filename returns name of index file of the stats file.
+func Filename(filename string) string {
+	return filename + Suffix
+}
+
+// Writer appends entries to index file.
+type Writer struct {
+	file *os.File
+	buf  *bufio.Writer
+}
+
+// Open opens index file for writing. Existing index is truncated or, when appending is requested, entries which refer
+// beyond the end of the stats file of passed size are removed. Invalid index file is recreated.
+func Open(filename string, size int64, append bool) (*Writer, error) {
+	flags := os.O_CREATE | os.O_RDWR
+	if !append {
+		flags |= os.O_TRUNC
+	}
+
+	f, err := os.OpenFile(filepath.Clean(filename), flags, 0600)
+	if err != nil {
+		return nil, err
+	}
+
+	end, err := validEnd(f, size)
+	if err != nil {
+		_ = f.Close()
+		return nil, err
+	}
+
+	err = f.Truncate(end)
+	if err != nil {
+		_ = f.Close()
+		return nil, err
+	}
+
+	_, err = f.Seek(end, io.SeekStart)
+	if err != nil {
+		_ = f.Close()
+		return nil, err
+	}
+
+	w := &Writer{file: f, buf: bufio.NewWriter(f)}
+
+	// New index starts with magic header.
+	if end == 0 {
+		_, err = w.buf.WriteString(Magic)
+		if err != nil {
+			_ = f.Close()
+			return nil, err
+		}
+	}
+
+	return w, nil
+}
+
+// validEnd returns offset of the end of the last complete entry which refers within the stats file of passed size.
+// Zero offset is returned for empty or invalid index file.
+func validEnd(f *os.File, size int64) (int64, error) {
+	r, err := newReader(f)
+	if err != nil {
+		return 0, nil
+	}
+
+	// Offsets of entries grow with every entry, find the first entry beyond the size.
+	n := sort.Search(r.n, func(i int) bool {
+		e, err := r.entry(i)
+		return err != nil || e.Offset >= size
+	})
+	if r.err != nil {
+		return 0, r.err
+	}
+
+	return int64(len(Magic)) + int64(n)*entrySize, nil
+}
+
+// Add appends entry to the index.
+func (w *Writer) Add(e Entry) error {
+	if len(e.Name) > maxNameLen {
+		return fmt.Errorf("view name too long for time index: %s", e.Name)
+	}
+
+	var b [entrySize]byte
+	binary.LittleEndian.PutUint64(b[0:8], uint64(e.Ts.UnixNano()))
+	binary.LittleEndian.PutUint64(b[8:16], uint64(e.Offset))
+	copy(b[16:], e.Name)
+
+	_, err := w.buf.Write(b[:])
+	return err
+}
+
+// Sync flushes buffered entries and syncs them to disk.
+func (w *Writer) Sync() error {
+	err := w.buf.Flush()
+	if err != nil {
+		return err
+	}
+
+	return w.file.Sync()
+}
+
+// Close syncs buffered entries and closes index file.
+func (w *Writer) Close() error {
+	err := w.Sync()
+	if err != nil {
+		_ = w.file.Close()
+		return err
+	}
+
+	return w.file.Close()
+}
+
+// Lookup searches index file and returns offset in the stats file where reading of snapshots of the view recorded
+// since passed time could be started. Entries which refer beyond the end of the stats file of passed size are ignored.
+// Zero offset is returned when all recorded snapshots should be read.
+func Lookup(filename string, name string, ts time.Time, size int64) (int64, error) {
+	f, err := os.Open(filepath.Clean(filename))
+	if err != nil {
+		return 0, err
+	}
+
+	defer func() { _ = f.Close() }()
+
+	r, err := newReader(f)
+	if err != nil {
+		return 0, err
+	}
+
+	// Find the first entry recorded after the time, and then the nearest preceding entry of the view.
+	n := sort.Search(r.n, func(i int) bool {
+		e, err := r.entry(i)
+		return err != nil || e.Ts.After(ts)
+	})
+
+	for i := n - 1; i >= 0; i-- {
+		e, err := r.entry(i)
+		if err != nil {
+			return 0, err
+		}
+
+		if e.Name == name && e.Offset < size {
+			return e.Offset, nil
+		}
+	}
+
+	return 0, r.err
+}
+
+// reader reads entries of index file.
+type reader struct {
+	r   io.ReaderAt
+	n   int   // number of complete entries
+	err error // the first error occurred during reading entries
+}
+
+// newReader checks magic header of index file and creates reader of its entries.
+func newReader(f *os.File) (*reader, error) {
+	st, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+
+	header := make([]byte, len(Magic))
+	_, err = f.ReadAt(header, 0)
+	if err != nil || !bytes.Equal(header, []byte(Magic)) {
+		return nil, fmt.Errorf("not an index file")
+	}
+
+	return &reader{r: f, n: int((st.Size() - int64(len(Magic))) / entrySize)}, nil
+}
+
+// entry reads entry with passed number.
+func (r *reader) entry(i int) (Entry, error) {
+	var b [entrySize]byte
+	_, err := r.r.ReadAt(b[:], int64(len(Magic))+int64(i)*entrySize)
+	if err != nil {
+		if r.err == nil {
+			r.err = err
+		}
+		return Entry{}, err
+	}
+
+	return Entry{
+		Ts:     time.Unix(0, int64(binary.LittleEndian.Uint64(b[0:8]))),
+		Offset: int64(binary.LittleEndian.Uint64(b[8:16])),
+		Name:   string(bytes.TrimRight(b[16:], "\x00")),
+	}, nil
+}
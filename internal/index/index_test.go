@@ -0,0 +1,85 @@
+package index
+
+import (
+	"github.com/stretchr/testify/assert"
+	"io/ioutil"
+	"os"
+	"testing"
+	"time"
+)
+
+func TestWriter(t *testing.T) {
+	filename := "/tmp/pgcenter-index-testing.idx"
+	ts := time.Date(2021, 1, 1, 12, 0, 0, 0, time.UTC)
+
+	// Two views recorded every second, each record takes 100 bytes.
+	w, err := Open(filename, 0, false)
+	assert.NoError(t, err)
+	for i := 0; i < 10; i++ {
+		assert.NoError(t, w.Add(Entry{Ts: ts.Add(time.Duration(i) * time.Second), Name: "databases", Offset: int64(i * 200)}))
+		assert.NoError(t, w.Add(Entry{Ts: ts.Add(time.Duration(i) * time.Second), Name: "tables", Offset: int64(i*200 + 100)}))
+	}
+	assert.Error(t, w.Add(Entry{Ts: ts, Name: "very_long_name_of_view_which_does_not_fit"}))
+	assert.NoError(t, w.Close())
+
+	testcases := []struct {
+		name string
+		ts   time.Time
+		size int64
+		want int64
+	}{
+		{name: "databases", ts: ts.Add(5 * time.Second), size: 2000, want: 1000},
+		{name: "tables", ts: ts.Add(5 * time.Second), size: 2000, want: 1100},
+		{name: "tables", ts: ts.Add(5500 * time.Millisecond), size: 2000, want: 1100},
+		{name: "tables", ts: ts.Add(time.Hour), size: 2000, want: 1900},
+		{name: "tables", ts: ts.Add(time.Hour), size: 1500, want: 1300}, // stats file is shorter than indexed
+		{name: "tables", ts: ts.Add(-time.Hour), size: 2000, want: 0},
+		{name: "unknown", ts: ts.Add(time.Hour), size: 2000, want: 0},
+	}
+
+	for _, tc := range testcases {
+		got, err := Lookup(filename, tc.name, tc.ts, tc.size)
+		assert.NoError(t, err)
+		assert.Equal(t, tc.want, got)
+	}
+
+	// Appending removes entries which refer beyond the end of stats file.
+	w, err = Open(filename, 1000, true)
+	assert.NoError(t, err)
+	assert.NoError(t, w.Add(Entry{Ts: ts.Add(time.Hour), Name: "tables", Offset: 1000}))
+	assert.NoError(t, w.Close())
+
+	got, err := Lookup(filename, "databases", ts.Add(time.Hour), 2000)
+	assert.NoError(t, err)
+	assert.Equal(t, int64(800), got)
+	got, err = Lookup(filename, "tables", ts.Add(time.Hour), 2000)
+	assert.NoError(t, err)
+	assert.Equal(t, int64(1000), got)
+
+	// Torn entry is ignored.
+	st, err := os.Stat(filename)
+	assert.NoError(t, err)
+	assert.NoError(t, os.Truncate(filename, st.Size()-10))
+	got, err = Lookup(filename, "tables", ts.Add(time.Hour), 2000)
+	assert.NoError(t, err)
+	assert.Equal(t, int64(900), got)
+
+	// Invalid index is recreated at appending.
+	assert.NoError(t, ioutil.WriteFile(filename, []byte("invalid"), 0600))
+	_, err = Lookup(filename, "tables", ts, 2000)
+	assert.Error(t, err)
+
+	w, err = Open(filename, 1000, true)
+	assert.NoError(t, err)
+	assert.NoError(t, w.Add(Entry{Ts: ts, Name: "tables", Offset: 1000}))
+	assert.NoError(t, w.Close())
+
+	got, err = Lookup(filename, "tables", ts, 2000)
+	assert.NoError(t, err)
+	assert.Equal(t, int64(1000), got)
+
+	// Missing index.
+	assert.NoError(t, os.Remove(filename))
+	_, err = Lookup(filename, "tables", ts, 2000)
+	assert.Error(t, err)
+}
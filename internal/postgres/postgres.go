@@ -125,6 +125,16 @@ func (db *DB) Query(query string, args ...interface{}) (pgx.Rows, error) {
 	return db.Conn.Query(context.TODO(), query, args...)
 }
 
+// SendBatch is a wrapper over pgx.SendBatch.
+func (db *DB) SendBatch(b *pgx.Batch) pgx.BatchResults {
+	return db.Conn.SendBatch(context.TODO(), b)
+}
+
+// IsClosed reports if connection to Postgres has been closed or is in broken state.
+func (db *DB) IsClosed() bool {
+	return db.Conn.IsClosed()
+}
+
 // Close closes connection to Postgres.
 func (db *DB) Close() {
 	if err := db.Conn.Close(context.TODO()); err != nil {
@@ -143,6 +143,7 @@ func TestReconnect(t *testing.T) {
 
 	err = c1.PQstatus()
 	assert.Error(t, err)
+	assert.True(t, c1.IsClosed())
 
 	err = Reconnect(c1)
 	assert.NoError(t, err)
@@ -173,5 +174,17 @@ func TestDB_ALL(t *testing.T) {
 	assert.NotNil(t, rows)
 	rows.Close()
 
+	b := &pgx.Batch{}
+	b.Queue("SELECT 1")
+	b.Queue("SELECT relname FROM pg_class")
+	br := conn.SendBatch(b)
+	assert.NoError(t, br.QueryRow().Scan(&count))
+	assert.Equal(t, 1, count)
+	rows, err = br.Query()
+	assert.NoError(t, err)
+	rows.Close()
+	assert.NoError(t, br.Close())
+	assert.False(t, conn.IsClosed())
+
 	conn.Close()
 }
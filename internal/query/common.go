@@ -5,6 +5,8 @@ const (
 	GetSetting = "SELECT current_setting($1)"
 	// GetRecoveryStatus queries current Postgres recovery status.
 	GetRecoveryStatus = "SELECT pg_is_in_recovery()"
+	// GetClockTimestamp queries current time of Postgres server, used for measuring time between stats snapshots.
+	GetClockTimestamp = "SELECT clock_timestamp()"
 	// GetUptime queries Postgres uptime.
 	GetUptime = "SELECT date_trunc('seconds', now() - pg_postmaster_start_time())"
 	// CheckSchemaExists checks schema exists in the database.
@@ -69,6 +69,7 @@ func Test_CommonQueries(t *testing.T) {
 	}{
 		{query: GetSetting, args: []interface{}{"work_mem"}},
 		{query: GetRecoveryStatus},
+		{query: GetClockTimestamp},
 		{query: GetUptime},
 		{query: CheckSchemaExists, args: []interface{}{"public"}},
 		{query: CheckExtensionExists, args: []interface{}{"plpgsql"}},
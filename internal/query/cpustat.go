@@ -0,0 +1,14 @@
+package query
+
+const (
+	// PgcenterCpuStatDefault is the default query for getting per-CPU stats from pgcenter schema. Times are converted
+	// into hundredths of second, hence their per-second rates are percents of CPU time.
+	// { Name: "cpustat", Query: query.PgcenterCpuStatDefault, DiffIntvl: [2]int{1,8}, Ncols: 9, OrderKey: 8, OrderDesc: true }
+	PgcenterCpuStatDefault = "SELECT cpu, " +
+		"us_time * 100 / t.ticks AS us, sy_time * 100 / t.ticks AS sy, ni_time * 100 / t.ticks AS ni, " +
+		"wa_time * 100 / t.ticks AS wa, hi_time * 100 / t.ticks AS hi, si_time * 100 / t.ticks AS si, " +
+		"st_time * 100 / t.ticks AS st, " +
+		"(us_time + ni_time + sy_time + wa_time + hi_time + si_time + st_time) * 100 / t.ticks AS busy " +
+		"FROM pgcenter.sys_proc_stat, (SELECT pgcenter.get_sys_clk_ticks() AS ticks) t " +
+		"WHERE cpu ~ '^cpu[0-9]+$' ORDER BY cpu"
+)
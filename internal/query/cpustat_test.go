@@ -0,0 +1,20 @@
+package query
+
+import (
+	"github.com/lesovsky/pgcenter/internal/postgres"
+	"github.com/stretchr/testify/assert"
+	"testing"
+)
+
+func Test_PgcenterCpuStatQuery(t *testing.T) {
+	q, err := Format(PgcenterCpuStatDefault, NewOptions(130000, "f", "off", 256))
+	assert.NoError(t, err)
+
+	conn, err := postgres.NewTestConnect()
+	assert.NoError(t, err)
+
+	_, err = conn.Exec(q)
+	assert.NoError(t, err)
+
+	conn.Close()
+}
@@ -0,0 +1,266 @@
+// Package sketch implements streaming quantile sketch with relative accuracy guarantee and bounded memory.
+//
+// Values are counted in logarithmically sized buckets: bucket with index i keeps values in (gamma^(i-1), gamma^i],
+// hence quantiles are estimated with relative error not exceeding the accuracy of the sketch. Sketches are mergeable:
+// merged sketch is the same as sketch of all values added into merged ones. Number of buckets is limited, when limit
+// is reached the lowest buckets are collapsed, hence accuracy of the lowest quantiles is lost first.
+package sketch
+
+import "math"
+
+const (
+	// Accuracy defines relative accuracy of estimated quantiles.
+	Accuracy = 0.01
+	// MaxBins defines max number of buckets used for values of the same sign.
+	MaxBins = 2048
+	// minValue defines absolute value below which values are counted as zeros.
+	minValue = 1e-9
+)
+
+var (
+	gamma    = (1 + Accuracy) / (1 - Accuracy)
+	logGamma = math.Log(gamma)
+)
+
+// Sketch is the streaming quantile sketch. Zero value is an empty sketch ready to use.
+type Sketch struct {
+	pos   store   // buckets of positive values
+	neg   store   // buckets of absolute values of negative values
+	zeros uint64  // number of values counted as zeros
+	count uint64  // number of added values
+	min   float64 // min of added values
+	max   float64 // max of added values
+	sum   float64 // sum of added values
+}
+
+// Add adds value into the sketch. NaNs are ignored.
+func (s *Sketch) Add(v float64) {
+	if math.IsNaN(v) {
+		return
+	}
+
+	switch {
+	case v > minValue:
+		s.pos.add(index(v), 1)
+	case v < -minValue:
+		s.neg.add(index(-v), 1)
+	default:
+		s.zeros++
+	}
+
+	if s.count == 0 || v < s.min {
+		s.min = v
+	}
+	if s.count == 0 || v > s.max {
+		s.max = v
+	}
+	s.count++
+	s.sum += v
+}
+
+// Merge adds all values of other sketch into the sketch.
+func (s *Sketch) Merge(o *Sketch) {
+	if o.count == 0 {
+		return
+	}
+
+	s.pos.merge(&o.pos)
+	s.neg.merge(&o.neg)
+	s.zeros += o.zeros
+
+	if s.count == 0 || o.min < s.min {
+		s.min = o.min
+	}
+	if s.count == 0 || o.max > s.max {
+		s.max = o.max
+	}
+	s.count += o.count
+	s.sum += o.sum
+}
+
+// Reset empties the sketch, allocated memory is kept for reuse.
+func (s *Sketch) Reset() {
+	s.pos.reset()
+	s.neg.reset()
+	s.zeros, s.count = 0, 0
+	s.min, s.max, s.sum = 0, 0, 0
+}
+
+// Count returns number of added values.
+func (s *Sketch) Count() uint64 { return s.count }
+
+// Min returns exact min of added values.
+func (s *Sketch) Min() float64 { return s.min }
+
+// Max returns exact max of added values.
+func (s *Sketch) Max() float64 { return s.max }
+
+// Avg returns exact average of added values.
+func (s *Sketch) Avg() float64 {
+	if s.count == 0 {
+		return 0
+	}
+	return s.sum / float64(s.count)
+}
+
+// Quantile returns estimated value of quantile q in [0, 1], returns zero for empty sketch.
+func (s *Sketch) Quantile(q float64) float64 {
+	if s.count == 0 {
+		return 0
+	}
+	if q <= 0 {
+		return s.min
+	}
+	if q >= 1 {
+		return s.max
+	}
+
+	rank := uint64(q * float64(s.count-1))
+
+	var v float64
+	switch {
+	case rank < s.neg.count:
+		// Negative values are ordered from the largest absolute value.
+		v = -value(s.neg.indexAt(s.neg.count - 1 - rank))
+	case rank < s.neg.count+s.zeros:
+		v = 0
+	default:
+		v = value(s.pos.indexAt(rank - s.neg.count - s.zeros))
+	}
+
+	// Estimation never leaves the range of exact values.
+	return math.Max(s.min, math.Min(s.max, v))
+}
+
+// index returns index of bucket for positive value.
+func index(v float64) int {
+	return int(math.Ceil(math.Log(v) / logGamma))
+}
+
+// value returns estimation of values of bucket with passed index, relative error of estimation doesn't exceed accuracy.
+func value(i int) float64 {
+	return 2 * math.Pow(gamma, float64(i)) / (gamma + 1)
+}
+
+// store keeps counts of contiguous range of buckets.
+type store struct {
+	bins   []uint64 // counts of buckets
+	offset int      // index of the first bucket
+	count  uint64   // total count of values
+}
+
+// add adds n values into bucket with passed index.
+func (s *store) add(i int, n uint64) {
+	if s.count == 0 {
+		s.bins = append(s.bins[:0], 0)
+		s.offset = i
+	}
+
+	lo, hi := s.offset, s.offset+len(s.bins)-1
+	if i < lo || i > hi {
+		// Range is extended with a margin to avoid moving buckets on every new index.
+		margin := len(s.bins)/2 + 8
+		if i < lo {
+			lo = i - margin
+		} else {
+			hi = i + margin
+		}
+		if hi-lo+1 > MaxBins {
+			lo, hi = minInt(s.offset, i), maxInt(s.offset+len(s.bins)-1, i)
+		}
+		s.extend(lo, hi)
+	}
+
+	// Indexes of collapsed buckets are counted in the lowest bucket.
+	if i < s.offset {
+		i = s.offset
+	}
+
+	s.bins[i-s.offset] += n
+	s.count += n
+}
+
+// extend changes range of buckets to [lo, hi], where hi is not less than the current upper bound. When number of
+// buckets exceeds the limit, the lowest buckets are collapsed.
+func (s *store) extend(lo, hi int) {
+	if hi-lo+1 > MaxBins {
+		lo = hi - MaxBins + 1
+	}
+
+	old, offset := s.bins, s.offset
+	var collapsed uint64
+	if lo > offset {
+		k := minInt(lo-offset, len(old))
+		for _, c := range old[:k] {
+			collapsed += c
+		}
+		old, offset = old[k:], lo
+	}
+
+	n := hi - lo + 1
+	shift := offset - lo
+
+	var bins []uint64
+	if cap(s.bins) >= n {
+		bins = s.bins[:n]
+	} else {
+		bins = make([]uint64, n, n+n/4)
+	}
+
+	// Buckets are moved in place when memory is reused, copy handles overlapping.
+	copy(bins[shift:], old)
+	for j := range bins[:shift] {
+		bins[j] = 0
+	}
+	for j := range bins[shift+len(old):] {
+		bins[shift+len(old)+j] = 0
+	}
+	bins[0] += collapsed
+
+	s.bins, s.offset = bins, lo
+}
+
+// merge adds counts of other store.
+func (s *store) merge(o *store) {
+	if o.count == 0 {
+		return
+	}
+
+	for j, c := range o.bins {
+		if c > 0 {
+			s.add(o.offset+j, c)
+		}
+	}
+}
+
+// indexAt returns index of bucket which keeps value with passed rank, ranks start at zero.
+func (s *store) indexAt(rank uint64) int {
+	var n uint64
+	for j, c := range s.bins {
+		n += c
+		if n > rank {
+			return s.offset + j
+		}
+	}
+	return s.offset + len(s.bins) - 1
+}
+
+// reset empties the store, memory of buckets is kept.
+func (s *store) reset() {
+	s.bins = s.bins[:0]
+	s.offset, s.count = 0, 0
+}
+
+func minInt(a, b int) int {
+	if a < b {
+		return a
+	}
+	return b
+}
+
+func maxInt(a, b int) int {
+	if a > b {
+		return a
+	}
+	return b
+}
@@ -0,0 +1,126 @@
+package sketch
+
+import (
+	"github.com/stretchr/testify/assert"
+	"math"
+	"math/rand"
+	"sort"
+	"testing"
+)
+
+// exactQuantile returns exact quantile of sorted values using the same rank as sketch.
+func exactQuantile(values []float64, q float64) float64 {
+	return values[int(q*float64(len(values)-1))]
+}
+
+func TestSketch(t *testing.T) {
+	rnd := rand.New(rand.NewSource(1))
+
+	testcases := []struct {
+		name string
+		gen  func() float64
+	}{
+		{name: "uniform", gen: func() float64 { return rnd.Float64() * 1000 }},
+		{name: "exponential", gen: func() float64 { return rnd.ExpFloat64() * 50 }},
+		{name: "lognormal", gen: func() float64 { return math.Exp(rnd.NormFloat64() * 3) }},
+		{name: "integers", gen: func() float64 { return float64(rnd.Intn(20)) }},
+		{name: "signed", gen: func() float64 { return rnd.NormFloat64() * 100 }},
+	}
+
+	for _, tc := range testcases {
+		var s Sketch
+		values := make([]float64, 10000)
+		var sum float64
+		for i := range values {
+			values[i] = tc.gen()
+			sum += values[i]
+			s.Add(values[i])
+		}
+		sort.Float64s(values)
+
+		assert.Equal(t, uint64(len(values)), s.Count(), tc.name)
+		assert.Equal(t, values[0], s.Min(), tc.name)
+		assert.Equal(t, values[len(values)-1], s.Max(), tc.name)
+		assert.InDelta(t, sum/float64(len(values)), s.Avg(), 1e-9, tc.name)
+
+		for _, q := range []float64{0, 0.01, 0.25, 0.5, 0.75, 0.95, 0.99, 1} {
+			want := exactQuantile(values, q)
+			assert.InDelta(t, want, s.Quantile(q), math.Abs(want)*Accuracy+1e-9, tc.name)
+		}
+	}
+
+	// Empty sketch.
+	var s Sketch
+	assert.Equal(t, float64(0), s.Quantile(0.5))
+	assert.Equal(t, float64(0), s.Avg())
+	s.Add(math.NaN())
+	assert.Equal(t, uint64(0), s.Count())
+}
+
+func TestSketch_Merge(t *testing.T) {
+	rnd := rand.New(rand.NewSource(1))
+
+	var all, a, b Sketch
+	for i := 0; i < 5000; i++ {
+		v := rnd.ExpFloat64() * 100
+		all.Add(v)
+		a.Add(v)
+
+		v = rnd.ExpFloat64() * 10000
+		all.Add(v)
+		b.Add(v)
+	}
+
+	a.Merge(&b)
+	a.Merge(&Sketch{})
+	assert.Equal(t, all.Count(), a.Count())
+	assert.Equal(t, all.Min(), a.Min())
+	assert.Equal(t, all.Max(), a.Max())
+	for _, q := range []float64{0.5, 0.95, 0.99} {
+		assert.Equal(t, all.Quantile(q), a.Quantile(q))
+	}
+
+	// Merging into empty sketch.
+	var c Sketch
+	c.Merge(&b)
+	assert.Equal(t, b.Quantile(0.5), c.Quantile(0.5))
+	assert.Equal(t, b.Min(), c.Min())
+}
+
+func TestSketch_bounded(t *testing.T) {
+	var s Sketch
+
+	// Values spread over the widest range use bounded number of buckets, the highest quantiles are kept accurate.
+	for e := -9.0; e <= 15; e += 0.001 {
+		s.Add(math.Pow(10, e))
+	}
+	assert.LessOrEqual(t, len(s.pos.bins), MaxBins)
+	assert.Equal(t, s.Max(), s.Quantile(1))
+	want := math.Pow(10, 15-24*0.01)
+	assert.InDelta(t, want, s.Quantile(0.99), want*Accuracy*1.1)
+
+	// Memory is reused after reset.
+	s.Reset()
+	assert.Equal(t, uint64(0), s.Count())
+	s.Add(5)
+	s.Add(7)
+	assert.Equal(t, float64(5), s.Quantile(0))
+	assert.InDelta(t, 5, s.Quantile(0.5), 5*Accuracy)
+}
+
+// BenchmarkSketch_Add adds values of wide range into the sketch.
+func BenchmarkSketch_Add(b *testing.B) {
+	rnd := rand.New(rand.NewSource(1))
+	values := make([]float64, 1024)
+	for i := range values {
+		values[i] = math.Exp(rnd.NormFloat64() * 3)
+	}
+
+	var s Sketch
+	b.ReportAllocs()
+	b.ResetTimer()
+
+	for i := 0; i < b.N; i++ {
+		s.Add(values[i%len(values)])
+	}
+}
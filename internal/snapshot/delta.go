@@ -0,0 +1,351 @@
+package snapshot
+
+import (
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"math"
+	"time"
+)
+
+// Operations of delta frame, each operation produces rows of the snapshot using rows of the previous snapshot.
+const (
+	opCopy   byte = iota // copy run of unchanged rows of the previous snapshot
+	opChange             // take row of the previous snapshot and change values of some columns
+	opNew                // add row which doesn't exist in the previous snapshot
+)
+
+// Kinds of encoded values.
+const (
+	valueNull   byte = iota // value is NULL
+	valueFull               // value is encoded as is
+	valueDelta              // integer value is encoded as difference with value of the previous snapshot
+	valueScaled             // float value is encoded as difference with value of the previous snapshot scaled by precision
+)
+
+// maxExactFloat defines max absolute value of integer which could be represented by float exactly.
+const maxExactFloat = 1 << 53
+
+// pow10 contains powers of ten used for scaling floats, max power corresponds to the max precision of floats.
+var pow10 = [...]float64{1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15}
+
+// appendDelta appends snapshot of the view encoded as difference with the previous snapshot of the view. Rows of
+// snapshots are matched using unique key column. Runs of unchanged rows are encoded as references to rows of the
+// previous snapshot, only changed values of changed rows are written. Values of the key are not required to be unique,
+// rows are restored from referenced rows and written changes, hence duplicate keys only make encoding less efficient.
+func (v *writerView) appendDelta(buf []byte, ts time.Time, res stat.PGresult) []byte {
+	buf = appendUvarint(buf, v.id)
+	buf = appendVarint(buf, ts.UnixNano())
+	buf = appendUvarint(buf, uint64(res.Nrows))
+	buf = v.appendDictionaries(buf, res)
+
+	for i := range res.Columns {
+		if res.Columns[i].Type == stat.FloatColumn {
+			buf = appendUvarint(buf, uint64(res.Columns[i].Prec))
+		}
+	}
+
+	prev, key := &v.prev, &res.Columns[v.ukey]
+	mask := make([]byte, (len(res.Columns)+7)/8)
+
+	for j := 0; j < res.Nrows; {
+		p, ok := v.prevIdx.Lookup(key, j)
+		if !ok {
+			buf = append(buf, opNew)
+			for i := range res.Columns {
+				buf = appendValue(buf, &res.Columns[i], j, v.dicts[i])
+			}
+			j++
+			continue
+		}
+
+		if rowsEqual(&res, j, prev, p) {
+			n := 1
+			for j+n < res.Nrows && p+n < prev.Nrows && rowsEqual(&res, j+n, prev, p+n) {
+				n++
+			}
+
+			buf = append(buf, opCopy)
+			buf = appendUvarint(buf, uint64(p))
+			buf = appendUvarint(buf, uint64(n))
+			j += n
+			continue
+		}
+
+		for i := range mask {
+			mask[i] = 0
+		}
+		for i := range res.Columns {
+			if !cellsEqual(&res.Columns[i], j, &prev.Columns[i], p) {
+				mask[i/8] |= 1 << uint(i%8)
+			}
+		}
+
+		buf = append(buf, opChange)
+		buf = appendUvarint(buf, uint64(p))
+		buf = append(buf, mask...)
+		for i := range res.Columns {
+			if mask[i/8]&(1<<uint(i%8)) != 0 {
+				buf = appendChange(buf, &res.Columns[i], j, &prev.Columns[i], p, v.dicts[i])
+			}
+		}
+		j++
+	}
+
+	return buf
+}
+
+// appendValue appends value of the column as is.
+func appendValue(buf []byte, c *stat.Column, i int, dict map[string]int) []byte {
+	if c.IsNull(i) {
+		return append(buf, valueNull)
+	}
+
+	buf = append(buf, valueFull)
+	switch c.Type {
+	case stat.IntColumn:
+		return appendVarint(buf, c.Int[i])
+	case stat.FloatColumn:
+		return appendFloat(buf, c.Float[i])
+	default:
+		return appendUvarint(buf, uint64(dict[c.Text[i]]))
+	}
+}
+
+// appendChange appends value of the column encoded as difference with value of the previous snapshot when possible.
+func appendChange(buf []byte, c *stat.Column, i int, prev *stat.Column, j int, dict map[string]int) []byte {
+	if c.IsNull(i) || prev.IsNull(j) {
+		return appendValue(buf, c, i, dict)
+	}
+
+	switch c.Type {
+	case stat.IntColumn:
+		buf = append(buf, valueDelta)
+		return appendVarint(buf, c.Int[i]-prev.Int[j])
+	case stat.FloatColumn:
+		// Floats are scaled to integers using precision of the column, the difference is used only if it allows
+		// to restore the value exactly.
+		ps, cs := scaleFloat(prev.Float[j], c.Prec), scaleFloat(c.Float[i], c.Prec)
+		if math.Abs(ps) < maxExactFloat && math.Abs(cs) < maxExactFloat {
+			delta := int64(cs) - int64(ps)
+			if math.Float64bits(applyScaledDelta(prev.Float[j], delta, c.Prec)) == math.Float64bits(c.Float[i]) {
+				buf = append(buf, valueScaled)
+				return appendVarint(buf, delta)
+			}
+		}
+	}
+
+	return appendValue(buf, c, i, dict)
+}
+
+// readDelta decodes snapshot encoded as difference with the previous snapshot of the view.
+func (v *readerView) readDelta(d *decoder, nrows int) {
+	prev, res := &v.last, &v.next
+	resetColumns(res, v.types)
+
+	for i := range res.Columns {
+		if res.Columns[i].Type == stat.FloatColumn {
+			res.Columns[i].Prec = int(d.uvarint())
+		}
+	}
+
+	mask := make([]byte, (len(res.Columns)+7)/8)
+
+	var rows int
+	for rows < nrows && d.err == nil {
+		switch d.byte() {
+		case opCopy:
+			p, n := d.uvarint(), d.uvarint()
+			if n == 0 || p > uint64(prev.Nrows) || n > uint64(prev.Nrows)-p || n > uint64(nrows-rows) {
+				d.err = ErrDamaged
+				return
+			}
+			for k := int(p); k < int(p)+int(n); k++ {
+				for i := range res.Columns {
+					copyValue(&res.Columns[i], &prev.Columns[i], k)
+				}
+			}
+			rows += int(n)
+		case opChange:
+			p := d.uvarint()
+			if p >= uint64(prev.Nrows) {
+				d.err = ErrDamaged
+				return
+			}
+			copy(mask, d.bytes(len(mask)))
+			for i := range res.Columns {
+				if mask[i/8]&(1<<uint(i%8)) != 0 {
+					readValue(d, &res.Columns[i], &prev.Columns[i], int(p), v.dicts[i])
+				} else {
+					copyValue(&res.Columns[i], &prev.Columns[i], int(p))
+				}
+			}
+			rows++
+		case opNew:
+			for i := range res.Columns {
+				readValue(d, &res.Columns[i], nil, 0, v.dicts[i])
+			}
+			rows++
+		default:
+			d.err = ErrDamaged
+		}
+	}
+
+	res.Cols, res.Ncols, res.Nrows, res.Valid = v.cols, len(v.cols), rows, true
+}
+
+// readValue decodes value and appends it to the column. Value might be encoded as difference with value of the
+// previous snapshot's column.
+func readValue(d *decoder, c *stat.Column, prev *stat.Column, j int, dict []string) {
+	kind := d.byte()
+	if kind == valueNull {
+		appendNullValue(c)
+		return
+	}
+
+	switch {
+	case kind == valueFull && c.Type == stat.IntColumn:
+		appendInt(c, d.varint())
+	case kind == valueFull && c.Type == stat.FloatColumn:
+		appendFloatValue(c, d.float())
+	case kind == valueFull && c.Type == stat.TextColumn:
+		k := d.uvarint()
+		if k >= uint64(len(dict)) {
+			d.err = ErrDamaged
+			return
+		}
+		appendText(c, dict[k])
+	case kind == valueDelta && c.Type == stat.IntColumn && prev != nil:
+		appendInt(c, prev.Int[j]+d.varint())
+	case kind == valueScaled && c.Type == stat.FloatColumn && prev != nil:
+		appendFloatValue(c, applyScaledDelta(prev.Float[j], d.varint(), c.Prec))
+	default:
+		d.err = ErrDamaged
+	}
+}
+
+// rowsEqual returns true if values of all columns of rows of passed snapshots are equal.
+func rowsEqual(a *stat.PGresult, i int, b *stat.PGresult, j int) bool {
+	for k := range a.Columns {
+		if !cellsEqual(&a.Columns[k], i, &b.Columns[k], j) {
+			return false
+		}
+	}
+	return true
+}
+
+// cellsEqual returns true if value 'i' of column 'a' is equal to value 'j' of column 'b', columns have the same type.
+func cellsEqual(a *stat.Column, i int, b *stat.Column, j int) bool {
+	if a.IsNull(i) || b.IsNull(j) {
+		return a.IsNull(i) == b.IsNull(j)
+	}
+
+	switch a.Type {
+	case stat.IntColumn:
+		return a.Int[i] == b.Int[j]
+	case stat.FloatColumn:
+		return math.Float64bits(a.Float[i]) == math.Float64bits(b.Float[j])
+	default:
+		return a.Text[i] == b.Text[j]
+	}
+}
+
+// scaleFloat returns float value scaled by precision and rounded.
+func scaleFloat(v float64, prec int) float64 {
+	return math.Round(v * pow10[prec])
+}
+
+// applyScaledDelta returns float value which differs from passed value by scaled delta.
+func applyScaledDelta(v float64, delta int64, prec int) float64 {
+	return float64(int64(scaleFloat(v, prec))+delta) / pow10[prec]
+}
+
+// copyValue appends value with passed number of source column to the column.
+func copyValue(c *stat.Column, src *stat.Column, j int) {
+	if src.IsNull(j) {
+		appendNullValue(c)
+		return
+	}
+
+	switch src.Type {
+	case stat.IntColumn:
+		appendInt(c, src.Int[j])
+	case stat.FloatColumn:
+		appendFloatValue(c, src.Float[j])
+	default:
+		appendText(c, src.Text[j])
+	}
+}
+
+// appendNullValue appends NULL value to the column.
+func appendNullValue(c *stat.Column) {
+	if c.Null == nil {
+		c.Null = make([]bool, c.Len(), c.Len()+1)
+	}
+	c.Null = append(c.Null, true)
+
+	switch c.Type {
+	case stat.IntColumn:
+		c.Int = append(c.Int, 0)
+	case stat.FloatColumn:
+		c.Float = append(c.Float, 0)
+	default:
+		c.Text = append(c.Text, "")
+	}
+}
+
+func appendInt(c *stat.Column, v int64) {
+	if c.Null != nil {
+		c.Null = append(c.Null, false)
+	}
+	c.Int = append(c.Int, v)
+}
+
+func appendFloatValue(c *stat.Column, v float64) {
+	if c.Null != nil {
+		c.Null = append(c.Null, false)
+	}
+	c.Float = append(c.Float, v)
+}
+
+func appendText(c *stat.Column, v string) {
+	if c.Null != nil {
+		c.Null = append(c.Null, false)
+	}
+	c.Text = append(c.Text, v)
+}
+
+// resetColumns truncates columns of the result and sets their types, memory allocated for values is kept for reusing.
+func resetColumns(res *stat.PGresult, types []stat.ColumnType) {
+	if cap(res.Columns) < len(types) {
+		res.Columns = make([]stat.Column, len(types))
+	}
+	res.Columns = res.Columns[:len(types)]
+
+	for i, t := range types {
+		c := &res.Columns[i]
+		c.Type, c.Prec = t, 0
+		c.Text, c.Int, c.Float, c.Null = c.Text[:0], c.Int[:0], c.Float[:0], nil
+	}
+}
+
+// copyResult copies values of source result into the result, memory of the result is reused.
+func copyResult(res *stat.PGresult, src *stat.PGresult) {
+	if cap(res.Columns) < len(src.Columns) {
+		res.Columns = make([]stat.Column, len(src.Columns))
+	}
+	res.Columns = res.Columns[:len(src.Columns)]
+
+	for i := range src.Columns {
+		c, s := &res.Columns[i], &src.Columns[i]
+		c.Type, c.Prec = s.Type, s.Prec
+		c.Text = append(c.Text[:0], s.Text...)
+		c.Int = append(c.Int[:0], s.Int...)
+		c.Float = append(c.Float[:0], s.Float...)
+		if s.Null != nil {
+			c.Null = append(c.Null[:0], s.Null...)
+		} else {
+			c.Null = nil
+		}
+	}
+
+	res.Cols, res.Ncols, res.Nrows, res.Valid = src.Cols, src.Ncols, src.Nrows, src.Valid
+}
@@ -0,0 +1,222 @@
+package snapshot
+
+import (
+	"bytes"
+	"database/sql"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"math"
+	"testing"
+	"time"
+)
+
+// newDeltaTestSnapshots returns consecutive stats snapshots with various changes between them.
+func newDeltaTestSnapshots() []stat.PGresult {
+	cols := []string{"relname", "seq_scan", "vacuum_t", "comment"}
+	v := func(s string) sql.NullString { return sql.NullString{String: s, Valid: true} }
+	null := sql.NullString{}
+
+	return []stat.PGresult{
+		stat.NewPGresultFromValues(cols, [][]sql.NullString{
+			{v("table_1"), v("10"), v("1.25"), null},
+			{v("table_2"), v("20"), null, v("example")},
+			{v("table_3"), v("30"), v("3.50"), v("example")},
+			{v("table_4"), v("40"), v("4.75"), v("other")},
+		}),
+		// nothing changed
+		stat.NewPGresultFromValues(cols, [][]sql.NullString{
+			{v("table_1"), v("10"), v("1.25"), null},
+			{v("table_2"), v("20"), null, v("example")},
+			{v("table_3"), v("30"), v("3.50"), v("example")},
+			{v("table_4"), v("40"), v("4.75"), v("other")},
+		}),
+		// counters changed, NULLs appeared and disappeared, rows reordered
+		stat.NewPGresultFromValues(cols, [][]sql.NullString{
+			{v("table_3"), v("35"), v("3.75"), v("example")},
+			{v("table_4"), v("40"), v("4.75"), v("other")},
+			{v("table_1"), v("9"), v("1.30"), v("new label")},
+			{v("table_2"), null, v("2.00"), null},
+		}),
+		// rows removed and added
+		stat.NewPGresultFromValues(cols, [][]sql.NullString{
+			{v("table_5"), v("50"), v("5.00"), null},
+			{v("table_3"), v("36"), v("3.75"), v("example")},
+			{v("table_1"), v("9"), v("1.30"), v("new label")},
+		}),
+		// duplicate and NULL keys
+		stat.NewPGresultFromValues(cols, [][]sql.NullString{
+			{v("table_5"), v("50"), v("5.00"), null},
+			{v("table_5"), v("51"), v("5.01"), null},
+			{null, v("1"), v("1.00"), null},
+			{null, v("2"), v("2.00"), null},
+			{v(""), v("3"), v("3.00"), null},
+		}),
+		stat.NewPGresultFromValues(cols, [][]sql.NullString{
+			{v("table_5"), v("52"), v("5.02"), null},
+			{v(""), v("3"), v("3.00"), null},
+			{null, v("2"), v("2.00"), null},
+			{v("table_5"), v("53"), v("5.02"), null},
+		}),
+		// precision and schema changes
+		stat.NewPGresultFromValues(cols, [][]sql.NullString{
+			{v("table_5"), v("53"), v("5.021"), null},
+		}),
+		stat.NewPGresultFromValues(cols, [][]sql.NullString{
+			{v("table_5"), v("53.5"), v("5.021"), null},
+		}),
+		// empty snapshot
+		stat.NewPGresultFromValues(cols, [][]sql.NullString{}),
+	}
+}
+
+// assertSnapshotsEqual checks that values of snapshots are equal.
+func assertSnapshotsEqual(t *testing.T, want, got stat.PGresult) {
+	assert.True(t, got.Valid)
+	assert.Equal(t, want.Cols, got.Cols)
+	assert.Equal(t, want.Ncols, got.Ncols)
+	assert.Equal(t, want.Nrows, got.Nrows)
+	for j := range want.Columns {
+		assert.Equal(t, want.Columns[j].Type, got.Columns[j].Type)
+		assert.Equal(t, want.Columns[j].Prec, got.Columns[j].Prec)
+		for k := 0; k < want.Nrows; k++ {
+			assert.Equal(t, want.Value(k, j), got.Value(k, j))
+			assert.Equal(t, want.Columns[j].IsNull(k), got.Columns[j].IsNull(k))
+		}
+	}
+}
+
+func TestWriter_delta(t *testing.T) {
+	snapshots := newDeltaTestSnapshots()
+	ts := time.Date(2021, 1, 1, 12, 0, 0, 0, time.UTC)
+
+	buf := bytes.NewBufferString(Magic)
+	w := NewWriter(buf)
+	w.EnableDelta(map[string]int{"tables": 0})
+	for i, s := range snapshots {
+		assert.NoError(t, w.Write("tables", ts.Add(time.Duration(i)*time.Second), s))
+		assert.NoError(t, w.Write("other", ts, snapshots[0]))
+	}
+
+	// Read all views.
+	r, err := NewReader(bytes.NewReader(buf.Bytes()))
+	assert.NoError(t, err)
+
+	var res stat.PGresult
+	for i := range snapshots {
+		name, got, err := r.Next()
+		assert.NoError(t, err)
+		assert.Equal(t, "tables", name)
+		assert.True(t, ts.Add(time.Duration(i)*time.Second).Equal(got))
+		assert.NoError(t, r.Read(&res))
+		assertSnapshotsEqual(t, snapshots[i], res)
+
+		name, _, err = r.Next()
+		assert.NoError(t, err)
+		assert.Equal(t, "other", name)
+		assert.NoError(t, r.Read(&res))
+		assertSnapshotsEqual(t, snapshots[0], res)
+	}
+	_, _, err = r.Next()
+	assert.Equal(t, io.EOF, err)
+
+	// Read single view.
+	r, err = NewReader(bytes.NewReader(buf.Bytes()))
+	assert.NoError(t, err)
+	r.SetViews("tables")
+
+	for i := range snapshots {
+		name, _, err := r.Next()
+		assert.NoError(t, err)
+		assert.Equal(t, "tables", name)
+		assert.NoError(t, r.Read(&res))
+		assertSnapshotsEqual(t, snapshots[i], res)
+	}
+	_, _, err = r.Next()
+	assert.Equal(t, io.EOF, err)
+}
+
+func TestWriter_delta_size(t *testing.T) {
+	snapshots := newDeltaTestSnapshots()
+
+	// Unchanged snapshot is written as a single run of copied rows.
+	full, delta := &bytes.Buffer{}, &bytes.Buffer{}
+	w := NewWriter(delta)
+	w.EnableDelta(map[string]int{"tables": 0})
+	assert.NoError(t, w.Write("tables", time.Now(), snapshots[0]))
+	assert.NoError(t, NewWriter(full).Write("tables", time.Now(), snapshots[0]))
+	assert.Equal(t, full.Len(), delta.Len()) // keyframe
+
+	delta.Reset()
+	assert.NoError(t, w.Write("tables", time.Now(), snapshots[1]))
+	assert.Less(t, delta.Len(), 30)
+
+	// Segment starts with keyframe.
+	delta.Reset()
+	assert.NoError(t, w.StartSegment())
+	assert.NoError(t, w.Write("tables", time.Now(), snapshots[1]))
+	assert.Equal(t, full.Len(), delta.Len())
+}
+
+func TestReaderView_readDelta_damaged(t *testing.T) {
+	last := stat.NewPGresultFromValues([]string{"seq_scan"}, [][]sql.NullString{
+		{{String: "10", Valid: true}}, {{String: "20", Valid: true}},
+	})
+	appendCopy := func(buf []byte, p, n uint64) []byte {
+		buf = append(buf, opCopy)
+		return appendUvarint(appendUvarint(buf, p), n)
+	}
+
+	testcases := []struct {
+		name string
+		buf  []byte
+	}{
+		{name: "empty run", buf: appendCopy(nil, 0, 0)},
+		{name: "run out of previous rows", buf: appendCopy(nil, 1, 2)},
+		{name: "run start out of previous rows", buf: appendCopy(nil, 3, 1)},
+		{name: "too many rows", buf: appendCopy(appendCopy(nil, 0, 1), 0, 2)},
+		// Sums of the run start and length or number of rows overflow and wrap around.
+		{name: "overflowed run", buf: appendCopy(appendCopy(appendCopy(nil, 0, 1), 1, math.MaxUint64), 0, 2)},
+	}
+
+	for _, tc := range testcases {
+		t.Run(tc.name, func(t *testing.T) {
+			v := &readerView{cols: last.Cols, types: []stat.ColumnType{last.Columns[0].Type}, dicts: make([][]string, 1), last: last}
+			d := decoder{buf: tc.buf}
+			v.readDelta(&d, 2)
+			assert.Equal(t, ErrDamaged, d.err)
+		})
+	}
+}
+
+func Test_appendChange(t *testing.T) {
+	testcases := []struct {
+		prev float64
+		curr float64
+		prec int
+		kind byte
+	}{
+		{prev: 1.25, curr: 1.5, prec: 2, kind: valueScaled},
+		{prev: 0.1, curr: 0.3, prec: 1, kind: valueScaled},
+		{prev: 123456.789, curr: 123457.001, prec: 3, kind: valueScaled},
+		{prev: 1.25, curr: 1.2345678, prec: 2, kind: valueFull}, // value has more digits than precision
+		{prev: 1e300, curr: 2e300, prec: 2, kind: valueFull},    // values are too large
+		{prev: 1, curr: math.NaN(), prec: 2, kind: valueFull},
+	}
+
+	for _, tc := range testcases {
+		prev := stat.Column{Type: stat.FloatColumn, Float: []float64{tc.prev}, Prec: tc.prec}
+		curr := stat.Column{Type: stat.FloatColumn, Float: []float64{tc.curr}, Prec: tc.prec}
+
+		buf := appendChange(nil, &curr, 0, &prev, 0, nil)
+		assert.Equal(t, tc.kind, buf[0])
+
+		// Decoded value must be exactly the same.
+		var got stat.Column
+		got.Type, got.Prec = stat.FloatColumn, tc.prec
+		d := decoder{buf: buf}
+		readValue(&d, &got, &prev, 0, nil)
+		assert.NoError(t, d.err)
+		assert.Equal(t, math.Float64bits(tc.curr), math.Float64bits(got.Float[0]))
+	}
+}
@@ -0,0 +1,234 @@
+package snapshot
+
+import (
+	"bufio"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"io"
+	"time"
+)
+
+// Reader reads stats snapshots in binary snapshot format.
+type Reader struct {
+	r      *bufio.Reader
+	views  map[uint64]*readerView // views defined in the current segment
+	names  map[string]bool        // names of views which snapshots are read, all views are read if nil
+	buf    []byte                 // buffer for reading frames
+	curr   *readerView            // view of the current snapshot
+	offset int64                  // number of bytes of complete frames read
+}
+
+// readerView describes state of the view within current segment.
+type readerView struct {
+	name  string
+	cols  []string
+	types []stat.ColumnType
+	dicts [][]string    // dictionaries of text columns
+	last  stat.PGresult // the last decoded snapshot of the view, used as a base for delta-encoded snapshots
+	next  stat.PGresult // buffer for decoding the next snapshot
+	valid bool          // the last snapshot has been decoded in the current segment
+}
+
+// NewReader creates new reader, magic header is read and checked.
+func NewReader(r io.Reader) (*Reader, error) {
+	br := bufio.NewReaderSize(r, 64*1024)
+
+	header := make([]byte, len(Magic))
+	_, err := io.ReadFull(br, header)
+	if err != nil || !IsSnapshotFile(header) {
+		return nil, fmt.Errorf("not a snapshot file")
+	}
+
+	return NewSegmentReader(br), nil
+}
+
+// NewSegmentReader creates new reader of frames starting at the beginning of a segment, e.g. when reading is started
+// in the middle of the file. Magic header is not read.
+func NewSegmentReader(r io.Reader) *Reader {
+	br, ok := r.(*bufio.Reader)
+	if !ok {
+		br = bufio.NewReaderSize(r, 64*1024)
+	}
+
+	return &Reader{r: br, views: map[uint64]*readerView{}}
+}
+
+// SetViews limits snapshots returned by the reader to snapshots of views with passed names, snapshots of other views
+// are skipped without decoding.
+func (r *Reader) SetViews(names ...string) {
+	r.names = map[string]bool{}
+	for _, name := range names {
+		r.names[name] = true
+	}
+}
+
+// Next advances to the next snapshot and returns its view name and timestamp. Values of the snapshot could be read
+// using Read. Returns io.EOF when there are no more snapshots.
+func (r *Reader) Next() (string, time.Time, error) {
+	r.curr = nil
+
+	for {
+		typ, payload, size, err := readFrame(r.r, r.buf)
+		r.buf = payload[:cap(payload)]
+		if err != nil {
+			return "", time.Time{}, err
+		}
+		r.offset += int64(size)
+
+		d := decoder{buf: payload}
+
+		switch typ {
+		case frameSegment:
+			r.views = map[uint64]*readerView{}
+		case frameSchema:
+			id := d.uvarint()
+			v := &readerView{name: d.string()}
+			ncols := d.count(2)
+			v.cols = make([]string, ncols)
+			v.types = make([]stat.ColumnType, ncols)
+			v.dicts = make([][]string, ncols)
+			for i := 0; i < ncols; i++ {
+				v.cols[i] = d.string()
+				v.types[i] = stat.ColumnType(d.byte())
+			}
+			if d.err != nil {
+				return "", time.Time{}, d.err
+			}
+			r.views[id] = v
+		case frameData, frameDelta:
+			v, ok := r.views[d.uvarint()]
+			if !ok {
+				return "", time.Time{}, ErrDamaged
+			}
+
+			if r.names != nil && !r.names[v.name] {
+				continue
+			}
+
+			ts, err := v.read(&d, typ)
+			if err != nil {
+				return "", time.Time{}, err
+			}
+
+			r.curr = v
+			return v.name, ts, nil
+		default:
+			return "", time.Time{}, ErrDamaged
+		}
+	}
+}
+
+// Offset returns number of bytes of complete frames read by the reader, magic header is not counted. Frames which
+// have been read partially are not counted, hence reading could be resumed at the returned offset from the position
+// where the reader has been started.
+func (r *Reader) Offset() int64 {
+	return r.offset
+}
+
+// Read copies values of the current snapshot into passed result, memory of the result is reused.
+func (r *Reader) Read(res *stat.PGresult) error {
+	if r.curr == nil {
+		return fmt.Errorf("no current snapshot")
+	}
+
+	copyResult(res, &r.curr.last)
+
+	return nil
+}
+
+// read decodes snapshot of the view from payload of data or delta frame. Decoded snapshot becomes the last snapshot
+// of the view.
+func (v *readerView) read(d *decoder, typ byte) (time.Time, error) {
+	ts := time.Unix(0, d.varint())
+	nrows := int(d.uvarint())
+	if nrows > maxFrameSize {
+		return time.Time{}, ErrDamaged
+	}
+
+	// New entries of dictionaries are written before values.
+	for i, t := range v.types {
+		if t != stat.TextColumn {
+			continue
+		}
+		n := d.count(1)
+		for j := 0; j < n; j++ {
+			v.dicts[i] = append(v.dicts[i], d.string())
+		}
+	}
+
+	if typ == frameDelta {
+		if !v.valid {
+			return time.Time{}, ErrDamaged
+		}
+		v.readDelta(d, nrows)
+	} else {
+		resetColumns(&v.next, v.types)
+		for i, t := range v.types {
+			readColumn(d, &v.next.Columns[i], t, nrows, v.dicts[i])
+		}
+		v.next.Cols, v.next.Ncols, v.next.Nrows, v.next.Valid = v.cols, len(v.cols), nrows, true
+	}
+
+	if d.err != nil {
+		v.valid = false
+		return time.Time{}, d.err
+	}
+
+	v.last, v.next = v.next, v.last
+	v.valid = true
+
+	return ts, nil
+}
+
+// readColumn decodes NULL bitmap and values of the column.
+func readColumn(d *decoder, c *stat.Column, t stat.ColumnType, nrows int, dict []string) {
+	c.Type, c.Prec = t, 0
+	c.Text, c.Int, c.Float, c.Null = c.Text[:0], c.Int[:0], c.Float[:0], c.Null[:0]
+
+	if d.byte() == 1 {
+		bitmap := d.bytes((nrows + 7) / 8)
+		if bitmap == nil {
+			return
+		}
+		for j := 0; j < nrows; j++ {
+			c.Null = append(c.Null, bitmap[j/8]&(1<<uint(j%8)) != 0)
+		}
+	} else {
+		c.Null = nil
+	}
+
+	switch t {
+	case stat.IntColumn:
+		for j := 0; j < nrows; j++ {
+			var v int64
+			if !c.IsNull(j) {
+				v = d.varint()
+			}
+			c.Int = append(c.Int, v)
+		}
+	case stat.FloatColumn:
+		c.Prec = int(d.uvarint())
+		for j := 0; j < nrows; j++ {
+			var v float64
+			if !c.IsNull(j) {
+				v = d.float()
+			}
+			c.Float = append(c.Float, v)
+		}
+	case stat.TextColumn:
+		for j := 0; j < nrows; j++ {
+			var v string
+			if !c.IsNull(j) {
+				k := d.uvarint()
+				if k >= uint64(len(dict)) {
+					d.err = ErrDamaged
+					return
+				}
+				v = dict[k]
+			}
+			c.Text = append(c.Text, v)
+		}
+	default:
+		d.err = ErrDamaged
+	}
+}
@@ -0,0 +1,226 @@
+// Package snapshot implements compact binary columnar format for recorded stats snapshots.
+//
+// File starts with magic header followed by a sequence of frames. Each frame consists of type byte, varint length of
+// payload, payload and CRC32 checksum of the payload. There are four types of frames:
+//   - segment frame starts a new segment, schemas and dictionaries of all views defined before are discarded;
+//   - schema frame defines name, columns' names and types of a view within the segment;
+//   - data frame contains a single snapshot of the view: timestamp, number of rows, new entries of dictionaries of text
+//     columns and values of columns;
+//   - delta frame contains a snapshot of the view encoded as difference with the previous snapshot of the view in the
+//     segment: runs of unchanged rows are encoded as references to rows of the previous snapshot, for changed rows
+//     only changed values are written, counters are written as differences with their previous values.
+//
+// Values of text columns are encoded as numbers of entries in per-column dictionaries, dictionaries grow across
+// snapshots of the segment, hence repeated labels are stored once per segment. Values of integer columns are encoded
+// as zig-zag varints, values of float columns as 64-bit IEEE 754 numbers. NULLs are stored in bitmaps.
+package snapshot
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"hash/crc32"
+	"io"
+	"math"
+)
+
+// Magic is the header of files in binary snapshot format.
+const Magic = "PGCSTAT\x01"
+
+// Types of frames.
+const (
+	frameSegment byte = 'G'
+	frameSchema  byte = 'S'
+	frameData    byte = 'D'
+	frameDelta   byte = 'E'
+)
+
+// maxFrameSize defines max allowed size of frame payload, larger frames are considered as damaged.
+const maxFrameSize = 1 << 30
+
+// ErrDamaged is returned when frame is damaged and could not be decoded.
+var ErrDamaged = errors.New("damaged snapshot frame")
+
+// IsSnapshotFile returns true if passed beginning of file is a header of the binary snapshot format.
+func IsSnapshotFile(header []byte) bool {
+	return bytes.HasPrefix(header, []byte(Magic))
+}
+
+// Recover scans file in binary snapshot format and returns offset of the end of the last complete frame. Scanning stops
+// at the first incomplete or damaged frame. Zero offset is returned for empty file.
+func Recover(r io.Reader) (int64, error) {
+	br := bufio.NewReader(r)
+
+	header := make([]byte, len(Magic))
+	n, err := io.ReadFull(br, header)
+	if n == 0 && err == io.EOF {
+		return 0, nil
+	}
+	if err != nil || !IsSnapshotFile(header) {
+		return 0, fmt.Errorf("not a snapshot file")
+	}
+
+	offset := int64(len(Magic))
+	var buf []byte
+	for {
+		var size int
+		_, buf, size, err = readFrame(br, buf)
+		if err != nil {
+			break
+		}
+		offset += int64(size)
+	}
+
+	return offset, nil
+}
+
+// appendFrame appends frame with passed type and payload to the buffer.
+func appendFrame(buf []byte, typ byte, payload []byte) []byte {
+	buf = append(buf, typ)
+	buf = appendUvarint(buf, uint64(len(payload)))
+	buf = append(buf, payload...)
+	var sum [4]byte
+	binary.LittleEndian.PutUint32(sum[:], crc32.ChecksumIEEE(payload))
+	return append(buf, sum[:]...)
+}
+
+// readFrame reads frame from the reader and returns its type, payload read into memory of passed buffer and total size
+// of the frame. Returns io.EOF if there are no more frames and io.ErrUnexpectedEOF if frame is incomplete.
+func readFrame(r *bufio.Reader, buf []byte) (byte, []byte, int, error) {
+	typ, err := r.ReadByte()
+	if err != nil {
+		return 0, buf, 0, err
+	}
+
+	length, err := binary.ReadUvarint(r)
+	if err != nil {
+		return 0, buf, 0, io.ErrUnexpectedEOF
+	}
+	if length > maxFrameSize {
+		return 0, buf, 0, ErrDamaged
+	}
+
+	size := int(length) + 4
+	if cap(buf) < size {
+		buf = make([]byte, size)
+	}
+	buf = buf[:size]
+
+	_, err = io.ReadFull(r, buf)
+	if err != nil {
+		return 0, buf, 0, io.ErrUnexpectedEOF
+	}
+
+	payload, sum := buf[:length], buf[length:]
+	if crc32.ChecksumIEEE(payload) != binary.LittleEndian.Uint32(sum) {
+		return 0, buf, 0, ErrDamaged
+	}
+
+	return typ, payload, 1 + uvarintLen(length) + size, nil
+}
+
+// appendUvarint appends unsigned varint to the buffer.
+func appendUvarint(buf []byte, v uint64) []byte {
+	for v >= 0x80 {
+		buf = append(buf, byte(v)|0x80)
+		v >>= 7
+	}
+	return append(buf, byte(v))
+}
+
+// appendVarint appends signed zig-zag varint to the buffer.
+func appendVarint(buf []byte, v int64) []byte {
+	return appendUvarint(buf, uint64(v<<1)^uint64(v>>63))
+}
+
+// appendString appends length-prefixed string to the buffer.
+func appendString(buf []byte, s string) []byte {
+	buf = appendUvarint(buf, uint64(len(s)))
+	return append(buf, s...)
+}
+
+// appendFloat appends 64-bit float to the buffer.
+func appendFloat(buf []byte, v float64) []byte {
+	var b [8]byte
+	binary.LittleEndian.PutUint64(b[:], math.Float64bits(v))
+	return append(buf, b[:]...)
+}
+
+// uvarintLen returns length of unsigned varint.
+func uvarintLen(v uint64) int {
+	n := 1
+	for v >= 0x80 {
+		v >>= 7
+		n++
+	}
+	return n
+}
+
+// decoder reads values from frame payload. The first error is remembered and zero values are returned after that.
+type decoder struct {
+	buf []byte
+	err error
+}
+
+func (d *decoder) uvarint() uint64 {
+	if d.err != nil {
+		return 0
+	}
+	v, n := binary.Uvarint(d.buf)
+	if n <= 0 {
+		d.err = ErrDamaged
+		return 0
+	}
+	d.buf = d.buf[n:]
+	return v
+}
+
+func (d *decoder) varint() int64 {
+	v := d.uvarint()
+	return int64(v>>1) ^ -int64(v&1)
+}
+
+// count reads unsigned varint used as number of subsequent items, each of them takes at least 'min' bytes.
+func (d *decoder) count(min int) int {
+	v := d.uvarint()
+	if v > uint64(len(d.buf)/min) {
+		d.err = ErrDamaged
+		return 0
+	}
+	return int(v)
+}
+
+func (d *decoder) bytes(n int) []byte {
+	if d.err != nil {
+		return nil
+	}
+	if n > len(d.buf) {
+		d.err = ErrDamaged
+		return nil
+	}
+	b := d.buf[:n]
+	d.buf = d.buf[n:]
+	return b
+}
+
+func (d *decoder) byte() byte {
+	b := d.bytes(1)
+	if b == nil {
+		return 0
+	}
+	return b[0]
+}
+
+func (d *decoder) string() string {
+	return string(d.bytes(d.count(1)))
+}
+
+func (d *decoder) float() float64 {
+	b := d.bytes(8)
+	if b == nil {
+		return 0
+	}
+	return math.Float64frombits(binary.LittleEndian.Uint64(b))
+}
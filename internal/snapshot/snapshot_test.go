@@ -0,0 +1,195 @@
+package snapshot
+
+import (
+	"bytes"
+	"database/sql"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"testing"
+	"time"
+)
+
+// newTestSnapshots returns stats snapshots for test purposes.
+func newTestSnapshots() []stat.PGresult {
+	return []stat.PGresult{
+		stat.NewPGresultFromValues(
+			[]string{"relname", "seq_scan", "vacuum_t", "comment"},
+			[][]sql.NullString{
+				{{String: "table_1", Valid: true}, {String: "10", Valid: true}, {String: "1.25", Valid: true}, {String: "", Valid: false}},
+				{{String: "table_2", Valid: true}, {String: "-20", Valid: true}, {String: "", Valid: false}, {String: "example", Valid: true}},
+			},
+		),
+		stat.NewPGresultFromValues(
+			[]string{"relname", "seq_scan", "vacuum_t", "comment"},
+			[][]sql.NullString{
+				{{String: "table_2", Valid: true}, {String: "25", Valid: true}, {String: "2.50", Valid: true}, {String: "example", Valid: true}},
+				{{String: "table_3", Valid: true}, {String: "9223372036854775807", Valid: true}, {String: "0.001", Valid: true}, {String: "", Valid: true}},
+				{{String: "table_1", Valid: true}, {String: "15", Valid: true}, {String: "1.50", Valid: true}, {String: "", Valid: false}},
+			},
+		),
+		// schema change: integer column is promoted to float column.
+		stat.NewPGresultFromValues(
+			[]string{"relname", "seq_scan", "vacuum_t", "comment"},
+			[][]sql.NullString{
+				{{String: "table_1", Valid: true}, {String: "15.5", Valid: true}, {String: "1.50", Valid: true}, {String: "", Valid: false}},
+			},
+		),
+		// empty snapshot
+		stat.NewPGresultFromValues([]string{"relname", "seq_scan", "vacuum_t", "comment"}, [][]sql.NullString{}),
+	}
+}
+
+func TestWriter_Reader(t *testing.T) {
+	snapshots := newTestSnapshots()
+	ts := time.Date(2021, 1, 1, 12, 0, 0, 500, time.UTC)
+
+	buf := bytes.NewBufferString(Magic)
+	w := NewWriter(buf)
+	for i, s := range snapshots {
+		// Start new segment in the middle, dictionaries should be written again.
+		if i == 2 {
+			assert.NoError(t, w.StartSegment())
+		}
+		assert.NoError(t, w.Write("tables", ts.Add(time.Duration(i)*time.Second), s))
+		assert.NoError(t, w.Write("other", ts, snapshots[0]))
+	}
+
+	size := buf.Len()
+	r, err := NewReader(buf)
+	assert.NoError(t, err)
+
+	var res stat.PGresult
+	for i := range snapshots {
+		name, got, err := r.Next()
+		assert.NoError(t, err)
+		assert.Equal(t, "tables", name)
+		assert.True(t, ts.Add(time.Duration(i)*time.Second).Equal(got))
+
+		assert.NoError(t, r.Read(&res))
+		assert.True(t, res.Valid)
+		assert.Equal(t, snapshots[i].Cols, res.Cols)
+		assert.Equal(t, snapshots[i].Nrows, res.Nrows)
+		for j := range res.Columns {
+			assert.Equal(t, snapshots[i].Columns[j].Type, res.Columns[j].Type)
+			assert.Equal(t, snapshots[i].Columns[j].Prec, res.Columns[j].Prec)
+			for k := 0; k < res.Nrows; k++ {
+				assert.Equal(t, snapshots[i].Value(k, j), res.Value(k, j))
+				assert.Equal(t, snapshots[i].Columns[j].IsNull(k), res.Columns[j].IsNull(k))
+			}
+		}
+
+		// skip snapshot of other view without reading
+		name, _, err = r.Next()
+		assert.NoError(t, err)
+		assert.Equal(t, "other", name)
+	}
+
+	_, _, err = r.Next()
+	assert.Equal(t, io.EOF, err)
+	assert.Equal(t, int64(size-len(Magic)), r.Offset())
+
+	// Reading without current snapshot.
+	assert.Error(t, r.Read(&res))
+}
+
+func TestWriter_dictionary(t *testing.T) {
+	s := newTestSnapshots()[0]
+
+	buf := &bytes.Buffer{}
+	w := NewWriter(buf)
+	assert.NoError(t, w.Write("tables", time.Now(), s))
+	first := buf.Len()
+
+	// Labels are already in dictionaries, the second snapshot must be smaller.
+	buf.Reset()
+	assert.NoError(t, w.Write("tables", time.Now(), s))
+	assert.Less(t, buf.Len(), first)
+	for _, label := range []string{"table_1", "table_2", "example"} {
+		assert.NotContains(t, buf.String(), label)
+	}
+}
+
+func TestNewReader(t *testing.T) {
+	_, err := NewReader(bytes.NewBufferString(Magic))
+	assert.NoError(t, err)
+
+	_, err = NewReader(bytes.NewBufferString("invalid header"))
+	assert.Error(t, err)
+
+	_, err = NewReader(bytes.NewBufferString(""))
+	assert.Error(t, err)
+}
+
+func TestReader_damaged(t *testing.T) {
+	buf := bytes.NewBufferString(Magic)
+	w := NewWriter(buf)
+	assert.NoError(t, w.Write("tables", time.Now(), newTestSnapshots()[0]))
+	data := buf.Bytes()
+
+	// Flip a byte in the last frame, checksum must not match.
+	damaged := append([]byte{}, data...)
+	damaged[len(damaged)-10] ^= 0xff
+	r, err := NewReader(bytes.NewReader(damaged))
+	assert.NoError(t, err)
+	_, _, err = r.Next()
+	assert.Equal(t, ErrDamaged, err)
+
+	// Incomplete frame.
+	r, err = NewReader(bytes.NewReader(data[:len(data)-10]))
+	assert.NoError(t, err)
+	_, _, err = r.Next()
+	assert.Equal(t, io.ErrUnexpectedEOF, err)
+}
+
+func TestRecover(t *testing.T) {
+	buf := bytes.NewBufferString(Magic)
+	w := NewWriter(buf)
+	assert.NoError(t, w.Write("tables", time.Now(), newTestSnapshots()[0]))
+	complete := buf.Len()
+	assert.NoError(t, w.Write("tables", time.Now(), newTestSnapshots()[1]))
+	data := buf.Bytes()
+
+	testcases := []struct {
+		data []byte
+		want int64
+		err  bool
+	}{
+		{data: nil, want: 0},
+		{data: []byte(Magic), want: int64(len(Magic))},
+		{data: data, want: int64(len(data))},
+		{data: data[:len(data)-1], want: int64(complete)},
+		{data: data[:complete+1], want: int64(complete)},
+		{data: []byte("invalid header"), err: true},
+	}
+
+	for _, tc := range testcases {
+		got, err := Recover(bytes.NewReader(tc.data))
+		if tc.err {
+			assert.Error(t, err)
+			continue
+		}
+		assert.NoError(t, err)
+		assert.Equal(t, tc.want, got)
+	}
+}
+
+func Test_varint(t *testing.T) {
+	values := []int64{0, 1, -1, 63, -64, 64, 1 << 40, -1 << 40, 9223372036854775807, -9223372036854775808}
+
+	var buf []byte
+	for _, v := range values {
+		buf = appendVarint(buf, v)
+	}
+
+	d := decoder{buf: buf}
+	for _, v := range values {
+		assert.Equal(t, v, d.varint())
+	}
+	assert.NoError(t, d.err)
+	assert.Equal(t, 0, len(d.buf))
+
+	// reading beyond the end of data
+	d.varint()
+	assert.Equal(t, ErrDamaged, d.err)
+}
@@ -0,0 +1,247 @@
+package snapshot
+
+import (
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"io"
+	"time"
+)
+
+// Writer writes stats snapshots in binary snapshot format. Magic header is not written by Writer, it should be written
+// once at the beginning of the file.
+type Writer struct {
+	w         io.Writer
+	views     map[string]*writerView // views known by the writer
+	nextID    uint64                 // identifier of the next new view
+	inSegment bool                   // segment has been started
+	ukeys     map[string]int         // unique keys of delta-encoded views
+	payload   []byte                 // buffer for encoding frames' payload
+	frame     []byte                 // buffer for encoding frames
+}
+
+// writerView describes state of the view within current segment.
+type writerView struct {
+	id      uint64
+	defined bool              // schema of the view has been written in the current segment
+	cols    []string          // names of columns
+	types   []stat.ColumnType // types of columns
+	dicts   []map[string]int  // dictionaries of text columns
+	added   [][]string        // entries added to dictionaries by current snapshot
+	ukey    int               // unique key column of delta-encoded view, -1 if view is not delta-encoded
+	prev    stat.PGresult     // the previous snapshot of delta-encoded view
+	prevIdx *stat.RowIndex    // index of the previous snapshot, nil if there is no previous snapshot in the segment
+}
+
+// NewWriter creates new writer.
+func NewWriter(w io.Writer) *Writer {
+	return &Writer{w: w, views: map[string]*writerView{}}
+}
+
+// EnableDelta enables delta encoding for views with passed names, rows of snapshots are matched using passed unique
+// key columns. Only the first snapshot of the view in the segment is written as is (keyframe), next snapshots are
+// written as differences with the previous ones. Should be called before writing.
+func (w *Writer) EnableDelta(ukeys map[string]int) {
+	w.ukeys = ukeys
+}
+
+// StartSegment starts a new segment. Schemas and dictionaries of all views are written again in the new segment, hence
+// the segment can be decoded without reading the preceding ones.
+func (w *Writer) StartSegment() error {
+	for _, v := range w.views {
+		v.defined = false
+	}
+
+	w.inSegment = true
+	return w.writeFrame(frameSegment, nil)
+}
+
+// Write writes snapshot of the view with passed name and timestamp. Segment is started if it hasn't been started yet.
+func (w *Writer) Write(name string, ts time.Time, res stat.PGresult) error {
+	if !w.inSegment {
+		err := w.StartSegment()
+		if err != nil {
+			return err
+		}
+	}
+
+	v, ok := w.views[name]
+	if !ok {
+		v = &writerView{id: w.nextID, ukey: -1}
+		if ukey, ok := w.ukeys[name]; ok {
+			v.ukey = ukey
+		}
+		w.nextID++
+		w.views[name] = v
+	}
+
+	// Schema of the view is written when view appears in the segment first time, or when its columns are changed.
+	if !v.defined || !v.sameSchema(res) {
+		v.define(res)
+		err := w.writeFrame(frameSchema, v.appendSchema(w.payload[:0], name))
+		if err != nil {
+			return err
+		}
+	}
+
+	if v.ukey < 0 {
+		return w.writeFrame(frameData, v.appendData(w.payload[:0], ts, res))
+	}
+
+	// Snapshot of delta-encoded view is written as difference with the previous one written in the segment.
+	var err error
+	if v.prevIdx != nil && v.ukey < len(res.Columns) {
+		err = w.writeFrame(frameDelta, v.appendDelta(w.payload[:0], ts, res))
+	} else {
+		err = w.writeFrame(frameData, v.appendData(w.payload[:0], ts, res))
+	}
+
+	copyResult(&v.prev, &res)
+	v.prevIdx = stat.NewRowIndex(res, v.ukey)
+
+	return err
+}
+
+// writeFrame writes frame with passed type and payload.
+func (w *Writer) writeFrame(typ byte, payload []byte) error {
+	w.payload = payload
+	w.frame = appendFrame(w.frame[:0], typ, payload)
+	_, err := w.w.Write(w.frame)
+	return err
+}
+
+// sameSchema returns true if columns of passed result are the same as columns of the view.
+func (v *writerView) sameSchema(res stat.PGresult) bool {
+	if len(res.Cols) != len(v.cols) || len(res.Columns) != len(v.types) {
+		return false
+	}
+
+	for i := range v.cols {
+		if res.Cols[i] != v.cols[i] || res.Columns[i].Type != v.types[i] {
+			return false
+		}
+	}
+
+	return true
+}
+
+// define sets schema of the view using columns of passed result, dictionaries are reset.
+func (v *writerView) define(res stat.PGresult) {
+	v.defined = true
+	v.cols = append(v.cols[:0], res.Cols...)
+	v.types = v.types[:0]
+	v.dicts = v.dicts[:0]
+	v.added = v.added[:0]
+	v.prevIdx = nil
+
+	for _, c := range res.Columns {
+		v.types = append(v.types, c.Type)
+		v.dicts = append(v.dicts, nil)
+		v.added = append(v.added, nil)
+	}
+}
+
+// appendSchema appends schema of the view to the payload.
+func (v *writerView) appendSchema(buf []byte, name string) []byte {
+	buf = appendUvarint(buf, v.id)
+	buf = appendString(buf, name)
+	buf = appendUvarint(buf, uint64(len(v.cols)))
+	for i, name := range v.cols {
+		buf = appendString(buf, name)
+		buf = append(buf, byte(v.types[i]))
+	}
+	return buf
+}
+
+// appendData appends snapshot of the view to the payload.
+func (v *writerView) appendData(buf []byte, ts time.Time, res stat.PGresult) []byte {
+	buf = appendUvarint(buf, v.id)
+	buf = appendVarint(buf, ts.UnixNano())
+	buf = appendUvarint(buf, uint64(res.Nrows))
+	buf = v.appendDictionaries(buf, res)
+
+	for i := range res.Columns {
+		buf = appendColumn(buf, &res.Columns[i], res.Nrows, v.dicts[i])
+	}
+
+	return buf
+}
+
+// appendDictionaries finds labels of snapshot missing in dictionaries, adds them to dictionaries and appends them to
+// the payload. Labels are written before values.
+func (v *writerView) appendDictionaries(buf []byte, res stat.PGresult) []byte {
+	for i := range res.Columns {
+		c := &res.Columns[i]
+		if c.Type != stat.TextColumn {
+			continue
+		}
+
+		if v.dicts[i] == nil {
+			v.dicts[i] = map[string]int{}
+		}
+
+		added := v.added[i][:0]
+		for j := 0; j < res.Nrows; j++ {
+			if c.IsNull(j) {
+				continue
+			}
+			if _, ok := v.dicts[i][c.Text[j]]; !ok {
+				v.dicts[i][c.Text[j]] = len(v.dicts[i])
+				added = append(added, c.Text[j])
+			}
+		}
+		v.added[i] = added
+
+		buf = appendUvarint(buf, uint64(len(added)))
+		for _, s := range added {
+			buf = appendString(buf, s)
+		}
+	}
+
+	return buf
+}
+
+// appendColumn appends NULL bitmap and values of the column to the payload. Values of NULLs are not written.
+func appendColumn(buf []byte, c *stat.Column, nrows int, dict map[string]int) []byte {
+	var hasNulls bool
+	for j := 0; j < nrows && !hasNulls; j++ {
+		hasNulls = c.IsNull(j)
+	}
+
+	if hasNulls {
+		buf = append(buf, 1)
+		for j := 0; j < nrows; j += 8 {
+			var b byte
+			for k := j; k < j+8 && k < nrows; k++ {
+				if c.IsNull(k) {
+					b |= 1 << uint(k-j)
+				}
+			}
+			buf = append(buf, b)
+		}
+	} else {
+		buf = append(buf, 0)
+	}
+
+	switch c.Type {
+	case stat.IntColumn:
+		for j := 0; j < nrows; j++ {
+			if !c.IsNull(j) {
+				buf = appendVarint(buf, c.Int[j])
+			}
+		}
+	case stat.FloatColumn:
+		buf = appendUvarint(buf, uint64(c.Prec))
+		for j := 0; j < nrows; j++ {
+			if !c.IsNull(j) {
+				buf = appendFloat(buf, c.Float[j])
+			}
+		}
+	default:
+		for j := 0; j < nrows; j++ {
+			if !c.IsNull(j) {
+				buf = appendUvarint(buf, uint64(dict[c.Text[j]]))
+			}
+		}
+	}
+
+	return buf
+}
@@ -0,0 +1,356 @@
+// Stuff related to OS resources usage of Postgres backends. Usage is read from local /proc/<pid> files of backends
+// listed in activity stats and joined with activity stats by pid.
+
+package stat
+
+import (
+	"bytes"
+	"os"
+	"strconv"
+	"sync"
+	"syscall"
+	"time"
+	"unsafe"
+)
+
+const (
+	// backendReadWorkers defines max number of goroutines reading proc files of backends in parallel.
+	backendReadWorkers = 8
+	// backendsPerWorker defines number of backends read by a single goroutine, fewer backends are read without
+	// spawning goroutines.
+	backendsPerWorker = 256
+)
+
+// BackendColumns defines names of columns added into activity stats: CPU usage in percents, resident memory in kB,
+// storage reads and writes in kB/s.
+var BackendColumns = []string{"cpu_pct", "rss_kb", "read_kbs", "write_kbs"}
+
+// backendSample describes resources usage counters of a single backend process.
+type backendSample struct {
+	cpu    uint64 // time spent in user and system mode, in clock ticks
+	rss    uint64 // resident set size, in pages
+	read   uint64 // bytes read from storage
+	write  uint64 // bytes written to storage
+	hasCPU bool   // stat file has been read
+	hasRSS bool   // statm file has been read
+	hasIO  bool   // io file has been read, it is readable only by the owner of the process
+}
+
+// backendWorker is the per-goroutine state used for reading proc files, kept between reads.
+type backendWorker struct {
+	path []byte // buffer for building paths of proc files
+	buf  []byte // buffer for content of proc files
+}
+
+// backendReader reads resources usage of backends. Added columns are double-buffered: a returned result is valid until
+// the next but one join.
+type backendReader struct {
+	root     string
+	dirfd    int // descriptor of proc directory, opened at the first read
+	ticks    float64
+	pagesize uint64
+
+	workers []backendWorker         // readers state, one per goroutine
+	samples []backendSample         // samples of the current read, in order of pids
+	prev    map[int64]backendSample // samples of the previous read, by pid
+	curr    map[int64]backendSample // samples of the current read, by pid
+	updated time.Time               // time of the previous read
+
+	columns [2][]Column // buffers for added columns, used in turn
+	results [2][]Column // buffers for columns of joined results, used in turn
+	nbuf    int         // number of buffers used for the next join
+	cols    []string    // names of columns of joined result, reused while names of activity columns are the same
+}
+
+// newBackendReader creates reader of backends proc files located in passed directory.
+func newBackendReader(root string, ticks float64) *backendReader {
+	return &backendReader{
+		root:     root,
+		dirfd:    -1,
+		ticks:    ticks,
+		pagesize: uint64(os.Getpagesize()),
+		prev:     map[int64]backendSample{},
+		curr:     map[int64]backendSample{},
+	}
+}
+
+// close closes proc directory, it is opened again at the next read.
+func (r *backendReader) close() error {
+	if r.dirfd < 0 {
+		return nil
+	}
+	err := syscall.Close(r.dirfd)
+	r.dirfd = -1
+	return err
+}
+
+// reset forgets samples of the previous read, hence rates are not calculated over a long gap between reads.
+func (r *backendReader) reset() {
+	for pid := range r.prev {
+		delete(r.prev, pid)
+	}
+	r.updated = time.Time{}
+}
+
+// join reads resources usage of backends listed in passed activity stats and returns activity stats with added
+// columns, which are inserted before the last column (query text). Pids are taken from the first column, stats are
+// returned as-is if there is no such column. Rates of backends which have not been seen at the previous read are NULL.
+func (r *backendReader) join(res PGresult, now time.Time) PGresult {
+	if !res.Valid || res.Ncols == 0 || len(res.Cols) != res.Ncols || res.Cols[0] != "pid" || res.Columns[0].Type != IntColumn {
+		return res
+	}
+
+	pids := res.Columns[0].Int[:res.Nrows]
+	r.read(pids)
+
+	var itv float64
+	if !r.updated.IsZero() {
+		itv = now.Sub(r.updated).Seconds()
+	}
+	r.updated = now
+
+	// Fill added columns.
+	added := r.columns[r.nbuf]
+	if len(added) != len(BackendColumns) {
+		added = make([]Column, len(BackendColumns))
+		added[0].Type, added[1].Type, added[2].Type, added[3].Type = FloatColumn, IntColumn, FloatColumn, FloatColumn
+	}
+	for i := range added {
+		added[i].Int, added[i].Float, added[i].Null = added[i].Int[:0], added[i].Float[:0], added[i].Null[:0]
+		if added[i].Type == FloatColumn {
+			added[i].Prec = 2
+		}
+	}
+
+	for i, pid := range pids {
+		curr := r.samples[i]
+		prev, ok := r.prev[pid]
+		ok = ok && itv > 0
+
+		appendRate(&added[0], ok && curr.hasCPU && prev.hasCPU, curr.cpu, prev.cpu, itv*r.ticks/100)
+		added[1].Int = append(added[1].Int, int64(curr.rss*r.pagesize/1024))
+		added[1].Null = append(added[1].Null, !curr.hasRSS)
+		appendRate(&added[2], ok && curr.hasIO && prev.hasIO, curr.read, prev.read, itv*1024)
+		appendRate(&added[3], ok && curr.hasIO && prev.hasIO, curr.write, prev.write, itv*1024)
+	}
+	r.columns[r.nbuf] = added
+
+	// Make columns of joined result, values of activity columns are shared with passed stats.
+	n := res.Ncols
+	out := append(r.results[r.nbuf][:0], res.Columns[:n-1]...)
+	out = append(out, added...)
+	out = append(out, res.Columns[n-1])
+	r.results[r.nbuf] = out
+	r.nbuf = 1 - r.nbuf
+
+	if len(r.cols) != n+len(BackendColumns) || !equalJoinedNames(r.cols, res.Cols) {
+		r.cols = make([]string, 0, n+len(BackendColumns))
+		r.cols = append(r.cols, res.Cols[:n-1]...)
+		r.cols = append(r.cols, BackendColumns...)
+		r.cols = append(r.cols, res.Cols[n-1])
+	}
+
+	// Current samples become previous, memory of previous ones is reused at the next read.
+	r.prev, r.curr = r.curr, r.prev
+	for pid := range r.curr {
+		delete(r.curr, pid)
+	}
+
+	return PGresult{Columns: out, Cols: r.cols, Ncols: len(out), Nrows: res.Nrows, Valid: true}
+}
+
+// equalJoinedNames returns true if passed names of joined columns correspond to passed names of activity columns.
+func equalJoinedNames(joined, cols []string) bool {
+	n := len(cols)
+	for i := 0; i < n-1; i++ {
+		if joined[i] != cols[i] {
+			return false
+		}
+	}
+	return joined[len(joined)-1] == cols[n-1]
+}
+
+// appendRate appends rate of the counter over passed interval to float column, NULL is appended if rate is unknown.
+func appendRate(c *Column, ok bool, curr, prev uint64, itv float64) {
+	if !ok || curr < prev {
+		c.Float = append(c.Float, 0)
+		c.Null = append(c.Null, !ok)
+		return
+	}
+	c.Float = append(c.Float, float64(curr-prev)/itv)
+	c.Null = append(c.Null, false)
+}
+
+// read reads samples of passed backends. Large number of backends is split between several goroutines, every goroutine
+// reads its own range of backends using its own buffers. Samples are empty if proc directory can't be opened.
+func (r *backendReader) read(pids []int64) {
+	if r.dirfd < 0 {
+		fd, err := syscall.Open(r.root, syscall.O_RDONLY|syscall.O_DIRECTORY|syscall.O_CLOEXEC, 0)
+		if err == nil {
+			r.dirfd = fd
+		}
+	}
+
+	if cap(r.samples) < len(pids) {
+		r.samples = make([]backendSample, len(pids))
+	}
+	r.samples = r.samples[:len(pids)]
+
+	if r.dirfd < 0 {
+		for i := range r.samples {
+			r.samples[i] = backendSample{}
+		}
+		return
+	}
+
+	nworkers := (len(pids) + backendsPerWorker - 1) / backendsPerWorker
+	if nworkers > backendReadWorkers {
+		nworkers = backendReadWorkers
+	}
+	if nworkers < 1 {
+		nworkers = 1
+	}
+	for len(r.workers) < nworkers {
+		r.workers = append(r.workers, backendWorker{buf: make([]byte, procBufSize)})
+	}
+
+	if nworkers == 1 {
+		r.readRange(&r.workers[0], pids, r.samples)
+	} else {
+		chunk := (len(pids) + nworkers - 1) / nworkers
+		var wg sync.WaitGroup
+		for i := 0; i < nworkers; i++ {
+			start, end := i*chunk, (i+1)*chunk
+			if end > len(pids) {
+				end = len(pids)
+			}
+			if start >= end {
+				break
+			}
+
+			wg.Add(1)
+			go func(w *backendWorker, pids []int64, samples []backendSample) {
+				defer wg.Done()
+				r.readRange(w, pids, samples)
+			}(&r.workers[i], pids[start:end], r.samples[start:end])
+		}
+		wg.Wait()
+	}
+
+	for i, pid := range pids {
+		r.curr[pid] = r.samples[i]
+	}
+}
+
+// readRange reads samples of passed backends into passed slice. Files which can't be read, e.g. when backend has
+// exited or access is denied, are skipped.
+func (r *backendReader) readRange(w *backendWorker, pids []int64, samples []backendSample) {
+	for i, pid := range pids {
+		var s backendSample
+
+		if data, ok := w.read(r.dirfd, pid, "stat"); ok {
+			s.cpu, s.hasCPU = parseProcPidStat(data)
+		}
+		if data, ok := w.read(r.dirfd, pid, "statm"); ok {
+			s.rss, s.hasRSS = parseProcPidStatm(data)
+		}
+		if data, ok := w.read(r.dirfd, pid, "io"); ok {
+			s.read, s.write, s.hasIO = parseProcPidIO(data)
+		}
+
+		samples[i] = s
+	}
+}
+
+// read reads whole content of the proc file of passed process into worker's buffer using directory descriptor of
+// proc filesystem, hence neither paths nor files are allocated. Returned data is valid until the next read.
+func (w *backendWorker) read(dirfd int, pid int64, name string) ([]byte, bool) {
+	w.path = strconv.AppendInt(w.path[:0], pid, 10)
+	w.path = append(w.path, '/')
+	w.path = append(w.path, name...)
+	w.path = append(w.path, 0)
+
+	fd, _, errno := syscall.Syscall6(syscall.SYS_OPENAT, uintptr(dirfd), uintptr(unsafe.Pointer(&w.path[0])), uintptr(syscall.O_RDONLY|syscall.O_CLOEXEC), 0, 0, 0)
+	if errno != 0 {
+		return nil, false
+	}
+	defer func() { _ = syscall.Close(int(fd)) }()
+
+	var n int
+	for {
+		m, err := syscall.Read(int(fd), w.buf[n:])
+		if err != nil {
+			return nil, false
+		}
+		if m == 0 {
+			return w.buf[:n], true
+		}
+		n += m
+		if n == len(w.buf) {
+			// Content doesn't fit into buffer, grow it and continue reading.
+			buf := make([]byte, 2*len(w.buf))
+			copy(buf, w.buf)
+			w.buf = buf
+		}
+	}
+}
+
+// parseProcPidStat returns sum of user and system time from content of /proc/<pid>/stat. Name of the process might
+// contain spaces and parentheses, hence fields are counted after the last closing parenthesis.
+func parseProcPidStat(data []byte) (uint64, bool) {
+	i := bytes.LastIndexByte(data, ')')
+	if i < 0 {
+		return 0, false
+	}
+
+	// Fields after name start from state (3rd field), utime and stime are 14th and 15th fields.
+	var fields [13][]byte
+	line, _ := nextLine(data[i+1:])
+	if splitFields(line, fields[:]) < len(fields) {
+		return 0, false
+	}
+
+	utime, ok1 := parseUint(fields[11])
+	stime, ok2 := parseUint(fields[12])
+	if !ok1 || !ok2 {
+		return 0, false
+	}
+
+	return utime + stime, true
+}
+
+// parseProcPidStatm returns resident set size in pages from content of /proc/<pid>/statm.
+func parseProcPidStatm(data []byte) (uint64, bool) {
+	var fields [2][]byte
+	line, _ := nextLine(data)
+	if splitFields(line, fields[:]) < len(fields) {
+		return 0, false
+	}
+
+	return parseUint(fields[1])
+}
+
+// parseProcPidIO returns number of bytes read from and written to storage from content of /proc/<pid>/io.
+func parseProcPidIO(data []byte) (uint64, uint64, bool) {
+	var read, write uint64
+	var hasRead, hasWrite bool
+
+	var fields [2][]byte
+	for len(data) > 0 {
+		var line []byte
+		line, data = nextLine(data)
+
+		if splitFields(line, fields[:]) != 2 {
+			continue
+		}
+
+		switch string(fields[0]) {
+		case "read_bytes:":
+			read, hasRead = parseUint(fields[1])
+		case "write_bytes:":
+			write, hasWrite = parseUint(fields[1])
+		}
+	}
+
+	return read, write, hasRead && hasWrite
+}
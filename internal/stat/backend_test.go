@@ -0,0 +1,176 @@
+package stat
+
+import (
+	"database/sql"
+	"fmt"
+	"github.com/stretchr/testify/assert"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"strconv"
+	"testing"
+	"time"
+)
+
+// writeTestBackend writes proc files of the backend process with passed counters.
+func writeTestBackend(t testing.TB, root string, pid int, cpu, rss, read, write uint64) {
+	dir := filepath.Join(root, strconv.Itoa(pid))
+	assert.NoError(t, os.MkdirAll(dir, 0700))
+
+	files := map[string]string{
+		"stat":  fmt.Sprintf("%d (postgres: app db [local] (idle)) S 1 %d 0 0 -1 4194560 100 0 0 0 %d %d 0 0 20 0 1 0 100 200 300\n", pid, pid, cpu, cpu),
+		"statm": fmt.Sprintf("55000 %d 1000 1500 0 2000 0\n", rss),
+		"io":    fmt.Sprintf("rchar: 1\nwchar: 2\nsyscr: 3\nsyscw: 4\nread_bytes: %d\nwrite_bytes: %d\ncancelled_write_bytes: 0\n", read, write),
+	}
+	for name, content := range files {
+		assert.NoError(t, ioutil.WriteFile(filepath.Join(dir, name), []byte(content), 0600))
+	}
+}
+
+// newTestActivity creates activity stats with passed pids.
+func newTestActivity(pids ...int) PGresult {
+	values := make([][]sql.NullString, len(pids))
+	for i, pid := range pids {
+		values[i] = []sql.NullString{{String: strconv.Itoa(pid), Valid: true}, {String: "active", Valid: true}, {String: "SELECT 1", Valid: true}}
+	}
+	return newPGresultFromValues([]string{"pid", "state", "query"}, values, []ColumnType{IntColumn, TextColumn, TextColumn})
+}
+
+func Test_backendReader_join(t *testing.T) {
+	dir, err := ioutil.TempDir("", "pgcenter-backend-testing")
+	assert.NoError(t, err)
+	defer func() { _ = os.RemoveAll(dir) }()
+
+	writeTestBackend(t, dir, 100, 1000, 2000, 4096, 8192)
+	writeTestBackend(t, dir, 200, 500, 1000, 0, 0)
+
+	r := newBackendReader(dir, 100)
+	defer func() { _ = r.close() }()
+	r.pagesize = 4096
+
+	// At the first join only memory usage is known, pid 300 is missing.
+	ts := time.Now()
+	got := r.join(newTestActivity(100, 200, 300), ts)
+	assert.Equal(t, []string{"pid", "state", "cpu_pct", "rss_kb", "read_kbs", "write_kbs", "query"}, got.Cols)
+	assert.Equal(t, 7, got.Ncols)
+	assert.Equal(t, 3, got.Nrows)
+	assert.Equal(t, []string{"100", "active", "", "8000", "", "", "SELECT 1"}, rowValues(got, 0))
+	assert.Equal(t, []string{"300", "active", "", "", "", "", "SELECT 1"}, rowValues(got, 2))
+
+	// At the next join rates are calculated, new backends have no rates.
+	writeTestBackend(t, dir, 100, 1050, 2000, 4096+2*1024*1024, 8192+1024*1024)
+	writeTestBackend(t, dir, 200, 510, 1000, 0, 0)
+	writeTestBackend(t, dir, 300, 10, 1000, 0, 0)
+
+	curr := r.join(newTestActivity(100, 200, 300), ts.Add(2*time.Second))
+	assert.Equal(t, []string{"100", "active", "50.00", "8000", "1024.00", "512.00", "SELECT 1"}, rowValues(curr, 0))
+	assert.Equal(t, []string{"200", "active", "10.00", "4000", "0.00", "0.00", "SELECT 1"}, rowValues(curr, 1))
+	assert.Equal(t, []string{"300", "active", "", "4000", "", "", "SELECT 1"}, rowValues(curr, 2))
+
+	// Added columns are double-buffered.
+	assert.Equal(t, "8000", got.Value(0, 3))
+	assert.True(t, &got.Columns[2].Float[0] != &curr.Columns[2].Float[0])
+
+	// Columns' names are reused.
+	assert.True(t, &got.Cols[0] == &curr.Cols[0])
+
+	// Rates are not calculated after reset.
+	r.reset()
+	curr = r.join(newTestActivity(100), ts.Add(3*time.Second))
+	assert.Equal(t, "", curr.Value(0, 2))
+
+	// Stats without pids are returned as-is.
+	res := NewPGresultFromValues([]string{"datname", "query"}, [][]sql.NullString{{{String: "db", Valid: true}, {String: "q", Valid: true}}})
+	assert.Equal(t, res, r.join(res, ts))
+}
+
+// rowValues returns values of the row formatted as strings.
+func rowValues(res PGresult, row int) []string {
+	values := make([]string, res.Ncols)
+	for i := range values {
+		values[i] = res.Value(row, i)
+	}
+	return values
+}
+
+func Test_backendReader_read(t *testing.T) {
+	dir, err := ioutil.TempDir("", "pgcenter-backend-testing")
+	assert.NoError(t, err)
+	defer func() { _ = os.RemoveAll(dir) }()
+
+	// Backends are read by several goroutines.
+	pids := make([]int64, 1000)
+	for i := range pids {
+		pids[i] = int64(i + 1)
+		writeTestBackend(t, dir, i+1, uint64(i), uint64(i), uint64(i), uint64(i))
+	}
+
+	r := newBackendReader(dir, 100)
+	r.read(pids)
+	assert.Len(t, r.workers, 4)
+	assert.Len(t, r.curr, 1000)
+	for i, s := range r.samples {
+		assert.Equal(t, backendSample{cpu: uint64(2 * i), rss: uint64(i), read: uint64(i), write: uint64(i), hasCPU: true, hasRSS: true, hasIO: true}, s)
+	}
+	assert.NoError(t, r.close())
+
+	// Missing proc directory.
+	r = newBackendReader(filepath.Join(dir, "missing"), 100)
+	r.read(pids[:1])
+	assert.Equal(t, []backendSample{{}}, r.samples)
+	assert.NoError(t, r.close())
+}
+
+func Test_parseProcPidStat(t *testing.T) {
+	testcases := []struct {
+		data  string
+		valid bool
+		want  uint64
+	}{
+		{data: "123 (postgres) S 1 123 123 0 -1 4194560 100 0 0 0 15 25 0 0 20 0 1 0 100 200 300\n", valid: true, want: 40},
+		{data: "123 (post gres) (x)) S 1 123 123 0 -1 4194560 100 0 0 0 15 25 0 0 20 0 1 0 100\n", valid: true, want: 40},
+		{data: "123 (postgres) S 1 123 123 0 -1 4194560 100 0 0 0 15\n", valid: false},
+		{data: "123 postgres S 1 123 123 0 -1 4194560 100 0 0 0 15 25\n", valid: false},
+		{data: "123 (postgres) S 1 123 123 0 -1 4194560 100 0 0 0 15 invalid\n", valid: false},
+	}
+
+	for _, tc := range testcases {
+		got, ok := parseProcPidStat([]byte(tc.data))
+		assert.Equal(t, tc.valid, ok)
+		assert.Equal(t, tc.want, got)
+	}
+}
+
+func Test_parseProcPidIO(t *testing.T) {
+	read, write, ok := parseProcPidIO([]byte("rchar: 1\nwchar: 2\nread_bytes: 300\nwrite_bytes: 400\n"))
+	assert.True(t, ok)
+	assert.Equal(t, uint64(300), read)
+	assert.Equal(t, uint64(400), write)
+
+	_, _, ok = parseProcPidIO([]byte("rchar: 1\nwchar: 2\n"))
+	assert.False(t, ok)
+}
+
+// Benchmark_backendReader_join reads and joins resources usage of 3000 backends, e.g. when max_connections is large.
+func Benchmark_backendReader_join(b *testing.B) {
+	dir, err := ioutil.TempDir("", "pgcenter-backend-testing")
+	assert.NoError(b, err)
+	defer func() { _ = os.RemoveAll(dir) }()
+
+	pids := make([]int, 3000)
+	for i := range pids {
+		pids[i] = i + 1
+		writeTestBackend(b, dir, i+1, uint64(i), uint64(i), uint64(i), uint64(i))
+	}
+	res := newTestActivity(pids...)
+
+	r := newBackendReader(dir, 100)
+	defer func() { _ = r.close() }()
+	ts := time.Now()
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		_ = r.join(res, ts.Add(time.Duration(i+1)*time.Second))
+	}
+}
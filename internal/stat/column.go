@@ -0,0 +1,376 @@
+package stat
+
+import (
+	"strconv"
+	"strings"
+)
+
+// ColumnType defines how values of the column are stored.
+type ColumnType int
+
+const (
+	// TextColumn stores values as strings, used for labels: names of databases, relations, users, etc.
+	TextColumn ColumnType = iota
+	// IntColumn stores values as 64-bit integers, used for counters.
+	IntColumn
+	// FloatColumn stores values as 64-bit floats, used for timings and other fractional values.
+	FloatColumn
+)
+
+// OIDs of Postgres numeric types, values of these types are parsed into numbers.
+const (
+	oidInt8    = 20
+	oidInt2    = 21
+	oidInt4    = 23
+	oidOid     = 26
+	oidFloat4  = 700
+	oidFloat8  = 701
+	oidNumeric = 1700
+)
+
+// maxFloatPrec defines max number of digits after decimal point used for formatting floats.
+const maxFloatPrec = 15
+
+// isNumericOID returns true if values of Postgres type with passed OID are numbers.
+func isNumericOID(oid uint32) bool {
+	switch oid {
+	case oidInt8, oidInt2, oidInt4, oidOid, oidFloat4, oidFloat8, oidNumeric:
+		return true
+	}
+	return false
+}
+
+// Column is the container for values of a single column of PGresult. Depending on type, values are stored in one of
+// the typed slices, others are empty.
+type Column struct {
+	Type  ColumnType // type of column's values
+	Text  []string   // values of text column
+	Int   []int64    // values of integer column
+	Float []float64  // values of float column
+	Null  []bool     // NULL flags of values, might be nil when column has no NULLs
+	Prec  int        // number of digits after decimal point used for formatting values of float column
+}
+
+// Len returns number of values in the column.
+func (c *Column) Len() int {
+	switch c.Type {
+	case IntColumn:
+		return len(c.Int)
+	case FloatColumn:
+		return len(c.Float)
+	default:
+		return len(c.Text)
+	}
+}
+
+// IsNull returns true if value with passed number is NULL.
+func (c *Column) IsNull(i int) bool {
+	return c.Null != nil && c.Null[i]
+}
+
+// String returns value with passed number formatted as string. NULLs are returned as empty strings.
+func (c *Column) String(i int) string {
+	if c.IsNull(i) {
+		return ""
+	}
+
+	switch c.Type {
+	case IntColumn:
+		return strconv.FormatInt(c.Int[i], 10)
+	case FloatColumn:
+		return strconv.FormatFloat(c.Float[i], 'f', c.Prec, 64)
+	default:
+		return c.Text[i]
+	}
+}
+
+// AppendString appends value with passed number formatted as string to the buffer. NULLs are appended as empty strings.
+func (c *Column) AppendString(buf []byte, i int) []byte {
+	if c.IsNull(i) {
+		return buf
+	}
+
+	switch c.Type {
+	case IntColumn:
+		return strconv.AppendInt(buf, c.Int[i], 10)
+	case FloatColumn:
+		return strconv.AppendFloat(buf, c.Float[i], 'f', c.Prec, 64)
+	default:
+		return append(buf, c.Text[i]...)
+	}
+}
+
+// StringLen returns length of value with passed number formatted as string. Values are formatted on stack, hence
+// calculating length doesn't allocate.
+func (c *Column) StringLen(i int) int {
+	if c.IsNull(i) {
+		return 0
+	}
+
+	var buf [64]byte
+	switch c.Type {
+	case IntColumn:
+		return len(strconv.AppendInt(buf[:0], c.Int[i], 10))
+	case FloatColumn:
+		return len(strconv.AppendFloat(buf[:0], c.Float[i], 'f', c.Prec, 64))
+	default:
+		return len(c.Text[i])
+	}
+}
+
+// float returns value with passed number as float. Values of text columns are parsed.
+func (c *Column) float(i int) (float64, error) {
+	switch c.Type {
+	case IntColumn:
+		return float64(c.Int[i]), nil
+	case FloatColumn:
+		return c.Float[i], nil
+	default:
+		return strconv.ParseFloat(c.Text[i], 64)
+	}
+}
+
+// Float64 returns value with passed number as float, returns false if value is NULL or is not a number.
+func (c *Column) Float64(i int) (float64, bool) {
+	if c.IsNull(i) {
+		return 0, false
+	}
+
+	v, err := c.float(i)
+	if err != nil {
+		return 0, false
+	}
+	return v, true
+}
+
+// equal returns true if value with number 'i' is equal to value with number 'j' of column 'o'.
+func (c *Column) equal(i int, o *Column, j int) bool {
+	if c.Type == o.Type {
+		switch c.Type {
+		case IntColumn:
+			return c.Int[i] == o.Int[j]
+		case TextColumn:
+			return c.Text[i] == o.Text[j]
+		}
+	}
+	return c.String(i) == o.String(j)
+}
+
+// appendNull appends NULL value to the column.
+func (c *Column) appendNull() {
+	if c.Null == nil {
+		c.Null = make([]bool, c.Len(), c.Len()+1)
+	}
+	c.Null = append(c.Null, true)
+
+	switch c.Type {
+	case IntColumn:
+		c.Int = append(c.Int, 0)
+	case FloatColumn:
+		c.Float = append(c.Float, 0)
+	default:
+		c.Text = append(c.Text, "")
+	}
+}
+
+// appendValue parses text value and appends it to the column. Integer column is promoted to float column when value
+// is fractional, numeric columns are promoted to text column when value is not a number.
+func (c *Column) appendValue(s string) {
+	if c.Null != nil {
+		c.Null = append(c.Null, false)
+	}
+
+	if c.Type != TextColumn {
+		if c.appendNumber(s) {
+			return
+		}
+		c.toText()
+	}
+
+	c.Text = append(c.Text, s)
+}
+
+// appendRaw parses raw text value received from Postgres and appends it to the column. Numbers are parsed without
+// copying raw value to heap. Text values equal to the values stored at the same position before the column has been
+// reset are reused, hence labels which remain the same in consecutive snapshots are not copied.
+func (c *Column) appendRaw(b []byte) {
+	switch c.Type {
+	case IntColumn, FloatColumn:
+		if c.appendNumber(string(b)) {
+			if c.Null != nil {
+				c.Null = append(c.Null, false)
+			}
+			return
+		}
+	case TextColumn:
+		if i := len(c.Text); i < cap(c.Text) && c.Text[:i+1][i] == string(b) {
+			c.Text = c.Text[:i+1]
+			if c.Null != nil {
+				c.Null = append(c.Null, false)
+			}
+			return
+		}
+	}
+
+	c.appendValue(string(b))
+}
+
+// appendNumber parses value as a number and appends it to numeric column. Integer column is promoted to float column
+// when value is fractional. Returns false if value is not a number.
+func (c *Column) appendNumber(s string) bool {
+	if v, ok := parseInt(s); ok {
+		if c.Type == IntColumn {
+			c.Int = append(c.Int, v)
+		} else {
+			c.Float = append(c.Float, float64(v))
+		}
+		return true
+	}
+
+	v, prec, ok := parseFloat(s)
+	if !ok {
+		return false
+	}
+
+	if c.Type == IntColumn {
+		c.toFloat()
+	}
+
+	c.Float = append(c.Float, v)
+	if prec > c.Prec {
+		c.Prec = prec
+	}
+
+	return true
+}
+
+// reset truncates the column and sets its type, memory allocated for values is kept for reusing.
+func (c *Column) reset(t ColumnType) {
+	c.Type, c.Prec = t, 0
+	c.Text, c.Int, c.Float = c.Text[:0], c.Int[:0], c.Float[:0]
+	if c.Null != nil {
+		c.Null = c.Null[:0]
+	}
+}
+
+// toFloat converts integer column to float column.
+func (c *Column) toFloat() {
+	c.Float = c.Float[:0]
+	for _, v := range c.Int {
+		c.Float = append(c.Float, float64(v))
+	}
+	c.Type, c.Int, c.Prec = FloatColumn, c.Int[:0], 0
+}
+
+// toText converts numeric column to text column.
+func (c *Column) toText() {
+	n := c.Len()
+	text := make([]string, n, n+1)
+	for i := 0; i < n; i++ {
+		text[i] = c.String(i)
+	}
+	c.Type, c.Text, c.Int, c.Float, c.Prec = TextColumn, text, c.Int[:0], c.Float[:0], 0
+}
+
+// permute returns copy of the column with values reordered accordingly to passed permutation of values' numbers.
+func (c *Column) permute(perm []int) Column {
+	p := Column{Type: c.Type, Prec: c.Prec}
+
+	switch c.Type {
+	case IntColumn:
+		p.Int = make([]int64, len(perm))
+		for i, j := range perm {
+			p.Int[i] = c.Int[j]
+		}
+	case FloatColumn:
+		p.Float = make([]float64, len(perm))
+		for i, j := range perm {
+			p.Float[i] = c.Float[j]
+		}
+	default:
+		p.Text = make([]string, len(perm))
+		for i, j := range perm {
+			p.Text[i] = c.Text[j]
+		}
+	}
+
+	if c.Null != nil {
+		p.Null = make([]bool, len(perm))
+		for i, j := range perm {
+			p.Null[i] = c.Null[j]
+		}
+	}
+
+	return p
+}
+
+// parseInt parses value as integer. Only canonical representation of integers is accepted, values with leading zeros
+// or explicit plus sign are not considered as integers. Values which are not integers are rejected without
+// allocating errors, because fractional values are usually checked for integers first.
+func parseInt(s string) (int64, bool) {
+	digits := s
+	if len(s) > 0 && s[0] == '-' {
+		digits = s[1:]
+	}
+
+	if len(digits) == 0 || (digits[0] == '0' && len(s) > 1) {
+		return 0, false
+	}
+
+	// Long values might overflow, leave them to strconv.
+	if len(digits) > 18 {
+		v, err := strconv.ParseInt(s, 10, 64)
+		if err != nil {
+			return 0, false
+		}
+		return v, true
+	}
+
+	var v int64
+	for i := 0; i < len(digits); i++ {
+		c := digits[i]
+		if c < '0' || c > '9' {
+			return 0, false
+		}
+		v = v*10 + int64(c-'0')
+	}
+
+	if len(digits) != len(s) {
+		v = -v
+	}
+
+	return v, true
+}
+
+// parseFloat parses value in decimal or scientific notation and returns it with number of digits after decimal point.
+func parseFloat(s string) (float64, int, bool) {
+	mantissa, exp := s, 0
+	if i := strings.IndexAny(s, "eE"); i >= 0 {
+		e, err := strconv.Atoi(s[i+1:])
+		if err != nil {
+			return 0, 0, false
+		}
+		mantissa, exp = s[:i], e
+	} else if !strings.Contains(s, ".") {
+		return 0, 0, false
+	}
+
+	v, err := strconv.ParseFloat(s, 64)
+	if err != nil {
+		return 0, 0, false
+	}
+
+	var prec int
+	if i := strings.IndexByte(mantissa, '.'); i >= 0 {
+		prec = len(mantissa) - i - 1
+	}
+
+	prec -= exp
+	if prec < 0 {
+		prec = 0
+	} else if prec > maxFloatPrec {
+		prec = maxFloatPrec
+	}
+
+	return v, prec, true
+}
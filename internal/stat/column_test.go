@@ -0,0 +1,147 @@
+package stat
+
+import (
+	"github.com/stretchr/testify/assert"
+	"testing"
+)
+
+// newColumn creates column with values parsed from passed text values.
+func newColumn(numeric bool, values []string, nulls []bool) Column {
+	var c Column
+	if numeric {
+		c.Type = IntColumn
+	}
+
+	for i, v := range values {
+		if nulls != nil && nulls[i] {
+			c.appendNull()
+			continue
+		}
+		c.appendValue(v)
+	}
+
+	return c
+}
+
+func Test_appendValue(t *testing.T) {
+	testcases := []struct {
+		name    string
+		numeric bool
+		values  []string
+		nulls   []bool
+		want    Column
+	}{
+		{
+			name: "integers", numeric: true, values: []string{"1", "-20", "300"},
+			want: Column{Type: IntColumn, Int: []int64{1, -20, 300}},
+		},
+		{
+			name: "integers with nulls", numeric: true, values: []string{"1", "", "300"}, nulls: []bool{false, true, false},
+			want: Column{Type: IntColumn, Int: []int64{1, 0, 300}, Null: []bool{false, true, false}},
+		},
+		{
+			name: "promote to float", numeric: true, values: []string{"1", "2.50", "15e-1"},
+			want: Column{Type: FloatColumn, Float: []float64{1, 2.5, 1.5}, Prec: 2},
+		},
+		{
+			name: "promote to text", numeric: true, values: []string{"1", "2.5", "example"},
+			want: Column{Type: TextColumn, Text: []string{"1.0", "2.5", "example"}},
+		},
+		{
+			name: "not canonical integers", numeric: true, values: []string{"0", "007"},
+			want: Column{Type: TextColumn, Text: []string{"0", "007"}},
+		},
+		{
+			name: "text", numeric: false, values: []string{"1", "2.5"},
+			want: Column{Type: TextColumn, Text: []string{"1", "2.5"}},
+		},
+	}
+
+	for _, tc := range testcases {
+		t.Run(tc.name, func(t *testing.T) {
+			got := newColumn(tc.numeric, tc.values, tc.nulls)
+			assert.Equal(t, tc.want.Type, got.Type)
+			assert.Equal(t, len(tc.want.Int), len(got.Int))
+			assert.Equal(t, len(tc.want.Float), len(got.Float))
+			assert.Equal(t, len(tc.want.Text), len(got.Text))
+			for i := 0; i < got.Len(); i++ {
+				assert.Equal(t, tc.want.String(i), got.String(i))
+			}
+			assert.Equal(t, tc.want.Null, got.Null)
+			assert.Equal(t, tc.want.Prec, got.Prec)
+		})
+	}
+}
+
+func TestColumn_String(t *testing.T) {
+	c := newColumn(true, []string{"0.5", "", "110400e-4"}, []bool{false, true, false})
+
+	assert.Equal(t, 3, c.Len())
+	assert.Equal(t, "0.5000", c.String(0))
+	assert.Equal(t, 6, c.StringLen(0))
+	assert.Equal(t, "", c.String(1))
+	assert.Equal(t, 0, c.StringLen(1))
+	assert.True(t, c.IsNull(1))
+	assert.Equal(t, "11.0400", c.String(2))
+	assert.Equal(t, 7, c.StringLen(2))
+	assert.Equal(t, "x:11.0400", string(c.AppendString(c.AppendString([]byte("x:"), 1), 2)))
+
+	v, ok := c.Float64(2)
+	assert.True(t, ok)
+	assert.Equal(t, 11.04, v)
+	_, ok = c.Float64(1)
+	assert.False(t, ok)
+}
+
+func Test_parseInt(t *testing.T) {
+	testcases := []struct {
+		value string
+		want  int64
+		ok    bool
+	}{
+		{value: "0", want: 0, ok: true},
+		{value: "12345", want: 12345, ok: true},
+		{value: "-12345", want: -12345, ok: true},
+		{value: "9223372036854775807", want: 9223372036854775807, ok: true},
+		{value: "-9223372036854775808", want: -9223372036854775808, ok: true},
+		{value: "9223372036854775808", ok: false},
+		{value: "", ok: false},
+		{value: "-", ok: false},
+		{value: "-0", ok: false},
+		{value: "007", ok: false},
+		{value: "+7", ok: false},
+		{value: "12.5", ok: false},
+		{value: "12a", ok: false},
+	}
+
+	for _, tc := range testcases {
+		got, ok := parseInt(tc.value)
+		assert.Equal(t, tc.ok, ok, tc.value)
+		assert.Equal(t, tc.want, got, tc.value)
+	}
+}
+
+func Test_parseFloat(t *testing.T) {
+	testcases := []struct {
+		value string
+		want  float64
+		prec  int
+		ok    bool
+	}{
+		{value: "12.05", want: 12.05, prec: 2, ok: true},
+		{value: "110400e-4", want: 11.04, prec: 4, ok: true},
+		{value: "1.5E2", want: 150, prec: 0, ok: true},
+		{value: "0e-2", want: 0, prec: 2, ok: true},
+		{value: "12", ok: false},
+		{value: "1234e5678a", ok: false},
+		{value: "127.0.0.1", ok: false},
+		{value: "NaN", ok: false},
+	}
+
+	for _, tc := range testcases {
+		got, prec, ok := parseFloat(tc.value)
+		assert.Equal(t, tc.ok, ok, tc.value)
+		assert.Equal(t, tc.want, got, tc.value)
+		assert.Equal(t, tc.prec, prec, tc.value)
+	}
+}
@@ -3,13 +3,8 @@
 package stat
 
 import (
-	"bufio"
 	"fmt"
 	"github.com/lesovsky/pgcenter/internal/postgres"
-	"io"
-	"os"
-	"path/filepath"
-	"strings"
 )
 
 // CpuStat describes CPU statistics based on /proc/stat.
@@ -28,10 +23,22 @@ type CpuStat struct {
 	Total   float64
 }
 
+// CpuStats is the container for per-CPU stats.
+type CpuStats []CpuStat
+
+// Busy returns percent of time CPU spent not being idle over time interval of per-CPU usage stats. Zero is returned
+// if CPU has not been running during the interval.
+func (s CpuStat) Busy() float64 {
+	if s.Total == 0 {
+		return 0
+	}
+	return 100 - s.Idle
+}
+
 // readCpuStat returns CPU stats based on type of passed DB connection.
-func readCpuStat(db *postgres.DB, schemaExists bool) (CpuStat, error) {
+func readCpuStat(db *postgres.DB, r *procReader, schemaExists bool) (CpuStat, error) {
 	if db.Local {
-		return readCpuStatLocal("/proc/stat")
+		return readCpuStatLocal(r.statFile)
 	} else if schemaExists {
 		return readCpuStatRemote(db)
 	}
@@ -40,42 +47,37 @@ func readCpuStat(db *postgres.DB, schemaExists bool) (CpuStat, error) {
 }
 
 // readCpuStatLocal returns CPU stats read from local proc file.
-func readCpuStatLocal(statfile string) (CpuStat, error) {
+func readCpuStatLocal(f *procFile) (CpuStat, error) {
 	var stat CpuStat
-	f, err := os.Open(filepath.Clean(statfile))
+	data, err := f.read()
 	if err != nil {
 		return stat, err
 	}
-	defer func() {
-		_ = f.Close()
-	}()
-
-	scanner := bufio.NewScanner(f)
 
-	for scanner.Scan() {
-		line := scanner.Text()
+	var fields [11][]byte
+	for len(data) > 0 {
+		var line []byte
+		line, data = nextLine(data)
 
-		parts := strings.Fields(line)
-		if len(parts) < 2 {
+		n := splitFields(line, fields[:])
+		if n < 2 {
 			continue
 		}
 
 		// Looking only for total stat, skip per-CPU stats.
-		if parts[0] != "cpu" {
+		if string(fields[0]) != "cpu" {
 			continue
 		}
 
-		count, err := fmt.Sscanf(
-			line,
-			"%s %f %f %f %f %f %f %f %f %f %f",
-			&stat.Entry, &stat.User, &stat.Nice, &stat.Sys, &stat.Idle, &stat.Iowait, &stat.Irq, &stat.Softirq, &stat.Steal, &stat.Guest, &stat.GstNice,
-		)
-
-		if err != nil && err != io.EOF {
-			return stat, fmt.Errorf("%s bad content: %s", statfile, err)
+		if n < 11 {
+			return stat, fmt.Errorf("%s bad content: not enough fields in '%s'", f.path, line)
 		}
-		if count != 11 {
-			return stat, fmt.Errorf("%s bad content: not enough fields in '%s'", statfile, line)
+
+		stat.Entry = "cpu"
+		if !parseFloatFields(fields[1:],
+			&stat.User, &stat.Nice, &stat.Sys, &stat.Idle, &stat.Iowait, &stat.Irq, &stat.Softirq, &stat.Steal, &stat.Guest, &stat.GstNice,
+		) {
+			return stat, fmt.Errorf("%s bad content: invalid value in '%s'", f.path, line)
 		}
 
 		stat.Total = stat.User + stat.Nice + stat.Sys + stat.Idle + stat.Iowait + stat.Irq + stat.Softirq + stat.Steal + stat.Guest
@@ -84,7 +86,7 @@ func readCpuStatLocal(statfile string) (CpuStat, error) {
 		break
 	}
 
-	return stat, scanner.Err()
+	return stat, nil
 }
 
 // readCpuStatRemote returns CPU stats from SQL stats schema.
@@ -118,3 +120,149 @@ func countCpuUsage(prev CpuStat, curr CpuStat, ticks float64) CpuStat {
 
 	return stat
 }
+
+// readCpuStats returns per-CPU stats based on type of passed DB connection.
+func readCpuStats(db *postgres.DB, r *procReader, config Config) (CpuStats, error) {
+	if db.Local {
+		return readCpuStatsLocal(r)
+	} else if config.SchemaPgcenterAvail {
+		return readCpuStatsRemote(db)
+	}
+
+	return CpuStats{}, nil
+}
+
+// readCpuStatsLocal returns per-CPU stats read from local proc file. Returned stats are kept in reader's buffer and
+// valid until the next but one read.
+func readCpuStatsLocal(r *procReader) (CpuStats, error) {
+	data, err := r.statFile.read()
+	if err != nil {
+		return nil, err
+	}
+
+	stat := r.cpustats[r.ncpu][:0]
+
+	var fields [11][]byte
+	for len(data) > 0 {
+		var line []byte
+		line, data = nextLine(data)
+
+		n := splitFields(line, fields[:])
+		if n < 2 {
+			continue
+		}
+
+		// Per-CPU lines follow the total line, no reason to read next lines after them.
+		name := fields[0]
+		if len(name) < 3 || string(name[:3]) != "cpu" {
+			break
+		}
+
+		// Skip total stat.
+		if len(name) == 3 {
+			continue
+		}
+
+		if n < 11 {
+			return nil, fmt.Errorf("%s bad content: not enough fields in '%s'", r.statFile.path, line)
+		}
+
+		var s CpuStat
+		if !parseFloatFields(fields[1:],
+			&s.User, &s.Nice, &s.Sys, &s.Idle, &s.Iowait, &s.Irq, &s.Softirq, &s.Steal, &s.Guest, &s.GstNice,
+		) {
+			return nil, fmt.Errorf("%s bad content: invalid value in '%s'", r.statFile.path, line)
+		}
+
+		s.Entry = r.name(name)
+		s.Total = s.User + s.Nice + s.Sys + s.Idle + s.Iowait + s.Irq + s.Softirq + s.Steal + s.Guest
+		stat = append(stat, s)
+	}
+
+	r.cpustats[r.ncpu] = stat
+	r.ncpu = 1 - r.ncpu
+
+	return stat, nil
+}
+
+// readCpuStatsRemote returns per-CPU stats from SQL stats schema.
+func readCpuStatsRemote(db *postgres.DB) (CpuStats, error) {
+	q := `SELECT cpu,us_time::numeric,ni_time::numeric,sy_time::numeric,id_time::numeric,wa_time::numeric,hi_time::numeric,si_time::numeric,st_time::numeric,quest_time::numeric,guest_ni_time::numeric FROM pgcenter.sys_proc_stat WHERE cpu ~ '^cpu[0-9]+$' ORDER BY substr(cpu, 4)::int`
+	rows, err := db.Query(q)
+	if err != nil {
+		return nil, err
+	}
+	defer rows.Close()
+
+	var stat CpuStats
+	for rows.Next() {
+		var s CpuStat
+		err := rows.Scan(&s.Entry, &s.User, &s.Nice, &s.Sys, &s.Idle,
+			&s.Iowait, &s.Irq, &s.Softirq, &s.Steal, &s.Guest, &s.GstNice)
+		if err != nil {
+			return nil, err
+		}
+
+		s.Total = s.User + s.Nice + s.Sys + s.Idle + s.Iowait + s.Irq + s.Softirq + s.Steal + s.Guest
+		stat = append(stat, s)
+	}
+
+	return stat, rows.Err()
+}
+
+// countCpuStatsUsage compares per-CPU stats snapshots and returns per-CPU usage stats over time interval. CPUs which
+// have not been running during the interval (e.g. offline) have zero total. Snapshots must list the same CPUs in the
+// same order, otherwise nil is returned.
+func countCpuStatsUsage(prev CpuStats, curr CpuStats, ticks float64) CpuStats {
+	if len(curr) != len(prev) {
+		// do nothing and return
+		return nil
+	}
+
+	stat := make(CpuStats, len(curr))
+
+	for i := 0; i < len(curr); i++ {
+		if curr[i].Entry != prev[i].Entry {
+			return nil
+		}
+		stat[i] = countCpuUsage(prev[i], curr[i], ticks)
+		stat[i].Entry = curr[i].Entry
+		stat[i].Total = curr[i].Total - prev[i].Total
+	}
+
+	return stat
+}
+
+// Hottest returns indexes of at most k the most utilized CPUs in order of descending utilization. Only k CPUs are
+// kept sorted during the single pass, hence selection is cheap when k is much smaller than number of CPUs.
+func (s CpuStats) Hottest(k int) []int {
+	if k > len(s) {
+		k = len(s)
+	}
+	if k <= 0 {
+		return nil
+	}
+
+	hot := make([]int, 0, k)
+	for i := range s {
+		busy := s[i].Busy()
+		if len(hot) == k && busy <= s[hot[k-1]].Busy() {
+			continue
+		}
+
+		// Find position of the CPU among selected ones, CPUs with the same utilization are kept in order of numbers.
+		j := len(hot)
+		if j == k {
+			j--
+		} else {
+			hot = append(hot, 0)
+		}
+		for j > 0 && s[hot[j-1]].Busy() < busy {
+			hot[j] = hot[j-1]
+			j--
+		}
+		hot[j] = i
+	}
+
+	return hot
+}
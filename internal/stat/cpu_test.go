@@ -13,18 +13,18 @@ func Test_readCpuStat(t *testing.T) {
 
 	// test "local" reading
 	conn.Local = true
-	got, err := readCpuStat(conn, false)
+	got, err := readCpuStat(conn, newProcReader("/proc"), false)
 	assert.NoError(t, err)
 	assert.Greater(t, got.Total, float64(0))
 
 	// test "remote" reading
 	conn.Local = false
-	got, err = readCpuStat(conn, true)
+	got, err = readCpuStat(conn, newProcReader("/proc"), true)
 	assert.NoError(t, err)
 	assert.Greater(t, got.Total, float64(0))
 
 	// test "remote", but when schema is not available
-	got, err = readCpuStat(conn, false)
+	got, err = readCpuStat(conn, newProcReader("/proc"), false)
 	assert.NoError(t, err)
 	assert.Equal(t, got.Total, float64(0))
 }
@@ -57,7 +57,7 @@ func Test_readCpuStatLocal(t *testing.T) {
 	}
 
 	for _, tc := range testcases {
-		got, err := readCpuStatLocal(tc.statfile)
+		got, err := readCpuStatLocal(newProcFile(tc.statfile))
 		if tc.valid {
 			assert.NoError(t, err)
 			assert.Equal(t, tc.want, got)
@@ -83,10 +83,10 @@ func Test_readCpuStatRemote(t *testing.T) {
 }
 
 func Test_countCpuUsage(t *testing.T) {
-	prev, err := readCpuStatLocal("testdata/proc/stat.golden")
+	prev, err := readCpuStatLocal(newProcFile("testdata/proc/stat.golden"))
 	assert.NoError(t, err)
 
-	curr, err := readCpuStatLocal("testdata/proc/stat2.golden")
+	curr, err := readCpuStatLocal(newProcFile("testdata/proc/stat2.golden"))
 	assert.NoError(t, err)
 
 	got := countCpuUsage(prev, curr, 100)
@@ -108,3 +108,100 @@ func Test_countCpuUsage(t *testing.T) {
 
 	assert.Equal(t, want, got)
 }
+
+func Test_readCpuStats(t *testing.T) {
+	conn, err := postgres.NewTestConnect()
+	assert.NoError(t, err)
+	defer conn.Close()
+
+	// test "local" reading
+	conn.Local = true
+	got, err := readCpuStats(conn, newProcReader("/proc"), Config{})
+	assert.NoError(t, err)
+	assert.Greater(t, len(got), 0)
+
+	// test "remote" reading
+	conn.Local = false
+	got, err = readCpuStats(conn, newProcReader("/proc"), Config{PostgresProperties: PostgresProperties{SchemaPgcenterAvail: true}})
+	assert.NoError(t, err)
+	assert.Greater(t, len(got), 0)
+	assert.Greater(t, got[0].Total, float64(0))
+
+	// test "remote", but when schema is not available
+	got, err = readCpuStats(conn, newProcReader("/proc"), Config{})
+	assert.NoError(t, err)
+	assert.Len(t, got, 0)
+}
+
+func Test_readCpuStatsLocal(t *testing.T) {
+	r := newGoldenProcReader()
+	defer func() { _ = r.close() }()
+
+	got, err := readCpuStatsLocal(r)
+	assert.NoError(t, err)
+	assert.Len(t, got, 8)
+	assert.Equal(t, CpuStat{
+		Entry: "cpu0", User: 391544, Nice: 434, Sys: 177276, Idle: 16543983, Iowait: 4924, Softirq: 200282, Total: 17318443,
+	}, got[0])
+	assert.Equal(t, "cpu7", got[7].Entry)
+
+	// snapshots are read into buffers in turn and names are reused
+	curr, err := readCpuStatsLocal(r)
+	assert.NoError(t, err)
+	assert.Equal(t, got, curr)
+	assert.True(t, &got[0] != &curr[0])
+	assert.Len(t, r.names, 8)
+
+	// total stat without per-CPU stats
+	r.statFile = newProcFile("testdata/proc/meminfo.golden")
+	got, err = readCpuStatsLocal(r)
+	assert.NoError(t, err)
+	assert.Len(t, got, 0)
+}
+
+func Test_countCpuStatsUsage(t *testing.T) {
+	prev := CpuStats{
+		{Entry: "cpu0", User: 100, Sys: 100, Idle: 800, Total: 1000},
+		{Entry: "cpu1", User: 100, Sys: 100, Idle: 800, Total: 1000},
+	}
+	curr := CpuStats{
+		{Entry: "cpu0", User: 150, Sys: 110, Idle: 840, Total: 1100},
+		{Entry: "cpu1", User: 100, Sys: 100, Idle: 800, Total: 1000},
+	}
+
+	got := countCpuStatsUsage(prev, curr, 100)
+	assert.Equal(t, CpuStats{
+		{Entry: "cpu0", User: 50, Sys: 10, Idle: 40, Total: 100},
+		{Entry: "cpu1", Total: 0},
+	}, got)
+	assert.Equal(t, float64(60), got[0].Busy())
+	assert.Equal(t, float64(0), got[1].Busy()) // CPU has not been running
+
+	// number of CPUs changed
+	assert.Nil(t, countCpuStatsUsage(prev, curr[:1], 100))
+
+	// CPUs listed in different order
+	assert.Nil(t, countCpuStatsUsage(prev, CpuStats{curr[1], curr[0]}, 100))
+}
+
+func Test_CpuStats_Hottest(t *testing.T) {
+	stats := make(CpuStats, 6)
+	for i, idle := range []float64{90, 10, 50, 10, 100, 30} {
+		stats[i] = CpuStat{Idle: idle, Total: 100}
+	}
+
+	testcases := []struct {
+		k    int
+		want []int
+	}{
+		{k: 0, want: nil},
+		{k: 1, want: []int{1}},
+		{k: 3, want: []int{1, 3, 5}},
+		{k: 6, want: []int{1, 3, 5, 2, 0, 4}},
+		{k: 10, want: []int{1, 3, 5, 2, 0, 4}},
+	}
+
+	for _, tc := range testcases {
+		assert.Equal(t, tc.want, stats.Hottest(tc.k))
+	}
+}
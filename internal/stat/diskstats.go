@@ -1,13 +1,9 @@
 package stat
 
 import (
-	"bufio"
+	"bytes"
 	"fmt"
 	"github.com/lesovsky/pgcenter/internal/postgres"
-	"os"
-	"path/filepath"
-	"regexp"
-	"strings"
 )
 
 const (
@@ -64,9 +60,9 @@ type Diskstat struct {
 type Diskstats []Diskstat
 
 // readDiskstats returns block devices stats depending on type of passed DB connection.
-func readDiskstats(db *postgres.DB, config Config) (Diskstats, error) {
+func readDiskstats(db *postgres.DB, r *procReader, config Config) (Diskstats, error) {
 	if db.Local {
-		return readDiskstatsLocal("/proc/diskstats", config.ticks)
+		return readDiskstatsLocal(r, config.ticks)
 	} else if config.SchemaPgcenterAvail {
 		return readDiskstatsRemote(db)
 	}
@@ -74,77 +70,78 @@ func readDiskstats(db *postgres.DB, config Config) (Diskstats, error) {
 	return Diskstats{}, nil
 }
 
-// readDiskstatsLocal return block devices stats read from local proc file.
-func readDiskstatsLocal(statfile string, ticks float64) (Diskstats, error) {
-	var stat Diskstats
-	f, err := os.Open(filepath.Clean(statfile))
+// readDiskstatsLocal return block devices stats read from local proc file. Returned stats are kept in reader's buffer
+// and valid until the next but one read.
+func readDiskstatsLocal(r *procReader, ticks float64) (Diskstats, error) {
+	data, err := r.diskstatsFile.read()
 	if err != nil {
-		return stat, err
+		return nil, err
 	}
-	defer func() {
-		_ = f.Close()
-	}()
 
-	uptime, err := readUptimeLocal("/proc/uptime", ticks)
+	uptime, err := readUptimeLocal(r.uptimeFile, ticks)
 	if err != nil {
 		return nil, err
 	}
 
-	scanner := bufio.NewScanner(f)
+	stat := r.diskstats[r.ndisk][:0]
 
-	for scanner.Scan() {
-		line := scanner.Text()
-		values := strings.Fields(line)
+	var fields [20][]byte
+	for len(data) > 0 {
+		var line []byte
+		line, data = nextLine(data)
 
 		// Linux kernel <= 4.18 have 14 columns, 4.18+ have 18, 5.5+ have 20 columns
 		// for details see https://www.kernel.org/doc/Documentation/ABI/testing/procfs-diskstats)
-		if len(values) != 14 && len(values) != 18 && len(values) != 20 {
-			return nil, fmt.Errorf("%s bad content: unknown file format, wrong number of columns in line: %s", statfile, line)
+		n := splitFields(line, fields[:])
+		if n == 0 {
+			continue
+		}
+		if n != 14 && n != 18 && n != 20 {
+			return nil, fmt.Errorf("%s bad content: unknown file format, wrong number of columns in line: %s", r.diskstatsFile.path, line)
 		}
 
-		var d = Diskstat{}
+		major, ok1 := parseUint(fields[0])
+		minor, ok2 := parseUint(fields[1])
+		if !ok1 || !ok2 {
+			return nil, fmt.Errorf("%s bad content: invalid device number in line: %s", r.diskstatsFile.path, line)
+		}
+
+		d := Diskstat{Major: int(major), Minor: int(minor), Uptime: uptime}
 
-		switch len(values) {
-		case 14:
-			_, err = fmt.Sscan(line,
-				&d.Major, &d.Minor, &d.Device,
-				&d.Rcompleted, &d.Rmerged, &d.Rsectors, &d.Rspent, &d.Wcompleted, &d.Wmerged, &d.Wsectors, &d.Wspent,
-				&d.Ioinprogress, &d.Tspent, &d.Tweighted,
-			)
-		case 18:
-			_, err = fmt.Sscan(line,
-				&d.Major, &d.Minor, &d.Device,
-				&d.Rcompleted, &d.Rmerged, &d.Rsectors, &d.Rspent, &d.Wcompleted, &d.Wmerged, &d.Wsectors, &d.Wspent,
-				&d.Ioinprogress, &d.Tspent, &d.Tweighted, &d.Dcompleted, &d.Dmerged, &d.Dsectors, &d.Dspent,
-			)
-		case 20:
-			_, err = fmt.Sscan(line,
-				&d.Major, &d.Minor, &d.Device,
-				&d.Rcompleted, &d.Rmerged, &d.Rsectors, &d.Rspent, &d.Wcompleted, &d.Wmerged, &d.Wsectors, &d.Wspent,
-				&d.Ioinprogress, &d.Tspent, &d.Tweighted, &d.Dcompleted, &d.Dmerged, &d.Dsectors, &d.Dspent,
-				&d.Fcompleted, &d.Fspent,
-			)
-		default:
-			// should not be here, but anyway check for that
-			err = fmt.Errorf("unknown file format, wrong number of columns in line: %s", line)
+		ok := parseFloatFields(fields[3:],
+			&d.Rcompleted, &d.Rmerged, &d.Rsectors, &d.Rspent, &d.Wcompleted, &d.Wmerged, &d.Wsectors, &d.Wspent,
+			&d.Ioinprogress, &d.Tspent, &d.Tweighted,
+		)
+		if ok && n >= 18 {
+			ok = parseFloatFields(fields[14:], &d.Dcompleted, &d.Dmerged, &d.Dsectors, &d.Dspent)
 		}
-		if err != nil {
-			return nil, fmt.Errorf("%s bad content: %w", statfile, err)
+		if ok && n == 20 {
+			ok = parseFloatFields(fields[18:], &d.Fcompleted, &d.Fspent)
+		}
+		if !ok {
+			return nil, fmt.Errorf("%s bad content: invalid value in line: %s", r.diskstatsFile.path, line)
 		}
 
 		// skip pseudo block devices.
-		re := regexp.MustCompile(`^(ram|loop|fd)`)
-		if re.MatchString(d.Device) {
+		if isPseudoDevice(fields[2]) {
 			continue
 		}
 
-		d.Uptime = uptime
+		d.Device = r.name(fields[2])
 		stat = append(stat, d)
 	}
 
+	r.diskstats[r.ndisk] = stat
+	r.ndisk = 1 - r.ndisk
+
 	return stat, nil
 }
 
+// isPseudoDevice returns true for names of pseudo block devices.
+func isPseudoDevice(name []byte) bool {
+	return bytes.HasPrefix(name, []byte("ram")) || bytes.HasPrefix(name, []byte("loop")) || bytes.HasPrefix(name, []byte("fd"))
+}
+
 // readDiskstatsRemote returns block devices stats from SQL stats schema.
 func readDiskstatsRemote(db *postgres.DB) (Diskstats, error) {
 	var uptime float64
@@ -174,8 +171,7 @@ func readDiskstatsRemote(db *postgres.DB) (Diskstats, error) {
 		}
 
 		// skip pseudo block devices.
-		re := regexp.MustCompile(`^(ram|loop|fd)`)
-		if re.MatchString(d.Device) {
+		if isPseudoDevice([]byte(d.Device)) {
 			continue
 		}
 
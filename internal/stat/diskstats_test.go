@@ -17,18 +17,18 @@ func Test_readDiskstats(t *testing.T) {
 
 	// test "local" reading
 	conn.Local = true
-	got, err := readDiskstats(conn, Config{ticks: ticks, PostgresProperties: PostgresProperties{SchemaPgcenterAvail: false}})
+	got, err := readDiskstats(conn, newProcReader("/proc"), Config{ticks: ticks, PostgresProperties: PostgresProperties{SchemaPgcenterAvail: false}})
 	assert.NoError(t, err)
 	assert.Greater(t, len(got), 0)
 
 	// test "remote" reading
 	conn.Local = false
-	got, err = readDiskstats(conn, Config{PostgresProperties: PostgresProperties{SchemaPgcenterAvail: true}})
+	got, err = readDiskstats(conn, newProcReader("/proc"), Config{PostgresProperties: PostgresProperties{SchemaPgcenterAvail: true}})
 	assert.NoError(t, err)
 	assert.Greater(t, len(got), 0)
 
 	// test "remote", but when schema is not available
-	got, err = readDiskstats(conn, Config{PostgresProperties: PostgresProperties{SchemaPgcenterAvail: false}})
+	got, err = readDiskstats(conn, newProcReader("/proc"), Config{PostgresProperties: PostgresProperties{SchemaPgcenterAvail: false}})
 	assert.NoError(t, err)
 	assert.Equal(t, len(got), 0)
 }
@@ -108,7 +108,7 @@ func Test_readDiskstatsLocal(t *testing.T) {
 	}
 
 	for _, tc := range testcases {
-		got, err := readDiskstatsLocal(tc.statfile, ticks)
+		got, err := readDiskstatsLocal(newTestProcReader(tc.statfile), ticks)
 		if tc.valid {
 			// as a workaround copy Uptime value from 'got' because it's read from real /proc/stat.
 			for i := range got {
@@ -146,10 +146,10 @@ func Test_countDiskstatsUsage(t *testing.T) {
 	assert.NoError(t, err)
 	assert.NotEqual(t, float64(0), ticks)
 
-	prev, err := readDiskstatsLocal("testdata/proc/diskstats.v2.golden", ticks)
+	prev, err := readDiskstatsLocal(newTestProcReader("testdata/proc/diskstats.v2.golden"), ticks)
 	assert.NoError(t, err)
 
-	curr, err := readDiskstatsLocal("testdata/proc/diskstats.v2.2.golden", ticks)
+	curr, err := readDiskstatsLocal(newTestProcReader("testdata/proc/diskstats.v2.2.golden"), ticks)
 	assert.NoError(t, err)
 
 	// as a workaround copy Uptime value from 'got' because it's read from real /proc/stat.
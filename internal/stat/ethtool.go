@@ -85,14 +85,8 @@ type ifreq struct {
 	ifrData uintptr
 }
 
-// getLinkSettings return network interface settings using ethtool communication.
-func getLinkSettings(ifname string) (int64, int64, error) {
-	e, err := newEthtool()
-	if err != nil {
-		return 0, 0, fmt.Errorf("new ethtool failed: %s", err)
-	}
-	defer e.close()
-
+// linkSettings returns network interface speed and duplex using opened communication channel.
+func (e *ethtool) linkSettings(ifname string) (int64, int64, error) {
 	ecmd := ethtoolCmd{Cmd: ethtoolGset}
 
 	var name [ifNameSize]byte
@@ -105,7 +99,7 @@ func getLinkSettings(ifname string) (int64, int64, error) {
 
 	_, _, errno := syscall.Syscall(syscall.SYS_IOCTL, uintptr(e.fd), siocEthtool, uintptr(unsafe.Pointer(&ifr))) // #nosec G103
 	if errno != 0 {
-		return 0, 0, fmt.Errorf("ioctl failed: %s", errno)
+		return 0, 0, errno
 	}
 
 	//var speedval uint32 = (uint32(ecmd.Speed_hi) << 16) | (uint32(ecmd.Speed) & 0xffff)
@@ -0,0 +1,546 @@
+package stat
+
+import (
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/view"
+	"regexp"
+	"strconv"
+	"strings"
+)
+
+// Filter expressions select rows of stats using conditions on values of columns, for example:
+//
+//   datname = app AND calls > 100 AND query ~ 'UPDATE'
+//
+// Conditions are 'column op value', where op is one of =, !=, <, <=, >, >= for comparing and ~, !~ for matching
+// regular expressions. Conditions are combined using AND, OR, NOT and parentheses. Values are quoted when contain
+// spaces or parentheses. Unquoted numbers are compared with numeric values as numbers, other values are compared as
+// strings. NULLs are considered as empty strings and don't satisfy numeric comparisons.
+
+// filterOp defines operation of filter expression node.
+type filterOp int
+
+const (
+	filterAnd filterOp = iota
+	filterOr
+	filterNot
+	filterEq
+	filterNe
+	filterLt
+	filterLe
+	filterGt
+	filterGe
+	filterMatch
+	filterNotMatch
+)
+
+// filterOps defines operators of conditions, longer operators go first.
+var filterOps = []struct {
+	text string
+	op   filterOp
+}{
+	{"!=", filterNe}, {"<=", filterLe}, {">=", filterGe}, {"!~", filterNotMatch},
+	{"=", filterEq}, {"<", filterLt}, {">", filterGt}, {"~", filterMatch},
+}
+
+// filterNode is a node of filter expression tree.
+type filterNode struct {
+	op          filterOp
+	left, right *filterNode    // operands of AND, OR; NOT uses only left operand
+	name        string         // name of column used in condition
+	col         int            // number of column used in condition, resolved at compiling
+	value       string         // value compared with values of column
+	num         float64        // value parsed as number
+	isNum       bool           // value is number and compared numerically
+	re          *regexp.Regexp // regexp used for matching
+}
+
+// FilterExpr is a parsed filter expression, columns used in expression are resolved at compiling.
+type FilterExpr struct {
+	root *filterNode
+}
+
+// ParseFilter parses filter expression.
+func ParseFilter(s string) (*FilterExpr, error) {
+	p := filterParser{s: s}
+
+	root, err := p.parseOr()
+	if err != nil {
+		return nil, fmt.Errorf("invalid filter: %s", err)
+	}
+
+	p.skipSpaces()
+	if p.pos < len(p.s) {
+		return nil, fmt.Errorf("invalid filter: unexpected '%s'", p.s[p.pos:])
+	}
+
+	return &FilterExpr{root: root}, nil
+}
+
+// NewMatchFilter creates filter expression which matches values of the column using regexp.
+func NewMatchFilter(name string, re *regexp.Regexp) *FilterExpr {
+	return &FilterExpr{root: &filterNode{op: filterMatch, name: name, value: re.String(), re: re}}
+}
+
+// And returns expression satisfied when both expressions are satisfied. Nil expressions are ignored.
+func (e *FilterExpr) And(o *FilterExpr) *FilterExpr {
+	return joinFilterExpr(filterAnd, e, o)
+}
+
+// Or returns expression satisfied when any of expressions is satisfied. Nil expressions are ignored.
+func (e *FilterExpr) Or(o *FilterExpr) *FilterExpr {
+	return joinFilterExpr(filterOr, e, o)
+}
+
+// joinFilterExpr joins expressions using logical operator.
+func joinFilterExpr(op filterOp, e, o *FilterExpr) *FilterExpr {
+	if e == nil {
+		return o
+	}
+	if o == nil {
+		return e
+	}
+	return &FilterExpr{root: &filterNode{op: op, left: e.root, right: o.root}}
+}
+
+// Filter is a filter expression compiled against columns of stats. Conditions joined by top-level AND are split into
+// those which use only columns copied as-is at diff, and those which use diffed columns. The first are checked before
+// diff, hence rows which can't be shown are not diffed; the second are checked after diff but before sorting.
+// Filter is not safe for concurrent use.
+type Filter struct {
+	pre  *filterNode // conditions checked before diff
+	post *filterNode // conditions checked after diff
+	buf  []byte      // buffer used for matching numeric values
+}
+
+// Compile resolves columns used in expression and returns filter for stats with passed columns and diff interval.
+func (e *FilterExpr) Compile(cols []string, interval [2]int) (*Filter, error) {
+	if e == nil {
+		return nil, nil
+	}
+
+	root, err := e.root.compile(cols)
+	if err != nil {
+		return nil, err
+	}
+
+	var f Filter
+	for _, n := range root.conjuncts(nil) {
+		if n.isDiffed(interval) {
+			f.post = joinFilterNode(f.post, n)
+		} else {
+			f.pre = joinFilterNode(f.pre, n)
+		}
+	}
+
+	return &f, nil
+}
+
+// Match returns true if the row satisfies the filter. Nil filter is satisfied by any row.
+func (f *Filter) Match(r *PGresult, row int) bool {
+	if f == nil {
+		return true
+	}
+
+	return (f.pre == nil || f.match(f.pre, r, row)) && (f.post == nil || f.match(f.post, r, row))
+}
+
+// selectBeforeDiff returns result with rows satisfying conditions checked before diff.
+func (f *Filter) selectBeforeDiff(r PGresult) PGresult {
+	if f == nil {
+		return r
+	}
+
+	rows := f.rows(f.pre, &r)
+	if rows == nil {
+		return r
+	}
+
+	return r.selectRows(rows)
+}
+
+// rowsAfterDiff returns numbers of rows satisfying conditions checked after diff, nil means all rows.
+func (f *Filter) rowsAfterDiff(r *PGresult) []int {
+	if f == nil {
+		return nil
+	}
+
+	return f.rows(f.post, r)
+}
+
+// rows returns numbers of rows satisfying the node, nil means all rows.
+func (f *Filter) rows(n *filterNode, r *PGresult) []int {
+	if n == nil {
+		return nil
+	}
+
+	rows := make([]int, 0, r.Nrows)
+	for i := 0; i < r.Nrows; i++ {
+		if f.match(n, r, i) {
+			rows = append(rows, i)
+		}
+	}
+
+	if len(rows) == r.Nrows {
+		return nil
+	}
+
+	return rows
+}
+
+// match evaluates the node using values of the row.
+func (f *Filter) match(n *filterNode, r *PGresult, row int) bool {
+	switch n.op {
+	case filterAnd:
+		return f.match(n.left, r, row) && f.match(n.right, r, row)
+	case filterOr:
+		return f.match(n.left, r, row) || f.match(n.right, r, row)
+	case filterNot:
+		return !f.match(n.left, r, row)
+	case filterMatch, filterNotMatch:
+		c := &r.Columns[n.col]
+
+		var ok bool
+		if c.Type == TextColumn {
+			ok = n.re.MatchString(c.Text[row])
+		} else {
+			f.buf = c.AppendString(f.buf[:0], row)
+			ok = n.re.Match(f.buf)
+		}
+
+		return ok == (n.op == filterMatch)
+	default:
+		return n.compare(&r.Columns[n.col], row)
+	}
+}
+
+// compare compares value of the column with value of the condition.
+func (n *filterNode) compare(c *Column, i int) bool {
+	if n.isNum {
+		var v float64
+		var ok = !c.IsNull(i)
+
+		if ok {
+			switch c.Type {
+			case IntColumn:
+				v = float64(c.Int[i])
+			case FloatColumn:
+				v = c.Float[i]
+			default:
+				v, ok = parseNumber(c.Text[i])
+			}
+		}
+
+		// Values which are not numbers don't satisfy numeric comparison.
+		if !ok {
+			return n.op == filterNe
+		}
+
+		switch {
+		case v < n.num:
+			return n.satisfied(-1)
+		case v > n.num:
+			return n.satisfied(1)
+		default:
+			return n.satisfied(0)
+		}
+	}
+
+	if c.Type == TextColumn {
+		return n.satisfied(strings.Compare(c.Text[i], n.value))
+	}
+
+	return n.satisfied(strings.Compare(c.String(i), n.value))
+}
+
+// satisfied returns true if result of comparing values satisfies operator of the condition.
+func (n *filterNode) satisfied(cmp int) bool {
+	switch n.op {
+	case filterEq:
+		return cmp == 0
+	case filterNe:
+		return cmp != 0
+	case filterLt:
+		return cmp < 0
+	case filterLe:
+		return cmp <= 0
+	case filterGt:
+		return cmp > 0
+	default:
+		return cmp >= 0
+	}
+}
+
+// compile returns copy of the node with resolved numbers of columns.
+func (n *filterNode) compile(cols []string) (*filterNode, error) {
+	c := *n
+
+	switch n.op {
+	case filterAnd, filterOr, filterNot:
+		var err error
+		c.left, err = n.left.compile(cols)
+		if err != nil {
+			return nil, err
+		}
+
+		if n.right != nil {
+			c.right, err = n.right.compile(cols)
+			if err != nil {
+				return nil, err
+			}
+		}
+	default:
+		c.col = -1
+		for i, name := range cols {
+			if name == n.name {
+				c.col = i
+				break
+			}
+		}
+
+		if c.col < 0 {
+			return nil, fmt.Errorf("filter: unknown column '%s'", n.name)
+		}
+	}
+
+	return &c, nil
+}
+
+// conjuncts appends conditions joined by top-level AND.
+func (n *filterNode) conjuncts(list []*filterNode) []*filterNode {
+	if n.op == filterAnd {
+		return n.right.conjuncts(n.left.conjuncts(list))
+	}
+
+	return append(list, n)
+}
+
+// isDiffed returns true if the node uses columns which are diffed.
+func (n *filterNode) isDiffed(interval [2]int) bool {
+	if n == nil || interval == [2]int{0, 0} {
+		return false
+	}
+
+	switch n.op {
+	case filterAnd, filterOr, filterNot:
+		return n.left.isDiffed(interval) || n.right.isDiffed(interval)
+	default:
+		return n.col >= interval[0] && n.col <= interval[1]
+	}
+}
+
+// joinFilterNode joins nodes using AND, nil nodes are ignored.
+func joinFilterNode(n, o *filterNode) *filterNode {
+	if n == nil {
+		return o
+	}
+
+	return &filterNode{op: filterAnd, left: n, right: o}
+}
+
+// parseNumber parses value as number without allocating errors.
+func parseNumber(s string) (float64, bool) {
+	if v, ok := parseInt(s); ok {
+		return float64(v), true
+	}
+
+	v, _, ok := parseFloat(s)
+	return v, ok
+}
+
+// filterParser implements recursive descent parsing of filter expressions.
+type filterParser struct {
+	s   string
+	pos int
+}
+
+// parseOr parses conditions joined by OR.
+func (p *filterParser) parseOr() (*filterNode, error) {
+	n, err := p.parseAnd()
+	if err != nil {
+		return nil, err
+	}
+
+	for p.keyword("OR") {
+		right, err := p.parseAnd()
+		if err != nil {
+			return nil, err
+		}
+		n = &filterNode{op: filterOr, left: n, right: right}
+	}
+
+	return n, nil
+}
+
+// parseAnd parses conditions joined by AND.
+func (p *filterParser) parseAnd() (*filterNode, error) {
+	n, err := p.parseUnary()
+	if err != nil {
+		return nil, err
+	}
+
+	for p.keyword("AND") {
+		right, err := p.parseUnary()
+		if err != nil {
+			return nil, err
+		}
+		n = &filterNode{op: filterAnd, left: n, right: right}
+	}
+
+	return n, nil
+}
+
+// parseUnary parses negated condition, expression in parentheses or single condition.
+func (p *filterParser) parseUnary() (*filterNode, error) {
+	if p.keyword("NOT") {
+		n, err := p.parseUnary()
+		if err != nil {
+			return nil, err
+		}
+		return &filterNode{op: filterNot, left: n}, nil
+	}
+
+	p.skipSpaces()
+	if p.pos < len(p.s) && p.s[p.pos] == '(' {
+		p.pos++
+
+		n, err := p.parseOr()
+		if err != nil {
+			return nil, err
+		}
+
+		p.skipSpaces()
+		if p.pos >= len(p.s) || p.s[p.pos] != ')' {
+			return nil, fmt.Errorf("missing closing parenthesis")
+		}
+		p.pos++
+
+		return n, nil
+	}
+
+	return p.parseCondition()
+}
+
+// parseCondition parses condition 'column op value'.
+func (p *filterParser) parseCondition() (*filterNode, error) {
+	p.skipSpaces()
+
+	start := p.pos
+	for p.pos < len(p.s) && !strings.ContainsRune(" \t()'\"=!<>~", rune(p.s[p.pos])) {
+		p.pos++
+	}
+	if p.pos == start {
+		return nil, fmt.Errorf("column name expected at position %d", start)
+	}
+
+	n := &filterNode{name: p.s[start:p.pos]}
+
+	p.skipSpaces()
+	var found bool
+	for _, o := range filterOps {
+		if strings.HasPrefix(p.s[p.pos:], o.text) {
+			n.op = o.op
+			p.pos += len(o.text)
+			found = true
+			break
+		}
+	}
+	if !found {
+		return nil, fmt.Errorf("operator expected after '%s'", n.name)
+	}
+
+	value, quoted, err := p.parseValue()
+	if err != nil {
+		return nil, err
+	}
+	n.value = value
+
+	switch n.op {
+	case filterMatch, filterNotMatch:
+		n.re, err = regexp.Compile(value)
+		if err != nil {
+			return nil, err
+		}
+	default:
+		if !quoted {
+			if v, err := strconv.ParseFloat(value, 64); err == nil {
+				n.num, n.isNum = v, true
+			}
+		}
+	}
+
+	return n, nil
+}
+
+// parseValue parses quoted or unquoted value, quotes are escaped by doubling.
+func (p *filterParser) parseValue() (string, bool, error) {
+	p.skipSpaces()
+	if p.pos >= len(p.s) {
+		return "", false, fmt.Errorf("value expected at position %d", p.pos)
+	}
+
+	quote := p.s[p.pos]
+	if quote != '\'' && quote != '"' {
+		start := p.pos
+		for p.pos < len(p.s) && p.s[p.pos] != ' ' && p.s[p.pos] != '\t' && p.s[p.pos] != ')' {
+			p.pos++
+		}
+		if p.pos == start {
+			return "", false, fmt.Errorf("value expected at position %d", start)
+		}
+		return p.s[start:p.pos], false, nil
+	}
+
+	var b strings.Builder
+	for p.pos++; p.pos < len(p.s); p.pos++ {
+		if p.s[p.pos] == quote {
+			if p.pos+1 < len(p.s) && p.s[p.pos+1] == quote {
+				p.pos++
+			} else {
+				p.pos++
+				return b.String(), true, nil
+			}
+		}
+		b.WriteByte(p.s[p.pos])
+	}
+
+	return "", false, fmt.Errorf("missing closing quote")
+}
+
+// keyword consumes keyword if it is the next token, keywords are case-insensitive.
+func (p *filterParser) keyword(kw string) bool {
+	p.skipSpaces()
+
+	end := p.pos + len(kw)
+	if end > len(p.s) || !strings.EqualFold(p.s[p.pos:end], kw) {
+		return false
+	}
+
+	// Keyword should be followed by space, parenthesis or the end of expression.
+	if end < len(p.s) && !strings.ContainsRune(" \t(", rune(p.s[end])) {
+		return false
+	}
+
+	p.pos = end
+	return true
+}
+
+// skipSpaces skips spaces and tabs.
+func (p *filterParser) skipSpaces() {
+	for p.pos < len(p.s) && (p.s[p.pos] == ' ' || p.s[p.pos] == '\t') {
+		p.pos++
+	}
+}
+
+// newViewFilter compiles regexps of the view's columns into filter. Row satisfies filter when any of regexps matches.
+func newViewFilter(v view.View, cols []string) (*Filter, error) {
+	var e *FilterExpr
+	for i, re := range v.Filters {
+		if re == nil || i >= len(cols) {
+			continue
+		}
+		e = e.Or(NewMatchFilter(cols[i], re))
+	}
+
+	return e.Compile(cols, v.DiffIntvl)
+}
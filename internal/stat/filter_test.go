@@ -0,0 +1,194 @@
+package stat
+
+import (
+	"database/sql"
+	"github.com/lesovsky/pgcenter/internal/view"
+	"github.com/stretchr/testify/assert"
+	"regexp"
+	"testing"
+)
+
+func TestParseFilter(t *testing.T) {
+	testcases := []struct {
+		expr  string
+		valid bool
+	}{
+		{expr: "datname = app", valid: true},
+		{expr: "datname=app AND calls>100", valid: true},
+		{expr: "datname = 'my app' or (calls >= 1e3 AND NOT query ~ 'UPDATE')", valid: true},
+		{expr: `query !~ "it's" AND calls != 0`, valid: true},
+		{expr: "query ~ 'it''s'", valid: true},
+		{expr: "", valid: false},
+		{expr: "datname", valid: false},
+		{expr: "datname =", valid: false},
+		{expr: "= app", valid: false},
+		{expr: "datname = app AND", valid: false},
+		{expr: "datname = app calls > 1", valid: false},
+		{expr: "(datname = app", valid: false},
+		{expr: "query ~ 'UPDATE", valid: false},
+		{expr: "query ~ '['", valid: false},
+	}
+
+	for _, tc := range testcases {
+		_, err := ParseFilter(tc.expr)
+		if tc.valid {
+			assert.NoError(t, err, tc.expr)
+		} else {
+			assert.Error(t, err, tc.expr)
+		}
+	}
+}
+
+func TestFilter_Match(t *testing.T) {
+	res := NewPGresultFromValues(
+		[]string{"datname", "calls", "time", "query"},
+		[][]sql.NullString{
+			{{String: "app", Valid: true}, {String: "150", Valid: true}, {String: "1.5", Valid: true}, {String: "UPDATE t SET x = 1", Valid: true}},
+			{{String: "app", Valid: true}, {String: "50", Valid: true}, {String: "20.5", Valid: true}, {String: "SELECT 1", Valid: true}},
+			{{String: "my app", Valid: true}, {String: "500", Valid: true}, {String: "", Valid: false}, {String: "UPDATE t SET y = 1", Valid: true}},
+			{{String: "postgres", Valid: true}, {String: "", Valid: false}, {String: "3", Valid: true}, {String: "it's", Valid: true}},
+		},
+	)
+
+	testcases := []struct {
+		expr string
+		want []bool
+	}{
+		{expr: "datname = app", want: []bool{true, true, false, false}},
+		{expr: "datname = app AND calls > 100 AND query ~ 'UPDATE'", want: []bool{true, false, false, false}},
+		{expr: "datname = 'my app' OR calls < 100", want: []bool{false, true, true, false}},
+		{expr: "NOT (datname = app)", want: []bool{false, false, true, true}},
+		{expr: "calls >= 150 and calls <= 500", want: []bool{true, false, true, false}},
+		{expr: "calls != 150", want: []bool{false, true, true, true}},
+		{expr: "calls ~ '^5'", want: []bool{false, true, true, false}},
+		{expr: "time > 2", want: []bool{false, true, false, true}},
+		{expr: "time ~ '\\.5$'", want: []bool{true, true, false, false}},
+		{expr: "query !~ UPDATE", want: []bool{false, true, false, true}},
+		{expr: "query = 'it''s'", want: []bool{false, false, false, true}},
+		{expr: "datname > m", want: []bool{false, false, true, true}},
+	}
+
+	for _, tc := range testcases {
+		e, err := ParseFilter(tc.expr)
+		assert.NoError(t, err)
+		f, err := e.Compile(res.Cols, [2]int{0, 0})
+		assert.NoError(t, err)
+
+		for i, want := range tc.want {
+			assert.Equal(t, want, f.Match(&res, i), tc.expr)
+		}
+	}
+
+	// Unknown column.
+	e, err := ParseFilter("unknown = 1")
+	assert.NoError(t, err)
+	_, err = e.Compile(res.Cols, [2]int{0, 0})
+	assert.Error(t, err)
+
+	// Nil filter matches any row.
+	var f *Filter
+	assert.True(t, f.Match(&res, 0))
+	f, err = (*FilterExpr)(nil).Compile(res.Cols, [2]int{0, 0})
+	assert.NoError(t, err)
+	assert.Nil(t, f)
+}
+
+func TestFilterExpr_Compile(t *testing.T) {
+	cols := []string{"datname", "calls", "time", "query"}
+	testcases := []struct {
+		expr     string
+		interval [2]int
+		pre      bool
+		post     bool
+	}{
+		{expr: "datname = app AND query ~ UPDATE", interval: [2]int{1, 2}, pre: true},
+		{expr: "calls > 100 AND time > 1", interval: [2]int{1, 2}, post: true},
+		{expr: "datname = app AND calls > 100", interval: [2]int{1, 2}, pre: true, post: true},
+		{expr: "datname = app OR calls > 100", interval: [2]int{1, 2}, post: true},
+		{expr: "datname = app AND calls > 100", interval: [2]int{0, 0}, pre: true},
+	}
+
+	for _, tc := range testcases {
+		e, err := ParseFilter(tc.expr)
+		assert.NoError(t, err)
+		f, err := e.Compile(cols, tc.interval)
+		assert.NoError(t, err)
+		assert.Equal(t, tc.pre, f.pre != nil, tc.expr)
+		assert.Equal(t, tc.post, f.post != nil, tc.expr)
+	}
+}
+
+func Test_calculateDelta_filter(t *testing.T) {
+	prev := NewPGresultFromValues(
+		[]string{"unique", "datname", "calls"},
+		[][]sql.NullString{
+			{{String: "1", Valid: true}, {String: "app", Valid: true}, {String: "100", Valid: true}},
+			{{String: "2", Valid: true}, {String: "app", Valid: true}, {String: "100", Valid: true}},
+			{{String: "3", Valid: true}, {String: "postgres", Valid: true}, {String: "100", Valid: true}},
+			{{String: "4", Valid: true}, {String: "app", Valid: true}, {String: "100", Valid: true}},
+		},
+	)
+	curr := NewPGresultFromValues(
+		[]string{"unique", "datname", "calls"},
+		[][]sql.NullString{
+			{{String: "1", Valid: true}, {String: "app", Valid: true}, {String: "150", Valid: true}},
+			{{String: "2", Valid: true}, {String: "app", Valid: true}, {String: "105", Valid: true}},
+			{{String: "3", Valid: true}, {String: "postgres", Valid: true}, {String: "900", Valid: true}},
+			{{String: "4", Valid: true}, {String: "app", Valid: true}, {String: "120", Valid: true}},
+		},
+	)
+
+	e, err := ParseFilter("datname = app AND calls >= 10")
+	assert.NoError(t, err)
+	f, err := e.Compile(curr.Cols, [2]int{2, 2})
+	assert.NoError(t, err)
+
+	// Values of diffed columns are filtered after diff.
+	got, err := calculateDelta(curr, prev, nil, 1, [2]int{2, 2}, 2, true, 0, f)
+	assert.NoError(t, err)
+	assert.Equal(t, [][]sql.NullString{
+		{{String: "1", Valid: true}, {String: "app", Valid: true}, {String: "50", Valid: true}},
+		{{String: "4", Valid: true}, {String: "app", Valid: true}, {String: "20", Valid: true}},
+	}, got.values())
+
+	// Current snapshot is kept as-is.
+	assert.Equal(t, 4, curr.Nrows)
+
+	// Without previous snapshot, all conditions are checked using current values.
+	got, err = calculateDelta(curr, PGresult{}, nil, 1, [2]int{2, 2}, 2, true, 0, f)
+	assert.NoError(t, err)
+	assert.Equal(t, 3, got.Nrows)
+
+	// Filter which doesn't match any rows.
+	e, err = ParseFilter("datname = unknown")
+	assert.NoError(t, err)
+	f, err = e.Compile(curr.Cols, [2]int{2, 2})
+	assert.NoError(t, err)
+	got, err = calculateDelta(curr, prev, nil, 1, [2]int{2, 2}, 2, true, 0, f)
+	assert.NoError(t, err)
+	assert.Equal(t, 0, got.Nrows)
+}
+
+func Test_newViewFilter(t *testing.T) {
+	res := NewPGresultFromValues(
+		[]string{"datname", "calls"},
+		[][]sql.NullString{
+			{{String: "app", Valid: true}, {String: "150", Valid: true}},
+			{{String: "postgres", Valid: true}, {String: "50", Valid: true}},
+			{{String: "test", Valid: true}, {String: "10", Valid: true}},
+		},
+	)
+
+	// Row satisfies filter when any of regexps matches.
+	v := view.View{Filters: map[int]*regexp.Regexp{0: regexp.MustCompile("^app"), 1: regexp.MustCompile("^5")}}
+	f, err := newViewFilter(v, res.Cols)
+	assert.NoError(t, err)
+	assert.True(t, f.Match(&res, 0))
+	assert.True(t, f.Match(&res, 1))
+	assert.False(t, f.Match(&res, 2))
+
+	// No filters.
+	f, err = newViewFilter(view.View{Filters: map[int]*regexp.Regexp{}}, res.Cols)
+	assert.NoError(t, err)
+	assert.Nil(t, f)
+}
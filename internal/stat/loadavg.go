@@ -5,10 +5,6 @@ package stat
 import (
 	"fmt"
 	"github.com/lesovsky/pgcenter/internal/postgres"
-	"io/ioutil"
-	"path/filepath"
-	"strconv"
-	"strings"
 )
 
 // LoadAvg describes 'load average' stats based on /proc/loadavg.
@@ -19,9 +15,9 @@ type LoadAvg struct {
 }
 
 // readLoadAverage returns load average stats based on type of passed DB connection.
-func readLoadAverage(db *postgres.DB, schemaExists bool) (LoadAvg, error) {
+func readLoadAverage(db *postgres.DB, r *procReader, schemaExists bool) (LoadAvg, error) {
 	if db.Local {
-		return readLoadAverageLocal("/proc/loadavg")
+		return readLoadAverageLocal(r.loadavgFile)
 	} else if schemaExists {
 		return readLoadAverageRemote(db)
 	}
@@ -30,30 +26,29 @@ func readLoadAverage(db *postgres.DB, schemaExists bool) (LoadAvg, error) {
 }
 
 // readLoadAverageLocal returns load average stats read from local proc file.
-func readLoadAverageLocal(statfile string) (LoadAvg, error) {
+func readLoadAverageLocal(f *procFile) (LoadAvg, error) {
 	var stat LoadAvg
 
-	data, err := ioutil.ReadFile(filepath.Clean(statfile))
+	data, err := f.read()
 	if err != nil {
 		return stat, err
 	}
 
-	fields := strings.Fields(string(data))
+	line, _ := nextLine(data)
 
-	if len(fields) < 3 {
-		return stat, fmt.Errorf("%s invalid content", statfile)
+	var fields [3][]byte
+	if splitFields(line, fields[:]) < 3 {
+		return stat, fmt.Errorf("%s invalid content", f.path)
 	}
 
-	values := make([]float64, 3)
-	for i, value := range fields[0:3] {
-		values[i], err = strconv.ParseFloat(value, 64)
-		if err != nil {
-			return stat, err
+	for i, v := range []*float64{&stat.One, &stat.Five, &stat.Fifteen} {
+		var ok bool
+		*v, ok = parseDecimal(fields[i])
+		if !ok {
+			return stat, fmt.Errorf("%s invalid content: invalid value '%s'", f.path, fields[i])
 		}
 	}
 
-	stat.One, stat.Five, stat.Fifteen = values[0], values[1], values[2]
-
 	return stat, nil
 }
 
@@ -13,18 +13,18 @@ func Test_readLoadAverage(t *testing.T) {
 
 	// test "local" reading
 	conn.Local = true
-	got, err := readLoadAverage(conn, false)
+	got, err := readLoadAverage(conn, newProcReader("/proc"), false)
 	assert.NoError(t, err)
 	assert.Greater(t, got.One, float64(0))
 
 	// test "remote" reading
 	conn.Local = false
-	got, err = readLoadAverage(conn, true)
+	got, err = readLoadAverage(conn, newProcReader("/proc"), true)
 	assert.NoError(t, err)
 	assert.Greater(t, got.One, float64(0))
 
 	// test "remote", but when schema is not available
-	got, err = readLoadAverage(conn, false)
+	got, err = readLoadAverage(conn, newProcReader("/proc"), false)
 	assert.NoError(t, err)
 	assert.Equal(t, got.One, float64(0))
 }
@@ -40,7 +40,7 @@ func Test_readLoadAverageLocal(t *testing.T) {
 	}
 
 	for _, tc := range testcases {
-		got, err := readLoadAverageLocal(tc.statfile)
+		got, err := readLoadAverageLocal(newProcFile(tc.statfile))
 		if tc.valid {
 			assert.NoError(t, err)
 			assert.Equal(t, tc.want, got)
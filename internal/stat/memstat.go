@@ -3,12 +3,7 @@
 package stat
 
 import (
-	"bufio"
 	"github.com/lesovsky/pgcenter/internal/postgres"
-	"os"
-	"path/filepath"
-	"strconv"
-	"strings"
 )
 
 // Meminfo describes memory/swap stats based on /proc/meminfo.
@@ -27,9 +22,9 @@ type Meminfo struct {
 }
 
 // readMeminfo returns memory/swap stats based on type of passed DB connection.
-func readMeminfo(db *postgres.DB, schemaExists bool) (Meminfo, error) {
+func readMeminfo(db *postgres.DB, r *procReader, schemaExists bool) (Meminfo, error) {
 	if db.Local {
-		return readMeminfoLocal("/proc/meminfo")
+		return readMeminfoLocal(r.meminfoFile)
 	} else if schemaExists {
 		return readMeminfoRemote(db)
 	}
@@ -38,35 +33,31 @@ func readMeminfo(db *postgres.DB, schemaExists bool) (Meminfo, error) {
 }
 
 // readMeminfoLocal returns memory/swap stats read from local proc file.
-func readMeminfoLocal(statfile string) (Meminfo, error) {
+func readMeminfoLocal(f *procFile) (Meminfo, error) {
 	var stat Meminfo
 
-	f, err := os.Open(filepath.Clean(statfile))
+	data, err := f.read()
 	if err != nil {
 		return stat, err
 	}
-	defer func() {
-		_ = f.Close()
-	}()
 
-	scanner := bufio.NewScanner(f)
+	var fields [3][]byte
+	for len(data) > 0 {
+		var line []byte
+		line, data = nextLine(data)
 
-	for scanner.Scan() {
-		line := scanner.Text()
-
-		fields := strings.Fields(line)
-		if len(fields) < 3 {
+		if splitFields(line, fields[:]) < 3 {
 			// TODO: log error to stderr
 			continue
 		}
 
-		value, err := strconv.ParseUint(fields[1], 10, 64)
-		if err != nil {
+		value, ok := parseUint(fields[1])
+		if !ok {
 			// TODO: log error to stderr
 			continue
 		}
 
-		switch fields[0] {
+		switch string(fields[0]) {
 		case "MemTotal:":
 			stat.MemTotal = value / 1024
 		case "MemFree:":
@@ -90,7 +81,7 @@ func readMeminfoLocal(statfile string) (Meminfo, error) {
 	stat.MemUsed = stat.MemTotal - stat.MemFree - stat.MemCached - stat.MemBuffers - stat.MemSlab
 	stat.SwapUsed = stat.SwapTotal - stat.SwapFree
 
-	return stat, scanner.Err()
+	return stat, nil
 }
 
 // readMeminfoRemote returns memory/swap stats from SQL stats schema.
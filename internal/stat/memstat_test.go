@@ -13,18 +13,18 @@ func Test_readMeminfo(t *testing.T) {
 
 	// test "local" reading
 	conn.Local = true
-	got, err := readMeminfo(conn, false)
+	got, err := readMeminfo(conn, newProcReader("/proc"), false)
 	assert.NoError(t, err)
 	assert.Greater(t, got.MemTotal, uint64(0))
 
 	// test "remote" reading
 	conn.Local = false
-	got, err = readMeminfo(conn, true)
+	got, err = readMeminfo(conn, newProcReader("/proc"), true)
 	assert.NoError(t, err)
 	assert.Greater(t, got.MemTotal, uint64(0))
 
 	// test "remote", but when schema is not available
-	got, err = readMeminfo(conn, false)
+	got, err = readMeminfo(conn, newProcReader("/proc"), false)
 	assert.NoError(t, err)
 	assert.Equal(t, got.MemTotal, uint64(0))
 }
@@ -44,7 +44,7 @@ func Test_readMeminfoLocal(t *testing.T) {
 	}
 
 	for _, tc := range testcases {
-		got, err := readMeminfoLocal(tc.statfile)
+		got, err := readMeminfoLocal(newProcFile(tc.statfile))
 		if tc.valid {
 			assert.NoError(t, err)
 			assert.Equal(t, tc.want, got)
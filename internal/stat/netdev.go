@@ -3,14 +3,11 @@
 package stat
 
 import (
-	"bufio"
+	"bytes"
 	"fmt"
 	"github.com/lesovsky/pgcenter/internal/postgres"
 	"math"
-	"os"
-	"path/filepath"
-	"regexp"
-	"strings"
+	"time"
 )
 
 const (
@@ -58,9 +55,9 @@ type Netdev struct {
 type Netdevs []Netdev
 
 // readNetdevs returns network interfaces stats based on type of passed DB connection.
-func readNetdevs(db *postgres.DB, config Config) (Netdevs, error) {
+func readNetdevs(db *postgres.DB, r *procReader, config Config) (Netdevs, error) {
 	if db.Local {
-		return readNetdevsLocal("/proc/net/dev", config.ticks)
+		return readNetdevsLocal(r, config.ticks)
 	} else if config.SchemaPgcenterAvail {
 		return readNetdevsRemote(db)
 	}
@@ -68,66 +65,80 @@ func readNetdevs(db *postgres.DB, config Config) (Netdevs, error) {
 	return Netdevs{}, nil
 }
 
-// readNetdevsLocal returns network interfaces stats read from local proc file.
-func readNetdevsLocal(statfile string, ticks float64) (Netdevs, error) {
-	var stat Netdevs
-	f, err := os.Open(filepath.Clean(statfile))
+// readNetdevsLocal returns network interfaces stats read from local proc file. Returned stats are kept in reader's
+// buffer and valid until the next but one read.
+func readNetdevsLocal(r *procReader, ticks float64) (Netdevs, error) {
+	data, err := r.netdevFile.read()
 	if err != nil {
-		return stat, err
+		return nil, err
 	}
-	defer func() {
-		_ = f.Close()
-	}()
 
-	uptime, err := readUptimeLocal("/proc/uptime", ticks)
+	uptime, err := readUptimeLocal(r.uptimeFile, ticks)
 	if err != nil {
 		return nil, err
 	}
 
-	scanner := bufio.NewScanner(f)
 	// skip header
-	_ = scanner.Scan()
-	_ = scanner.Scan()
-
-	for scanner.Scan() {
-		line := scanner.Text()
-		values := strings.Fields(line)
+	_, data = nextLine(data)
+	_, data = nextLine(data)
+
+	stat := r.netdevs[r.nnetdev][:0]
+	now := time.Now()
+
+	var fields [16][]byte
+	for len(data) > 0 {
+		var line []byte
+		line, data = nextLine(data)
+
+		// Interface name is separated by colon, counters could follow it without spaces.
+		i := bytes.IndexByte(line, ':')
+		if i < 0 {
+			if splitFields(line, fields[:]) == 0 {
+				continue
+			}
+			return nil, fmt.Errorf("%s bad content: unknown file format, no interface name in line: %s", r.netdevFile.path, line)
+		}
 
-		if len(values) != 17 {
-			return nil, fmt.Errorf("%s bad content: unknown file format, wrong number of columns in line: %s", statfile, line)
+		if splitFields(line[i+1:], fields[:]) != 16 {
+			return nil, fmt.Errorf("%s bad content: unknown file format, wrong number of columns in line: %s", r.netdevFile.path, line)
 		}
 
-		var n = Netdev{}
+		ifname := bytes.TrimSpace(line[:i])
 
-		_, err = fmt.Sscanln(line,
-			&n.Ifname,
+		var n = Netdev{}
+		if !parseFloatFields(fields[:],
 			&n.Rbytes, &n.Rpackets, &n.Rerrs, &n.Rdrop, &n.Rfifo, &n.Rframe, &n.Rcompressed, &n.Rmulticast,
-			&n.Tbytes, &n.Tpackets, &n.Terrs, &n.Tdrop, &n.Tfifo, &n.Tcolls, &n.Tcarrier, &n.Tcompressed)
-		if err != nil {
-			return nil, fmt.Errorf("%s bad content", statfile)
+			&n.Tbytes, &n.Tpackets, &n.Terrs, &n.Tdrop, &n.Tfifo, &n.Tcolls, &n.Tcarrier, &n.Tcompressed,
+		) {
+			return nil, fmt.Errorf("%s bad content", r.netdevFile.path)
 		}
 
-		// skip pseudo block devices.
-		re := regexp.MustCompile(`docker|virbr|veth`)
-		if re.MatchString(n.Ifname) {
+		// skip virtual network interfaces.
+		if isVirtualInterface(ifname) {
 			continue
 		}
 
-		n.Ifname = strings.TrimRight(n.Ifname, ":")
+		n.Ifname = r.name(ifname)
 		n.Saturation = n.Rerrs + n.Rdrop + n.Tdrop + n.Tfifo + n.Tcolls + n.Tcarrier
 		n.Uptime = uptime
 
-		// Get interface's speed and duplex
-		// TODO: perhaps it's too expensive to poll interface in every execution of the function.
-		// TODO: log errors.
-		n.Speed, n.Duplex, _ = getLinkSettings(n.Ifname) // ignore errors, just use zeros if any
+		// Get interface's speed and duplex, settings are re-read periodically.
+		n.Speed, n.Duplex = r.linkSettings(n.Ifname, now)
 
 		stat = append(stat, n)
 	}
 
+	r.netdevs[r.nnetdev] = stat
+	r.nnetdev = 1 - r.nnetdev
+
 	return stat, nil
 }
 
+// isVirtualInterface returns true for names of virtual network interfaces.
+func isVirtualInterface(name []byte) bool {
+	return bytes.Contains(name, []byte("docker")) || bytes.Contains(name, []byte("virbr")) || bytes.Contains(name, []byte("veth"))
+}
+
 // readNetdevsRemote returns network interfaces stats from SQL stats schema.
 func readNetdevsRemote(db *postgres.DB) (Netdevs, error) {
 	var uptime float64
@@ -154,8 +165,7 @@ func readNetdevsRemote(db *postgres.DB) (Netdevs, error) {
 		}
 
 		// skip virtual network interfaces.
-		re := regexp.MustCompile(`docker|virbr|veth`)
-		if re.MatchString(n.Ifname) {
+		if isVirtualInterface([]byte(n.Ifname)) {
 			continue
 		}
 
@@ -17,18 +17,18 @@ func Test_readNetdevs(t *testing.T) {
 
 	// test "local" reading
 	conn.Local = true
-	got, err := readNetdevs(conn, Config{ticks: ticks, PostgresProperties: PostgresProperties{SchemaPgcenterAvail: false}})
+	got, err := readNetdevs(conn, newProcReader("/proc"), Config{ticks: ticks, PostgresProperties: PostgresProperties{SchemaPgcenterAvail: false}})
 	assert.NoError(t, err)
 	assert.Greater(t, len(got), 0)
 
 	// test "remote" reading
 	conn.Local = false
-	got, err = readNetdevs(conn, Config{PostgresProperties: PostgresProperties{SchemaPgcenterAvail: true}})
+	got, err = readNetdevs(conn, newProcReader("/proc"), Config{PostgresProperties: PostgresProperties{SchemaPgcenterAvail: true}})
 	assert.NoError(t, err)
 	assert.Greater(t, len(got), 0)
 
 	// test "remote", but when schema is not available
-	got, err = readNetdevs(conn, Config{PostgresProperties: PostgresProperties{SchemaPgcenterAvail: false}})
+	got, err = readNetdevs(conn, newProcReader("/proc"), Config{PostgresProperties: PostgresProperties{SchemaPgcenterAvail: false}})
 	assert.NoError(t, err)
 	assert.Equal(t, len(got), 0)
 }
@@ -69,7 +69,7 @@ func Test_readNetdevsLocal(t *testing.T) {
 	}
 
 	for _, tc := range testcases {
-		got, err := readNetdevsLocal(tc.statfile, ticks)
+		got, err := readNetdevsLocal(newTestProcReader(tc.statfile), ticks)
 		if tc.valid {
 			// as a workaround copy Uptime value from 'got' because it's read from real /proc/stat.
 			for i := range got {
@@ -107,10 +107,10 @@ func Test_countNetdevsUsage(t *testing.T) {
 	assert.NoError(t, err)
 	assert.NotEqual(t, float64(0), ticks)
 
-	prev, err := readNetdevsLocal("testdata/proc/netdev.v1.golden", ticks)
+	prev, err := readNetdevsLocal(newTestProcReader("testdata/proc/netdev.v1.golden"), ticks)
 	assert.NoError(t, err)
 
-	curr, err := readNetdevsLocal("testdata/proc/netdev.v2.golden", ticks)
+	curr, err := readNetdevsLocal(newTestProcReader("testdata/proc/netdev.v2.golden"), ticks)
 	assert.NoError(t, err)
 
 	// as a workaround copy Uptime value from 'got' because it's read from real /proc/stat.
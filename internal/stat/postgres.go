@@ -3,26 +3,56 @@ package stat
 import (
 	"bytes"
 	"database/sql"
+	"encoding/json"
 	"fmt"
+	"github.com/jackc/pgproto3/v2"
+	"github.com/jackc/pgx/v4"
 	"github.com/lesovsky/pgcenter/internal/postgres"
 	"github.com/lesovsky/pgcenter/internal/query"
 	"sort"
 	"strconv"
 	"strings"
+	"time"
 )
 
 // Pgstat describes collected Postgres stats.
 type Pgstat struct {
-	Activity Activity
-	Result   PGresult
+	Activity  Activity
+	Result    PGresult
+	Timestamp time.Time // time of Postgres server when stats have been collected
+	Elapsed   float64   // seconds elapsed since the previous snapshot, used for calculating rates
 }
 
-// collectPostgresStat collect Postgres activity stats and stats returned by passed query.
-func collectPostgresStat(db *postgres.DB, version int, pgss bool, itv int, query string, prev Pgstat) (Pgstat, error) {
+// collectPostgresStat collect Postgres activity stats and stats returned by passed query. All queries are sent to
+// Postgres in a single batch, hence collecting takes one network round trip regardless of number of queries. Stats
+// are read into memory of passed buffer, which should not be used by caller anymore. Time elapsed since the previous
+// snapshot is measured using clock of Postgres server, refresh interval is used when the previous snapshot has no time.
+func collectPostgresStat(db *postgres.DB, version int, pgss bool, refresh time.Duration, query string, prev Pgstat, buf PGresult) (Pgstat, error) {
 	var pgstat Pgstat
 
-	activity, err := collectActivityStat(db, version, pgss, itv, prev)
+	if query == "" {
+		return pgstat, fmt.Errorf("no query defined")
+	}
+
+	b := &pgx.Batch{}
+	queueClockTimestamp(b)
+	queueActivityStat(b, version, pgss)
+	b.Queue(query)
+
+	br := db.SendBatch(b)
+
+	ts, err := readClockTimestamp(br)
 	if err != nil {
+		_ = br.Close()
+		return pgstat, err
+	}
+
+	pgstat.Timestamp = ts
+	pgstat.Elapsed = elapsed(prev.Timestamp, ts, refresh)
+
+	activity, err := readActivityStat(br, pgss, pgstat.Elapsed, prev)
+	if err != nil {
+		_ = br.Close()
 		pgstat.Activity = activity
 		return pgstat, err
 	}
@@ -30,16 +60,55 @@ func collectPostgresStat(db *postgres.DB, version int, pgss bool, itv int, query
 	pgstat.Activity = activity
 
 	// Read stat
-	res, err := NewPGresult(db, query)
+	rows, err := br.Query()
+	if err != nil {
+		_ = br.Close()
+		return pgstat, err
+	}
+
+	err = buf.read(rows)
+	if err != nil {
+		_ = br.Close()
+		return pgstat, err
+	}
+
+	err = br.Close()
 	if err != nil {
 		return pgstat, err
 	}
 
-	pgstat.Result = res
+	pgstat.Result = buf
 
 	return pgstat, nil
 }
 
+// queueClockTimestamp queues query of the current time of Postgres server into the batch. Query is queued first: all
+// queries of the batch are executed in single transaction, and stats snapshot is taken at the first access to stats.
+func queueClockTimestamp(b *pgx.Batch) {
+	b.Queue(query.GetClockTimestamp)
+}
+
+// readClockTimestamp reads result of query queued by queueClockTimestamp.
+func readClockTimestamp(br pgx.BatchResults) (time.Time, error) {
+	var ts time.Time
+	err := br.QueryRow().Scan(&ts)
+	return ts, err
+}
+
+// elapsed returns number of seconds elapsed between times of two snapshots. When time of the previous snapshot is not
+// known or clock went backwards, the expected interval is returned.
+func elapsed(prev, curr time.Time, expected time.Duration) float64 {
+	if !prev.IsZero() && curr.After(prev) {
+		return curr.Sub(prev).Seconds()
+	}
+
+	if expected > 0 {
+		return expected.Seconds()
+	}
+
+	return 1
+}
+
 // Activity describes Postgres' current activity stats.
 type Activity struct {
 	State        string  // state of Postgres - up or down
@@ -60,47 +129,61 @@ type Activity struct {
 	Uptime       string  // Postgres uptime (since start)
 	Recovery     string  // Postgres recovery state
 	Calls        int     // Number of calls
-	CallsRate    int     // Number of calls per refresh interval
+	CallsRate    int     // Number of calls per second
 }
 
-// collectActivityStat collects Postgres runtime activity about connected clients and workload.
-func collectActivityStat(db *postgres.DB, version int, pgss bool, itv int, prev Pgstat) (Activity, error) {
-	var s Activity
+// queueActivityStat queues queries necessary for collecting Postgres activity stats into the batch.
+func queueActivityStat(b *pgx.Batch, version int, pgss bool) {
+	b.Queue(query.GetUptime)
+	b.Queue(query.GetRecoveryStatus)
 
-	if err := db.QueryRow(query.GetUptime).Scan(&s.Uptime); err != nil {
-		s.Uptime = "--:--:--"
+	// Depending on Postgres version select proper queries.
+	b.Queue(query.SelectActivityActivityQuery(version))
+	b.Queue(query.SelectActivityAutovacuumQuery(version))
+
+	// read pg_stat_statements only if it's available
+	if pgss {
+		b.Queue(query.SelectActivityStatementsQuery(version))
 	}
 
-	if err := db.QueryRow(query.GetRecoveryStatus).Scan(&s.Recovery); err != nil {
+	b.Queue(query.SelectActivityTimes)
+}
+
+// readActivityStat reads results of queries queued by queueActivityStat and returns Postgres runtime activity about
+// connected clients and workload.
+func readActivityStat(br pgx.BatchResults, pgss bool, itv float64, prev Pgstat) (Activity, error) {
+	var s Activity
+
+	// Queries are sent in a single implicit transaction, failed query aborts all following queries, hence there is
+	// no fallback value for uptime.
+	if err := br.QueryRow().Scan(&s.Uptime); err != nil {
 		return s, err
 	}
 
-	// Depending on Postgres version select proper queries.
-	queryActivity := query.SelectActivityActivityQuery(version)
-	queryAutovacuum := query.SelectActivityAutovacuumQuery(version)
+	if err := br.QueryRow().Scan(&s.Recovery); err != nil {
+		return s, err
+	}
 
-	err := db.QueryRow(queryActivity).Scan(
+	err := br.QueryRow().Scan(
 		&s.ConnTotal, &s.ConnIdle, &s.ConnIdleXact, &s.ConnActive, &s.ConnWaiting, &s.ConnOthers, &s.ConnPrepared)
 	if err != nil {
 		return s, err
 	}
 
-	err = db.QueryRow(queryAutovacuum).Scan(&s.AVWorkers, &s.AVAntiwrap, &s.AVUser, &s.AVMaxTime)
+	err = br.QueryRow().Scan(&s.AVWorkers, &s.AVAntiwrap, &s.AVUser, &s.AVMaxTime)
 	if err != nil {
 		return s, err
 	}
 
-	// read pg_stat_statements only if it's available
 	if pgss {
-		q := query.SelectActivityStatementsQuery(version)
-		err := db.QueryRow(q).Scan(&s.StmtAvgTime, &s.Calls)
+		err := br.QueryRow().Scan(&s.StmtAvgTime, &s.Calls)
 		if err != nil {
 			return s, err
 		}
-		s.CallsRate = (s.Calls - prev.Activity.Calls) / itv
+		s.CallsRate = int(float64(s.Calls-prev.Activity.Calls) / itv)
 	}
 
-	err = db.QueryRow(query.SelectActivityTimes).Scan(&s.XactMaxTime, &s.PrepMaxTime)
+	err = br.QueryRow().Scan(&s.XactMaxTime, &s.PrepMaxTime)
 	if err != nil {
 		return s, err
 	}
@@ -157,83 +240,389 @@ func GetPostgresProperties(db *postgres.DB) (PostgresProperties, error) {
 	return props, nil
 }
 
-// PGresult is the container for basic Postgres stats collected from pg_stat_* views
+// PGresult is the container for basic Postgres stats collected from pg_stat_* views. Values are stored per column in
+// typed columns, numbers are parsed once when result is created and formatted only when printed.
 type PGresult struct {
-	Values [][]sql.NullString /* values */
-	Cols   []string           /* list of columns' names */
-	Ncols  int                /* numbers of columns in Result */
-	Nrows  int                /* number of rows in Result */
-	Valid  bool               /* Used for result invalidations, on context switching for example */
+	Columns []Column /* values, stored per column */
+	Cols    []string /* list of columns' names */
+	Ncols   int      /* numbers of columns in Result */
+	Nrows   int      /* number of rows in Result */
+	Valid   bool     /* Used for result invalidations, on context switching for example */
 }
 
 // NewPGresult does query and wraps returned result into PGresult.
 func NewPGresult(db *postgres.DB, query string) (PGresult, error) {
+	var res PGresult
+	err := ReadPGresult(db, query, &res)
+	if err != nil {
+		return PGresult{}, err
+	}
+
+	return res, nil
+}
+
+// ReadPGresult does query and reads returned result into passed PGresult. Memory allocated for values of passed
+// PGresult is reused, hence reading results of the same query repeatedly allocates almost nothing.
+func ReadPGresult(db *postgres.DB, query string, res *PGresult) error {
 	if query == "" {
-		return PGresult{}, fmt.Errorf("no query defined")
+		return fmt.Errorf("no query defined")
 	}
 
 	rows, err := db.Query(query)
+	if err != nil {
+		return err
+	}
+
+	return res.read(rows)
+}
+
+// ReadPGresults sends passed queries to Postgres in a single batch and reads their results into memory of passed
+// results, hence reading takes one network round trip regardless of number of queries. Returns time of Postgres server
+// when results have been read.
+func ReadPGresults(db *postgres.DB, queries []string, res []PGresult) (time.Time, error) {
+	if len(queries) != len(res) {
+		return time.Time{}, fmt.Errorf("number of queries and results mismatch: %d != %d", len(queries), len(res))
+	}
+
+	b := &pgx.Batch{}
+	queueClockTimestamp(b)
+	for _, q := range queries {
+		if q == "" {
+			return time.Time{}, fmt.Errorf("no query defined")
+		}
+		b.Queue(q)
+	}
+
+	br := db.SendBatch(b)
+
+	ts, err := readClockTimestamp(br)
+	if err != nil {
+		_ = br.Close()
+		return time.Time{}, err
+	}
+
+	for i := range res {
+		rows, err := br.Query()
+		if err != nil {
+			_ = br.Close()
+			return time.Time{}, err
+		}
+
+		err = res[i].read(rows)
+		if err != nil {
+			_ = br.Close()
+			return time.Time{}, err
+		}
+	}
+
+	return ts, br.Close()
+}
+
+// NewPGresultFromValues wraps passed columns' names and text values into PGresult. Types of columns are detected using
+// the values: columns where all values are numbers become numeric columns. Numbers in scientific notation are not
+// considered as numbers, because labels might look like them, e.g. query ids in hex '12345678e9'.
+func NewPGresultFromValues(cols []string, values [][]sql.NullString) PGresult {
+	return newPGresultFromValues(cols, values, nil)
+}
+
+// newPGresultFromValues wraps passed columns' names and text values into PGresult using passed types of columns. When
+// types are not passed, they are detected using the values.
+func newPGresultFromValues(cols []string, values [][]sql.NullString, types []ColumnType) PGresult {
+	res := PGresult{
+		Columns: make([]Column, len(cols)),
+		Cols:    cols,
+		Ncols:   len(cols),
+		Nrows:   len(values),
+		Valid:   true,
+	}
+
+	for i := range res.Columns {
+		if types != nil {
+			res.Columns[i].Type = types[i]
+		} else {
+			res.Columns[i].Type = IntColumn
+		}
+	}
+
+	for _, row := range values {
+		for i := range res.Columns {
+			if i >= len(row) || !row[i].Valid {
+				res.Columns[i].appendNull()
+				continue
+			}
+			if types == nil && res.Columns[i].Type != TextColumn && strings.ContainsAny(row[i].String, "eE") {
+				res.Columns[i].toText()
+			}
+			res.Columns[i].appendValue(row[i].String)
+		}
+	}
+
+	return res
+}
+
+// newPGresult reads passed rows and wraps them into PGresult. Rows are closed after reading.
+func newPGresult(rows pgx.Rows) (PGresult, error) {
+	var res PGresult
+	err := res.read(rows)
 	if err != nil {
 		return PGresult{}, err
 	}
 
+	return res, nil
+}
+
+// read reads passed rows into PGresult reusing memory allocated for values and columns' names. Rows are closed after
+// reading.
+func (r *PGresult) read(rows pgx.Rows) error {
 	var (
 		descs = rows.FieldDescriptions()
 		ncols = len(descs)
 		nrows int
+		text  = true
 	)
 
-	// Storage used for data extracted from rows.
-	// Scan operation supports only slice of interfaces, 'pointers' slice is the intermediate store where all values written.
-	// Next values from 'pointers' associated with type-strict slice - 'values'. When Scan is writing to the 'pointers' it
-	// also writing to the 'values' under the hood. When all pointers/values have been scanned, put them into 'rowsStore'.
-	// Finally we get queryResult iterable store with data and information about stored rows, columns and columns names.
-	var rowsStore = make([][]sql.NullString, 0, 10)
+	if cap(r.Columns) < ncols {
+		r.Columns = append(r.Columns[:cap(r.Columns)], make([]Column, ncols-cap(r.Columns))...)
+	}
+	r.Columns = r.Columns[:ncols]
 
-	for rows.Next() {
-		pointers := make([]interface{}, ncols)
-		values := make([]sql.NullString, ncols)
+	// Columns of numeric types are parsed into numbers, others are stored as strings.
+	for i, d := range descs {
+		if isNumericOID(d.DataTypeOID) {
+			r.Columns[i].reset(IntColumn)
+		} else {
+			r.Columns[i].reset(TextColumn)
+		}
+		if d.Format != pgx.TextFormatCode {
+			text = false
+		}
+	}
 
+	// Values in text format are parsed directly from raw values. Values in binary format (when simple protocol is
+	// not used) are scanned into intermediate strings.
+	var values []sql.NullString
+	var pointers []interface{}
+	if !text {
+		values = make([]sql.NullString, ncols)
+		pointers = make([]interface{}, ncols)
 		for i := range pointers {
 			pointers[i] = &values[i]
 		}
+	}
 
-		err = rows.Scan(pointers...)
-		if err != nil {
-			//log.Warnf("skip collecting stats: %s", err) // TODO: add error handling and notification
-			continue
+	for rows.Next() {
+		if text {
+			for i, v := range rows.RawValues() {
+				if v == nil {
+					r.Columns[i].appendNull()
+					continue
+				}
+				r.Columns[i].appendRaw(v)
+			}
+		} else {
+			err := rows.Scan(pointers...)
+			if err != nil {
+				continue
+			}
+			for i, v := range values {
+				if !v.Valid {
+					r.Columns[i].appendNull()
+					continue
+				}
+				r.Columns[i].appendValue(v.String)
+			}
 		}
-		rowsStore = append(rowsStore, values)
 		nrows++
 	}
 
 	rows.Close()
 
-	// Convert pgproto3.FieldDescription into string.
-	colnames := make([]string, ncols)
+	err := rows.Err()
+	if err != nil {
+		return err
+	}
+
+	// Convert pgproto3.FieldDescription into string. Names are replaced only when they are changed, because
+	// slice of names might be shared with other results or views.
+	if r.Cols == nil || !equalNames(r.Cols, descs) {
+		r.Cols = make([]string, ncols)
+		for i, d := range descs {
+			r.Cols[i] = string(d.Name)
+		}
+	}
+
+	r.Ncols, r.Nrows, r.Valid = ncols, nrows, true
+
+	return nil
+}
+
+// equalNames returns true if passed names are equal to names of passed fields.
+func equalNames(names []string, descs []pgproto3.FieldDescription) bool {
+	if len(names) != len(descs) {
+		return false
+	}
+
 	for i, d := range descs {
-		colnames[i] = string(d.Name)
+		if names[i] != string(d.Name) {
+			return false
+		}
 	}
 
-	return PGresult{
-		Nrows:  nrows,
-		Ncols:  ncols,
-		Cols:   colnames,
-		Values: rowsStore,
-		Valid:  true,
-	}, nil
+	return true
+}
+
+// Value returns value of the cell formatted as string. NULLs are returned as empty strings.
+func (r *PGresult) Value(row, col int) string {
+	return r.Columns[col].String(row)
+}
+
+// ValueLen returns length of cell's value formatted as string.
+func (r *PGresult) ValueLen(row, col int) int {
+	return r.Columns[col].StringLen(row)
+}
+
+// values returns values of all cells formatted as strings and grouped by rows.
+func (r *PGresult) values() [][]sql.NullString {
+	values := make([][]sql.NullString, r.Nrows)
+	for i := range values {
+		values[i] = make([]sql.NullString, len(r.Columns))
+		for j := range r.Columns {
+			values[i][j] = sql.NullString{String: r.Columns[j].String(i), Valid: !r.Columns[j].IsNull(i)}
+		}
+	}
+
+	return values
+}
+
+// pgresultJSON defines JSON representation of PGresult. Values are stored as rows of strings which is compatible
+// with stats recorded by previous versions, types of columns are optional.
+type pgresultJSON struct {
+	Values [][]sql.NullString
+	Cols   []string
+	Ncols  int
+	Nrows  int
+	Valid  bool
+	Types  []ColumnType `json:",omitempty"`
+}
+
+// MarshalJSON implements json.Marshaler interface.
+func (r PGresult) MarshalJSON() ([]byte, error) {
+	v := pgresultJSON{
+		Values: r.values(),
+		Cols:   r.Cols,
+		Ncols:  r.Ncols,
+		Nrows:  r.Nrows,
+		Valid:  r.Valid,
+		Types:  make([]ColumnType, len(r.Columns)),
+	}
+
+	for i := range r.Columns {
+		v.Types[i] = r.Columns[i].Type
+	}
+
+	return json.Marshal(v)
+}
+
+// UnmarshalJSON implements json.Unmarshaler interface. When types of columns are not stored (stats recorded by
+// previous versions), types are detected using the values.
+func (r *PGresult) UnmarshalJSON(data []byte) error {
+	var v pgresultJSON
+	if err := json.Unmarshal(data, &v); err != nil {
+		return err
+	}
+
+	if len(v.Types) != len(v.Cols) {
+		v.Types = nil
+	}
+
+	*r = newPGresultFromValues(v.Cols, v.Values, v.Types)
+	r.Valid = v.Valid
+
+	return nil
+}
+
+// RowIndex maps values of unique key column to numbers of rows in stats snapshot. Index allows to find rows of the
+// previous snapshot without scanning the whole snapshot. Integer keys are indexed as is, other keys are indexed using
+// their string representation.
+type RowIndex struct {
+	ints map[int64]int
+	text map[string]int
+}
+
+// NewRowIndex creates index of rows for passed stats snapshot using column specified by unique key. If snapshot
+// contains rows with the same unique key, the first row is indexed.
+func NewRowIndex(r PGresult, ukey int) *RowIndex {
+	idx := &RowIndex{}
+
+	if ukey >= len(r.Columns) {
+		idx.text = map[string]int{}
+		return idx
+	}
+
+	col := &r.Columns[ukey]
+	switch col.Type {
+	case IntColumn:
+		idx.ints = make(map[int64]int, r.Nrows)
+		for i, v := range col.Int {
+			if _, ok := idx.ints[v]; !ok {
+				idx.ints[v] = i
+			}
+		}
+	default:
+		idx.text = make(map[string]int, r.Nrows)
+		for i := 0; i < col.Len(); i++ {
+			v := col.String(i)
+			if _, ok := idx.text[v]; !ok {
+				idx.text[v] = i
+			}
+		}
+	}
+
+	return idx
+}
+
+// Lookup returns number of indexed row which unique key is equal to value with passed number of passed column.
+func (idx *RowIndex) Lookup(c *Column, i int) (int, bool) {
+	var j int
+	var ok bool
+
+	switch {
+	case idx.ints != nil && c.Type == IntColumn:
+		j, ok = idx.ints[c.Int[i]]
+	case idx.ints != nil:
+		v, valid := parseInt(c.String(i))
+		if valid {
+			j, ok = idx.ints[v]
+		}
+	case c.Type == TextColumn:
+		j, ok = idx.text[c.Text[i]]
+	default:
+		j, ok = idx.text[c.String(i)]
+	}
+
+	return j, ok
 }
 
 // Compare is public wrapper around calculateDelta.
-func Compare(curr, prev PGresult, itv int, interval [2]int, skey int, desc bool, ukey int) (PGresult, error) {
-	return calculateDelta(curr, prev, itv, interval, skey, desc, ukey)
+func Compare(curr, prev PGresult, prevIdx *RowIndex, itv float64, interval [2]int, skey int, desc bool, ukey int, filter *Filter) (PGresult, error) {
+	return calculateDelta(curr, prev, prevIdx, itv, interval, skey, desc, ukey, filter)
 }
 
-// calculateDelta compares two PGresult structs and returns ordered delta PGresult.
-func calculateDelta(curr, prev PGresult, itv int, interval [2]int, skey int, desc bool, ukey int) (PGresult, error) {
-	// Make prev snapshot using current snap, at startup or at context switching
+// calculateDelta compares two PGresult structs and returns ordered delta PGresult, deltas are divided by number of
+// seconds elapsed between snapshots. Index of previous snapshot rows is optional, it is created when not passed. Filter is optional, rows of current snapshot which don't satisfy filter
+// are skipped before diff, and rows of delta which don't satisfy it are skipped before sorting.
+func calculateDelta(curr, prev PGresult, prevIdx *RowIndex, itv float64, interval [2]int, skey int, desc bool, ukey int, filter *Filter) (PGresult, error) {
+	// Skip rows which can't be shown, previous snapshot is kept as-is because its index refers to all rows.
+	curr = filter.selectBeforeDiff(curr)
+
+	// Make prev snapshot using current snap, at startup or at context switching. Current snapshot is copied, because its
+	// memory is reused by collector for next snapshots, while returned result might be still in use.
 	if !prev.Valid {
-		return curr, nil
+		rows := filter.rowsAfterDiff(&curr)
+		if rows == nil {
+			rows = allRows(curr.Nrows)
+		}
+		return curr.selectRows(rows), nil
 	}
 
 	var delta PGresult
@@ -241,7 +630,11 @@ func calculateDelta(curr, prev PGresult, itv int, interval [2]int, skey int, des
 
 	// Diff previous and current stats snapshot
 	if interval != [2]int{0, 0} {
-		delta, err = diff(curr, prev, itv, interval, ukey)
+		if prevIdx == nil {
+			prevIdx = NewRowIndex(prev, ukey)
+		}
+
+		delta, err = diff(curr, prev, prevIdx, itv, interval, ukey)
 		if err != nil {
 			return PGresult{}, fmt.Errorf("diff failed: %s", err)
 		}
@@ -249,112 +642,242 @@ func calculateDelta(curr, prev PGresult, itv int, interval [2]int, skey int, des
 		delta = curr
 	}
 
-	delta.sort(skey, desc)
+	delta.sortRows(filter.rowsAfterDiff(&delta), skey, desc)
 
 	return delta, nil
 }
 
-// diff compares two PGresult values and produces new differential PGresult.
-func diff(curr PGresult, prev PGresult, itv int, interval [2]int, ukey int) (PGresult, error) {
+// diff compares two PGresult values and produces new differential PGresult. Rows of 'previous' snapshot are looked up
+// using passed index.
+func diff(curr PGresult, prev PGresult, prevIdx *RowIndex, itv float64, interval [2]int, ukey int) (PGresult, error) {
 	var diff PGresult
-	var found bool
 
-	diff.Values = make([][]sql.NullString, curr.Nrows)
+	diff.Columns = make([]Column, curr.Ncols)
 	diff.Cols = curr.Cols
 	diff.Ncols = len(curr.Cols)
 	diff.Nrows = curr.Nrows
 
-	// Take every row from 'current' snapshot and check its existing in 'previous' snapshot. If row exists in both snapshots
-	// make diff between them. If target row is not found in 'previous' snapshot, no diff needed, hence append this row
-	// as-is into 'result' snapshot.
+	// Find rows of 'previous' snapshot which correspond to rows of 'current' snapshot, -1 means row is not found.
 	// Thus in the end, all rows that aren't exist in the 'current' snapshot, but exist in 'previous', will be skipped.
-	for i, cv := range curr.Values {
-		// Allocate container for target row and reset 'found' flag
-		diff.Values[i] = make([]sql.NullString, curr.Ncols)
-		found = false
-
-		for j, pv := range prev.Values {
-			if cv[ukey].String == pv[ukey].String {
-				// Row exists in both snapshots
-				found = true
-
-				// Do diff
-				for l := 0; l < curr.Ncols; l++ {
-					if l < interval[0] || l > interval[1] {
-						diff.Values[i][l].String = curr.Values[i][l].String // don't diff, copy value as-is
-						diff.Values[i][l].Valid = curr.Values[i][l].Valid
-					} else {
-						// Values with dots or in scientific notation consider as floats and integer otherwise.
-						if strings.Contains(prev.Values[j][l].String, ".") || strings.Contains(prev.Values[j][l].String, "e") ||
-							strings.Contains(curr.Values[i][l].String, ".") || strings.Contains(curr.Values[i][l].String, "e") {
-							cv, err := strconv.ParseFloat(curr.Values[i][l].String, 64)
-							if err != nil {
-								return diff, fmt.Errorf("failed to convert curr to float [%d:%d]: %s", i, l, err)
-							}
-							pv, err := strconv.ParseFloat(prev.Values[j][l].String, 64)
-							if err != nil {
-								return diff, fmt.Errorf("failed to convert prev to float [%d:%d]: %s", j, l, err)
-							}
-							diff.Values[i][l].String = strconv.FormatFloat((cv-pv)/float64(itv), 'f', 2, 64)
-							diff.Values[i][l].Valid = true
-						} else {
-							cv, err := strconv.ParseInt(curr.Values[i][l].String, 10, 64)
-							if err != nil {
-								return diff, fmt.Errorf("failed to convert curr to integer [%d:%d]: %s", i, l, err)
-							}
-							pv, err := strconv.ParseInt(prev.Values[j][l].String, 10, 64)
-							if err != nil {
-								return diff, fmt.Errorf("failed to convert prev to integer [%d:%d]: %s", j, l, err)
-							}
-							diff.Values[i][l].String = strconv.FormatInt((cv-pv)/int64(itv), 10)
-							diff.Values[i][l].Valid = true
-						}
-					}
-				}
-				break // Go to searching next row from current snapshot
-			}
+	prows := make([]int, curr.Nrows)
+	for i := range prows {
+		j, found := prevIdx.Lookup(&curr.Columns[ukey], i)
+
+		// Index doesn't correspond to 'previous' snapshot (e.g. snapshot has been re-ordered), rebuild it.
+		if found && (j >= prev.Nrows || !prev.Columns[ukey].equal(j, &curr.Columns[ukey], i)) {
+			prevIdx = NewRowIndex(prev, ukey)
+			j, found = prevIdx.Lookup(&curr.Columns[ukey], i)
 		}
 
-		// End of the searching in 'previous' snapshot, if we reached here it means row not found and it simply should be added as is.
 		if !found {
-			for l := 0; l < curr.Ncols; l++ {
-				diff.Values[i][l].String = curr.Values[i][l].String // don't diff, copy value as-is
-				diff.Values[i][l].Valid = curr.Values[i][l].Valid
-			}
+			j = -1
+		}
+		prows[i] = j
+	}
+
+	// Columns outside of diff interval are copied as-is, other columns are diffed. If row is not found in 'previous'
+	// snapshot no diff needed, and values are copied as-is.
+	for l := 0; l < curr.Ncols; l++ {
+		if l < interval[0] || l > interval[1] {
+			diff.Columns[l] = curr.Columns[l]
+			continue
+		}
+
+		col, err := diffColumn(&curr.Columns[l], &prev.Columns[l], prows, itv)
+		if err != nil {
+			return diff, fmt.Errorf("column %d: %s", l, err)
 		}
+		diff.Columns[l] = col
 	}
 
 	diff.Valid = true
 	return diff, nil
 }
 
+// diffColumn calculates per-second delta between values of 'current' and 'previous' columns. Values of integer columns
+// produce integer deltas truncated toward zero, floats are used otherwise.
+func diffColumn(curr, prev *Column, prows []int, itv float64) (Column, error) {
+	var res Column
+
+	// Columns with non-numeric values can't be diffed in a typed manner, diff their values one by one.
+	if curr.Type == TextColumn || prev.Type == TextColumn {
+		return diffTextColumn(curr, prev, prows, itv)
+	}
+
+	if curr.Null != nil {
+		res.Null = make([]bool, len(prows))
+	}
+
+	if curr.Type == IntColumn && prev.Type == IntColumn {
+		res.Type = IntColumn
+		res.Int = make([]int64, len(prows))
+		for i, j := range prows {
+			switch {
+			case curr.IsNull(i):
+				res.Null[i] = true
+			case j < 0 || prev.IsNull(j):
+				res.Int[i] = curr.Int[i]
+			default:
+				res.Int[i] = int64(float64(curr.Int[i]-prev.Int[j]) / itv)
+			}
+		}
+		return res, nil
+	}
+
+	res.Type = FloatColumn
+	res.Prec = 2
+	res.Float = make([]float64, len(prows))
+	for i, j := range prows {
+		cv, _ := curr.float(i)
+		switch {
+		case curr.IsNull(i):
+			res.Null[i] = true
+		case j < 0 || prev.IsNull(j):
+			res.Float[i] = cv
+		default:
+			pv, _ := prev.float(j)
+			res.Float[i] = (cv - pv) / itv
+		}
+	}
+
+	return res, nil
+}
+
+// diffTextColumn calculates per-second delta between values of columns which contain non-numeric values. Values are
+// parsed one by one, values with dots or in scientific notation consider as floats and integer otherwise.
+func diffTextColumn(curr, prev *Column, prows []int, itv float64) (Column, error) {
+	res := Column{Type: TextColumn, Text: make([]string, len(prows))}
+	if curr.Null != nil {
+		res.Null = make([]bool, len(prows))
+	}
+
+	for i, j := range prows {
+		if curr.IsNull(i) {
+			res.Null[i] = true
+			continue
+		}
+
+		cs := curr.String(i)
+		if j < 0 {
+			res.Text[i] = cs // don't diff, copy value as-is
+			continue
+		}
+
+		ps := prev.String(j)
+		if strings.ContainsAny(cs, ".e") || strings.ContainsAny(ps, ".e") {
+			cv, err := strconv.ParseFloat(cs, 64)
+			if err != nil {
+				return res, fmt.Errorf("failed to convert curr to float [%d]: %s", i, err)
+			}
+			pv, err := strconv.ParseFloat(ps, 64)
+			if err != nil {
+				return res, fmt.Errorf("failed to convert prev to float [%d]: %s", j, err)
+			}
+			res.Text[i] = strconv.FormatFloat((cv-pv)/itv, 'f', 2, 64)
+		} else {
+			cv, err := strconv.ParseInt(cs, 10, 64)
+			if err != nil {
+				return res, fmt.Errorf("failed to convert curr to integer [%d]: %s", i, err)
+			}
+			pv, err := strconv.ParseInt(ps, 10, 64)
+			if err != nil {
+				return res, fmt.Errorf("failed to convert prev to integer [%d]: %s", j, err)
+			}
+			res.Text[i] = strconv.FormatInt(int64(float64(cv-pv)/itv), 10)
+		}
+	}
+
+	return res, nil
+}
+
 // sort performs sorting of PGresult using order key and order.
 func (r *PGresult) sort(key int, desc bool) {
-	if r.Nrows == 0 {
-		return /* nothing to sort */
+	r.sortRows(nil, key, desc)
+}
+
+// sortRows performs sorting of PGresult using order key and order, only rows with passed numbers are kept. All rows
+// are kept if no numbers passed.
+func (r *PGresult) sortRows(rows []int, key int, desc bool) {
+	// Sort numbers of rows using values of key column, and then reorder all columns accordingly.
+	perm := rows
+	if perm == nil {
+		if r.Nrows == 0 {
+			return /* nothing to sort */
+		}
+
+		perm = allRows(r.Nrows)
 	}
 
-	_, err := strconv.ParseFloat(r.Values[0][key].String, 64)
-	if err == nil {
-		// value is numeric
-		sort.Slice(r.Values, func(i, j int) bool {
-			// TODO: handle errors
-			l, _ := strconv.ParseFloat(r.Values[i][key].String, 64)
-			r, _ := strconv.ParseFloat(r.Values[j][key].String, 64)
+	col := &r.Columns[key]
+	switch col.Type {
+	case IntColumn:
+		sort.Slice(perm, func(i, j int) bool {
 			if desc {
-				return l > r /* desc order: 10 -> 0 */
+				return col.Int[perm[i]] > col.Int[perm[j]] /* desc order: 10 -> 0 */
 			}
-			return l < r /* asc order: 0 -> 10 */
+			return col.Int[perm[i]] < col.Int[perm[j]] /* asc order: 0 -> 10 */
 		})
-	} else {
-		// value is string
-		sort.Slice(r.Values, func(i, j int) bool {
+	case FloatColumn:
+		sort.Slice(perm, func(i, j int) bool {
 			if desc {
-				return r.Values[i][key].String > r.Values[j][key].String /* desc order: 'z' -> 'a' */
+				return col.Float[perm[i]] > col.Float[perm[j]] /* desc order: 10 -> 0 */
 			}
-			return r.Values[i][key].String < r.Values[j][key].String /* asc order: 'a' -> 'z' */
+			return col.Float[perm[i]] < col.Float[perm[j]] /* asc order: 0 -> 10 */
 		})
+	default:
+		// Text columns might contain numbers formatted by Postgres, e.g. rounded timings or percents, they are sorted
+		// as numbers when the first value is a number. Values are parsed once before sorting.
+		if len(perm) > 0 {
+			if _, err := strconv.ParseFloat(col.Text[perm[0]], 64); err == nil {
+				nums := make([]float64, col.Len())
+				for _, i := range perm {
+					nums[i], _ = strconv.ParseFloat(col.Text[i], 64)
+				}
+				sort.Slice(perm, func(i, j int) bool {
+					if desc {
+						return nums[perm[i]] > nums[perm[j]] /* desc order: 10 -> 0 */
+					}
+					return nums[perm[i]] < nums[perm[j]] /* asc order: 0 -> 10 */
+				})
+				break
+			}
+		}
+
+		sort.Slice(perm, func(i, j int) bool {
+			if desc {
+				return col.Text[perm[i]] > col.Text[perm[j]] /* desc order: 'z' -> 'a' */
+			}
+			return col.Text[perm[i]] < col.Text[perm[j]] /* asc order: 'a' -> 'z' */
+		})
+	}
+
+	r.permute(perm)
+}
+
+// allRows returns numbers of all rows of result with passed number of rows.
+func allRows(n int) []int {
+	rows := make([]int, n)
+	for i := range rows {
+		rows[i] = i
+	}
+	return rows
+}
+
+// selectRows returns result with rows with passed numbers.
+func (r PGresult) selectRows(rows []int) PGresult {
+	r.permute(rows)
+	return r
+}
+
+// permute reorders rows of PGresult accordingly to passed numbers of rows, rows which are not passed are removed.
+func (r *PGresult) permute(perm []int) {
+	// Columns might be shared with other results, hence reordered columns are created instead of reordering in-place.
+	columns := make([]Column, len(r.Columns))
+	for i := range r.Columns {
+		columns[i] = r.Columns[i].permute(perm)
 	}
+	r.Columns = columns
+	r.Nrows = len(perm)
 }
 
 // Fprint prints content of PGresult container to buffer.
@@ -363,8 +886,8 @@ func (r *PGresult) Fprint(buf *bytes.Buffer) error {
 	widthMap := map[int]int{}
 	var valuelen int
 	for colnum := range r.Cols {
-		for rownum := 0; rownum < len(r.Values); rownum++ {
-			valuelen = len(r.Values[rownum][colnum].String)
+		for rownum := 0; rownum < r.Nrows; rownum++ {
+			valuelen = r.ValueLen(rownum, colnum)
 			if valuelen > widthMap[colnum] {
 				widthMap[colnum] = valuelen
 			}
@@ -387,7 +910,7 @@ func (r *PGresult) Fprint(buf *bytes.Buffer) error {
 	for colnum, rownum := 0, 0; rownum < r.Nrows; rownum, colnum = rownum+1, 0 {
 		for range r.Cols {
 			/* m[row][column] */
-			_, err := fmt.Fprintf(buf, "%-*s", widthMap[colnum]+2, r.Values[rownum][colnum].String)
+			_, err := fmt.Fprintf(buf, "%-*s", widthMap[colnum]+2, r.Value(rownum, colnum))
 			if err != nil {
 				return err
 			}
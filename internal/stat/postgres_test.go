@@ -3,21 +3,23 @@ package stat
 import (
 	"bytes"
 	"database/sql"
+	"encoding/json"
 	"fmt"
+	"github.com/jackc/pgproto3/v2"
+	"github.com/jackc/pgx/v4"
 	"github.com/lesovsky/pgcenter/internal/postgres"
 	"github.com/lesovsky/pgcenter/internal/query"
 	"github.com/stretchr/testify/assert"
+	"strconv"
 	"testing"
+	"time"
 )
 
 // newTestPGresult return PGresult with test content for test purposes.
 func newTestPGresult() PGresult {
-	return PGresult{
-		Valid: true,
-		Ncols: 4,
-		Nrows: 8,
-		Cols:  []string{"col1", "col2", "col3", "col4"},
-		Values: [][]sql.NullString{
+	return NewPGresultFromValues(
+		[]string{"col1", "col2", "col3", "col4"},
+		[][]sql.NullString{
 			{
 				{String: "248", Valid: true}, {String: "brodsky", Valid: true}, {String: "row6:value3", Valid: true}, {String: "row6:value4", Valid: true},
 			},
@@ -43,7 +45,7 @@ func newTestPGresult() PGresult {
 				{String: "1", Valid: true}, {String: "bronze", Valid: true}, {String: "row1:value3", Valid: true}, {String: "row1:value4", Valid: true},
 			},
 		},
-	}
+	)
 }
 
 func Test_collectPostgresStat(t *testing.T) {
@@ -53,14 +55,23 @@ func Test_collectPostgresStat(t *testing.T) {
 	prev := Pgstat{Activity: Activity{Calls: 0}}
 
 	version := 1000000 // suppose to use PG 100.0
-	got, err := collectPostgresStat(conn, version, true, 1, query.PgStatDatabaseDefault, prev)
+	got, err := collectPostgresStat(conn, version, true, 1, query.PgStatDatabaseDefault, prev, PGresult{})
 	assert.NoError(t, err)
 	assert.Equal(t, "ok", got.Activity.State)
 	assert.Greater(t, got.Result.Nrows, 0)
 
+	// testing with invalid query, activity stats should be collected anyway
+	got, err = collectPostgresStat(conn, version, true, 1, "SELECT qq", prev, PGresult{})
+	assert.Error(t, err)
+	assert.Equal(t, "ok", got.Activity.State)
+
+	// testing with empty query
+	_, err = collectPostgresStat(conn, version, true, 1, "", prev, PGresult{})
+	assert.Error(t, err)
+
 	// testing with already closed conn
 	conn.Close()
-	_, err = collectPostgresStat(conn, 0, true, 1, "SELECT qq", prev)
+	_, err = collectPostgresStat(conn, 0, true, 1, "SELECT qq", prev, PGresult{})
 	assert.Error(t, err)
 }
 
@@ -71,8 +82,12 @@ func Test_collectActivityStat(t *testing.T) {
 	prev := Pgstat{Activity: Activity{Calls: 0}}
 
 	version := 1000000 // suppose to use PG 100.0
-	got, err := collectActivityStat(conn, version, true, 1, prev)
+	b := &pgx.Batch{}
+	queueActivityStat(b, version, true)
+	br := conn.SendBatch(b)
+	got, err := readActivityStat(br, true, 1, prev)
 	assert.NoError(t, err)
+	assert.NoError(t, br.Close())
 	assert.Equal(t, "ok", got.State)
 	assert.NotEqual(t, "", got.Uptime)
 	assert.NotEqual(t, "", got.Recovery)
@@ -84,8 +99,12 @@ func Test_collectActivityStat(t *testing.T) {
 
 	// testing with already closed conn
 	conn.Close()
-	_, err = collectActivityStat(conn, 0, true, 1, prev)
+	b = &pgx.Batch{}
+	queueActivityStat(b, 0, true)
+	br = conn.SendBatch(b)
+	_, err = readActivityStat(br, true, 1, prev)
 	assert.Error(t, err)
+	assert.Error(t, br.Close())
 }
 
 func TestGetPostgresProperties(t *testing.T) {
@@ -117,11 +136,12 @@ func TestNewPGresult(t *testing.T) {
 
 	want := PGresult{
 		Valid: true, Ncols: 4, Nrows: 3, Cols: []string{"id", "name", "v1", "v2"},
-		Values: [][]sql.NullString{
-			{{String: "1", Valid: true}, {String: "one", Valid: true}, {String: "10", Valid: true}, {String: "111e-1", Valid: true}},
-			{{String: "2", Valid: true}, {String: "two", Valid: true}, {String: "20", Valid: true}, {String: "222e-1", Valid: true}},
-			// next row contains NULL values, all Valid fields are 'false'
-			{{String: "3", Valid: true}, {String: "", Valid: false}, {String: "", Valid: false}, {String: "", Valid: false}},
+		Columns: []Column{
+			{Type: IntColumn, Int: []int64{1, 2, 3}},
+			// next columns contain NULL values
+			{Type: TextColumn, Text: []string{"one", "two", ""}, Null: []bool{false, false, true}},
+			{Type: IntColumn, Int: []int64{10, 20, 0}, Null: []bool{false, false, true}},
+			{Type: FloatColumn, Float: []float64{11.1, 22.2, 0}, Null: []bool{false, false, true}, Prec: 1},
 		},
 	}
 	got, err := NewPGresult(conn, "SELECT * FROM (VALUES (1,'one',10,11.1), (2,'two',20,22.2), (3,NULL,NULL,NULL)) AS t (id,name,v1,v2)")
@@ -138,10 +158,136 @@ func TestNewPGresult(t *testing.T) {
 	assert.Error(t, err)
 }
 
+func TestReadPGresults(t *testing.T) {
+	conn, err := postgres.NewTestConnect()
+	assert.NoError(t, err)
+
+	queries := []string{"SELECT 1 AS a", "SELECT 'one' AS b, 2.5 AS c"}
+	res := make([]PGresult, len(queries))
+	ts, err := ReadPGresults(conn, queries, res)
+	assert.NoError(t, err)
+	assert.False(t, ts.IsZero())
+	assert.Equal(t, []string{"a"}, res[0].Cols)
+	assert.Equal(t, "1", res[0].Value(0, 0))
+	assert.Equal(t, []string{"b", "c"}, res[1].Cols)
+	assert.Equal(t, "one", res[1].Value(0, 0))
+	assert.Equal(t, "2.5", res[1].Value(0, 1))
+
+	// testing mismatched number of results
+	_, err = ReadPGresults(conn, queries, res[:1])
+	assert.Error(t, err)
+
+	// testing empty query
+	_, err = ReadPGresults(conn, []string{"SELECT 1", ""}, res)
+	assert.Error(t, err)
+
+	// testing invalid query, connection should remain usable
+	_, err = ReadPGresults(conn, []string{"SELECT 1", "SELECT invalid"}, res)
+	assert.Error(t, err)
+	_, err = ReadPGresults(conn, queries, res)
+	assert.NoError(t, err)
+
+	// testing with already closed conn
+	conn.Close()
+	_, err = ReadPGresults(conn, queries, res)
+	assert.Error(t, err)
+}
+
+// testRows implements pgx.Rows and returns predefined raw values in text format.
+type testRows struct {
+	pgx.Rows
+	descs  []pgproto3.FieldDescription
+	values [][][]byte
+	n      int
+}
+
+func (r *testRows) FieldDescriptions() []pgproto3.FieldDescription { return r.descs }
+func (r *testRows) Next() bool                                     { r.n++; return r.n <= len(r.values) }
+func (r *testRows) RawValues() [][]byte                            { return r.values[r.n-1] }
+func (r *testRows) Close()                                         {}
+func (r *testRows) Err() error                                     { return nil }
+
+// newTestRows returns rows similar to 'tables' stats view: relation name, integer counters and float timing.
+func newTestRows(nrows int, shift int) *testRows {
+	rows := &testRows{
+		descs: []pgproto3.FieldDescription{
+			{Name: []byte("relation"), DataTypeOID: 25},
+			{Name: []byte("seq_scan"), DataTypeOID: oidInt8},
+			{Name: []byte("idx_scan"), DataTypeOID: oidInt8},
+			{Name: []byte("vacuum_t"), DataTypeOID: oidNumeric},
+			{Name: []byte("comment"), DataTypeOID: 25},
+		},
+	}
+
+	for i := 0; i < nrows; i++ {
+		row := [][]byte{
+			[]byte(fmt.Sprintf("public.relation_%d", i)),
+			[]byte(strconv.Itoa(i + shift)),
+			[]byte(strconv.Itoa(i * shift)),
+			[]byte(fmt.Sprintf("%d.%02d", i, shift%100)),
+			nil,
+		}
+		rows.values = append(rows.values, row)
+	}
+
+	return rows
+}
+
+func TestPGresult_read(t *testing.T) {
+	var res PGresult
+	assert.NoError(t, res.read(newTestRows(3, 10)))
+	assert.Equal(t, []string{"relation", "seq_scan", "idx_scan", "vacuum_t", "comment"}, res.Cols)
+	assert.Equal(t, 3, res.Nrows)
+	assert.Equal(t, 5, res.Ncols)
+	assert.Equal(t, []ColumnType{TextColumn, IntColumn, IntColumn, FloatColumn, TextColumn},
+		[]ColumnType{res.Columns[0].Type, res.Columns[1].Type, res.Columns[2].Type, res.Columns[3].Type, res.Columns[4].Type})
+	assert.Equal(t, "public.relation_1", res.Value(1, 0))
+	assert.Equal(t, "11", res.Value(1, 1))
+	assert.Equal(t, "1.10", res.Value(1, 3))
+	assert.True(t, res.Columns[4].IsNull(2))
+
+	// reading into the same result reuses memory of columns, names and labels
+	cols, labels := res.Cols, res.Columns[0].Text
+	assert.NoError(t, res.read(newTestRows(2, 20)))
+	assert.Equal(t, 2, res.Nrows)
+	assert.Equal(t, "21", res.Value(1, 1))
+	assert.Equal(t, "1.20", res.Value(1, 3))
+	assert.Equal(t, &cols[0], &res.Cols[0])
+	assert.Equal(t, &labels[0], &res.Columns[0].Text[0])
+
+	// result read into reused memory is the same as result read into new one
+	want, err := newPGresult(newTestRows(2, 20))
+	assert.NoError(t, err)
+	assert.Equal(t, want.values(), res.values())
+}
+
+func BenchmarkPGresult_read(b *testing.B) {
+	for _, n := range []int{1000, 10000} {
+		rows := newTestRows(n, 10)
+
+		b.Run("new/"+strconv.Itoa(n), func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				rows.n = 0
+				_, _ = newPGresult(rows)
+			}
+		})
+
+		b.Run("reuse/"+strconv.Itoa(n), func(b *testing.B) {
+			var res PGresult
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				rows.n = 0
+				_ = res.read(rows)
+			}
+		})
+	}
+}
+
 func Test_calculateDelta(t *testing.T) {
-	prev := PGresult{
-		Valid: true, Ncols: 4, Nrows: 4, Cols: []string{"unique", "col2", "col3", "col4"},
-		Values: [][]sql.NullString{
+	prev := NewPGresultFromValues(
+		[]string{"unique", "col2", "col3", "col4"},
+		[][]sql.NullString{
 			{{String: "1", Valid: true}, {String: "300", Valid: true}, {String: "100", Valid: true}, {String: "500", Valid: true}},
 			{{String: "2", Valid: true}, {String: "400", Valid: true}, {String: "200", Valid: true}, {String: "600", Valid: true}},
 			{{String: "3", Valid: true}, {String: "100.0", Valid: true}, {String: "300", Valid: true}, {String: "700", Valid: true}},
@@ -149,10 +295,10 @@ func Test_calculateDelta(t *testing.T) {
 			// next row is not present in 'curr' and should be skipped.
 			{{String: "5", Valid: true}, {String: "200", Valid: true}, {String: "400.0", Valid: true}, {String: "800", Valid: true}},
 		},
-	}
-	curr := PGresult{
-		Valid: true, Ncols: 4, Nrows: 5, Cols: []string{"unique", "col2", "col3", "col4"},
-		Values: [][]sql.NullString{
+	)
+	curr := NewPGresultFromValues(
+		[]string{"unique", "col2", "col3", "col4"},
+		[][]sql.NullString{
 			{{String: "1", Valid: true}, {String: "330.5", Valid: true}, {String: "150", Valid: true}, {String: "500", Valid: true}},
 			{{String: "2", Valid: true}, {String: "440", Valid: true}, {String: "280.6", Valid: true}, {String: "620", Valid: true}},
 			{{String: "3", Valid: true}, {String: "110", Valid: true}, {String: "300", Valid: true}, {String: "710", Valid: true}},
@@ -160,58 +306,74 @@ func Test_calculateDelta(t *testing.T) {
 			// next row is not present in 'prev' and should be added as-is to 'diff' result.
 			{{String: "6", Valid: true}, {String: "560", Valid: true}, {String: "510", Valid: true}, {String: "920", Valid: true}},
 		},
-	}
-	currInvalid := PGresult{
-		Valid: true, Ncols: 4, Nrows: 1, Cols: []string{"unique", "col2", "col3", "col4"},
-		Values: [][]sql.NullString{
+	)
+	currInvalid := NewPGresultFromValues(
+		[]string{"unique", "col2", "col3", "col4"},
+		[][]sql.NullString{
 			{{String: "1", Valid: true}, {String: "invalid", Valid: true}, {String: "150", Valid: true}, {String: "500", Valid: true}},
 		},
+	)
+	// Columns with fractional values are diffed as floats, integer columns are diffed as integers.
+	wantAsc := [][]sql.NullString{
+		{{String: "3", Valid: true}, {String: "10.00", Valid: true}, {String: "0.00", Valid: true}, {String: "10", Valid: true}},
+		{{String: "4", Valid: true}, {String: "20.00", Valid: true}, {String: "90.00", Valid: true}, {String: "0", Valid: true}},
+		{{String: "1", Valid: true}, {String: "30.50", Valid: true}, {String: "50.00", Valid: true}, {String: "0", Valid: true}},
+		{{String: "2", Valid: true}, {String: "40.00", Valid: true}, {String: "80.60", Valid: true}, {String: "20", Valid: true}},
+		{{String: "6", Valid: true}, {String: "560.00", Valid: true}, {String: "510.00", Valid: true}, {String: "920", Valid: true}},
 	}
-	wantAsc := PGresult{
-		Valid: true, Ncols: 4, Nrows: 5, Cols: []string{"unique", "col2", "col3", "col4"},
-		Values: [][]sql.NullString{
-			{{String: "3", Valid: true}, {String: "10.00", Valid: true}, {String: "0", Valid: true}, {String: "10", Valid: true}},
-			{{String: "4", Valid: true}, {String: "20", Valid: true}, {String: "90.00", Valid: true}, {String: "0", Valid: true}},
-			{{String: "1", Valid: true}, {String: "30.50", Valid: true}, {String: "50", Valid: true}, {String: "0", Valid: true}},
-			{{String: "2", Valid: true}, {String: "40", Valid: true}, {String: "80.60", Valid: true}, {String: "20", Valid: true}},
-			{{String: "6", Valid: true}, {String: "560", Valid: true}, {String: "510", Valid: true}, {String: "920", Valid: true}},
-		},
+	wantDesc := [][]sql.NullString{
+		{{String: "6", Valid: true}, {String: "560.00", Valid: true}, {String: "510.00", Valid: true}, {String: "920", Valid: true}},
+		{{String: "2", Valid: true}, {String: "40.00", Valid: true}, {String: "80.60", Valid: true}, {String: "20", Valid: true}},
+		{{String: "1", Valid: true}, {String: "30.50", Valid: true}, {String: "50.00", Valid: true}, {String: "0", Valid: true}},
+		{{String: "4", Valid: true}, {String: "20.00", Valid: true}, {String: "90.00", Valid: true}, {String: "0", Valid: true}},
+		{{String: "3", Valid: true}, {String: "10.00", Valid: true}, {String: "0.00", Valid: true}, {String: "10", Valid: true}},
 	}
-	wantDesc := PGresult{
-		Valid: true, Ncols: 4, Nrows: 5, Cols: []string{"unique", "col2", "col3", "col4"},
-		Values: [][]sql.NullString{
-			{{String: "6", Valid: true}, {String: "560", Valid: true}, {String: "510", Valid: true}, {String: "920", Valid: true}},
-			{{String: "2", Valid: true}, {String: "40", Valid: true}, {String: "80.60", Valid: true}, {String: "20", Valid: true}},
-			{{String: "1", Valid: true}, {String: "30.50", Valid: true}, {String: "50", Valid: true}, {String: "0", Valid: true}},
-			{{String: "4", Valid: true}, {String: "20", Valid: true}, {String: "90.00", Valid: true}, {String: "0", Valid: true}},
-			{{String: "3", Valid: true}, {String: "10.00", Valid: true}, {String: "0", Valid: true}, {String: "10", Valid: true}},
-		},
+	// Without diff, current values are returned ordered.
+	wantCurr := [][]sql.NullString{
+		{{String: "6", Valid: true}, {String: "560.0", Valid: true}, {String: "510.0", Valid: true}, {String: "920", Valid: true}},
+		{{String: "2", Valid: true}, {String: "440.0", Valid: true}, {String: "280.6", Valid: true}, {String: "620", Valid: true}},
+		{{String: "1", Valid: true}, {String: "330.5", Valid: true}, {String: "150.0", Valid: true}, {String: "500", Valid: true}},
+		{{String: "4", Valid: true}, {String: "220.0", Valid: true}, {String: "490.0", Valid: true}, {String: "800", Valid: true}},
+		{{String: "3", Valid: true}, {String: "110.0", Valid: true}, {String: "300.0", Valid: true}, {String: "710", Valid: true}},
 	}
 
 	// calculate delta with ASC sort
-	got, err := calculateDelta(curr, prev, 1, [2]int{1, 3}, 1, false, 0)
+	got, err := calculateDelta(curr, prev, nil, 1, [2]int{1, 3}, 1, false, 0, nil)
 	assert.NoError(t, err)
-	assert.Equal(t, wantAsc, got)
+	assert.Equal(t, wantAsc, got.values())
 
 	// calculate delta with DESC sort
-	got, err = calculateDelta(curr, prev, 1, [2]int{1, 3}, 1, true, 0)
+	got, err = calculateDelta(curr, prev, nil, 1, [2]int{1, 3}, 1, true, 0, nil)
 	assert.NoError(t, err)
-	assert.Equal(t, wantDesc, got)
+	assert.Equal(t, wantDesc, got.values())
 
 	// calculate delta with zero diff-interval, just return current value
-	got, err = calculateDelta(curr, prev, 1, [2]int{0, 0}, 1, true, 0)
+	got, err = calculateDelta(curr, prev, nil, 1, [2]int{0, 0}, 1, true, 0, nil)
 	assert.NoError(t, err)
-	assert.Equal(t, curr, got)
+	assert.Equal(t, wantCurr, got.values())
 
 	// calculate with invalid input data
-	_, err = calculateDelta(currInvalid, prev, 1, [2]int{1, 3}, 1, true, 0)
+	_, err = calculateDelta(currInvalid, prev, nil, 1, [2]int{1, 3}, 1, true, 0, nil)
 	assert.Error(t, err)
+
+	// without previous snapshot, current values are returned in original order, but they don't share memory with
+	// current snapshot which is reused by collector
+	want := curr.values()
+	got, err = calculateDelta(curr, PGresult{}, nil, 1, [2]int{1, 3}, 1, true, 0, nil)
+	assert.NoError(t, err)
+	assert.Equal(t, want, got.values())
+	assert.True(t, &got.Columns[0].Int[0] != &curr.Columns[0].Int[0])
+	assert.True(t, &got.Columns[1].Float[0] != &curr.Columns[1].Float[0])
+
+	curr.Columns[0].reset(IntColumn)
+	curr.Columns[0].appendValue("100")
+	assert.Equal(t, want, got.values())
 }
 
 func Test_diff(t *testing.T) {
-	prev := PGresult{
-		Valid: true, Ncols: 4, Nrows: 4, Cols: []string{"unique", "col2", "col3", "col4"},
-		Values: [][]sql.NullString{
+	prev := NewPGresultFromValues(
+		[]string{"unique", "col2", "col3", "col4"},
+		[][]sql.NullString{
 			{{String: "1", Valid: true}, {String: "300", Valid: true}, {String: "100", Valid: true}, {String: "500", Valid: true}},
 			{{String: "2", Valid: true}, {String: "400", Valid: true}, {String: "200", Valid: true}, {String: "600", Valid: true}},
 			{{String: "3", Valid: true}, {String: "100.0", Valid: true}, {String: "300", Valid: true}, {String: "700", Valid: true}},
@@ -219,10 +381,10 @@ func Test_diff(t *testing.T) {
 			// next row is not present in 'curr' and should be skipped.
 			{{String: "5", Valid: true}, {String: "200", Valid: true}, {String: "400.0", Valid: true}, {String: "800", Valid: true}},
 		},
-	}
-	curr := PGresult{
-		Valid: true, Ncols: 4, Nrows: 5, Cols: []string{"unique", "col2", "col3", "col4"},
-		Values: [][]sql.NullString{
+	)
+	curr := NewPGresultFromValues(
+		[]string{"unique", "col2", "col3", "col4"},
+		[][]sql.NullString{
 			{{String: "1", Valid: true}, {String: "330.5", Valid: true}, {String: "150", Valid: true}, {String: "500", Valid: true}},
 			{{String: "2", Valid: true}, {String: "440", Valid: true}, {String: "280.6", Valid: true}, {String: "620", Valid: true}},
 			{{String: "3", Valid: true}, {String: "110", Valid: true}, {String: "300", Valid: true}, {String: "710", Valid: true}},
@@ -230,21 +392,103 @@ func Test_diff(t *testing.T) {
 			// next row is not present in 'prev' and should be added as-is to 'diff' result.
 			{{String: "6", Valid: true}, {String: "560", Valid: true}, {String: "510", Valid: true}, {String: "920", Valid: true}},
 		},
+	)
+	want := [][]sql.NullString{
+		{{String: "1", Valid: true}, {String: "30.50", Valid: true}, {String: "50.00", Valid: true}, {String: "0", Valid: true}},
+		{{String: "2", Valid: true}, {String: "40.00", Valid: true}, {String: "80.60", Valid: true}, {String: "20", Valid: true}},
+		{{String: "3", Valid: true}, {String: "10.00", Valid: true}, {String: "0.00", Valid: true}, {String: "10", Valid: true}},
+		{{String: "4", Valid: true}, {String: "20.00", Valid: true}, {String: "90.00", Valid: true}, {String: "0", Valid: true}},
+		{{String: "6", Valid: true}, {String: "560.00", Valid: true}, {String: "510.00", Valid: true}, {String: "920", Valid: true}},
 	}
-	want := PGresult{
-		Valid: true, Ncols: 4, Nrows: 5, Cols: []string{"unique", "col2", "col3", "col4"},
-		Values: [][]sql.NullString{
-			{{String: "1", Valid: true}, {String: "30.50", Valid: true}, {String: "50", Valid: true}, {String: "0", Valid: true}},
-			{{String: "2", Valid: true}, {String: "40", Valid: true}, {String: "80.60", Valid: true}, {String: "20", Valid: true}},
-			{{String: "3", Valid: true}, {String: "10.00", Valid: true}, {String: "0", Valid: true}, {String: "10", Valid: true}},
-			{{String: "4", Valid: true}, {String: "20", Valid: true}, {String: "90.00", Valid: true}, {String: "0", Valid: true}},
-			{{String: "6", Valid: true}, {String: "560", Valid: true}, {String: "510", Valid: true}, {String: "920", Valid: true}},
+
+	got, err := diff(curr, prev, NewRowIndex(prev, 0), 1, [2]int{1, 3}, 0)
+	assert.NoError(t, err)
+	assert.Equal(t, want, got.values())
+
+	// index built for differently ordered snapshot must not affect the result
+	idx := NewRowIndex(prev, 0)
+	prev.sort(0, true)
+	got, err = diff(curr, prev, idx, 1, [2]int{1, 3}, 0)
+	assert.NoError(t, err)
+	assert.Equal(t, want, got.values())
+
+	// values of text columns are diffed one by one
+	currText := NewPGresultFromValues(
+		[]string{"unique", "col2"},
+		[][]sql.NullString{
+			{{String: "1", Valid: true}, {String: "330.5", Valid: true}},
+			{{String: "2", Valid: true}, {String: "440", Valid: true}},
+			{{String: "7", Valid: true}, {String: "unknown", Valid: true}},
 		},
-	}
+	)
+	got, err = diff(currText, prev, NewRowIndex(prev, 0), 1, [2]int{1, 1}, 0)
+	assert.NoError(t, err)
+	assert.Equal(t, TextColumn, got.Columns[1].Type)
+	assert.Equal(t, []string{"30.50", "40.00", "unknown"}, got.Columns[1].Text)
+}
 
-	got, err := diff(curr, prev, 1, [2]int{1, 3}, 0)
+func Test_diff_interval(t *testing.T) {
+	prev := NewPGresultFromValues(
+		[]string{"unique", "calls", "time"},
+		[][]sql.NullString{{{String: "1", Valid: true}, {String: "100", Valid: true}, {String: "10.0", Valid: true}}},
+	)
+	curr := NewPGresultFromValues(
+		[]string{"unique", "calls", "time"},
+		[][]sql.NullString{{{String: "1", Valid: true}, {String: "125", Valid: true}, {String: "12.5", Valid: true}}},
+	)
+
+	// deltas collected within a quarter of a second are reported per second
+	got, err := diff(curr, prev, NewRowIndex(prev, 0), 0.25, [2]int{1, 2}, 0)
 	assert.NoError(t, err)
-	assert.Equal(t, want, got)
+	assert.Equal(t, "100", got.Value(0, 1))
+	assert.Equal(t, "10.00", got.Value(0, 2))
+
+	// deltas collected within 2.5 seconds
+	got, err = diff(curr, prev, NewRowIndex(prev, 0), 2.5, [2]int{1, 2}, 0)
+	assert.NoError(t, err)
+	assert.Equal(t, "10", got.Value(0, 1))
+	assert.Equal(t, "1.00", got.Value(0, 2))
+}
+
+func Test_elapsed(t *testing.T) {
+	ts := time.Date(2021, 1, 23, 15, 31, 0, 0, time.UTC)
+
+	assert.Equal(t, 0.25, elapsed(ts, ts.Add(250*time.Millisecond), time.Second))
+	assert.Equal(t, 1.5, elapsed(ts, ts.Add(1500*time.Millisecond), time.Second))
+
+	// the first snapshot or clock moved backwards, expected interval is used
+	assert.Equal(t, 0.5, elapsed(time.Time{}, ts, 500*time.Millisecond))
+	assert.Equal(t, 2.0, elapsed(ts, ts.Add(-time.Second), 2*time.Second))
+	assert.Equal(t, 1.0, elapsed(time.Time{}, ts, 0))
+}
+
+func TestNewRowIndex(t *testing.T) {
+	res := NewPGresultFromValues(
+		[]string{"unique", "col2"},
+		[][]sql.NullString{
+			{{String: "1", Valid: true}, {String: "300", Valid: true}},
+			{{String: "2", Valid: true}, {String: "400", Valid: true}},
+			{{String: "3", Valid: true}, {String: "100", Valid: true}},
+			{{String: "2", Valid: true}, {String: "200", Valid: true}}, // duplicate key, should not be indexed
+		},
+	)
+
+	assert.Equal(t, &RowIndex{ints: map[int64]int{1: 0, 2: 1, 3: 2}}, NewRowIndex(res, 0))
+	assert.Equal(t, &RowIndex{ints: map[int64]int{300: 0, 400: 1, 100: 2, 200: 3}}, NewRowIndex(res, 1))
+	assert.Equal(t, &RowIndex{text: map[string]int{}}, NewRowIndex(res, 2))
+
+	// text keys and lookups of keys of other types
+	res = NewPGresultFromValues(
+		[]string{"unique"},
+		[][]sql.NullString{{{String: "alfa", Valid: true}}, {{String: "20", Valid: true}}},
+	)
+	idx := NewRowIndex(res, 0)
+	assert.Equal(t, &RowIndex{text: map[string]int{"alfa": 0, "20": 1}}, idx)
+
+	key := Column{Type: IntColumn, Int: []int64{20}}
+	j, ok := idx.Lookup(&key, 0)
+	assert.True(t, ok)
+	assert.Equal(t, 1, j)
 }
 
 func Test_sort(t *testing.T) {
@@ -312,14 +556,27 @@ func Test_sort(t *testing.T) {
 	for _, tc := range testcases {
 		t.Run(tc.name, func(t *testing.T) {
 			res.sort(tc.key, tc.desc)
-			assert.Equal(t, tc.want, res.Values)
+			assert.Equal(t, tc.want, res.values())
 		})
 	}
 
+	// test sorting of text column with numbers formatted by Postgres.
+	textRes := newPGresultFromValues(
+		[]string{"name", "avg_t"},
+		[][]sql.NullString{
+			{{String: "alfa", Valid: true}, {String: "9.5", Valid: true}},
+			{{String: "bravo", Valid: true}, {String: "10.2", Valid: true}},
+			{{String: "charlie", Valid: true}, {String: "", Valid: false}},
+		},
+		[]ColumnType{TextColumn, TextColumn},
+	)
+	textRes.sort(1, true)
+	assert.Equal(t, []string{"10.2", "9.5", ""}, textRes.Columns[1].Text)
+
 	// test sorting of empty PGresult.
-	emptyRes := PGresult{Valid: true, Ncols: 1, Nrows: 0, Cols: []string{"col1"}, Values: [][]sql.NullString{}}
+	emptyRes := NewPGresultFromValues([]string{"col1"}, [][]sql.NullString{})
 	emptyRes.sort(0, false)
-	assert.Equal(t, emptyRes.Values, [][]sql.NullString{})
+	assert.Equal(t, emptyRes.values(), [][]sql.NullString{})
 }
 
 func TestPGresult_Fprint(t *testing.T) {
@@ -334,6 +591,49 @@ func TestPGresult_Fprint(t *testing.T) {
 	}
 }
 
+func TestPGresult_JSON(t *testing.T) {
+	res := NewPGresultFromValues(
+		[]string{"name", "calls", "time"},
+		[][]sql.NullString{
+			{{String: "alfa", Valid: true}, {String: "10", Valid: true}, {String: "12.06", Valid: true}},
+			{{String: "bravo", Valid: true}, {String: "", Valid: false}, {String: "819.10", Valid: true}},
+		},
+	)
+
+	data, err := json.Marshal(res)
+	assert.NoError(t, err)
+
+	got := PGresult{}
+	assert.NoError(t, json.Unmarshal(data, &got))
+	assert.Equal(t, res, got)
+
+	// stats recorded by previous versions don't have columns types
+	legacy := `{"Values":[[{"String":"alfa","Valid":true},{"String":"10","Valid":true},{"String":"1206e-2","Valid":true}]],` +
+		`"Cols":["name","calls","time"],"Ncols":3,"Nrows":1,"Valid":true}`
+	got = PGresult{}
+	assert.NoError(t, json.Unmarshal([]byte(legacy), &got))
+	assert.Equal(t, 1, got.Nrows)
+	assert.Equal(t, []ColumnType{TextColumn, IntColumn, TextColumn}, []ColumnType{got.Columns[0].Type, got.Columns[1].Type, got.Columns[2].Type})
+	assert.Equal(t, "1206e-2", got.Value(0, 2))
+
+	assert.Error(t, json.Unmarshal([]byte("invalid"), &got))
+}
+
+func TestNewPGresultFromValues(t *testing.T) {
+	res := NewPGresultFromValues(
+		[]string{"queryid", "calls", "avg_t"},
+		[][]sql.NullString{
+			{{String: "1234567", Valid: true}, {String: "10", Valid: true}, {String: "12.06", Valid: true}},
+			{{String: "12345678e9", Valid: true}, {String: "20", Valid: true}, {String: "0.5", Valid: true}},
+		},
+	)
+
+	// Labels which look like numbers in scientific notation are kept as is.
+	assert.Equal(t, []ColumnType{TextColumn, IntColumn, FloatColumn}, []ColumnType{res.Columns[0].Type, res.Columns[1].Type, res.Columns[2].Type})
+	assert.Equal(t, []string{"1234567", "12345678e9"}, res.Columns[0].Text)
+	assert.Equal(t, "0.50", res.Value(1, 2))
+}
+
 func Test_isExtensionExists(t *testing.T) {
 	conn, err := postgres.NewTestConnect()
 	assert.NoError(t, err)
@@ -359,3 +659,43 @@ func Test_isSchemaExists(t *testing.T) {
 	conn.Close()
 	assert.False(t, isSchemaExists(conn, "public"))
 }
+
+// newBenchPGresult returns PGresult with specified number of rows similar to 'tables' stats view. Values of counters
+// are shifted by passed value, this is used for producing consecutive snapshots. Rows might be returned in reverse order.
+func newBenchPGresult(nrows int, shift int, reverse bool) PGresult {
+	cols := make([]string, 19)
+	for i := range cols {
+		cols[i] = fmt.Sprintf("col%d", i)
+	}
+
+	values := make([][]sql.NullString, nrows)
+	for i := 0; i < nrows; i++ {
+		row := make([]sql.NullString, len(cols))
+		row[0] = sql.NullString{String: fmt.Sprintf("public.relation_%d", i), Valid: true}
+		for j := 1; j < len(cols); j++ {
+			row[j] = sql.NullString{String: strconv.Itoa(i*j + shift), Valid: true}
+		}
+		if reverse {
+			values[nrows-i-1] = row
+		} else {
+			values[i] = row
+		}
+	}
+
+	return NewPGresultFromValues(cols, values)
+}
+
+func Benchmark_diff(b *testing.B) {
+	for _, n := range []int{1000, 10000, 100000} {
+		// Rows in current snapshot are reversed, rows are not guaranteed to be in the same order.
+		prev, curr := newBenchPGresult(n, 0, false), newBenchPGresult(n, 10, true)
+
+		b.Run(strconv.Itoa(n), func(b *testing.B) {
+			idx := NewRowIndex(prev, 0)
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				_, _ = diff(curr, prev, idx, 1, [2]int{1, 18}, 0)
+			}
+		})
+	}
+}
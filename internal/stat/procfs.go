@@ -0,0 +1,252 @@
+// Stuff related to reading local proc files. Proc files are kept open between reads and re-read from the beginning
+// into reused buffers, content is parsed in place without converting lines and fields into strings.
+
+package stat
+
+import (
+	"bytes"
+	"io"
+	"math"
+	"os"
+	"path/filepath"
+	"time"
+)
+
+const (
+	// procBufSize defines initial size of buffer used for reading proc file, buffer grows if file doesn't fit.
+	procBufSize = 4096
+	// linkSettingsInterval defines how often network interfaces settings are re-read.
+	linkSettingsInterval = time.Minute
+)
+
+// procFile is the proc file kept open between reads.
+type procFile struct {
+	path string
+	f    *os.File
+	buf  []byte
+}
+
+// newProcFile creates proc file with passed path, the file is opened at the first read.
+func newProcFile(path string) *procFile {
+	return &procFile{path: path}
+}
+
+// read reads whole content of the file using pread, so no seeking is required between reads. Returned data is valid
+// until the next read.
+func (p *procFile) read() ([]byte, error) {
+	if p.f == nil {
+		f, err := os.Open(filepath.Clean(p.path))
+		if err != nil {
+			return nil, err
+		}
+		p.f = f
+		p.buf = make([]byte, procBufSize)
+	}
+
+	for {
+		n, err := p.f.ReadAt(p.buf, 0)
+		if err != nil && err != io.EOF {
+			return nil, err
+		}
+		if n < len(p.buf) {
+			return p.buf[:n], nil
+		}
+
+		// Content doesn't fit into buffer, grow it and read again.
+		p.buf = make([]byte, 2*len(p.buf))
+	}
+}
+
+// close closes the file, the file is opened again at the next read.
+func (p *procFile) close() error {
+	if p.f == nil {
+		return nil
+	}
+	err := p.f.Close()
+	p.f, p.buf = nil, nil
+	return err
+}
+
+// linkSettings describes cached settings of network interface.
+type linkSettings struct {
+	speed   int64
+	duplex  int64
+	updated time.Time
+}
+
+// procReader reads local system stats. Snapshots of block devices, network interfaces and per-CPU stats are
+// double-buffered: a returned snapshot is valid until the next but one read.
+type procReader struct {
+	statFile      *procFile
+	meminfoFile   *procFile
+	loadavgFile   *procFile
+	uptimeFile    *procFile
+	diskstatsFile *procFile
+	netdevFile    *procFile
+
+	ethtool *ethtool                // channel used for reading network interfaces settings, opened at first use
+	links   map[string]linkSettings // cached network interfaces settings
+	names   map[string]string       // names of block devices, network interfaces and CPUs, reused between reads
+
+	diskstats [2]Diskstats // buffers for block devices stats, used in turn
+	netdevs   [2]Netdevs   // buffers for network interfaces stats, used in turn
+	cpustats  [2]CpuStats  // buffers for per-CPU stats, used in turn
+	ndisk     int          // number of the buffer used for the next read of block devices stats
+	nnetdev   int          // number of the buffer used for the next read of network interfaces stats
+	ncpu      int          // number of the buffer used for the next read of per-CPU stats
+}
+
+// newProcReader creates reader of proc files located in passed directory.
+func newProcReader(root string) *procReader {
+	return &procReader{
+		statFile:      newProcFile(filepath.Join(root, "stat")),
+		meminfoFile:   newProcFile(filepath.Join(root, "meminfo")),
+		loadavgFile:   newProcFile(filepath.Join(root, "loadavg")),
+		uptimeFile:    newProcFile(filepath.Join(root, "uptime")),
+		diskstatsFile: newProcFile(filepath.Join(root, "diskstats")),
+		netdevFile:    newProcFile(filepath.Join(root, "net", "dev")),
+		links:         map[string]linkSettings{},
+		names:         map[string]string{},
+	}
+}
+
+// close closes all opened files.
+func (r *procReader) close() error {
+	var err error
+	for _, f := range []*procFile{r.statFile, r.meminfoFile, r.loadavgFile, r.uptimeFile, r.diskstatsFile, r.netdevFile} {
+		if cerr := f.close(); err == nil {
+			err = cerr
+		}
+	}
+
+	if r.ethtool != nil {
+		r.ethtool.close()
+		r.ethtool = nil
+	}
+
+	return err
+}
+
+// name returns name of device, interface or CPU as a string, strings are reused between reads.
+func (r *procReader) name(b []byte) string {
+	if s, ok := r.names[string(b)]; ok {
+		return s
+	}
+	s := string(b)
+	r.names[s] = s
+	return s
+}
+
+// linkSettings returns speed and duplex of network interface. Settings are cached and re-read periodically, zeros are
+// returned if settings can't be read.
+func (r *procReader) linkSettings(ifname string, now time.Time) (int64, int64) {
+	if l, ok := r.links[ifname]; ok && now.Sub(l.updated) < linkSettingsInterval {
+		return l.speed, l.duplex
+	}
+
+	l := linkSettings{updated: now}
+	if r.ethtool == nil {
+		r.ethtool, _ = newEthtool() // ignore errors, just use zeros if any
+	}
+	if r.ethtool != nil {
+		l.speed, l.duplex, _ = r.ethtool.linkSettings(ifname)
+	}
+
+	r.links[ifname] = l
+	return l.speed, l.duplex
+}
+
+// nextLine returns the first line of data and the rest of data.
+func nextLine(data []byte) ([]byte, []byte) {
+	if i := bytes.IndexByte(data, '\n'); i >= 0 {
+		return data[:i], data[i+1:]
+	}
+	return data, nil
+}
+
+// splitFields splits line into whitespace-separated fields and stores them into passed slice. Returns total number of
+// fields in the line, which could be greater than length of the slice.
+func splitFields(line []byte, fields [][]byte) int {
+	var n int
+	for i := 0; i < len(line); {
+		for i < len(line) && isSpace(line[i]) {
+			i++
+		}
+		if i == len(line) {
+			break
+		}
+
+		start := i
+		for i < len(line) && !isSpace(line[i]) {
+			i++
+		}
+		if n < len(fields) {
+			fields[n] = line[start:i]
+		}
+		n++
+	}
+
+	return n
+}
+
+// isSpace returns true if passed character separates fields of proc file.
+func isSpace(c byte) bool {
+	return c == ' ' || c == '\t' || c == '\r'
+}
+
+// parseUint parses unsigned decimal integer.
+func parseUint(b []byte) (uint64, bool) {
+	if len(b) == 0 {
+		return 0, false
+	}
+
+	var v uint64
+	for _, c := range b {
+		if c < '0' || c > '9' {
+			return 0, false
+		}
+		d := uint64(c - '0')
+		if v > (math.MaxUint64-d)/10 {
+			return 0, false
+		}
+		v = v*10 + d
+	}
+
+	return v, true
+}
+
+// parseDecimal parses unsigned decimal number with optional fractional part, e.g. '2.43'. Result is the same as
+// returned by strconv.ParseFloat for numbers with up to 15 significant digits.
+func parseDecimal(b []byte) (float64, bool) {
+	i := bytes.IndexByte(b, '.')
+	if i < 0 {
+		v, ok := parseUint(b)
+		return float64(v), ok
+	}
+
+	// Parse digits of integer and fractional parts as a single integer and scale it.
+	v, ok := parseUint(b[:i])
+	if !ok {
+		return 0, false
+	}
+	frac := b[i+1:]
+	f, ok := parseUint(frac)
+	if !ok {
+		return 0, false
+	}
+
+	scale := math.Pow10(len(frac))
+	return (float64(v)*scale + float64(f)) / scale, true
+}
+
+// parseFloatFields parses fields as unsigned integers and stores them into passed values.
+func parseFloatFields(fields [][]byte, values ...*float64) bool {
+	for i, v := range values {
+		u, ok := parseUint(fields[i])
+		if !ok {
+			return false
+		}
+		*v = float64(u)
+	}
+	return true
+}
@@ -0,0 +1,249 @@
+package stat
+
+import (
+	"github.com/stretchr/testify/assert"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+)
+
+// newTestProcReader creates reader of local proc files where block devices and network interfaces stats are read from
+// passed file.
+func newTestProcReader(statfile string) *procReader {
+	r := newProcReader("/proc")
+	r.diskstatsFile = newProcFile(statfile)
+	r.netdevFile = newProcFile(statfile)
+	return r
+}
+
+// newGoldenProcReader creates reader of test proc files.
+func newGoldenProcReader() *procReader {
+	r := newProcReader("testdata/proc")
+	r.statFile = newProcFile("testdata/proc/stat.golden")
+	r.meminfoFile = newProcFile("testdata/proc/meminfo.golden")
+	r.loadavgFile = newProcFile("testdata/proc/loadavg.golden")
+	r.uptimeFile = newProcFile("testdata/proc/uptime.golden")
+	r.diskstatsFile = newProcFile("testdata/proc/diskstats.v3.golden")
+	r.netdevFile = newProcFile("testdata/proc/netdev.v1.golden")
+	return r
+}
+
+func Test_procFile_read(t *testing.T) {
+	dir, err := ioutil.TempDir("", "pgcenter-procfs-testing")
+	assert.NoError(t, err)
+	defer func() { _ = os.RemoveAll(dir) }()
+
+	filename := filepath.Join(dir, "stat")
+	content := strings.Repeat("0123456789\n", 1000) // larger than initial buffer
+	assert.NoError(t, ioutil.WriteFile(filename, []byte(content), 0600))
+
+	f := newProcFile(filename)
+	got, err := f.read()
+	assert.NoError(t, err)
+	assert.Equal(t, content, string(got))
+
+	// file is read from the beginning at every read
+	assert.NoError(t, ioutil.WriteFile(filename, []byte("changed\n"), 0600))
+	got, err = f.read()
+	assert.NoError(t, err)
+	assert.Equal(t, "changed\n", string(got))
+
+	// file is opened again after close
+	assert.NoError(t, f.close())
+	assert.NoError(t, f.close())
+	got, err = f.read()
+	assert.NoError(t, err)
+	assert.Equal(t, "changed\n", string(got))
+	assert.NoError(t, f.close())
+
+	_, err = newProcFile(filepath.Join(dir, "unknown")).read()
+	assert.Error(t, err)
+}
+
+func Test_splitFields(t *testing.T) {
+	var fields [3][]byte
+
+	n := splitFields([]byte("  cpu  10\t20 "), fields[:])
+	assert.Equal(t, 3, n)
+	assert.Equal(t, "cpu", string(fields[0]))
+	assert.Equal(t, "10", string(fields[1]))
+	assert.Equal(t, "20", string(fields[2]))
+
+	// fields which don't fit are counted
+	assert.Equal(t, 5, splitFields([]byte("a b c d e"), fields[:]))
+	assert.Equal(t, 0, splitFields([]byte("   "), fields[:]))
+	assert.Equal(t, 0, splitFields(nil, fields[:]))
+}
+
+func Test_parseUint(t *testing.T) {
+	testcases := []struct {
+		in    string
+		want  uint64
+		valid bool
+	}{
+		{in: "0", want: 0, valid: true},
+		{in: "1458752145", want: 1458752145, valid: true},
+		{in: "18446744073709551615", want: 18446744073709551615, valid: true},
+		{in: "18446744073709551616", valid: false},
+		{in: "", valid: false},
+		{in: "-1", valid: false},
+		{in: "12a", valid: false},
+	}
+
+	for _, tc := range testcases {
+		got, ok := parseUint([]byte(tc.in))
+		assert.Equal(t, tc.valid, ok)
+		assert.Equal(t, tc.want, got)
+	}
+}
+
+func Test_parseDecimal(t *testing.T) {
+	testcases := []struct {
+		in    string
+		want  float64
+		valid bool
+	}{
+		{in: "2.43", want: 2.43, valid: true},
+		{in: "0.1", want: 0.1, valid: true},
+		{in: "1701918.68", want: 1701918.68, valid: true},
+		{in: "15", want: 15, valid: true},
+		{in: "1.", valid: false},
+		{in: ".5", valid: false},
+		{in: "1.2.3", valid: false},
+		{in: "invalid", valid: false},
+	}
+
+	for _, tc := range testcases {
+		got, ok := parseDecimal([]byte(tc.in))
+		assert.Equal(t, tc.valid, ok)
+		if tc.valid {
+			assert.Equal(t, tc.want, got)
+		}
+	}
+}
+
+func Test_procReader_buffers(t *testing.T) {
+	r := newGoldenProcReader()
+	defer func() { _ = r.close() }()
+
+	// snapshots are read into buffers in turn
+	prev, err := readDiskstatsLocal(r, 100)
+	assert.NoError(t, err)
+	curr, err := readDiskstatsLocal(r, 100)
+	assert.NoError(t, err)
+	assert.Equal(t, prev, curr)
+	assert.True(t, &prev[0] != &curr[0])
+
+	next, err := readDiskstatsLocal(r, 100)
+	assert.NoError(t, err)
+	assert.True(t, &prev[0] == &next[0])
+
+	// names are reused
+	n1, err := readNetdevsLocal(r, 100)
+	assert.NoError(t, err)
+	n2, err := readNetdevsLocal(r, 100)
+	assert.NoError(t, err)
+	assert.Equal(t, []string{"br-1234567", "wlx1234567"}, []string{n1[0].Ifname, n1[1].Ifname})
+	assert.Equal(t, n1, n2)
+	assert.Len(t, r.names, 2+2) // block devices and network interfaces
+
+	assert.NoError(t, r.close())
+}
+
+func Test_readNetdevsLocal_noSpace(t *testing.T) {
+	dir, err := ioutil.TempDir("", "pgcenter-procfs-testing")
+	assert.NoError(t, err)
+	defer func() { _ = os.RemoveAll(dir) }()
+
+	// counters of interface could follow its name without spaces
+	filename := filepath.Join(dir, "dev")
+	content := "Inter-|   Receive\n face |bytes\n  eth0:197975757  583782 10 20 30 40 50 60 8688001214 1460628 70 80 90 100 110 120\n"
+	assert.NoError(t, ioutil.WriteFile(filename, []byte(content), 0600))
+
+	r := newTestProcReader(filename)
+	defer func() { _ = r.close() }()
+
+	got, err := readNetdevsLocal(r, 100)
+	assert.NoError(t, err)
+	assert.Len(t, got, 1)
+	assert.Equal(t, "eth0", got[0].Ifname)
+	assert.Equal(t, float64(197975757), got[0].Rbytes)
+	assert.Equal(t, float64(120), got[0].Tcompressed)
+}
+
+func Benchmark_readCpuStatLocal(b *testing.B) {
+	r := newGoldenProcReader()
+	defer func() { _ = r.close() }()
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		_, _ = readCpuStatLocal(r.statFile)
+	}
+}
+
+func Benchmark_readCpuStatsLocal(b *testing.B) {
+	r := newGoldenProcReader()
+	defer func() { _ = r.close() }()
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		_, _ = readCpuStatsLocal(r)
+	}
+}
+
+func Benchmark_readMeminfoLocal(b *testing.B) {
+	r := newGoldenProcReader()
+	defer func() { _ = r.close() }()
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		_, _ = readMeminfoLocal(r.meminfoFile)
+	}
+}
+
+func Benchmark_readLoadAverageLocal(b *testing.B) {
+	r := newGoldenProcReader()
+	defer func() { _ = r.close() }()
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		_, _ = readLoadAverageLocal(r.loadavgFile)
+	}
+}
+
+func Benchmark_readDiskstatsLocal(b *testing.B) {
+	r := newGoldenProcReader()
+	defer func() { _ = r.close() }()
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		_, _ = readDiskstatsLocal(r, 100)
+	}
+}
+
+func Benchmark_readNetdevsLocal(b *testing.B) {
+	r := newGoldenProcReader()
+	defer func() { _ = r.close() }()
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		_, _ = readNetdevsLocal(r, 100)
+	}
+}
+
+// Benchmark_procReader_refresh reads all local system stats, the same as collector does at every refresh.
+func Benchmark_procReader_refresh(b *testing.B) {
+	r := newGoldenProcReader()
+	defer func() { _ = r.close() }()
+
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		_, _ = readLoadAverageLocal(r.loadavgFile)
+		_, _ = readMeminfoLocal(r.meminfoFile)
+		_, _ = readCpuStatLocal(r.statFile)
+		_, _ = readDiskstatsLocal(r, 100)
+		_, _ = readNetdevsLocal(r, 100)
+	}
+}
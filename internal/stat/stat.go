@@ -1,14 +1,11 @@
 package stat
 
 import (
-	"bufio"
 	"bytes"
 	"fmt"
 	"github.com/lesovsky/pgcenter/internal/postgres"
 	"github.com/lesovsky/pgcenter/internal/view"
-	"io/ioutil"
 	"os/exec"
-	"path/filepath"
 	"strconv"
 	"strings"
 	"time"
@@ -26,6 +23,7 @@ const (
 	CollectDiskstats
 	CollectNetdev
 	CollectLogtail
+	CollectCpustats
 )
 
 // Stat defines all stats collected during single reading.
@@ -42,6 +40,7 @@ type System struct {
 	CpuStat
 	Diskstats
 	Netdevs
+	CpuStats
 }
 
 // Collector defines container for stats objects.
@@ -56,9 +55,19 @@ type Collector struct {
 	// network interfaces snapshots for previous and current intervals
 	prevNetdevs Netdevs
 	currNetdevs Netdevs
+	// per-CPU usage snapshots for previous and current intervals
+	prevCpuStats CpuStats
+	currCpuStats CpuStats
 	// postgres stats snapshots for previous and current intervals
 	prevPgStat Pgstat
 	currPgStat Pgstat
+	// indexes of rows of postgres stats snapshots, kept between updates and used for diffs
+	prevIndex *RowIndex
+	currIndex *RowIndex
+	// reader of local proc files, files are kept open between updates
+	proc *procReader
+	// reader of local proc files of Postgres backends, joined with activity stats
+	backends *backendReader
 }
 
 // Config defines collector's runtime configuration.
@@ -89,13 +98,29 @@ func NewCollector(db *postgres.DB) (*Collector, error) {
 			ticks:              systicks,
 			PostgresProperties: props,
 		},
+		proc:     newProcReader("/proc"),
+		backends: newBackendReader("/proc", systicks),
 	}, nil
 }
 
-// Reset clears stats snapshots.
+// Close closes files opened by collector.
+func (c *Collector) Close() error {
+	err := c.proc.close()
+	if cerr := c.backends.close(); err == nil {
+		err = cerr
+	}
+	return err
+}
+
+// Reset clears stats snapshots. Snapshots are invalidated, but their memory is kept for reusing.
 func (c *Collector) Reset() {
-	c.prevPgStat = Pgstat{}
-	c.currPgStat = Pgstat{}
+	c.prevPgStat = Pgstat{Result: c.prevPgStat.Result}
+	c.prevPgStat.Result.Valid = false
+	c.currPgStat = Pgstat{Result: c.currPgStat.Result}
+	c.currPgStat.Result.Valid = false
+	c.prevIndex = nil
+	c.currIndex = nil
+	c.backends.reset()
 }
 
 // Update implements stats collecting.
@@ -103,7 +128,7 @@ func (c *Collector) Update(db *postgres.DB, view view.View, refresh time.Duratio
 	var s Stat
 
 	// Collect load average stats.
-	loadavg, err := readLoadAverage(db, c.config.SchemaPgcenterAvail)
+	loadavg, err := readLoadAverage(db, c.proc, c.config.SchemaPgcenterAvail)
 	if err != nil {
 		return s, err
 	}
@@ -111,7 +136,7 @@ func (c *Collector) Update(db *postgres.DB, view view.View, refresh time.Duratio
 	s.LoadAvg = loadavg
 
 	// Collect memory/swap usage stats.
-	meminfo, err := readMeminfo(db, c.config.SchemaPgcenterAvail)
+	meminfo, err := readMeminfo(db, c.proc, c.config.SchemaPgcenterAvail)
 	if err != nil {
 		return s, err
 	}
@@ -119,7 +144,7 @@ func (c *Collector) Update(db *postgres.DB, view view.View, refresh time.Duratio
 	s.Meminfo = meminfo
 
 	// Collect CPU usage stats
-	cpustat, err := readCpuStat(db, c.config.SchemaPgcenterAvail)
+	cpustat, err := readCpuStat(db, c.proc, c.config.SchemaPgcenterAvail)
 	if err != nil {
 		return s, err
 	}
@@ -131,6 +156,7 @@ func (c *Collector) Update(db *postgres.DB, view view.View, refresh time.Duratio
 	// Collect extra stats if required.
 	var diskstats Diskstats
 	var netdevs Netdevs
+	var cpustats CpuStats
 
 	switch c.config.collectExtra {
 	case CollectDiskstats:
@@ -145,22 +171,28 @@ func (c *Collector) Update(db *postgres.DB, view view.View, refresh time.Duratio
 			return s, err
 		}
 		s.Netdevs = netdevs
+	case CollectCpustats:
+		cpustats, err = c.collectCpuStats(db)
+		if err != nil {
+			return s, err
+		}
+		s.CpuStats = cpustats
 	}
 
-	// Take refresh interval from view
-	itv := int(refresh / time.Second)
-
-	err = db.PQstatus()
-	if err != nil {
+	// Collect Postgres stats. Liveness of the connection is not probed separately, instead connection is
+	// re-established when collecting fails due to broken connection. Previous and current snapshots are
+	// double-buffered: new snapshot is read into memory of the previous one, which is not needed anymore.
+	// Rates are calculated using time elapsed since the current snapshot, measured by Postgres server clock.
+	pgstat, err := collectPostgresStat(db, c.config.VersionNum, c.config.ExtPGSSAvail, refresh, view.Query, c.currPgStat, c.prevPgStat.Result)
+	if err != nil && db.IsClosed() {
 		err = postgres.Reconnect(db)
 		if err != nil {
 			s.Pgstat.Activity.State = "down"
 			return s, err
 		}
-	}
 
-	// Collect Postgres stats.
-	pgstat, err := collectPostgresStat(db, c.config.VersionNum, c.config.ExtPGSSAvail, itv, view.Query, c.prevPgStat)
+		pgstat, err = collectPostgresStat(db, c.config.VersionNum, c.config.ExtPGSSAvail, refresh, view.Query, c.currPgStat, c.prevPgStat.Result)
+	}
 	if err != nil {
 		s.Pgstat.Activity = pgstat.Activity
 		return s, err
@@ -171,8 +203,28 @@ func (c *Collector) Update(db *postgres.DB, view view.View, refresh time.Duratio
 	c.prevPgStat = c.currPgStat
 	c.currPgStat = pgstat
 
+	// Index of current snapshot is built only when diff is required. Index of current snapshot is reused in the
+	// next update.
+	c.prevIndex = c.currIndex
+	c.currIndex = nil
+	if view.DiffIntvl != [2]int{0, 0} {
+		c.currIndex = NewRowIndex(c.currPgStat.Result, view.UniqueKey)
+	}
+
+	// Resources usage of local backends is joined with activity stats, hence it could be sorted and filtered as well.
+	curr := c.currPgStat.Result
+	if db.Local && view.Name == "activity" {
+		curr = c.backends.join(curr, time.Now())
+	}
+
+	// Compile filters of the view against columns of current snapshot.
+	filter, err := newViewFilter(view, curr.Cols)
+	if err != nil {
+		return s, err
+	}
+
 	// Compare previous and current Postgres stats snapshots and calculate delta.
-	diff, err := calculateDelta(c.currPgStat.Result, c.prevPgStat.Result, itv, view.DiffIntvl, view.OrderKey, view.OrderDesc, view.UniqueKey)
+	diff, err := calculateDelta(curr, c.prevPgStat.Result, c.prevIndex, c.currPgStat.Elapsed, view.DiffIntvl, view.OrderKey, view.OrderDesc, view.UniqueKey, filter)
 	if err != nil {
 		return s, err
 	}
@@ -189,7 +241,7 @@ func (c *Collector) ToggleCollectExtra(e int) {
 
 // collectDiskstats implements collecting of disk devices stats.
 func (c *Collector) collectDiskstats(db *postgres.DB) (Diskstats, error) {
-	stats, err := readDiskstats(db, c.config)
+	stats, err := readDiskstats(db, c.proc, c.config)
 	if err != nil {
 		return nil, err
 	}
@@ -209,7 +261,7 @@ func (c *Collector) collectDiskstats(db *postgres.DB) (Diskstats, error) {
 
 // collectNetdevs implements collecting network interfaces stats.
 func (c *Collector) collectNetdevs(db *postgres.DB) (Netdevs, error) {
-	stats, err := readNetdevs(db, c.config)
+	stats, err := readNetdevs(db, c.proc, c.config)
 	if err != nil {
 		return nil, err
 	}
@@ -227,26 +279,54 @@ func (c *Collector) collectNetdevs(db *postgres.DB) (Netdevs, error) {
 	return usage, nil
 }
 
-// readUptimeLocal returns uptime value from passed specified procfile.
-func readUptimeLocal(procfile string, ticks float64) (float64, error) {
-	var sec, csec int64
-
-	content, err := ioutil.ReadFile(filepath.Clean(procfile))
+// collectCpuStats implements collecting per-CPU stats.
+func (c *Collector) collectCpuStats(db *postgres.DB) (CpuStats, error) {
+	stats, err := readCpuStats(db, c.proc, c.config)
 	if err != nil {
-		return 0, err
+		return nil, err
 	}
 
-	reader := bufio.NewReader(bytes.NewBuffer(content))
+	c.prevCpuStats = c.currCpuStats
+	c.currCpuStats = stats
 
-	line, _, err := reader.ReadLine()
-	if err != nil {
-		return 0, err
+	// If number of CPUs changed just replace previous snapshot with current one and continue.
+	if len(c.prevCpuStats) != len(c.currCpuStats) {
+		c.prevCpuStats = c.currCpuStats
 	}
-	_, err = fmt.Sscanf(string(line), "%d.%d", &sec, &csec)
+
+	usage := countCpuStatsUsage(c.prevCpuStats, c.currCpuStats, c.config.ticks)
+
+	return usage, nil
+}
+
+// readUptimeLocal returns uptime value from passed proc file.
+func readUptimeLocal(f *procFile, ticks float64) (float64, error) {
+	data, err := f.read()
 	if err != nil {
 		return 0, err
 	}
 
+	// Uptime is in format 'seconds.centiseconds'.
+	line, _ := nextLine(data)
+	var fields [1][]byte
+	if splitFields(line, fields[:]) == 0 {
+		return 0, fmt.Errorf("%s bad content: no uptime value", f.path)
+	}
+
+	i := bytes.IndexByte(fields[0], '.')
+	if i < 0 {
+		return 0, fmt.Errorf("%s bad content: invalid uptime value '%s'", f.path, fields[0])
+	}
+
+	sec, ok := parseUint(fields[0][:i])
+	if !ok {
+		return 0, fmt.Errorf("%s bad content: invalid uptime value '%s'", f.path, fields[0])
+	}
+	csec, ok := parseUint(fields[0][i+1:])
+	if !ok {
+		return 0, fmt.Errorf("%s bad content: invalid uptime value '%s'", f.path, fields[0])
+	}
+
 	return (float64(sec) * ticks) + (float64(csec) * ticks / 100), nil
 }
 
@@ -64,7 +64,7 @@ func TestCollector_Update(t *testing.T) {
 	assert.NotEqual(t, 0, len(stat.System.Diskstats))
 	assert.NotEqual(t, float64(0), stat.Pgstat.Activity.ConnTotal)
 	assert.True(t, stat.Pgstat.Result.Valid)
-	assert.NotEqual(t, 0, len(stat.Pgstat.Result.Values))
+	assert.NotEqual(t, 0, stat.Pgstat.Result.Nrows)
 	assert.NotEqual(t, 0, len(stat.Pgstat.Result.Cols))
 }
 
@@ -103,11 +103,11 @@ func Test_readUptimeLocal(t *testing.T) {
 	assert.NoError(t, err)
 	assert.NotEqual(t, float64(0), ticks)
 
-	got, err := readUptimeLocal("testdata/proc/uptime.golden", ticks)
+	got, err := readUptimeLocal(newProcFile("testdata/proc/uptime.golden"), ticks)
 	assert.NoError(t, err)
 	assert.Equal(t, float64(170191868), got)
 
-	_, err = readUptimeLocal("testdata/proc/stat.golden", ticks)
+	_, err = readUptimeLocal(newProcFile("testdata/proc/stat.golden"), ticks)
 	assert.Error(t, err)
 }
 
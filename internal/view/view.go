@@ -97,6 +97,17 @@ func New() Views {
 			Msg:       "Show tables sizes statistics",
 			Filters:   map[int]*regexp.Regexp{},
 		},
+		"cpustat": {
+			Name:      "cpustat",
+			QueryTmpl: query.PgcenterCpuStatDefault,
+			DiffIntvl: [2]int{1, 8},
+			Ncols:     9,
+			OrderKey:  8,
+			OrderDesc: true,
+			ColsWidth: map[int]int{},
+			Msg:       "Show per-CPU statistics",
+			Filters:   map[int]*regexp.Regexp{},
+		},
 		"functions": {
 			Name:      "functions",
 			QueryTmpl: query.PgStatFunctionsDefault,
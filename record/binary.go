@@ -0,0 +1,104 @@
+package record
+
+import (
+	"github.com/lesovsky/pgcenter/internal/index"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"os"
+	"sort"
+	"time"
+)
+
+// defaultKeyframe defines default number of writes after which a new segment of binary file is started.
+const defaultKeyframe = 60
+
+// binaryRecorder implement recorder interface.
+// This implementation collects Postgres stats and stores it in binary snapshot format. Like tar archive, binary file is
+// kept open and written continuously, torn tail is truncated when file is opened for appending.
+// Each segment of the file starts with complete snapshots (keyframes), when delta encoding is enabled the following
+// snapshots of the segment are stored as differences with the previous ones.
+type binaryRecorder struct {
+	viewsCollector
+	recordFile
+	config recorderConfig
+	writer *snapshot.Writer
+	writes int // number of writes made in the current segment
+}
+
+// newBinaryRecorder creates new recorder.
+func newBinaryRecorder(c recorderConfig) recorder {
+	if c.keyframe <= 0 {
+		c.keyframe = defaultKeyframe
+	}
+
+	return &binaryRecorder{
+		config: c,
+	}
+}
+
+// open method opens binary file. Existing file is truncated or, when appending is requested, its tail after the last
+// complete frame is truncated.
+func (c *binaryRecorder) open() error {
+	f, err := openRecordFile(c.config, func(f *os.File) (int64, error) { return snapshot.Recover(f) })
+	if err != nil {
+		return err
+	}
+
+	c.recordFile = f
+
+	// New file starts with magic header.
+	if c.pos == 0 {
+		_, err = c.recordFile.Write([]byte(snapshot.Magic))
+		if err != nil {
+			_ = c.recordFile.close()
+			return err
+		}
+	}
+
+	// Appended data starts with new segment, it doesn't depend on previously written segments.
+	c.writer = snapshot.NewWriter(&c.recordFile)
+	c.writer.EnableDelta(c.config.uniqueKeys)
+	c.writes = 0
+
+	return nil
+}
+
+// write accepts stats data and writes it into binary file. Written data is buffered and synced to disk accordingly to
+// configured sync interval. Stats are recorded with time of Postgres server when they have been collected.
+func (c *binaryRecorder) write(stats map[string]stat.PGresult) error {
+	// Reading of the file could be started at the beginning of any segment, position of the segment is stored in the
+	// time index.
+	segment := int64(-1)
+	if c.writes == 0 || c.writes == c.config.keyframe {
+		segment = c.pos
+		err := c.writer.StartSegment()
+		if err != nil {
+			return err
+		}
+		c.writes = 0
+	}
+	c.writes++
+
+	names := make([]string, 0, len(stats))
+	for name := range stats {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+
+	now := c.timestamp()
+	for _, name := range names {
+		err := c.writer.Write(name, now, stats[name])
+		if err != nil {
+			return err
+		}
+
+		if segment >= 0 {
+			err = c.index.Add(index.Entry{Ts: now, Name: name, Offset: segment})
+			if err != nil {
+				return err
+			}
+		}
+	}
+
+	return c.syncPeriodically(time.Now())
+}
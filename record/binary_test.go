@@ -0,0 +1,116 @@
+package record
+
+import (
+	"database/sql"
+	"github.com/lesovsky/pgcenter/internal/index"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+)
+
+func Test_binaryRecorder_write(t *testing.T) {
+	stats := map[string]stat.PGresult{
+		"pgcenter_record_testing": stat.NewPGresultFromValues(
+			[]string{"col1", "col2"},
+			[][]sql.NullString{
+				{{String: "alfa", Valid: true}, {String: "12.06157", Valid: true}},
+				{{String: "bravo", Valid: true}, {String: "819.188", Valid: true}},
+			},
+		),
+	}
+
+	filename := "/tmp/pgcenter-record-testing.stat.bin"
+
+	readAll := func() []stat.PGresult {
+		f, err := os.Open(filepath.Clean(filename))
+		assert.NoError(t, err)
+		defer func() { _ = f.Close() }()
+
+		r, err := snapshot.NewReader(f)
+		assert.NoError(t, err)
+
+		var res []stat.PGresult
+		for {
+			name, _, err := r.Next()
+			if err == io.EOF {
+				break
+			}
+			assert.NoError(t, err)
+			assert.Equal(t, "pgcenter_record_testing", name)
+
+			var got stat.PGresult
+			assert.NoError(t, r.Read(&got))
+			res = append(res, got)
+		}
+		return res
+	}
+
+	// Write testdata, more than a segment.
+	tc := newBinaryRecorder(recorderConfig{filename: filename, append: false})
+	assert.NoError(t, tc.open())
+	for i := 0; i < defaultKeyframe+1; i++ {
+		assert.NoError(t, tc.write(stats))
+	}
+	assert.NoError(t, tc.close())
+
+	got := readAll()
+	assert.Equal(t, defaultKeyframe+1, len(got))
+	for _, res := range got {
+		assert.Equal(t, stats["pgcenter_record_testing"].Cols, res.Cols)
+		assert.Equal(t, "bravo", res.Value(1, 0))
+		assert.Equal(t, "819.18800", res.Value(1, 1))
+	}
+
+	// Index refers to the beginning of the second segment, stats recorded before are at the beginning of the file.
+	st, err := os.Stat(filename)
+	assert.NoError(t, err)
+	offset, err := index.Lookup(index.Filename(filename), "pgcenter_record_testing", time.Now(), st.Size())
+	assert.NoError(t, err)
+	assert.Greater(t, offset, int64(len(snapshot.Magic)))
+	offset, err = index.Lookup(index.Filename(filename), "pgcenter_record_testing", time.Time{}, st.Size())
+	assert.NoError(t, err)
+	assert.Equal(t, int64(0), offset)
+
+	// Append to existing file with torn tail.
+	st, err = os.Stat(filename)
+	assert.NoError(t, err)
+	assert.NoError(t, os.Truncate(filename, st.Size()-5))
+
+	tc = newBinaryRecorder(recorderConfig{filename: filename, append: true})
+	assert.NoError(t, tc.open())
+	assert.NoError(t, tc.write(stats))
+	assert.NoError(t, tc.close())
+	assert.Equal(t, defaultKeyframe+1, len(readAll()))
+
+	// Write testdata using delta encoding with short keyframe interval.
+	tc = newBinaryRecorder(recorderConfig{
+		filename: filename, append: false, keyframe: 3, uniqueKeys: map[string]int{"pgcenter_record_testing": 0},
+	})
+	assert.NoError(t, tc.open())
+	for i := 0; i < 10; i++ {
+		assert.NoError(t, tc.write(stats))
+	}
+	assert.NoError(t, tc.close())
+
+	got = readAll()
+	assert.Equal(t, 10, len(got))
+	for _, res := range got {
+		assert.Equal(t, "bravo", res.Value(1, 0))
+		assert.Equal(t, "819.18800", res.Value(1, 1))
+	}
+
+	// Appending to file in other format is not allowed.
+	assert.NoError(t, ioutil.WriteFile(filename, []byte("invalid"), 0600))
+	tc = newBinaryRecorder(recorderConfig{filename: filename, append: true})
+	assert.Error(t, tc.open())
+
+	// Cleanup.
+	assert.NoError(t, os.Remove(filename))
+	assert.NoError(t, os.Remove(index.Filename(filename)))
+}
@@ -15,13 +15,23 @@ import (
 
 // Config defines config container for configuring 'pgcenter record'.
 type Config struct {
-	Interval    time.Duration // Statistics recording interval
-	Count       int           // Number of statistics snapshot to record
-	OutputFile  string        // File where statistics will be saved
-	AppendFile  bool          // Append data to file
-	StringLimit int           // Limit of the length, to which query should be trimmed
+	Interval     time.Duration // Statistics recording interval
+	Count        int           // Number of statistics snapshot to record
+	OutputFile   string        // File where statistics will be saved
+	AppendFile   bool          // Append data to file
+	StringLimit  int           // Limit of the length, to which query should be trimmed
+	SyncInterval time.Duration // How often recorded statistics are synced to disk
+	Format       string        // Format of the file: tar archive with JSON files or binary
+	Delta        bool          // Store counters as differences between consecutive snapshots (binary format only)
+	Keyframe     int           // Number of snapshots between complete snapshots (binary format only)
 }
 
+// Formats of files with recorded statistics.
+const (
+	FormatTar    = "tar"
+	FormatBinary = "binary"
+)
+
 // RunMain is the 'pgcenter record' main entry point.
 func RunMain(dbConfig postgres.Config, config Config) error {
 	app := newApp(config, dbConfig)
@@ -45,6 +55,7 @@ func RunMain(dbConfig postgres.Config, config Config) error {
 type app struct {
 	config   Config
 	dbConfig postgres.Config
+	db       *postgres.DB // connection kept open during recording
 	views    view.Views
 	recorder recorder
 }
@@ -57,16 +68,49 @@ func newApp(config Config, dbConfig postgres.Config) *app {
 	}
 }
 
-// setup configures necessary queries depending on Postgres version.
+// setup connects to Postgres and configures necessary queries depending on Postgres version. Connection is kept open
+// and used for recording.
 func (app *app) setup() error {
+	// Create recorder depending on requested format.
+	rc := recorderConfig{
+		filename:     app.config.OutputFile,
+		append:       app.config.AppendFile,
+		syncInterval: app.config.SyncInterval,
+		keyframe:     app.config.Keyframe,
+	}
+
+	// Unique keys of views are used for matching rows of consecutive snapshots.
+	if app.config.Delta {
+		rc.uniqueKeys = map[string]int{}
+		for name, v := range view.New() {
+			rc.uniqueKeys[name] = v.UniqueKey
+		}
+	}
+
+	switch app.config.Format {
+	case FormatTar, "":
+		if app.config.Delta {
+			return fmt.Errorf("delta encoding is supported only by binary format")
+		}
+		// Names of files in tar archive have timestamps with one second resolution.
+		if app.config.Interval > 0 && app.config.Interval < time.Second && app.config.Count != 1 {
+			return fmt.Errorf("sub-second recording interval is supported only by binary format")
+		}
+		app.recorder = newTarRecorder(rc)
+	case FormatBinary:
+		app.recorder = newBinaryRecorder(rc)
+	default:
+		return fmt.Errorf("unknown format '%s'", app.config.Format)
+	}
+
 	db, err := postgres.Connect(app.dbConfig)
 	if err != nil {
 		return err
 	}
-	defer db.Close()
 
 	props, err := stat.GetPostgresProperties(db)
 	if err != nil {
+		db.Close()
 		return err
 	}
 
@@ -76,28 +120,50 @@ func (app *app) setup() error {
 	views := view.New()
 	err = views.Configure(opts)
 	if err != nil {
+		db.Close()
 		return err
 	}
 
-	app.views = views
+	// Per-CPU stats are read through pgcenter schema, skip them if schema is not installed.
+	if !props.SchemaPgcenterAvail {
+		delete(views, "cpustat")
+	}
 
-	// Create tar recorder.
-	app.recorder = newTarRecorder(tarConfig{
-		filename: app.config.OutputFile,
-		append:   app.config.AppendFile,
-	})
+	app.db = db
+	app.views = views
 
 	return nil
 }
 
-// record collects statistics and stores into file.
+// record collects statistics and stores into file. File is kept open during the whole recording.
 func (app *app) record(doQuit chan os.Signal) error {
+	defer app.db.Close()
+
+	err := app.recorder.open()
+	if err != nil {
+		return err
+	}
+
+	err = app.recordLoop(doQuit)
+
+	// Close file regardless of recording errors, to sync already collected stats.
+	cerr := app.recorder.close()
+	if err != nil {
+		return err
+	}
+
+	return cerr
+}
+
+// recordLoop collects statistics with configured interval and writes it into opened recorder.
+func (app *app) recordLoop(doQuit chan os.Signal) error {
 	var (
 		count    = app.config.Count
 		interval = app.config.Interval
 	)
 
 	t := time.NewTicker(interval)
+	defer t.Stop()
 
 	// record the number of snapshots requested by user (or record continuously until SIGINT will be received)
 	var n int
@@ -108,12 +174,7 @@ func (app *app) record(doQuit chan os.Signal) error {
 			n++
 		}
 
-		err := app.recorder.open()
-		if err != nil {
-			return err
-		}
-
-		stats, err := app.recorder.collect(app.dbConfig, app.views)
+		stats, err := app.recorder.collect(app.db, app.views)
 		if err != nil {
 			return err
 		}
@@ -123,16 +184,10 @@ func (app *app) record(doQuit chan os.Signal) error {
 			return err
 		}
 
-		err = app.recorder.close()
-		if err != nil {
-			return err
-		}
-
 		select {
 		case <-t.C:
 			continue
 		case sig := <-doQuit:
-			t.Stop()
 			return fmt.Errorf("got %s", sig.String())
 		}
 	}
@@ -2,6 +2,7 @@ package record
 
 import (
 	"archive/tar"
+	"github.com/lesovsky/pgcenter/internal/index"
 	"github.com/lesovsky/pgcenter/internal/postgres"
 	"github.com/lesovsky/pgcenter/internal/view"
 	"github.com/stretchr/testify/assert"
@@ -27,6 +28,12 @@ func Test_app_setup(t *testing.T) {
 		assert.NotEqual(t, "", v.Query) // view's queries must not be empty (must be created using templates)
 	}
 	assert.NotNil(t, app.recorder)
+	assert.NotNil(t, app.db)
+	app.db.Close()
+
+	// unknown format
+	app = newApp(Config{OutputFile: "/tmp/pgcenter-record-testing.stat.tar", Format: "invalid"}, dbconfig)
+	assert.Error(t, app.setup())
 }
 
 func Test_app_record(t *testing.T) {
@@ -93,4 +100,5 @@ func Test_app_record(t *testing.T) {
 		})
 	}
 	assert.NoError(t, os.Remove(filename))
+	assert.NoError(t, os.Remove(index.Filename(filename)))
 }
@@ -2,124 +2,208 @@ package record
 
 import (
 	"archive/tar"
+	"bufio"
 	"encoding/json"
 	"fmt"
+	"github.com/lesovsky/pgcenter/internal/index"
 	"github.com/lesovsky/pgcenter/internal/postgres"
 	"github.com/lesovsky/pgcenter/internal/stat"
 	"github.com/lesovsky/pgcenter/internal/view"
 	"io"
+	"io/ioutil"
 	"os"
 	"path/filepath"
+	"sort"
 	"time"
 )
 
 // recorder defines a way of how to record and store collected stats.
 type recorder interface {
 	open() error
-	collect(dbConfig postgres.Config, views view.Views) (map[string]stat.PGresult, error)
+	collect(db *postgres.DB, views view.Views) (map[string]stat.PGresult, error)
 	write(map[string]stat.PGresult) error
 	close() error
 }
 
-// tarConfig defines configuration needed for creating tar recorder.
-type tarConfig struct {
-	filename string
-	append   bool
+// recorderConfig defines configuration needed for creating recorders.
+type recorderConfig struct {
+	filename     string
+	append       bool
+	syncInterval time.Duration  // how often written stats are flushed and synced to disk, zero means after every write
+	keyframe     int            // number of writes between complete snapshots, used by binary recorder
+	uniqueKeys   map[string]int // unique keys of views for delta encoding, used by binary recorder
 }
 
+// tarBlockSize defines size of tar blocks, headers and data of archived files are padded to the block size.
+const tarBlockSize = 512
+
 // tarRecorder implement recorder interface.
-// This implementation collects Postgres stats and stores it in .json files packed into .tar archive.
+// This implementation collects Postgres stats and stores it in .json files packed into .tar archive. Archive is kept
+// open and written continuously, but tar trailer is written only at close. When recording is interrupted, the archive
+// remains readable up to the last completely written file, torn tail is truncated when archive is opened for appending.
 type tarRecorder struct {
-	config    tarConfig
-	file      *os.File
-	fileFlags int
-	writer    *tar.Writer
+	viewsCollector
+	recordFile
+	config recorderConfig
+	writer *tar.Writer
 }
 
 // newTarRecorder creates new recorder.
-func newTarRecorder(c tarConfig) recorder {
-	var flags int
-	if c.append {
-		flags = os.O_CREATE | os.O_RDWR
-	} else {
-		flags = os.O_CREATE | os.O_RDWR | os.O_TRUNC
-	}
-
+func newTarRecorder(c recorderConfig) recorder {
 	return &tarRecorder{
-		config:    c,
-		fileFlags: flags,
+		config: c,
 	}
 }
 
-// open method opens tar archive.
+// open method opens tar archive. Existing archive is truncated or, when appending is requested, its tail after the
+// last completely written file is truncated, including tar trailer.
 func (c *tarRecorder) open() error {
-	f, err := os.OpenFile(filepath.Clean(c.config.filename), c.fileFlags, 0600)
+	f, err := openRecordFile(c.config, recoverTar)
 	if err != nil {
 		return err
 	}
 
-	// Determine seek offset.
-	// If truncate is not requested check the file size. For empty files set
-	// offset to 0 - start writing from beginning. For non-empty files set
-	// offset to -1024 - start writing from last kB, to avoid overwrite tar metadata.
-	if (c.fileFlags & os.O_TRUNC) == 0 {
-		var offset int64
+	c.recordFile = f
+	c.writer = tar.NewWriter(&c.recordFile)
+
+	return nil
+}
+
+// recoverTar scans tar archive from the beginning and returns offset of the end of the last completely written file. Scanning stops at
+// tar trailer or at the first incomplete or damaged file. Error is returned if the file is not empty but contains no complete files, e.g.
+// it is not a tar archive or it is damaged at the beginning, otherwise the whole file would be truncated.
+func recoverTar(f *os.File) (int64, error) {
+	st, err := f.Stat()
+	if err != nil {
+		return 0, err
+	}
+
+	_, err = f.Seek(0, io.SeekStart)
+	if err != nil {
+		return 0, err
+	}
+
+	cr := &countingReader{r: bufio.NewReader(f)}
+	tr := tar.NewReader(cr)
 
-		st, err := f.Stat()
+	var offset int64
+	for {
+		hdr, err := tr.Next()
 		if err != nil {
-			return err
+			// Empty archive which consists of trailer only is valid.
+			if offset == 0 && err != io.EOF {
+				return 0, fmt.Errorf("%s is not a tar archive or damaged at the beginning", f.Name())
+			}
+			break
 		}
 
-		if st.Size() > 0 {
-			offset = -1024
+		// Data of the file is padded to the block size, the padding must be written too.
+		n, err := io.Copy(ioutil.Discard, tr)
+		end := cr.n + (-hdr.Size & (tarBlockSize - 1))
+		if err != nil || n != hdr.Size || end > st.Size() {
+			if offset == 0 {
+				return 0, fmt.Errorf("%s is damaged at the beginning, the first file is incomplete", f.Name())
+			}
+			break
 		}
 
-		_, err = f.Seek(offset, io.SeekEnd)
-		if err != nil {
-			return err
-		}
-	} else {
-		// If truncate was requested, disable O_TRUNC ans use just O_RDWR to
-		// avoid further archive truncation.
-		c.fileFlags = os.O_RDWR
+		offset = end
 	}
 
-	c.file = f
-	c.writer = tar.NewWriter(c.file)
+	return offset, nil
+}
 
-	return nil
+// countingReader counts bytes read from underlying reader.
+type countingReader struct {
+	r io.Reader
+	n int64
 }
 
-// collect connects to Postgres, collects and returns stats data.
-func (c *tarRecorder) collect(dbConfig postgres.Config, views view.Views) (map[string]stat.PGresult, error) {
-	db, err := postgres.Connect(dbConfig)
-	if err != nil {
-		return nil, err
+func (r *countingReader) Read(p []byte) (int, error) {
+	n, err := r.r.Read(p)
+	r.n += int64(n)
+	return n, err
+}
+
+// viewsCollector collects stats of views, memory of collected stats is reused in next collects.
+type viewsCollector struct {
+	stats map[string]stat.PGresult
+	ts    time.Time // time of Postgres server when stats have been collected
+}
+
+// timestamp returns time when the last stats have been collected, local time is used if stats have not been collected.
+// Time of Postgres server is converted to local time zone, because timestamps in names of recorded files are parsed
+// in local time zone when reports are built.
+func (c *viewsCollector) timestamp() time.Time {
+	if c.ts.IsZero() {
+		return time.Now()
+	}
+	return c.ts.Local()
+}
+
+// collect collects and returns stats data. Queries of all views are sent to Postgres in a single batch. Connection
+// is re-established when collecting fails due to broken connection.
+func (c *viewsCollector) collect(db *postgres.DB, views view.Views) (map[string]stat.PGresult, error) {
+	if c.stats == nil {
+		c.stats = map[string]stat.PGresult{}
 	}
 
-	stats := map[string]stat.PGresult{}
+	names := make([]string, 0, len(views))
+	for k := range views {
+		names = append(names, k)
+	}
+	sort.Strings(names)
 
-	for k, v := range views {
-		res, err := stat.NewPGresult(db, v.Query)
+	queries := make([]string, len(names))
+	res := make([]stat.PGresult, len(names))
+	for i, k := range names {
+		queries[i] = views[k].Query
+		res[i] = c.stats[k]
+	}
+
+	ts, err := stat.ReadPGresults(db, queries, res)
+	if err != nil && db.IsClosed() {
+		err = postgres.Reconnect(db)
 		if err != nil {
 			return nil, err
 		}
 
-		stats[k] = res
+		ts, err = stat.ReadPGresults(db, queries, res)
 	}
+	if err != nil {
+		return nil, err
+	}
+
+	c.ts = ts
 
-	return stats, nil
+	for i, k := range names {
+		c.stats[k] = res[i]
+	}
+
+	return c.stats, nil
 }
 
-// write accepts stats data and writes it into tar archive.
+// write accepts stats data and writes it into tar archive. Written data is buffered and synced to disk accordingly
+// to configured sync interval. Stats are recorded with time of Postgres server when they have been collected.
 func (c *tarRecorder) write(stats map[string]stat.PGresult) error {
+	now := c.timestamp()
 	for name, v := range stats {
 		data, err := json.Marshal(v)
 		if err != nil {
 			return err
 		}
 
-		now := time.Now()
+		// Pad previously written file to the block size, so the file header is written at the current position.
+		err = c.writer.Flush()
+		if err != nil {
+			return err
+		}
+
+		err = c.index.Add(index.Entry{Ts: now, Name: name, Offset: c.pos})
+		if err != nil {
+			return err
+		}
+
 		filename := fmt.Sprintf("%s.%s.json", name, now.Format("20060102T150405"))
 		hdr := &tar.Header{Name: filename, Mode: 0644, Size: int64(len(data)), ModTime: now}
 		err = c.writer.WriteHeader(hdr)
@@ -132,10 +216,17 @@ func (c *tarRecorder) write(stats map[string]stat.PGresult) error {
 			return err
 		}
 	}
-	return nil
+
+	// Pad the last written file to the block size, so the buffer contains only complete files.
+	err := c.writer.Flush()
+	if err != nil {
+		return err
+	}
+
+	return c.syncPeriodically(time.Now())
 }
 
-// close closes recorder's file and tar writer descriptors.
+// close writes tar trailer, syncs written data and closes recorder's file.
 func (c *tarRecorder) close() error {
 	if c.writer != nil {
 		err := c.writer.Close()
@@ -144,5 +235,117 @@ func (c *tarRecorder) close() error {
 		}
 	}
 
-	return c.file.Close()
+	return c.recordFile.close()
+}
+
+// recordFile is the file where stats are recorded. Writes are buffered and synced to disk accordingly to sync interval.
+// Positions of recorded stats are stored in time index kept in a sidecar file.
+type recordFile struct {
+	file         *os.File
+	buf          *bufio.Writer
+	pos          int64 // position in the file where the next write starts
+	index        *index.Writer
+	syncInterval time.Duration
+	lastSync     time.Time // time of the last sync of written stats to disk
+}
+
+// openRecordFile opens file for recording stats and its time index. Existing file is truncated or, when appending
+// is requested, its tail after the offset returned by recover function is truncated.
+func openRecordFile(c recorderConfig, recover func(f *os.File) (int64, error)) (recordFile, error) {
+	flags := os.O_CREATE | os.O_RDWR
+	if !c.append {
+		flags |= os.O_TRUNC
+	}
+
+	f, err := os.OpenFile(filepath.Clean(c.filename), flags, 0600)
+	if err != nil {
+		return recordFile{}, err
+	}
+
+	var offset int64
+	if c.append {
+		offset, err = recover(f)
+		if err != nil {
+			_ = f.Close()
+			return recordFile{}, err
+		}
+
+		err = f.Truncate(offset)
+		if err != nil {
+			_ = f.Close()
+			return recordFile{}, err
+		}
+
+		_, err = f.Seek(offset, io.SeekStart)
+		if err != nil {
+			_ = f.Close()
+			return recordFile{}, err
+		}
+	}
+
+	idx, err := index.Open(index.Filename(c.filename), offset, c.append)
+	if err != nil {
+		_ = f.Close()
+		return recordFile{}, err
+	}
+
+	return recordFile{
+		file:         f,
+		buf:          bufio.NewWriterSize(f, 64*1024),
+		pos:          offset,
+		index:        idx,
+		syncInterval: c.syncInterval,
+		lastSync:     time.Now(),
+	}, nil
+}
+
+// Write writes data into buffer and advances current position.
+func (f *recordFile) Write(p []byte) (int, error) {
+	n, err := f.buf.Write(p)
+	f.pos += int64(n)
+	return n, err
+}
+
+// syncPeriodically syncs written data if sync interval has been elapsed since the last sync.
+func (f *recordFile) syncPeriodically(now time.Time) error {
+	if now.Sub(f.lastSync) >= f.syncInterval {
+		return f.sync(now)
+	}
+	return nil
+}
+
+// sync flushes buffered data and syncs it to disk. Index is synced after the data, hence it doesn't refer to data
+// which has not been written.
+func (f *recordFile) sync(now time.Time) error {
+	err := f.buf.Flush()
+	if err != nil {
+		return err
+	}
+
+	err = f.file.Sync()
+	if err != nil {
+		return err
+	}
+
+	f.lastSync = now
+	return f.index.Sync()
+}
+
+// close syncs buffered data and closes the file and its index.
+func (f *recordFile) close() error {
+	if f.buf != nil {
+		err := f.sync(time.Now())
+		if err != nil {
+			fmt.Printf("syncing file failed: %s, continue", err)
+		}
+	}
+
+	if f.index != nil {
+		err := f.index.Close()
+		if err != nil {
+			fmt.Printf("closing index file failed: %s, continue", err)
+		}
+	}
+
+	return f.file.Close()
 }
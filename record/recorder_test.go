@@ -4,29 +4,32 @@ import (
 	"archive/tar"
 	"database/sql"
 	"encoding/json"
+	"github.com/lesovsky/pgcenter/internal/index"
 	"github.com/lesovsky/pgcenter/internal/postgres"
 	"github.com/lesovsky/pgcenter/internal/query"
 	"github.com/lesovsky/pgcenter/internal/stat"
 	"github.com/lesovsky/pgcenter/internal/view"
 	"github.com/stretchr/testify/assert"
 	"io"
+	"io/ioutil"
 	"os"
 	"path/filepath"
 	"testing"
+	"time"
 )
 
 func Test_tarRecorder_open_close(t *testing.T) {
-	tc := newTarRecorder(tarConfig{filename: "/tmp/pgcenter-record-testing.stat.tar", append: false})
+	tc := newTarRecorder(recorderConfig{filename: "/tmp/pgcenter-record-testing.stat.tar", append: false})
 	assert.NoError(t, tc.open())
 	assert.NoError(t, tc.close())
 
-	tc = newTarRecorder(tarConfig{filename: "/tmp/pgcenter-record-testing.stat.tar", append: true})
+	tc = newTarRecorder(recorderConfig{filename: "/tmp/pgcenter-record-testing.stat.tar", append: true})
 	assert.NoError(t, tc.open())
 	assert.NoError(t, tc.close())
 }
 
 func Test_tarRecorder(t *testing.T) {
-	tc := newTarRecorder(tarConfig{filename: "/tmp/pgcenter-record-testing.stat.tar"})
+	tc := newTarRecorder(recorderConfig{filename: "/tmp/pgcenter-record-testing.stat.tar"})
 	assert.NoError(t, tc.open())
 
 	// create and configure views
@@ -37,40 +40,51 @@ func Test_tarRecorder(t *testing.T) {
 	views := view.New()
 	opts := query.NewOptions(props.VersionNum, props.Recovery, props.GucTrackCommitTimestamp, 0)
 	assert.NoError(t, views.Configure(opts))
-	db.Close()
 
-	// create postgres config
-	dbConfig, err := postgres.NewTestConfig()
-	assert.NoError(t, err)
-	stats, err := tc.collect(dbConfig, views)
+	stats, err := tc.collect(db, views)
 	assert.NoError(t, err)
 	assert.NotNil(t, stats)
+	assert.Equal(t, len(views), len(stats))
 
 	// check all stats have filled columns
 	for _, s := range stats {
 		assert.Greater(t, len(s.Cols), 0)
 	}
 
+	// terminate recorder's connection, next collect should reconnect
+	db2, err := postgres.NewTestConnect()
+	assert.NoError(t, err)
+	var pid int
+	assert.NoError(t, db.QueryRow("SELECT pg_backend_pid()").Scan(&pid))
+	_, err = db2.Exec("SELECT pg_terminate_backend($1)", pid)
+	assert.NoError(t, err)
+	db2.Close()
+
+	stats, err = tc.collect(db, views)
+	assert.NoError(t, err)
+	assert.Equal(t, len(views), len(stats))
+
+	db.Close()
 	assert.NoError(t, tc.close())
 }
 
 func Test_tarRecorder_write(t *testing.T) {
 	stats := map[string]stat.PGresult{
-		"pgcenter_record_testing": {
-			Valid: true, Ncols: 2, Nrows: 4, Cols: []string{"col1", "col2"},
-			Values: [][]sql.NullString{
+		"pgcenter_record_testing": stat.NewPGresultFromValues(
+			[]string{"col1", "col2"},
+			[][]sql.NullString{
 				{{String: "alfa", Valid: true}, {String: "12.06157", Valid: true}},
 				{{String: "bravo", Valid: true}, {String: "819.188", Valid: true}},
 				{{String: "charli", Valid: true}, {String: "18.126", Valid: true}},
 				{{String: "delta", Valid: true}, {String: "137.176", Valid: true}},
 			},
-		},
+		),
 	}
 
 	filename := "/tmp/pgcenter-record-testing.stat.tar"
 
 	// Write testdata.
-	tc := newTarRecorder(tarConfig{filename: filename, append: false})
+	tc := newTarRecorder(recorderConfig{filename: filename, append: false})
 	assert.NoError(t, tc.open())
 	assert.NoError(t, tc.write(stats))
 	assert.NoError(t, tc.close())
@@ -92,4 +106,162 @@ func Test_tarRecorder_write(t *testing.T) {
 
 	// Cleanup.
 	assert.NoError(t, os.Remove(filename))
+	assert.NoError(t, os.Remove(index.Filename(filename)))
+}
+
+func Test_tarRecorder_write_timezone(t *testing.T) {
+	// Local time zone differs from time zone of Postgres session.
+	local := time.Local
+	time.Local = time.FixedZone("pgcenter-local", -5*3600)
+	defer func() { time.Local = local }()
+
+	filename := "/tmp/pgcenter-record-testing.stat.tar"
+	stats := map[string]stat.PGresult{
+		"pgcenter_record_testing": stat.NewPGresultFromValues([]string{"col1"}, [][]sql.NullString{{{String: "alfa", Valid: true}}}),
+	}
+
+	tc := newTarRecorder(recorderConfig{filename: filename, append: false}).(*tarRecorder)
+	tc.ts = time.Date(2021, 6, 1, 10, 30, 0, 0, time.FixedZone("pgcenter-server", 3*3600))
+	assert.NoError(t, tc.open())
+	assert.NoError(t, tc.write(stats))
+	assert.NoError(t, tc.close())
+
+	// Name of recorded file has local time of the moment when stats have been collected.
+	f, err := os.Open(filepath.Clean(filename))
+	assert.NoError(t, err)
+	hdr, err := tar.NewReader(f).Next()
+	assert.NoError(t, err)
+	assert.Equal(t, "pgcenter_record_testing.20210601T023000.json", hdr.Name)
+	assert.NoError(t, f.Close())
+
+	// Cleanup.
+	assert.NoError(t, os.Remove(filename))
+	assert.NoError(t, os.Remove(index.Filename(filename)))
+}
+
+func Test_tarRecorder_recovery(t *testing.T) {
+	stats := map[string]stat.PGresult{
+		"pgcenter_record_testing": stat.NewPGresultFromValues(
+			[]string{"col1", "col2"},
+			[][]sql.NullString{
+				{{String: "alfa", Valid: true}, {String: "12.06157", Valid: true}},
+			},
+		),
+	}
+
+	filename := "/tmp/pgcenter-record-testing.stat.tar"
+
+	countFiles := func() int {
+		f, err := os.Open(filepath.Clean(filename))
+		assert.NoError(t, err)
+		defer func() { _ = f.Close() }()
+
+		var n int
+		tr := tar.NewReader(f)
+		for {
+			_, err := tr.Next()
+			if err == io.EOF {
+				break
+			}
+			assert.NoError(t, err)
+			n++
+		}
+		return n
+	}
+
+	// Write two snapshots and close archive properly.
+	tc := newTarRecorder(recorderConfig{filename: filename, append: false})
+	assert.NoError(t, tc.open())
+	assert.NoError(t, tc.write(stats))
+	assert.NoError(t, tc.write(stats))
+	assert.NoError(t, tc.close())
+	assert.Equal(t, 2, countFiles())
+
+	// Write snapshot without closing archive, written stats must be readable without tar trailer.
+	tc = newTarRecorder(recorderConfig{filename: filename, append: true})
+	assert.NoError(t, tc.open())
+	assert.NoError(t, tc.write(stats))
+	assert.Equal(t, 3, countFiles())
+
+	// Simulate crash in the middle of writing: truncate the last file.
+	st, err := os.Stat(filename)
+	assert.NoError(t, err)
+	assert.NoError(t, os.Truncate(filename, st.Size()-100))
+
+	// Torn tail must be truncated at opening, new stats are appended after the last complete file.
+	tc = newTarRecorder(recorderConfig{filename: filename, append: true})
+	assert.NoError(t, tc.open())
+	assert.NoError(t, tc.write(stats))
+	assert.NoError(t, tc.close())
+	assert.Equal(t, 3, countFiles())
+
+	// Index refers to the last written file, entry of truncated file is removed. Each file takes header and data blocks.
+	st, err = os.Stat(filename)
+	assert.NoError(t, err)
+	offset, err := index.Lookup(index.Filename(filename), "pgcenter_record_testing", time.Now(), st.Size())
+	assert.NoError(t, err)
+	assert.Equal(t, int64(2*2*tarBlockSize), offset)
+
+	// Appending to file which is not a tar archive fails, the file is kept intact.
+	data := []byte("not a tar archive")
+	assert.NoError(t, ioutil.WriteFile(filename, data, 0600))
+	tc = newTarRecorder(recorderConfig{filename: filename, append: true})
+	assert.Error(t, tc.open())
+	got, err := ioutil.ReadFile(filename)
+	assert.NoError(t, err)
+	assert.Equal(t, data, got)
+
+	// Cleanup.
+	assert.NoError(t, os.Remove(filename))
+	assert.NoError(t, os.Remove(index.Filename(filename)))
+}
+
+func Test_recoverTar(t *testing.T) {
+	filename := "/tmp/pgcenter-record-testing.stat.tar"
+
+	// Empty file.
+	f, err := os.Create(filename)
+	assert.NoError(t, err)
+	offset, err := recoverTar(f)
+	assert.NoError(t, err)
+	assert.Equal(t, int64(0), offset)
+
+	// Archive with single file: header block and data padded to block size, trailer is not counted.
+	tw := tar.NewWriter(f)
+	assert.NoError(t, tw.WriteHeader(&tar.Header{Name: "test.json", Mode: 0644, Size: 5}))
+	_, err = tw.Write([]byte("hello"))
+	assert.NoError(t, err)
+	assert.NoError(t, tw.Close())
+
+	offset, err = recoverTar(f)
+	assert.NoError(t, err)
+	assert.Equal(t, int64(2*tarBlockSize), offset)
+
+	// Torn second file, archive is recovered up to the end of the first file.
+	_, err = f.Seek(2*tarBlockSize, io.SeekStart)
+	assert.NoError(t, err)
+	tw = tar.NewWriter(f)
+	assert.NoError(t, tw.WriteHeader(&tar.Header{Name: "test2.json", Mode: 0644, Size: 5}))
+	_, err = tw.Write([]byte("hello"))
+	assert.NoError(t, err)
+	assert.NoError(t, tw.Flush())
+	assert.NoError(t, f.Truncate(3*tarBlockSize+100))
+	offset, err = recoverTar(f)
+	assert.NoError(t, err)
+	assert.Equal(t, int64(2*tarBlockSize), offset)
+
+	// Torn padding of the first file.
+	assert.NoError(t, f.Truncate(tarBlockSize+100))
+	_, err = recoverTar(f)
+	assert.Error(t, err)
+
+	// Not a tar archive.
+	assert.NoError(t, f.Truncate(0))
+	_, err = f.WriteAt([]byte("PGCENTER binary recording, not a tar archive"), 0)
+	assert.NoError(t, err)
+	_, err = recoverTar(f)
+	assert.Error(t, err)
+
+	assert.NoError(t, f.Close())
+	assert.NoError(t, os.Remove(filename))
 }
@@ -0,0 +1,330 @@
+package report
+
+import (
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/lesovsky/pgcenter/internal/view"
+	"io"
+	"math"
+	"os"
+	"sort"
+	"time"
+)
+
+// Window defines interval of time, both bounds are included.
+type Window struct {
+	Start time.Time
+	End   time.Time
+}
+
+// contains returns true if passed time is within the window.
+func (w Window) contains(ts time.Time) bool {
+	return !ts.Before(w.Start) && !ts.After(w.End)
+}
+
+// String returns description of the window.
+func (w Window) String() string {
+	return w.Start.Format("2006-01-02 15:04:05") + ".." + w.End.Format("2006-01-02 15:04:05")
+}
+
+// windowStatReader reads stats snapshots recorded within compared windows, every snapshot is tagged with the number of
+// its window. Snapshots of all windows are read in single pass using the single reader, or every window is read using
+// its own reader. Snapshots outside of windows are skipped without decoding.
+type windowStatReader struct {
+	readers []statReader // readers of windows, or the single reader of all windows
+	windows []Window
+	cur     int // number of the current reader
+}
+
+// next returns next snapshot of compared windows.
+func (r *windowStatReader) next() (statEntry, error) {
+	for r.cur < len(r.readers) {
+		e, err := r.readers[r.cur].next()
+		if err == io.EOF {
+			r.cur++
+			continue
+		}
+		if err != nil {
+			return statEntry{}, err
+		}
+
+		if len(r.readers) > 1 {
+			if r.windows[r.cur].contains(e.ts) {
+				e.window = r.cur
+				return e, nil
+			}
+			continue
+		}
+
+		for i, w := range r.windows {
+			if w.contains(e.ts) {
+				e.window = i
+				return e, nil
+			}
+		}
+	}
+
+	return statEntry{}, io.EOF
+}
+
+// newCompareStatReader creates reader of snapshots of compared windows. When the second file is not specified, both
+// windows are read from the first file in single pass.
+func newCompareStatReader(f, f2 *os.File, c Config) (statReader, error) {
+	windows := c.Compare
+
+	if f2 == nil {
+		config := c
+		config.TsStart, config.TsEnd = windows[0].Start, windows[0].End
+		for _, w := range windows[1:] {
+			if w.Start.Before(config.TsStart) {
+				config.TsStart = w.Start
+			}
+			if w.End.After(config.TsEnd) {
+				config.TsEnd = w.End
+			}
+		}
+
+		r, err := newStatReader(f, config)
+		if err != nil {
+			return nil, err
+		}
+		return &windowStatReader{readers: []statReader{r}, windows: windows}, nil
+	}
+
+	readers := make([]statReader, len(windows))
+	for i, file := range []*os.File{f, f2} {
+		config := c
+		config.TsStart, config.TsEnd = windows[i].Start, windows[i].End
+
+		r, err := newStatReader(file, config)
+		if err != nil {
+			return nil, err
+		}
+		readers[i] = r
+	}
+
+	return &windowStatReader{readers: readers, windows: windows}, nil
+}
+
+// compareKey keeps sums of rates of the single row, identified by the value of unique key, in compared windows.
+type compareKey struct {
+	key    string
+	labels []string     // values of non-diffed columns, taken from the last delta where row has been seen
+	sums   [2][]float64 // sums of rates of diffed columns in every window
+	counts [2]int       // number of deltas where row has been seen in every window
+}
+
+// avg returns average rate of the diffed column in the window.
+func (k *compareKey) avg(w int, i int) float64 {
+	if k.counts[w] == 0 {
+		return 0
+	}
+	return k.sums[w][i] / float64(k.counts[w])
+}
+
+// compareTotals aggregates rates of rows in two compared windows.
+type compareTotals struct {
+	ukey      int                    // index of the column with unique key
+	diffCols  []int                  // indexes of diffed columns
+	labelCols []int                  // indexes of other columns
+	rankKey   int                    // index of diffed column which change is used for ranking rows
+	keys      map[string]*compareKey // rates by unique key
+}
+
+// newCompareTotals creates aggregates of the view with passed columns. Rows are ranked by change of the order column
+// if it is diffed, or by change of the first diffed column.
+func newCompareTotals(v view.View, cols []string) *compareTotals {
+	t := &compareTotals{ukey: v.UniqueKey, keys: map[string]*compareKey{}}
+
+	for i := range cols {
+		if i >= v.DiffIntvl[0] && i <= v.DiffIntvl[1] {
+			if i == v.OrderKey {
+				t.rankKey = len(t.diffCols)
+			}
+			t.diffCols = append(t.diffCols, i)
+		} else {
+			t.labelCols = append(t.labelCols, i)
+		}
+	}
+
+	return t
+}
+
+// add aggregates rates of the delta into the window.
+func (t *compareTotals) add(w int, res *stat.PGresult) {
+	for row := 0; row < res.Nrows; row++ {
+		key := res.Value(row, t.ukey)
+		k, ok := t.keys[key]
+		if !ok {
+			n := len(t.diffCols)
+			sums := make([]float64, 2*n)
+			k = &compareKey{key: key, labels: make([]string, len(t.labelCols)), sums: [2][]float64{sums[:n], sums[n:]}}
+			t.keys[key] = k
+		}
+
+		for i, col := range t.labelCols {
+			k.labels[i] = res.Value(row, col)
+		}
+		for i, col := range t.diffCols {
+			if v, ok := res.Columns[col].Float64(row); ok {
+				k.sums[w][i] += v
+			}
+		}
+		k.counts[w]++
+	}
+}
+
+// result returns comparison of average rates: values of non-diffed columns of the row followed by name of diffed
+// column, its average rates in both windows, change of the rate and ratio of rates. Rows are ordered by absolute
+// change of the rank column, rows are produced for every diffed column which rate is not zero in any window.
+func (t *compareTotals) result(cols []string) stat.PGresult {
+	keys := make([]*compareKey, 0, len(t.keys))
+	for _, k := range t.keys {
+		keys = append(keys, k)
+	}
+
+	sort.Slice(keys, func(i, j int) bool {
+		a := math.Abs(keys[i].avg(1, t.rankKey) - keys[i].avg(0, t.rankKey))
+		b := math.Abs(keys[j].avg(1, t.rankKey) - keys[j].avg(0, t.rankKey))
+		if a != b {
+			return a > b
+		}
+		return keys[i].key < keys[j].key
+	})
+
+	res := stat.PGresult{Valid: true}
+	for _, col := range t.labelCols {
+		res.Cols = append(res.Cols, cols[col])
+	}
+	res.Cols = append(res.Cols, "metric", "before", "after", "delta", "ratio")
+	res.Ncols = len(res.Cols)
+	res.Columns = make([]stat.Column, res.Ncols)
+
+	nlabels := len(t.labelCols)
+	values := res.Columns[nlabels+1:]
+	for i := range values {
+		values[i] = stat.Column{Type: stat.FloatColumn, Prec: 2}
+	}
+	values[3].Null = []bool{}
+
+	for _, k := range keys {
+		for i, col := range t.diffCols {
+			before, after := k.avg(0, i), k.avg(1, i)
+			if before == 0 && after == 0 {
+				continue
+			}
+
+			for j, label := range k.labels {
+				res.Columns[j].Text = append(res.Columns[j].Text, label)
+			}
+			res.Columns[nlabels].Text = append(res.Columns[nlabels].Text, cols[col])
+
+			values[0].Float = append(values[0].Float, before)
+			values[1].Float = append(values[1].Float, after)
+			values[2].Float = append(values[2].Float, after-before)
+
+			// Ratio is not defined when there were no activity in the first window.
+			if before != 0 {
+				values[3].Float = append(values[3].Float, after/before)
+				values[3].Null = append(values[3].Null, false)
+			} else {
+				values[3].Float = append(values[3].Float, 0)
+				values[3].Null = append(values[3].Null, true)
+			}
+			res.Nrows++
+		}
+	}
+
+	return res
+}
+
+// compareStats calculates deltas between consecutive snapshots within every window, aggregates rates of rows in
+// windows and sends the single item with comparison of windows. Deltas are calculated the same way as in the regular
+// report, snapshots of different windows are never compared. Item with error is sent as the last one.
+func (app *app) compareStats(in <-chan *reportItem, done <-chan struct{}) <-chan *reportItem {
+	out := make(chan *reportItem, 1)
+
+	go func() {
+		defer close(out)
+
+		c := app.config
+		v := app.view
+
+		send := func(item *reportItem) {
+			item.seq = 0
+			select {
+			case out <- item:
+			case <-done:
+			}
+		}
+
+		var totals *compareTotals
+		var filter *stat.Filter
+		var prev [2]*reportItem
+		var last *reportItem
+
+		for items := range reorder(in, done) {
+			for _, curr := range items {
+				if curr.err != nil {
+					send(curr)
+					return
+				}
+
+				// When first data read, list of columns is known and it is possible to set up order and filter.
+				if totals == nil {
+					if v.DiffIntvl == [2]int{0, 0} {
+						curr.err = fmt.Errorf("comparison is not supported by %s report, it has no diffed columns", c.ReportType)
+						send(curr)
+						return
+					}
+
+					if idx, ok := getColumnIndex(curr.entry.res.Cols, c.OrderColName); ok {
+						v.OrderKey = idx
+					}
+
+					filter, curr.err = c.Filter.Compile(curr.entry.res.Cols, v.DiffIntvl)
+					if curr.err != nil {
+						send(curr)
+						return
+					}
+
+					totals = newCompareTotals(v, curr.entry.res.Cols)
+				}
+
+				w := curr.entry.window
+				p := prev[w]
+				prev[w], last = curr, curr
+				if p == nil {
+					continue
+				}
+
+				interval := curr.entry.ts.Sub(p.entry.ts)
+				if interval <= 0 {
+					continue
+				}
+
+				diff, err := countDiff(curr.entry.res, p.entry.res, p.index, rateInterval(interval, c.Rate), v, filter)
+				if err != nil {
+					curr.err = err
+					send(curr)
+					return
+				}
+
+				totals.add(w, &diff)
+			}
+		}
+
+		if totals == nil {
+			return
+		}
+
+		res := totals.result(last.entry.res.Cols)
+
+		v.Aligned = false
+		formatStatSample(&res, &v, c)
+
+		send(&reportItem{entry: statEntry{report: c.ReportType, ts: last.entry.ts}, diff: res, view: v})
+	}()
+
+	return out
+}
@@ -0,0 +1,122 @@
+package report
+
+import (
+	"bytes"
+	"database/sql"
+	"encoding/csv"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/lesovsky/pgcenter/internal/view"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"strconv"
+	"testing"
+	"time"
+)
+
+func Test_windowStatReader(t *testing.T) {
+	start := time.Date(2021, 1, 23, 15, 0, 0, 0, time.Local)
+	newEntries := func() []statEntry {
+		entries := make([]statEntry, 6)
+		for i := range entries {
+			entries[i] = statEntry{report: "tables", ts: start.Add(time.Duration(i) * time.Minute)}
+		}
+		return entries
+	}
+	windows := []Window{
+		{Start: start.Add(4 * time.Minute), End: start.Add(5 * time.Minute)},
+		{Start: start, End: start.Add(time.Minute)},
+	}
+
+	// Windows are read from the single reader, snapshots outside of windows are skipped.
+	r := &windowStatReader{readers: []statReader{&testStatReader{entries: newEntries(), err: io.EOF}}, windows: windows}
+	var got []int
+	for {
+		e, err := r.next()
+		if err == io.EOF {
+			break
+		}
+		assert.NoError(t, err)
+		got = append(got, int(e.ts.Sub(start)/time.Minute)*10+e.window)
+	}
+	assert.Equal(t, []int{1, 11, 40, 50}, got)
+
+	// Every window is read from its own reader.
+	r = &windowStatReader{
+		readers: []statReader{&testStatReader{entries: newEntries(), err: io.EOF}, &testStatReader{entries: newEntries(), err: io.EOF}},
+		windows: windows,
+	}
+	got = nil
+	for {
+		e, err := r.next()
+		if err == io.EOF {
+			break
+		}
+		assert.NoError(t, err)
+		got = append(got, int(e.ts.Sub(start)/time.Minute)*10+e.window)
+	}
+	assert.Equal(t, []int{40, 50, 1, 11}, got)
+}
+
+func Test_compareTotals(t *testing.T) {
+	cols := []string{"name", "calls", "time"}
+	totals := newCompareTotals(view.View{DiffIntvl: [2]int{1, 2}, UniqueKey: 0, OrderKey: 2}, cols)
+
+	for _, tc := range []struct {
+		window int
+		values [][]sql.NullString
+	}{
+		{window: 0, values: [][]sql.NullString{{{String: "a", Valid: true}, {String: "10", Valid: true}, {String: "1", Valid: true}}, {{String: "b", Valid: true}, {String: "5", Valid: true}, {String: "0", Valid: true}}}},
+		{window: 0, values: [][]sql.NullString{{{String: "a", Valid: true}, {String: "30", Valid: true}, {String: "3", Valid: true}}, {{String: "b", Valid: true}, {String: "5", Valid: true}, {String: "0", Valid: true}}}},
+		{window: 1, values: [][]sql.NullString{{{String: "a", Valid: true}, {String: "20", Valid: true}, {String: "4", Valid: true}}, {{String: "c", Valid: true}, {String: "1", Valid: true}, {String: "50", Valid: true}}}},
+	} {
+		res := stat.NewPGresultFromValues(cols, tc.values)
+		totals.add(tc.window, &res)
+	}
+
+	// Rows are ranked by change of the order column, rows with zero rates in both windows are skipped.
+	got := totals.result(cols)
+	assert.Equal(t, []string{"name", "metric", "before", "after", "delta", "ratio"}, got.Cols)
+	assert.Equal(t, []string{"c", "c", "a", "a", "b"}, got.Columns[0].Text)
+	assert.Equal(t, []string{"calls", "time", "calls", "time", "calls"}, got.Columns[1].Text)
+	assert.Equal(t, []float64{0, 0, 20, 2, 5}, got.Columns[2].Float)
+	assert.Equal(t, []float64{1, 50, 20, 4, 0}, got.Columns[3].Float)
+	assert.Equal(t, []float64{1, 50, 0, 2, -5}, got.Columns[4].Float)
+	assert.Equal(t, []string{"", "", "1.00", "2.00", "0.00"}, []string{got.Value(0, 5), got.Value(1, 5), got.Value(2, 5), got.Value(3, 5), got.Value(4, 5)})
+}
+
+func Test_app_doReport_compare(t *testing.T) {
+	config := Config{ReportType: "tables", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now(), Workers: 2}
+	entries := readTestEntries(t, config)
+	assert.Greater(t, len(entries), 4)
+
+	// The first half of snapshots is the baseline.
+	for i := range entries {
+		if i >= len(entries)/2 {
+			entries[i].window = 1
+		}
+	}
+	config.Compare = []Window{{}, {}}
+	config.Format = formatCSV
+
+	app := newApp(config)
+	var buf bytes.Buffer
+	app.writer = &buf
+	assert.NoError(t, app.doReport(&testStatReader{entries: entries, err: io.EOF}))
+
+	records, err := csv.NewReader(&buf).ReadAll()
+	assert.NoError(t, err)
+	assert.Greater(t, len(records), 1)
+
+	// Delta is the difference of average rates, ratio is not defined when the baseline rate is zero.
+	n := len(records[0])
+	assert.Equal(t, []string{"metric", "before", "after", "delta", "ratio"}, records[0][n-5:])
+	for _, r := range records[1:] {
+		var values [3]float64
+		for i := range values {
+			values[i], err = strconv.ParseFloat(r[n-4+i], 64)
+			assert.NoError(t, err)
+		}
+		assert.InDelta(t, values[1]-values[0], values[2], 0.011)
+		assert.Equal(t, values[0] == 0, r[n-1] == "")
+	}
+}
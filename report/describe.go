@@ -145,6 +145,25 @@ Details: https://www.postgresql.org/docs/current/monitoring-stats.html#PG-STAT-U
 * - extended value, based on origin and calculated using additional functions.
 
 Details: https://www.postgresql.org/docs/current/functions-admin.html#FUNCTIONS-ADMIN-DBOBJECT
+`
+
+	// pgcenterCpuStatDescription is the detailed description of per-CPU stats
+	pgcenterCpuStatDescription = `Per-CPU statistics based on pgcenter.sys_proc_stat view (requires pgcenter schema):
+
+  column	origin		description
+- cpu		cpu		Name of the CPU
+- us		us_time		Percent of time spent in user mode
+- sy		sy_time		Percent of time spent in system mode
+- ni		ni_time		Percent of time spent in user mode with low priority (nice)
+- wa		wa_time		Percent of time spent waiting for I/O to complete
+- hi		hi_time		Percent of time spent servicing hardware interrupts
+- si		si_time		Percent of time spent servicing software interrupts
+- st		st_time		Percent of time stolen by other virtual machines
+- busy*		-		Percent of time CPU has not been idle
+
+* - extended value, based on origin and calculated using additional functions.
+
+Details: https://www.kernel.org/doc/html/latest/filesystems/proc.html#miscellaneous-kernel-statistics-in-proc-stat
 `
 
 	// pgStatActivityDescription is the detailed description of pg_stat_activity view
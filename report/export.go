@@ -0,0 +1,175 @@
+package report
+
+import (
+	"github.com/lesovsky/pgcenter/internal/align"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"math"
+	"time"
+	"unicode/utf8"
+)
+
+// Output formats of reports.
+const (
+	formatTable = ""      // aligned table for humans
+	formatCSV   = "csv"   // comma-separated values with header
+	formatJSONL = "jsonl" // JSON object per line
+)
+
+// exportTimestampColumn defines name of the column with time when stats were recorded.
+const exportTimestampColumn = "timestamp"
+
+// exportFileExt returns extension of files with reports in passed format.
+func exportFileExt(format string) string {
+	switch format {
+	case formatCSV:
+		return ".csv"
+	case formatJSONL:
+		return ".jsonl"
+	default:
+		return ".txt"
+	}
+}
+
+// renderExportHeader renders header of the report in passed format, only CSV has header.
+func renderExportHeader(t *align.Table, cols []string, format string) {
+	if format != formatCSV {
+		return
+	}
+
+	t.AppendFunc(func(buf []byte) []byte {
+		buf = append(buf, exportTimestampColumn...)
+		for _, name := range cols {
+			buf = append(buf, ',')
+			buf = appendCSVField(buf, name)
+		}
+		return append(buf, '\n')
+	})
+}
+
+// renderExportSample renders rows of the delta in passed format, every row starts with timestamp. Values are rendered
+// straight from typed columns. Returns number of rendered rows.
+func renderExportSample(t *align.Table, res *stat.PGresult, c Config, ts time.Time) int {
+	nrows := res.Nrows
+	if c.RowLimit > 0 && nrows > c.RowLimit {
+		nrows = c.RowLimit
+	}
+
+	var tsbuf [64]byte
+	timestamp := ts.AppendFormat(tsbuf[:0], time.RFC3339)
+
+	t.AppendFunc(func(buf []byte) []byte {
+		for row := 0; row < nrows; row++ {
+			switch c.Format {
+			case formatCSV:
+				buf = appendCSVRow(buf, res, row, timestamp)
+			case formatJSONL:
+				buf = appendJSONRow(buf, res, row, timestamp)
+			}
+		}
+		return buf
+	})
+
+	return nrows
+}
+
+// appendCSVRow appends the row as comma-separated values. NULLs are empty fields.
+func appendCSVRow(buf []byte, res *stat.PGresult, row int, ts []byte) []byte {
+	buf = append(buf, ts...)
+	for i := range res.Columns {
+		buf = append(buf, ',')
+
+		c := &res.Columns[i]
+		if c.Type == stat.TextColumn && !c.IsNull(row) {
+			buf = appendCSVField(buf, c.Text[row])
+			continue
+		}
+		buf = c.AppendString(buf, row)
+	}
+	return append(buf, '\n')
+}
+
+// appendCSVField appends text value, values with separators, quotes or line breaks are quoted.
+func appendCSVField(buf []byte, s string) []byte {
+	quote := false
+	for i := 0; i < len(s); i++ {
+		switch s[i] {
+		case ',', '"', '\n', '\r':
+			quote = true
+		}
+	}
+	if !quote {
+		return append(buf, s...)
+	}
+
+	buf = append(buf, '"')
+	for i := 0; i < len(s); i++ {
+		if s[i] == '"' {
+			buf = append(buf, '"')
+		}
+		buf = append(buf, s[i])
+	}
+	return append(buf, '"')
+}
+
+// appendJSONRow appends the row as JSON object, keys are names of columns. Numbers are JSON numbers, NULLs are nulls.
+func appendJSONRow(buf []byte, res *stat.PGresult, row int, ts []byte) []byte {
+	buf = append(buf, `{"`+exportTimestampColumn+`":"`...)
+	buf = append(buf, ts...)
+	buf = append(buf, '"')
+
+	for i := range res.Columns {
+		buf = append(buf, ',')
+		buf = appendJSONString(buf, res.Cols[i])
+		buf = append(buf, ':')
+
+		c := &res.Columns[i]
+		switch {
+		case c.IsNull(row):
+			buf = append(buf, "null"...)
+		case c.Type == stat.TextColumn:
+			buf = appendJSONString(buf, c.Text[row])
+		case c.Type == stat.FloatColumn && (math.IsNaN(c.Float[row]) || math.IsInf(c.Float[row], 0)):
+			buf = append(buf, "null"...)
+		default:
+			buf = c.AppendString(buf, row)
+		}
+	}
+	return append(buf, "}\n"...)
+}
+
+// appendJSONString appends string as JSON string. Invalid UTF-8 bytes are replaced with replacement character.
+func appendJSONString(buf []byte, s string) []byte {
+	const hex = "0123456789abcdef"
+
+	buf = append(buf, '"')
+	for i := 0; i < len(s); {
+		b := s[i]
+		if b < utf8.RuneSelf {
+			switch {
+			case b == '"' || b == '\\':
+				buf = append(buf, '\\', b)
+			case b == '\n':
+				buf = append(buf, '\\', 'n')
+			case b == '\r':
+				buf = append(buf, '\\', 'r')
+			case b == '\t':
+				buf = append(buf, '\\', 't')
+			case b < 0x20:
+				buf = append(buf, '\\', 'u', '0', '0', hex[b>>4], hex[b&0xf])
+			default:
+				buf = append(buf, b)
+			}
+			i++
+			continue
+		}
+
+		r, size := utf8.DecodeRuneInString(s[i:])
+		if r == utf8.RuneError && size == 1 {
+			buf = append(buf, "\ufffd"...)
+		} else {
+			buf = append(buf, s[i:i+size]...)
+		}
+		i += size
+	}
+	return append(buf, '"')
+}
@@ -0,0 +1,136 @@
+package report
+
+import (
+	"bytes"
+	"database/sql"
+	"encoding/csv"
+	"encoding/json"
+	"github.com/lesovsky/pgcenter/internal/align"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"io/ioutil"
+	"strconv"
+	"strings"
+	"testing"
+	"time"
+)
+
+// newExportTestResult creates result with values which need quoting and escaping.
+func newExportTestResult() stat.PGresult {
+	return stat.NewPGresultFromValues(
+		[]string{"name", "calls", "time", "query"},
+		[][]sql.NullString{
+			{{String: "app", Valid: true}, {String: "150", Valid: true}, {String: "1.5", Valid: true}, {String: `SELECT 'a,b', "c"`, Valid: true}},
+			{{String: "my\tapp", Valid: true}, {String: "", Valid: false}, {String: "", Valid: false}, {String: "SELECT\n1 \\ \x01 \xff", Valid: true}},
+		},
+	)
+}
+
+func Test_renderExportSample(t *testing.T) {
+	res := newExportTestResult()
+	ts := time.Date(2021, 1, 23, 15, 31, 26, 0, time.UTC)
+
+	// CSV.
+	table := align.NewTable(false)
+	renderExportHeader(table, res.Cols, formatCSV)
+	assert.Equal(t, 2, renderExportSample(table, &res, Config{Format: formatCSV}, ts))
+
+	records, err := csv.NewReader(bytes.NewReader(table.Bytes())).ReadAll()
+	assert.NoError(t, err)
+	assert.Equal(t, [][]string{
+		{"timestamp", "name", "calls", "time", "query"},
+		{"2021-01-23T15:31:26Z", "app", "150", "1.5", `SELECT 'a,b', "c"`},
+		{"2021-01-23T15:31:26Z", "my\tapp", "", "", "SELECT\n1 \\ \x01 \xff"},
+	}, records)
+
+	// JSON Lines.
+	table.Reset()
+	renderExportHeader(table, res.Cols, formatJSONL)
+	assert.Equal(t, 1, renderExportSample(table, &res, Config{Format: formatJSONL, RowLimit: 1}, ts))
+	assert.Equal(t, `{"timestamp":"2021-01-23T15:31:26Z","name":"app","calls":150,"time":1.5,"query":"SELECT 'a,b', \"c\""}`+"\n", string(table.Bytes()))
+
+	table.Reset()
+	renderExportSample(table, &res, Config{Format: formatJSONL}, ts)
+	lines := strings.Split(strings.TrimSuffix(string(table.Bytes()), "\n"), "\n")
+	assert.Len(t, lines, 2)
+
+	var row map[string]interface{}
+	assert.NoError(t, json.Unmarshal([]byte(lines[1]), &row))
+	assert.Equal(t, map[string]interface{}{
+		"timestamp": "2021-01-23T15:31:26Z", "name": "my\tapp", "calls": nil, "time": nil, "query": "SELECT\n1 \\ \x01 \ufffd",
+	}, row)
+}
+
+func Test_app_doReport_export(t *testing.T) {
+	config := Config{ReportType: "tables", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now(), Workers: 2}
+	entries := readTestEntries(t, config)
+	assert.Greater(t, len(entries), 2)
+
+	e := entries[0]
+	assert.NoError(t, e.decode())
+
+	for _, format := range []string{formatCSV, formatJSONL} {
+		config.Format = format
+		app := newApp(config)
+		var buf bytes.Buffer
+		app.writer = &buf
+
+		assert.NoError(t, app.doReport(&testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF}))
+
+		// Every exported row has timestamp and all columns of the report.
+		var rows int
+		switch format {
+		case formatCSV:
+			records, err := csv.NewReader(&buf).ReadAll()
+			assert.NoError(t, err)
+			assert.Equal(t, "timestamp", records[0][0])
+			assert.Equal(t, "relation", records[0][1])
+			for _, r := range records[1:] {
+				_, err := time.Parse(time.RFC3339, r[0])
+				assert.NoError(t, err)
+				_, err = strconv.ParseFloat(r[2], 64)
+				assert.NoError(t, err)
+			}
+			rows = len(records) - 1
+		case formatJSONL:
+			for _, line := range strings.Split(strings.TrimSuffix(buf.String(), "\n"), "\n") {
+				var row map[string]interface{}
+				assert.NoError(t, json.Unmarshal([]byte(line), &row))
+				assert.Len(t, row, len(e.res.Cols)+1)
+				_, ok := row["seq_scan"].(float64)
+				assert.True(t, ok)
+				rows++
+			}
+		}
+		assert.Greater(t, rows, 0)
+	}
+}
+
+// BenchmarkRenderExportSample renders 10k rows as CSV and JSON Lines.
+func BenchmarkRenderExportSample(b *testing.B) {
+	values := make([][]sql.NullString, 10000)
+	for i := range values {
+		n := strconv.Itoa(i * 7919)
+		values[i] = []sql.NullString{
+			{String: "public.table_with_long_name_" + n, Valid: true}, {String: n, Valid: true}, {String: n, Valid: i%2 == 0}, {String: "0.75", Valid: true},
+		}
+	}
+	res := stat.NewPGresultFromValues([]string{"relation", "seq_scan", "idx_scan", "ratio"}, values)
+	ts := time.Now()
+
+	for _, format := range []string{formatCSV, formatJSONL} {
+		b.Run(format, func(b *testing.B) {
+			table := align.NewTable(false)
+			config := Config{Format: format}
+			b.ReportAllocs()
+			b.ResetTimer()
+
+			for i := 0; i < b.N; i++ {
+				table.Reset()
+				renderExportSample(table, &res, config, ts)
+				_, _ = table.WriteTo(ioutil.Discard)
+			}
+		})
+	}
+}
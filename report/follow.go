@@ -0,0 +1,278 @@
+package report
+
+import (
+	"archive/tar"
+	"bufio"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
+	"io"
+	"os"
+	"time"
+)
+
+// followInterval defines how often statistics file is checked for appended data when following.
+var followInterval = 250 * time.Millisecond
+
+// tarBlockSize defines size of tar blocks, headers and data of archived files are padded to the block size.
+const tarBlockSize = 512
+
+// errTruncated is returned when followed file has been truncated before the read position.
+var errTruncated = fmt.Errorf("statistics file has been truncated")
+
+// followReader reads statistics file which is being recorded. At the end of the file reading waits for appended
+// data instead of returning io.EOF. File is read using positional reads, hence its offset is not used.
+type followReader struct {
+	f        *os.File
+	pos      int64         // position of the next read
+	interval time.Duration // interval of checking for appended data
+	done     <-chan struct{}
+}
+
+// Read reads data at the current position, waits for appended data at the end of the file. Returns io.EOF only
+// when following is stopped.
+func (r *followReader) Read(p []byte) (int, error) {
+	for {
+		n, err := r.f.ReadAt(p, r.pos)
+		r.pos += int64(n)
+		if n > 0 {
+			return n, nil
+		}
+		if err != nil && err != io.EOF {
+			return 0, err
+		}
+
+		// The end of the file is reached. Recorder might truncate the file when recovering its tail, the read
+		// position is not valid anymore in this case.
+		size, err := r.size()
+		if err != nil {
+			return 0, err
+		}
+		if size < r.pos {
+			return 0, errTruncated
+		}
+
+		if !r.wait() {
+			return 0, io.EOF
+		}
+	}
+}
+
+// size returns current size of the file.
+func (r *followReader) size() (int64, error) {
+	st, err := r.f.Stat()
+	if err != nil {
+		return 0, err
+	}
+	return st.Size(), nil
+}
+
+// wait waits for the check interval, returns false if following is stopped.
+func (r *followReader) wait() bool {
+	t := time.NewTimer(r.interval)
+	defer t.Stop()
+
+	select {
+	case <-t.C:
+		return true
+	case <-r.done:
+		return false
+	}
+}
+
+// newFollowStatReader creates reader of statistics file which is being recorded. Reading starts at the position of
+// stats recorded at the beginning of requested interval (if the file has time index) and continues with stats
+// appended by recorder, until following is stopped or stats recorded after the end of interval are read.
+func newFollowStatReader(f *os.File, c Config, done <-chan struct{}) (statReader, error) {
+	fr := &followReader{f: f, interval: followInterval, done: done}
+
+	// Wait for the header of the file if recording has just started.
+	header := make([]byte, len(snapshot.Magic))
+	_, err := io.ReadFull(fr, header)
+	if err != nil {
+		return nil, err
+	}
+
+	offset, _ := lookupIndex(f, c)
+	fr.pos = offset
+
+	reports := map[string]bool{}
+	for _, report := range c.reportTypes() {
+		reports[report] = true
+	}
+
+	if snapshot.IsSnapshotFile(header) {
+		// Reading starts at the beginning of a segment, magic header has been already read.
+		if offset == 0 {
+			offset = int64(len(snapshot.Magic))
+		}
+		fr.pos = offset
+
+		sr := snapshot.NewSegmentReader(fr)
+		sr.SetViews(c.reportTypes()...)
+		return &followBinaryReader{
+			binaryStatReader: binaryStatReader{r: sr, reports: reports, start: c.TsStart, end: c.TsEnd, stop: true},
+			f:                fr,
+			views:            c.reportTypes(),
+			offset:           offset,
+			failedSize:       -1,
+		}, nil
+	}
+
+	br := bufio.NewReader(fr)
+
+	return &followTarReader{
+		tarStatReader: tarStatReader{r: tar.NewReader(br), reports: reports, start: c.TsStart, end: c.TsEnd, stop: true},
+		f:             fr,
+		br:            br,
+		pos:           offset,
+		offset:        offset,
+		failedSize:    -1,
+	}, nil
+}
+
+// followBinaryReader reads binary file which is being recorded. When recording is resumed after crash, recorder
+// truncates torn tail of the file after the last complete frame and appends new segment. Hence, when reading fails,
+// reading is restarted with new segment reader at the end of the last complete frame, earlier data is never read again.
+type followBinaryReader struct {
+	binaryStatReader
+	f          *followReader
+	views      []string // names of read views
+	offset     int64    // position where the current segment reader has been started
+	failedSize int64    // size of the file when reading failed last time, -1 if reading has not failed
+}
+
+// next returns next stats snapshot, waits for stats appended by recorder. Returns io.EOF when following is stopped
+// or stats recorded after the end of interval have been read.
+func (r *followBinaryReader) next() (statEntry, error) {
+	for {
+		e, err := r.binaryStatReader.next()
+		if err == nil {
+			r.failedSize = -1
+			return e, nil
+		}
+		if err == io.EOF {
+			return statEntry{}, err
+		}
+
+		size, serr := r.f.size()
+		if serr != nil {
+			return statEntry{}, serr
+		}
+
+		// Recorder truncates only data after the last complete frame, smaller file means the file has been recorded
+		// from scratch.
+		pos := r.offset + r.r.Offset()
+		if size < pos {
+			return statEntry{}, errTruncated
+		}
+
+		// Torn frame has been truncated and written over, reading is retried, but only if the file has been changed
+		// since previous failure.
+		if size == r.failedSize {
+			return statEntry{}, err
+		}
+		r.failedSize = size
+
+		if !r.f.wait() {
+			return statEntry{}, io.EOF
+		}
+
+		// Restart reading at the end of the last complete frame, appended data starts with new segment.
+		r.f.pos = pos
+		r.offset = pos
+		r.r = snapshot.NewSegmentReader(r.f)
+		r.r.SetViews(r.views...)
+	}
+}
+
+// followTarReader reads tar archive which is being recorded. Recorder writes tar trailer when recording is stopped
+// and writes over it when recording is resumed; torn tail of the archive is truncated and written over too. Hence,
+// when reading hits the trailer or fails, reading is restarted at the end of the last processed file, earlier data
+// is never read again. Recorder writes files with plain headers, hence positions of files are calculated using their
+// sizes.
+type followTarReader struct {
+	tarStatReader
+	f          *followReader
+	br         *bufio.Reader
+	pos        int64 // position of the next file header
+	offset     int64 // position after the last processed file, reading is restarted here
+	failedSize int64 // size of the file when reading failed last time, -1 if reading has not failed
+	ended      bool  // stats recorded after the end of interval have been read
+}
+
+// next returns next stats snapshot, waits for stats appended by recorder. Returns io.EOF when following is stopped
+// or stats recorded after the end of interval have been read.
+func (r *followTarReader) next() (statEntry, error) {
+	for {
+		e, err := r.read()
+		if err == nil {
+			r.failedSize = -1
+			return e, nil
+		}
+		if r.ended {
+			return statEntry{}, io.EOF
+		}
+
+		size, serr := r.f.size()
+		if serr != nil {
+			return statEntry{}, serr
+		}
+
+		// Recorder truncates only data after the last completely written file, smaller file means the file has been
+		// recorded from scratch.
+		if size < r.offset {
+			return statEntry{}, errTruncated
+		}
+
+		// Trailer means recording has been stopped, wait until it is resumed. Other errors mean data has been
+		// written over, reading is retried, but only if the file has been changed since previous failure.
+		if err != io.EOF {
+			if size == r.failedSize {
+				return statEntry{}, err
+			}
+			r.failedSize = size
+		}
+
+		if !r.f.wait() {
+			return statEntry{}, io.EOF
+		}
+
+		// Restart reading at the end of the last processed file.
+		r.f.pos = r.offset
+		r.br.Reset(r.f)
+		r.r = tar.NewReader(r.br)
+		r.pos = r.offset
+	}
+}
+
+// read reads files headers continuously, reads stats files requested by user and skips others. Positions of read
+// files are tracked.
+func (r *followTarReader) read() (statEntry, error) {
+	for {
+		hdr, err := r.r.Next()
+		if err == io.EOF {
+			return statEntry{}, err
+		} else if err != nil {
+			return statEntry{}, fmt.Errorf("advance read position failed: %s", err)
+		}
+
+		// All files before the header have been processed.
+		r.offset = r.pos
+		r.pos += tarBlockSize + (hdr.Size+tarBlockSize-1)/tarBlockSize*tarBlockSize
+
+		e, ok, err := r.readFile(hdr)
+		if err == io.EOF {
+			r.ended = true
+			return statEntry{}, err
+		}
+		if err != nil {
+			return statEntry{}, err
+		}
+		if !ok {
+			continue
+		}
+
+		r.offset = r.pos
+		return e, nil
+	}
+}
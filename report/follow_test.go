@@ -0,0 +1,305 @@
+package report
+
+import (
+	"archive/tar"
+	"bytes"
+	"database/sql"
+	"encoding/json"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"os"
+	"testing"
+	"time"
+)
+
+// followTestStart defines time of the first snapshot written in follow tests.
+var followTestStart = time.Date(2021, 1, 23, 15, 31, 0, 0, time.Local)
+
+// newFollowTestStat returns snapshot with value of the single row equal to passed number.
+func newFollowTestStat(n int) stat.PGresult {
+	return stat.NewPGresultFromValues(
+		[]string{"datname", "xact_commit"},
+		[][]sql.NullString{{{String: "postgres", Valid: true}, {String: fmt.Sprint(n), Valid: true}}},
+	)
+}
+
+// writeFollowTestFile writes snapshot with passed number into tar archive.
+func writeFollowTestFile(t *testing.T, tw *tar.Writer, name string, n int) {
+	data, err := json.Marshal(newFollowTestStat(n))
+	assert.NoError(t, err)
+
+	ts := followTestStart.Add(time.Duration(n) * time.Second)
+	hdr := &tar.Header{Name: fmt.Sprintf("%s.%s.json", name, ts.Format("20060102T150405")), Mode: 0644, Size: int64(len(data)), ModTime: ts}
+	assert.NoError(t, tw.WriteHeader(hdr))
+	_, err = tw.Write(data)
+	assert.NoError(t, err)
+	assert.NoError(t, tw.Flush())
+}
+
+// readFollowTestStats reads snapshots and sends their numbers, channel is closed when reading stops.
+func readFollowTestStats(t *testing.T, r statReader) <-chan int {
+	ch := make(chan int, 100)
+	go func() {
+		defer close(ch)
+		for {
+			e, err := r.next()
+			if err == io.EOF {
+				return
+			}
+			if !assert.NoError(t, err) {
+				return
+			}
+			assert.NoError(t, e.decode())
+			ch <- int(e.res.Columns[1].Int[0])
+		}
+	}()
+	return ch
+}
+
+// receiveFollowTestStats receives numbers of snapshots.
+func receiveFollowTestStats(t *testing.T, ch <-chan int, n int) []int {
+	var got []int
+	for i := 0; i < n; i++ {
+		select {
+		case v := <-ch:
+			got = append(got, v)
+		case <-time.After(5 * time.Second):
+			t.Fatalf("snapshots are not received, got %v", got)
+		}
+	}
+	return got
+}
+
+func Test_followTarReader(t *testing.T) {
+	defer func(d time.Duration) { followInterval = d }(followInterval)
+	followInterval = 10 * time.Millisecond
+
+	filename := "/tmp/pgcenter-report-follow-testing.stat.tar"
+	w, err := os.Create(filename)
+	assert.NoError(t, err)
+	defer func() { _ = os.Remove(filename) }()
+
+	tw := tar.NewWriter(w)
+	writeFollowTestFile(t, tw, "databases", 1)
+	writeFollowTestFile(t, tw, "tables", 2)
+	writeFollowTestFile(t, tw, "databases", 3)
+
+	f, err := os.Open(filename)
+	assert.NoError(t, err)
+	defer func() { _ = f.Close() }()
+
+	done := make(chan struct{})
+	config := Config{ReportType: "databases", TsEnd: followTestStart.Add(time.Hour)}
+	r, err := newFollowStatReader(f, config, done)
+	assert.NoError(t, err)
+	ch := readFollowTestStats(t, r)
+
+	// Recorded stats are read.
+	assert.Equal(t, []int{1, 3}, receiveFollowTestStats(t, ch, 2))
+
+	// Appended stats are read.
+	writeFollowTestFile(t, tw, "databases", 4)
+	writeFollowTestFile(t, tw, "databases", 5)
+	assert.Equal(t, []int{4, 5}, receiveFollowTestStats(t, ch, 2))
+
+	// Recording is stopped and resumed - trailer is written over.
+	offset, err := w.Seek(0, io.SeekCurrent)
+	assert.NoError(t, err)
+	assert.NoError(t, tw.Close())
+	time.Sleep(5 * followInterval)
+
+	assert.NoError(t, w.Truncate(offset))
+	_, err = w.Seek(offset, io.SeekStart)
+	assert.NoError(t, err)
+	tw = tar.NewWriter(w)
+	writeFollowTestFile(t, tw, "databases", 6)
+	assert.Equal(t, []int{6}, receiveFollowTestStats(t, ch, 1))
+
+	// Torn file is truncated and written over when recording is resumed.
+	offset, err = w.Seek(0, io.SeekCurrent)
+	assert.NoError(t, err)
+
+	var buf bytes.Buffer
+	writeFollowTestFile(t, tar.NewWriter(&buf), "databases", 7)
+	_, err = w.Write(buf.Bytes()[:buf.Len()-tarBlockSize])
+	assert.NoError(t, err)
+	time.Sleep(5 * followInterval)
+
+	assert.NoError(t, w.Truncate(offset))
+	_, err = w.Seek(offset, io.SeekStart)
+	assert.NoError(t, err)
+	time.Sleep(5 * followInterval)
+
+	tw = tar.NewWriter(w)
+	writeFollowTestFile(t, tw, "databases", 8)
+	writeFollowTestFile(t, tw, "databases", 9)
+	assert.Equal(t, []int{8, 9}, receiveFollowTestStats(t, ch, 2))
+
+	// Reading stops when following is stopped.
+	close(done)
+	_, ok := <-ch
+	assert.False(t, ok)
+	assert.NoError(t, w.Close())
+}
+
+func Test_followStatReader_end(t *testing.T) {
+	defer func(d time.Duration) { followInterval = d }(followInterval)
+	followInterval = 10 * time.Millisecond
+
+	config := Config{ReportType: "databases", TsEnd: followTestStart.Add(2 * time.Second)}
+
+	// Tar archive.
+	filename := "/tmp/pgcenter-report-follow-testing.stat.tar"
+	w, err := os.Create(filename)
+	assert.NoError(t, err)
+	defer func() { _ = os.Remove(filename) }()
+
+	tw := tar.NewWriter(w)
+	writeFollowTestFile(t, tw, "databases", 1)
+	writeFollowTestFile(t, tw, "databases", 2)
+
+	f, err := os.Open(filename)
+	assert.NoError(t, err)
+	defer func() { _ = f.Close() }()
+
+	r, err := newFollowStatReader(f, config, nil)
+	assert.NoError(t, err)
+	ch := readFollowTestStats(t, r)
+	assert.Equal(t, []int{1, 2}, receiveFollowTestStats(t, ch, 2))
+
+	// Reading stops when stats recorded after the end of interval are appended, following is not stopped explicitly.
+	writeFollowTestFile(t, tw, "databases", 3)
+	writeFollowTestFile(t, tw, "databases", 4)
+	select {
+	case v, ok := <-ch:
+		assert.False(t, ok, v)
+	case <-time.After(5 * time.Second):
+		t.Fatal("reading is not stopped after the end of interval")
+	}
+	assert.NoError(t, w.Close())
+
+	// Binary file.
+	filename = "/tmp/pgcenter-report-follow-testing.stat"
+	w, err = os.Create(filename)
+	assert.NoError(t, err)
+	defer func() { _ = os.Remove(filename) }()
+
+	_, err = w.WriteString(snapshot.Magic)
+	assert.NoError(t, err)
+	sw := snapshot.NewWriter(w)
+	assert.NoError(t, sw.StartSegment())
+	assert.NoError(t, sw.Write("databases", followTestStart.Add(time.Second), newFollowTestStat(1)))
+
+	f, err = os.Open(filename)
+	assert.NoError(t, err)
+	defer func() { _ = f.Close() }()
+
+	r, err = newFollowStatReader(f, config, nil)
+	assert.NoError(t, err)
+	ch = readFollowTestStats(t, r)
+	assert.Equal(t, []int{1}, receiveFollowTestStats(t, ch, 1))
+
+	assert.NoError(t, sw.Write("databases", followTestStart.Add(3*time.Second), newFollowTestStat(3)))
+	select {
+	case v, ok := <-ch:
+		assert.False(t, ok, v)
+	case <-time.After(5 * time.Second):
+		t.Fatal("reading is not stopped after the end of interval")
+	}
+	assert.NoError(t, w.Close())
+}
+
+func Test_followTarReader_truncated(t *testing.T) {
+	defer func(d time.Duration) { followInterval = d }(followInterval)
+	followInterval = 10 * time.Millisecond
+
+	filename := "/tmp/pgcenter-report-follow-testing.stat.tar"
+	w, err := os.Create(filename)
+	assert.NoError(t, err)
+	defer func() { _ = os.Remove(filename) }()
+
+	tw := tar.NewWriter(w)
+	writeFollowTestFile(t, tw, "databases", 1)
+	writeFollowTestFile(t, tw, "databases", 2)
+
+	f, err := os.Open(filename)
+	assert.NoError(t, err)
+	defer func() { _ = f.Close() }()
+
+	r, err := newFollowStatReader(f, Config{ReportType: "databases", TsEnd: followTestStart.Add(time.Hour)}, nil)
+	assert.NoError(t, err)
+
+	for i := 0; i < 2; i++ {
+		_, err = r.next()
+		assert.NoError(t, err)
+	}
+
+	// File is recorded from scratch, already read stats are lost.
+	assert.NoError(t, w.Truncate(0))
+	_, err = r.next()
+	assert.Error(t, err)
+	assert.NoError(t, w.Close())
+}
+
+func Test_followReader_binary(t *testing.T) {
+	defer func(d time.Duration) { followInterval = d }(followInterval)
+	followInterval = 10 * time.Millisecond
+
+	filename := "/tmp/pgcenter-report-follow-testing.stat"
+	w, err := os.Create(filename)
+	assert.NoError(t, err)
+	defer func() { _ = os.Remove(filename) }()
+
+	_, err = w.WriteString(snapshot.Magic)
+	assert.NoError(t, err)
+	sw := snapshot.NewWriter(w)
+	assert.NoError(t, sw.StartSegment())
+	assert.NoError(t, sw.Write("databases", followTestStart.Add(time.Second), newFollowTestStat(1)))
+
+	f, err := os.Open(filename)
+	assert.NoError(t, err)
+	defer func() { _ = f.Close() }()
+
+	done := make(chan struct{})
+	r, err := newFollowStatReader(f, Config{ReportType: "databases", TsEnd: followTestStart.Add(time.Hour)}, done)
+	assert.NoError(t, err)
+	ch := readFollowTestStats(t, r)
+	assert.Equal(t, []int{1}, receiveFollowTestStats(t, ch, 1))
+
+	// Appended stats are read.
+	assert.NoError(t, sw.Write("databases", followTestStart.Add(2*time.Second), newFollowTestStat(2)))
+	assert.Equal(t, []int{2}, receiveFollowTestStats(t, ch, 1))
+
+	// Recorder crashed while writing a frame, then recovered: torn tail is truncated and new segment is appended.
+	torn := &bytes.Buffer{}
+	tw := snapshot.NewWriter(torn)
+	assert.NoError(t, tw.StartSegment())
+	assert.NoError(t, tw.Write("databases", followTestStart.Add(3*time.Second), newFollowTestStat(3)))
+	_, err = w.Write(torn.Bytes()[:torn.Len()-2])
+	assert.NoError(t, err)
+	time.Sleep(5 * followInterval)
+
+	_, err = w.Seek(0, io.SeekStart)
+	assert.NoError(t, err)
+	offset, err := snapshot.Recover(w)
+	assert.NoError(t, err)
+	assert.NoError(t, w.Truncate(offset))
+	_, err = w.Seek(offset, io.SeekStart)
+	assert.NoError(t, err)
+	sw = snapshot.NewWriter(w)
+	assert.NoError(t, sw.StartSegment())
+	assert.NoError(t, sw.Write("databases", followTestStart.Add(4*time.Second), newFollowTestStat(4)))
+	assert.Equal(t, []int{4}, receiveFollowTestStats(t, ch, 1))
+
+	// Appended stats are read after recovery.
+	assert.NoError(t, sw.Write("databases", followTestStart.Add(5*time.Second), newFollowTestStat(5)))
+	assert.Equal(t, []int{5}, receiveFollowTestStats(t, ch, 1))
+
+	close(done)
+	_, ok := <-ch
+	assert.False(t, ok)
+	assert.NoError(t, w.Close())
+}
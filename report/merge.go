@@ -0,0 +1,120 @@
+package report
+
+import (
+	"container/heap"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"io"
+)
+
+// mergeSource is the reader of the single statistics file merged with others.
+type mergeSource struct {
+	r     statReader
+	host  int       // number of the file
+	entry statEntry // the next snapshot of the file
+}
+
+// mergeHeap is the min-heap of sources ordered by time of their next snapshots, sources with snapshots of the same time
+// are ordered by number of the file.
+type mergeHeap []*mergeSource
+
+func (h mergeHeap) Len() int { return len(h) }
+
+func (h mergeHeap) Less(i, j int) bool {
+	if !h[i].entry.ts.Equal(h[j].entry.ts) {
+		return h[i].entry.ts.Before(h[j].entry.ts)
+	}
+	return h[i].host < h[j].host
+}
+
+func (h mergeHeap) Swap(i, j int) { h[i], h[j] = h[j], h[i] }
+
+func (h *mergeHeap) Push(x interface{}) { *h = append(*h, x.(*mergeSource)) }
+
+func (h *mergeHeap) Pop() interface{} {
+	old := *h
+	n := len(old)
+	s := old[n-1]
+	*h = old[:n-1]
+	return s
+}
+
+// mergeStatReader merges snapshots of several statistics files in order of time, every snapshot is tagged with the
+// number of its file. Files are read in streaming manner, only the next snapshot of every file is kept in memory.
+type mergeStatReader struct {
+	h mergeHeap
+}
+
+// newMergeStatReader creates reader which merges snapshots of passed readers.
+func newMergeStatReader(readers []statReader) (*mergeStatReader, error) {
+	r := &mergeStatReader{h: make(mergeHeap, 0, len(readers))}
+
+	for i, sr := range readers {
+		s := &mergeSource{r: sr, host: i}
+		ok, err := s.read()
+		if err != nil {
+			return nil, err
+		}
+		if ok {
+			r.h = append(r.h, s)
+		}
+	}
+	heap.Init(&r.h)
+
+	return r, nil
+}
+
+// read reads the next snapshot of the source, returns false at the end of the file.
+func (s *mergeSource) read() (bool, error) {
+	e, err := s.r.next()
+	if err == io.EOF {
+		return false, nil
+	}
+	if err != nil {
+		return false, err
+	}
+
+	e.host = s.host
+	s.entry = e
+	return true, nil
+}
+
+// next returns the earliest of the next snapshots of files.
+func (r *mergeStatReader) next() (statEntry, error) {
+	if len(r.h) == 0 {
+		return statEntry{}, io.EOF
+	}
+
+	s := r.h[0]
+	e := s.entry
+
+	ok, err := s.read()
+	if err != nil {
+		return statEntry{}, err
+	}
+	if ok {
+		heap.Fix(&r.h, 0)
+	} else {
+		heap.Pop(&r.h)
+	}
+
+	return e, nil
+}
+
+// addHostColumn returns result with the leading column which contains label of the host for every row.
+func addHostColumn(res stat.PGresult, host string) stat.PGresult {
+	out := res
+	out.Cols = make([]string, 0, res.Ncols+1)
+	out.Cols = append(out.Cols, "host")
+	out.Cols = append(out.Cols, res.Cols...)
+	out.Ncols = res.Ncols + 1
+
+	labels := make([]string, res.Nrows)
+	for i := range labels {
+		labels[i] = host
+	}
+	out.Columns = make([]stat.Column, 0, res.Ncols+1)
+	out.Columns = append(out.Columns, stat.Column{Type: stat.TextColumn, Text: labels})
+	out.Columns = append(out.Columns, res.Columns...)
+
+	return out
+}
@@ -0,0 +1,110 @@
+package report
+
+import (
+	"bytes"
+	"database/sql"
+	"encoding/csv"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"testing"
+	"time"
+)
+
+func Test_mergeStatReader(t *testing.T) {
+	start := time.Date(2021, 1, 23, 15, 0, 0, 0, time.Local)
+	newEntries := func(minutes ...int) []statEntry {
+		entries := make([]statEntry, len(minutes))
+		for i, m := range minutes {
+			entries[i] = statEntry{report: "databases", ts: start.Add(time.Duration(m) * time.Minute)}
+		}
+		return entries
+	}
+
+	// Snapshots are ordered by time, snapshots of the same time are ordered by number of the file.
+	r, err := newMergeStatReader([]statReader{
+		&testStatReader{entries: newEntries(0, 2, 4), err: io.EOF},
+		&testStatReader{entries: newEntries(1, 2, 3, 5, 6), err: io.EOF},
+		&testStatReader{err: io.EOF},
+	})
+	assert.NoError(t, err)
+
+	var got []int
+	for {
+		e, err := r.next()
+		if err == io.EOF {
+			break
+		}
+		assert.NoError(t, err)
+		got = append(got, int(e.ts.Sub(start)/time.Minute)*10+e.host)
+	}
+	assert.Equal(t, []int{0, 11, 20, 21, 31, 40, 51, 61}, got)
+
+	// Errors of any file are returned.
+	r, err = newMergeStatReader([]statReader{
+		&testStatReader{entries: newEntries(0, 2), err: io.EOF},
+		&testStatReader{entries: newEntries(1), err: fmt.Errorf("broken archive")},
+	})
+	assert.NoError(t, err)
+	for err == nil {
+		_, err = r.next()
+	}
+	assert.NotEqual(t, io.EOF, err)
+}
+
+func Test_addHostColumn(t *testing.T) {
+	res := stat.NewPGresultFromValues(
+		[]string{"datname", "xact_commit"},
+		[][]sql.NullString{{{String: "app", Valid: true}, {String: "10", Valid: true}}, {{String: "db", Valid: true}, {String: "5", Valid: true}}},
+	)
+
+	got := addHostColumn(res, "replica")
+	assert.Equal(t, []string{"host", "datname", "xact_commit"}, got.Cols)
+	assert.Equal(t, 3, got.Ncols)
+	assert.Equal(t, 2, got.Nrows)
+	assert.Equal(t, []string{"replica", "replica"}, got.Columns[0].Text)
+	assert.Equal(t, "10", got.Value(0, 2))
+
+	// Source result is not modified.
+	assert.Equal(t, []string{"datname", "xact_commit"}, res.Cols)
+}
+
+func Test_app_doReport_merge(t *testing.T) {
+	config := Config{ReportType: "tables", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now(), Workers: 2, Format: formatCSV}
+	entries := readTestEntries(t, config)
+	assert.Greater(t, len(entries), 2)
+
+	report := func(c Config, r statReader) [][]string {
+		app := newApp(c)
+		var buf bytes.Buffer
+		app.writer = &buf
+		assert.NoError(t, app.doReport(r))
+
+		records, err := csv.NewReader(&buf).ReadAll()
+		assert.NoError(t, err)
+		return records
+	}
+
+	want := report(config, &testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF})
+
+	// Both hosts recorded the same stats, deltas of every host are the same as deltas of the single file.
+	config.Hosts = []string{"primary", "replica"}
+	r, err := newMergeStatReader([]statReader{
+		&testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF},
+		&testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF},
+	})
+	assert.NoError(t, err)
+	got := report(config, r)
+
+	assert.Equal(t, append([]string{"timestamp", "host"}, want[0][1:]...), got[0])
+
+	hosts := map[string][][]string{}
+	for _, rec := range got[1:] {
+		hosts[rec[1]] = append(hosts[rec[1]], append([]string{rec[0]}, rec[2:]...))
+	}
+	assert.Len(t, hosts, 2)
+	for _, host := range config.Hosts {
+		assert.Equal(t, want[1:], hosts[host])
+	}
+}
@@ -0,0 +1,318 @@
+package report
+
+import (
+	"bufio"
+	"github.com/lesovsky/pgcenter/internal/align"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/lesovsky/pgcenter/internal/view"
+	"io"
+	"sync"
+)
+
+// reportItem is a stats snapshot passed through stages of report pipeline.
+type reportItem struct {
+	seq   int            // sequence number of the item, defines order of items
+	entry statEntry      // snapshot read from statistics file
+	index *stat.RowIndex // index of snapshot rows
+	diff  stat.PGresult  // delta between the snapshot and the previous one
+	view  view.View      // view used for formatting the delta
+	out   *align.Table   // formatted delta
+	lines int            // number of formatted lines
+	err   error          // error occurred at processing, the following items are not processed
+}
+
+// readStats reads stats snapshots and sends them in order of reading. Reading stops at the first error, error is
+// sent as the last item.
+func (app *app) readStats(r statReader, size int, done <-chan struct{}) <-chan *reportItem {
+	out := make(chan *reportItem, size)
+
+	go func() {
+		defer close(out)
+
+		for seq := 0; ; seq++ {
+			e, err := r.next()
+			if err == io.EOF {
+				return
+			}
+
+			select {
+			case out <- &reportItem{seq: seq, entry: e, err: err}:
+			case <-done:
+				return
+			}
+
+			if err != nil {
+				return
+			}
+		}
+	}()
+
+	return out
+}
+
+// decodeStat decodes the snapshot and indexes its rows.
+func (app *app) decodeStat(item *reportItem) {
+	item.err = item.entry.decode()
+	if item.err != nil {
+		return
+	}
+
+	item.index = newRowIndex(item.entry.res, app.view)
+}
+
+// diffStats calculates deltas between consecutive snapshots in order of their reading. Items with deltas are sent with
+// new sequence numbers, item with error is sent as the last one. Snapshots of merged files are diffed with snapshots of
+// the same file, deltas are labeled with the host of the file.
+func (app *app) diffStats(in <-chan *reportItem, done <-chan struct{}) <-chan *reportItem {
+	out := make(chan *reportItem, cap(in))
+
+	go func() {
+		defer close(out)
+
+		var prevs = map[int]*reportItem{} // previous snapshots of every merged file
+		var orderConfigured = false       // flag tells about order is not configured.
+		var filter *stat.Filter
+		var filterCompiled = false
+		var seq int
+
+		c := app.config
+		v := app.view
+
+		send := func(item *reportItem) bool {
+			item.seq = seq
+			seq++
+			select {
+			case out <- item:
+				return true
+			case <-done:
+				return false
+			}
+		}
+
+		for items := range reorder(in, done) {
+			for _, curr := range items {
+				if curr.err != nil {
+					send(curr)
+					return
+				}
+
+				// if previous stats snapshot is not defined, use current as previous.
+				// Usually this occurs when reading first stat sample at startup.
+				prev := prevs[curr.entry.host]
+				if prev == nil {
+					prevs[curr.entry.host] = curr
+					continue
+				}
+
+				// Calculate time interval. Snapshots recorded at the same time can't be diffed, e.g. snapshots appended
+				// into tar archive within the same second.
+				interval := curr.entry.ts.Sub(prev.entry.ts)
+				if interval <= 0 {
+					continue
+				}
+
+				// When first data read, list of columns is known and it is possible to set up order.
+				if c.OrderColName != "" && !orderConfigured {
+					if idx, ok := getColumnIndex(curr.entry.res.Cols, c.OrderColName); ok {
+						v.OrderKey = idx
+						v.OrderDesc = c.OrderDesc
+						orderConfigured = true
+					}
+				}
+
+				// When first data read, list of columns is known and filter could be compiled.
+				if !filterCompiled {
+					filter, curr.err = c.Filter.Compile(curr.entry.res.Cols, v.DiffIntvl)
+					if curr.err != nil {
+						send(curr)
+						return
+					}
+					filterCompiled = true
+				}
+
+				// Calculate delta between current and previous stats snapshots, filtered rows are not diffed.
+				curr.diff, curr.err = countDiff(curr.entry.res, prev.entry.res, prev.index, rateInterval(interval, c.Rate), v, filter)
+				if curr.err != nil {
+					send(curr)
+					return
+				}
+
+				if len(c.Hosts) > 1 {
+					curr.diff = addHostColumn(curr.diff, c.Hosts[curr.entry.host])
+				}
+
+				// Columns are aligned using the first delta.
+				formatStatSample(&curr.diff, &v, c)
+				curr.view = v
+
+				// Swap previous with current
+				prevs[curr.entry.host] = curr
+
+				if !send(curr) {
+					return
+				}
+			}
+		}
+	}()
+
+	return out
+}
+
+// tablePool keeps tables used for formatting deltas, memory of tables is reused between snapshots.
+var tablePool = sync.Pool{
+	New: func() interface{} { return align.NewTable(false) },
+}
+
+// formatStat formats the delta.
+func (app *app) formatStat(item *reportItem) {
+	item.out = tablePool.Get().(*align.Table)
+	item.out.Reset()
+	if app.config.Format != formatTable {
+		item.lines = renderExportSample(item.out, &item.diff, app.config, item.entry.ts)
+		return
+	}
+	item.lines = renderStatSample(item.out, &item.diff, item.view, app.config, item.entry.ts)
+}
+
+// printStats prints formatted deltas in order of snapshots through buffered writer. Printing stops at the first item
+// with error. Exported stats are printed without periodic headers.
+func (app *app) printStats(in <-chan *reportItem, done <-chan struct{}) error {
+	var linesPrinted = repeatHeaderAfter // initial value means print header at the beginning of all output
+	var export = app.config.Format != formatTable
+
+	w := bufio.NewWriter(app.writer)
+
+	err := func() error {
+		for items := range reorder(in, done) {
+			for _, item := range items {
+				if item.err != nil {
+					return item.err
+				}
+
+				if export {
+					err := app.printExportHeader(w, linesPrinted, item)
+					if err != nil {
+						return err
+					}
+					linesPrinted = 0
+				} else {
+					// print header after every Nth lines
+					var err error
+					linesPrinted, err = printStatHeader(w, linesPrinted, item.view)
+					if err != nil {
+						return err
+					}
+				}
+
+				// print the stats - calculated delta between previous and current stats snapshots
+				_, err := item.out.WriteTo(w)
+				tablePool.Put(item.out)
+				item.out = nil
+				if err != nil {
+					return err
+				}
+				linesPrinted += item.lines
+			}
+
+			// When following the file, stats are printed as soon as they arrive.
+			if app.config.Follow {
+				err := w.Flush()
+				if err != nil {
+					return err
+				}
+			}
+		}
+		return nil
+	}()
+
+	// Output printed before error is kept.
+	ferr := w.Flush()
+	if err != nil {
+		return err
+	}
+
+	return ferr
+}
+
+// printExportHeader prints header of exported stats at the beginning of the output.
+func (app *app) printExportHeader(w io.Writer, printedNum int, item *reportItem) error {
+	if printedNum < repeatHeaderAfter {
+		return nil
+	}
+
+	t := align.NewTable(false)
+	renderExportHeader(t, item.diff.Cols, app.config.Format)
+	_, err := t.WriteTo(w)
+	return err
+}
+
+// parallelStage processes items using passed number of parallel workers. Items are sent in order of their processing,
+// items with errors are passed as is.
+func parallelStage(in <-chan *reportItem, workers int, done <-chan struct{}, fn func(item *reportItem)) <-chan *reportItem {
+	out := make(chan *reportItem, workers)
+
+	var wg sync.WaitGroup
+	wg.Add(workers)
+	for i := 0; i < workers; i++ {
+		go func() {
+			defer wg.Done()
+			for item := range in {
+				if item.err == nil {
+					fn(item)
+				}
+
+				select {
+				case out <- item:
+				case <-done:
+					return
+				}
+			}
+		}()
+	}
+
+	go func() {
+		wg.Wait()
+		close(out)
+	}()
+
+	return out
+}
+
+// reorder restores order of items processed by parallel workers. Items are sent in batches of consecutive items.
+func reorder(in <-chan *reportItem, done <-chan struct{}) <-chan []*reportItem {
+	out := make(chan []*reportItem)
+
+	go func() {
+		defer close(out)
+
+		pending := map[int]*reportItem{}
+		var next int
+
+		for item := range in {
+			pending[item.seq] = item
+
+			var items []*reportItem
+			for {
+				ready, ok := pending[next]
+				if !ok {
+					break
+				}
+				delete(pending, next)
+				items = append(items, ready)
+				next++
+			}
+
+			if len(items) == 0 {
+				continue
+			}
+
+			select {
+			case out <- items:
+			case <-done:
+				return
+			}
+		}
+	}()
+
+	return out
+}
@@ -0,0 +1,160 @@
+package report
+
+import (
+	"bytes"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"os"
+	"strings"
+	"testing"
+	"time"
+)
+
+// testStatReader returns passed stats snapshots and then error.
+type testStatReader struct {
+	entries []statEntry
+	err     error
+}
+
+func (r *testStatReader) next() (statEntry, error) {
+	if len(r.entries) == 0 {
+		return statEntry{}, r.err
+	}
+
+	e := r.entries[0]
+	r.entries = r.entries[1:]
+	return e, nil
+}
+
+// readTestEntries reads raw stats snapshots of the report from tar archive.
+func readTestEntries(t *testing.T, config Config) []statEntry {
+	f, err := os.Open("testdata/pgcenter.stat.golden.tar")
+	assert.NoError(t, err)
+	defer func() { _ = f.Close() }()
+
+	r, err := newStatReader(f, config)
+	assert.NoError(t, err)
+
+	var entries []statEntry
+	for {
+		e, err := r.next()
+		if err == io.EOF {
+			break
+		}
+		assert.NoError(t, err)
+		entries = append(entries, e)
+	}
+
+	return entries
+}
+
+func Test_app_doReport_workers(t *testing.T) {
+	config := Config{ReportType: "tables", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now()}
+	entries := readTestEntries(t, config)
+	assert.Greater(t, len(entries), 2)
+
+	var want string
+	for _, workers := range []int{1, 2, 8, 64} {
+		config.Workers = workers
+		app := newApp(config)
+		var buf bytes.Buffer
+		app.writer = &buf
+
+		assert.NoError(t, app.doReport(&testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF}))
+		if want == "" {
+			want = buf.String()
+		}
+		assert.Equal(t, want, buf.String())
+	}
+}
+
+func Test_app_doReport_error(t *testing.T) {
+	config := Config{ReportType: "tables", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now(), Workers: 4}
+	entries := readTestEntries(t, config)
+	assert.Greater(t, len(entries), 4)
+
+	// Report of the first three snapshots.
+	app := newApp(config)
+	var want bytes.Buffer
+	app.writer = &want
+	assert.NoError(t, app.doReport(&testStatReader{entries: append([]statEntry{}, entries[:3]...), err: io.EOF}))
+
+	testcases := []struct {
+		name   string
+		reader statReader
+	}{
+		{
+			name:   "read error",
+			reader: &testStatReader{entries: append([]statEntry{}, entries[:3]...), err: fmt.Errorf("read failed")},
+		},
+		{
+			name: "decode error",
+			reader: &testStatReader{
+				entries: append(append([]statEntry{}, entries[:3]...), statEntry{ts: entries[3].ts, data: []byte("invalid")}, entries[4]),
+				err:     io.EOF,
+			},
+		},
+	}
+
+	// Snapshots read before error are printed.
+	for _, tc := range testcases {
+		t.Run(tc.name, func(t *testing.T) {
+			app := newApp(config)
+			var buf bytes.Buffer
+			app.writer = &buf
+
+			assert.Error(t, app.doReport(tc.reader))
+			assert.Equal(t, want.String(), buf.String())
+		})
+	}
+}
+
+func Test_reorder(t *testing.T) {
+	in := make(chan *reportItem, 10)
+	for _, seq := range []int{2, 0, 1, 5, 3, 4} {
+		in <- &reportItem{seq: seq}
+	}
+	close(in)
+
+	var got []int
+	for items := range reorder(in, nil) {
+		for _, item := range items {
+			got = append(got, item.seq)
+		}
+	}
+	assert.Equal(t, []int{0, 1, 2, 3, 4, 5}, got)
+}
+
+func Test_app_doReport_filter(t *testing.T) {
+	config := Config{ReportType: "databases", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now()}
+	entries := readTestEntries(t, config)
+
+	filter, err := stat.ParseFilter("datname = postgres AND commits > 0")
+	assert.NoError(t, err)
+	config.Filter = filter
+
+	app := newApp(config)
+	var buf bytes.Buffer
+	app.writer = &buf
+	assert.NoError(t, app.doReport(&testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF}))
+
+	// Only rows satisfying the filter are printed.
+	var printed int
+	for _, line := range strings.Split(strings.TrimSpace(buf.String()), "\n") {
+		if strings.Contains(line, "datname") {
+			continue // header
+		}
+		assert.Contains(t, strings.Fields(line), "postgres")
+		printed++
+	}
+	assert.Greater(t, printed, 0)
+
+	// Filter using unknown column.
+	config.Filter, err = stat.ParseFilter("unknown = 1")
+	assert.NoError(t, err)
+	app = newApp(config)
+	app.writer = &buf
+	assert.Error(t, app.doReport(&testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF}))
+}
@@ -0,0 +1,276 @@
+package report
+
+import (
+	"archive/tar"
+	"bufio"
+	"encoding/json"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/index"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"io"
+	"os"
+	"strings"
+	"time"
+)
+
+// statReader reads stats snapshots of requested report type recorded within requested interval.
+type statReader interface {
+	// next returns next stats snapshot, io.EOF is returned when no more snapshots.
+	next() (statEntry, error)
+}
+
+// statEntry is a stats snapshot read from statistics file. Snapshots read from tar archives are returned as raw JSON
+// data, decoding could be done separately from reading.
+type statEntry struct {
+	report string        // type of the report which snapshot belongs to
+	ts     time.Time     // time when snapshot has been recorded
+	data   []byte        // raw JSON data of snapshot, nil if snapshot has been decoded
+	res    stat.PGresult // decoded snapshot
+	window int           // number of compared window which snapshot belongs to
+	host   int           // number of merged file which snapshot has been read from
+}
+
+// decode unmarshals raw data of the snapshot.
+func (e *statEntry) decode() error {
+	if e.data == nil {
+		return nil
+	}
+
+	err := json.Unmarshal(e.data, &e.res)
+	e.data = nil
+	return err
+}
+
+// newStatReader creates reader of statistics file. Format of the file is detected using its header, files in binary
+// snapshot format and tar archives with JSON files are supported. When the file has time index, reading starts at the
+// position of stats recorded at the beginning of requested interval and stops after the end of interval. When following
+// is requested, stats appended to the file by recorder are read until the program is stopped.
+func newStatReader(r io.Reader, c Config) (statReader, error) {
+	if c.Follow {
+		f, ok := r.(*os.File)
+		if !ok {
+			return nil, fmt.Errorf("following is supported only for files")
+		}
+		return newFollowStatReader(f, c, nil)
+	}
+
+	br := bufio.NewReader(r)
+
+	header, err := br.Peek(len(snapshot.Magic))
+	if err != nil && err != io.EOF {
+		return nil, err
+	}
+
+	offset, indexed := lookupIndex(r, c)
+	if offset > 0 {
+		_, err = r.(io.Seeker).Seek(offset, io.SeekStart)
+		if err != nil {
+			return nil, err
+		}
+		br.Reset(r)
+	}
+
+	reports := map[string]bool{}
+	for _, report := range c.reportTypes() {
+		reports[report] = true
+	}
+
+	if snapshot.IsSnapshotFile(header) {
+		var sr *snapshot.Reader
+		if offset > 0 {
+			sr = snapshot.NewSegmentReader(br)
+		} else {
+			sr, err = snapshot.NewReader(br)
+			if err != nil {
+				return nil, err
+			}
+		}
+		sr.SetViews(c.reportTypes()...)
+		return &binaryStatReader{r: sr, reports: reports, start: c.TsStart, end: c.TsEnd, stop: indexed}, nil
+	}
+
+	return &tarStatReader{r: tar.NewReader(br), reports: reports, start: c.TsStart, end: c.TsEnd, stop: indexed}, nil
+}
+
+// lookupIndex looks up time index of the statistics file and returns offset where reading of requested stats could be
+// started. Returns false if the file has no valid index.
+func lookupIndex(r io.Reader, c Config) (int64, bool) {
+	f, ok := r.(*os.File)
+	if !ok {
+		return 0, false
+	}
+
+	st, err := f.Stat()
+	if err != nil {
+		return 0, false
+	}
+
+	// Reading starts at the position of the earliest of requested reports.
+	var offset int64 = -1
+	for _, report := range c.reportTypes() {
+		o, err := index.Lookup(index.Filename(f.Name()), report, c.TsStart, st.Size())
+		if err != nil {
+			return 0, false
+		}
+
+		if offset < 0 || o < offset {
+			offset = o
+		}
+	}
+
+	return offset, true
+}
+
+// tarStatReader reads stats snapshots from tar archive with JSON files.
+type tarStatReader struct {
+	r       *tar.Reader
+	reports map[string]bool // requested types of reports
+	start   time.Time
+	end     time.Time
+	stop    bool // stop reading after the end of interval, stats are recorded in chronological order
+}
+
+// next reads files headers continuously, reads stats files requested by user and skips others.
+func (r *tarStatReader) next() (statEntry, error) {
+	for {
+		hdr, err := r.r.Next()
+		if err == io.EOF {
+			return statEntry{}, err
+		} else if err != nil {
+			return statEntry{}, fmt.Errorf("advance read position failed: %s", err)
+		}
+
+		e, ok, err := r.readFile(hdr)
+		if err != nil {
+			return statEntry{}, err
+		}
+		if ok {
+			return e, nil
+		}
+	}
+}
+
+// readFile reads content of the current file if it is requested by user. Returns false if the file is skipped.
+func (r *tarStatReader) readFile(hdr *tar.Header) (statEntry, bool, error) {
+	// Check filename - it has valid format and corresponds to requested report type.
+	report := strings.SplitN(hdr.Name, ".", 2)[0]
+	if !r.reports[report] {
+		return statEntry{}, false, nil
+	}
+
+	err := isFilenameOK(hdr.Name, report)
+	if err != nil {
+		return statEntry{}, false, nil
+	}
+
+	// Check timestamp in filename, is it correct and is in requested report interval.
+	ts, err := isFilenameTimestampOK(hdr.Name, r.start, r.end)
+	if err != nil {
+		if r.stop && isFilenameAfter(hdr.Name, r.end) {
+			return statEntry{}, false, io.EOF
+		}
+		return statEntry{}, false, nil
+	}
+
+	// Read content of the file, it is decoded later.
+	data, err := readFileData(r.r, hdr.Size)
+	if err != nil {
+		return statEntry{}, false, err
+	}
+
+	return statEntry{report: report, ts: ts, data: data}, true, nil
+}
+
+// binaryStatReader reads stats snapshots from file in binary snapshot format.
+type binaryStatReader struct {
+	r       *snapshot.Reader
+	reports map[string]bool // requested types of reports
+	start   time.Time
+	end     time.Time
+	stop    bool // stop reading after the end of interval, stats are recorded in chronological order
+}
+
+// next reads snapshots continuously, decodes snapshots requested by user and skips others.
+func (r *binaryStatReader) next() (statEntry, error) {
+	for {
+		name, ts, err := r.r.Next()
+		if err == io.EOF {
+			return statEntry{}, err
+		} else if err != nil {
+			return statEntry{}, fmt.Errorf("advance read position failed: %s", err)
+		}
+
+		if !r.reports[name] {
+			continue
+		}
+
+		// Timestamps are kept with full resolution, hence rates of stats recorded with sub-second interval are
+		// calculated using the real time between snapshots.
+		if r.stop && ts.After(r.end) {
+			return statEntry{}, io.EOF
+		}
+		if ts.Before(r.start) || ts.After(r.end) {
+			continue
+		}
+
+		var res stat.PGresult
+		err = r.r.Read(&res)
+		if err != nil {
+			return statEntry{}, err
+		}
+
+		return statEntry{report: name, ts: ts, res: res}, nil
+	}
+}
+
+// reportStream is a reader of stats snapshots of single report type, snapshots are received from demultiplexer.
+type reportStream struct {
+	entries chan statEntry
+	err     error         // error returned after all received snapshots, set before entries channel is closed
+	done    chan struct{} // closed when report stops reading snapshots
+}
+
+// newReportStream creates new stream.
+func newReportStream() *reportStream {
+	return &reportStream{entries: make(chan statEntry, 16), err: io.EOF, done: make(chan struct{})}
+}
+
+// next returns next received stats snapshot.
+func (s *reportStream) next() (statEntry, error) {
+	e, ok := <-s.entries
+	if !ok {
+		return statEntry{}, s.err
+	}
+	return e, nil
+}
+
+// demultiplex reads stats snapshots and distributes them to streams of their reports. Snapshots of reports which stopped
+// reading are dropped. Reading error is passed to all streams.
+func demultiplex(r statReader, streams map[string]*reportStream) {
+	defer func() {
+		for _, s := range streams {
+			close(s.entries)
+		}
+	}()
+
+	for {
+		e, err := r.next()
+		if err != nil {
+			for _, s := range streams {
+				s.err = err
+			}
+			return
+		}
+
+		s, ok := streams[e.report]
+		if !ok {
+			continue
+		}
+
+		select {
+		case s.entries <- e:
+		case <-s.done:
+		}
+	}
+}
@@ -0,0 +1,148 @@
+package report
+
+import (
+	"archive/tar"
+	"bytes"
+	"encoding/json"
+	"github.com/lesovsky/pgcenter/internal/index"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+)
+
+func Test_newStatReader_index(t *testing.T) {
+	ts, err := time.ParseInLocation("2006-01-02 15:04:05", "2021-01-23 15:31:26", time.Now().Location())
+	assert.NoError(t, err)
+
+	for _, format := range []string{"tar", "binary"} {
+		filename := "/tmp/pgcenter-report-testing.stat." + format
+		writeIndexedTestStats(t, "testdata/pgcenter.stat.golden.tar", filename, format)
+
+		for _, report := range []string{"databases", "tables"} {
+			config := Config{ReportType: report, TruncLimit: 32, Rate: time.Second, TsStart: ts, TsEnd: ts.Add(3 * time.Second)}
+
+			// Report built using linear scan of the origin file.
+			f, err := os.Open("testdata/pgcenter.stat.golden.tar")
+			assert.NoError(t, err)
+			offset, indexed := lookupIndex(f, config)
+			assert.False(t, indexed)
+			assert.Equal(t, int64(0), offset)
+
+			want := buildTestReport(t, f, config)
+			assert.NoError(t, f.Close())
+
+			// Report built using index should be the same, stats recorded before the interval are not read.
+			f, err = os.Open(filepath.Clean(filename))
+			assert.NoError(t, err)
+			offset, indexed = lookupIndex(f, config)
+			assert.True(t, indexed)
+			assert.Greater(t, offset, int64(len(snapshot.Magic)))
+
+			assert.Equal(t, want, buildTestReport(t, f, config))
+			assert.NoError(t, f.Close())
+		}
+
+		assert.NoError(t, os.Remove(filename))
+		assert.NoError(t, os.Remove(index.Filename(filename)))
+	}
+}
+
+// buildTestReport reads stats and returns built report.
+func buildTestReport(t *testing.T, f *os.File, config Config) string {
+	app := newApp(config)
+	var buf bytes.Buffer
+	app.writer = &buf
+
+	r, err := newStatReader(f, config)
+	assert.NoError(t, err)
+	assert.NoError(t, app.doReport(r))
+
+	return buf.String()
+}
+
+// writeIndexedTestStats rewrites stats from tar archive into a file of passed format and creates its time index. The
+// beginning of the written file is damaged, hence it could be read only using index. Binary file is split into
+// segments of few snapshots.
+func writeIndexedTestStats(t *testing.T, src string, filename string, format string) {
+	in, err := os.Open(filepath.Clean(src))
+	assert.NoError(t, err)
+	defer func() { _ = in.Close() }()
+
+	out, err := os.Create(filepath.Clean(filename))
+	assert.NoError(t, err)
+
+	idx, err := index.Open(index.Filename(filename), 0, false)
+	assert.NoError(t, err)
+
+	pos := func() int64 {
+		offset, err := out.Seek(0, io.SeekCurrent)
+		assert.NoError(t, err)
+		return offset
+	}
+
+	tw := tar.NewWriter(out)
+	if format == "binary" {
+		_, err = out.WriteString(snapshot.Magic)
+		assert.NoError(t, err)
+	}
+	sw := snapshot.NewWriter(out)
+	var segment int64
+	indexed := map[string]bool{}
+
+	tr := tar.NewReader(in)
+	for n := 0; ; n++ {
+		hdr, err := tr.Next()
+		if err == io.EOF {
+			break
+		}
+		assert.NoError(t, err)
+
+		ts, err := isFilenameTimestampOK(hdr.Name, time.Time{}, time.Now())
+		assert.NoError(t, err)
+		name := strings.Split(hdr.Name, ".")[0]
+
+		data, err := readFileData(tr, hdr.Size)
+		assert.NoError(t, err)
+		e := statEntry{data: data}
+		assert.NoError(t, e.decode())
+		res := e.res
+
+		if format == "tar" {
+			assert.NoError(t, tw.Flush())
+			assert.NoError(t, idx.Add(index.Entry{Ts: ts, Name: name, Offset: pos()}))
+			data, err := json.Marshal(res)
+			assert.NoError(t, err)
+			hdr.Size = int64(len(data))
+			assert.NoError(t, tw.WriteHeader(hdr))
+			_, err = tw.Write(data)
+			assert.NoError(t, err)
+			continue
+		}
+
+		if n%20 == 0 {
+			segment = pos()
+			indexed = map[string]bool{}
+			assert.NoError(t, sw.StartSegment())
+		}
+		if !indexed[name] {
+			assert.NoError(t, idx.Add(index.Entry{Ts: ts, Name: name, Offset: segment}))
+			indexed[name] = true
+		}
+		assert.NoError(t, sw.Write(name, ts, res))
+	}
+
+	if format == "tar" {
+		assert.NoError(t, tw.Close())
+	}
+	assert.NoError(t, idx.Close())
+
+	// Damage the first file or frame.
+	_, err = out.WriteAt([]byte("damaged"), int64(len(snapshot.Magic)))
+	assert.NoError(t, err)
+	assert.NoError(t, out.Close())
+}
@@ -2,32 +2,45 @@ package report
 
 import (
 	"archive/tar"
-	"encoding/json"
 	"fmt"
 	"github.com/lesovsky/pgcenter/internal/align"
 	"github.com/lesovsky/pgcenter/internal/stat"
 	"github.com/lesovsky/pgcenter/internal/view"
 	"io"
+	"io/ioutil"
 	"os"
-	"regexp"
+	"path/filepath"
+	"runtime"
 	"strings"
+	"sync"
 	"time"
 )
 
 // Config contains application settings.
 type Config struct {
-	Describe      bool
-	ReportType    string
-	InputFile     string
-	TsStart       time.Time
-	TsEnd         time.Time
-	OrderColName  string
-	OrderDesc     bool
-	FilterColName string
-	FilterRE      *regexp.Regexp
-	RowLimit      int
-	TruncLimit    int
-	Rate          time.Duration
+	Describe     bool
+	ReportType   string
+	ReportTypes  []string // Types of reports built from single pass over statistics file, ReportType is used if empty
+	OutputDir    string   // Directory where reports are written into separate files, stdout is used if empty
+	InputFile    string
+	InputFiles   []string // Several files merged in order of time, InputFile is used if empty
+	Hosts        []string // Labels of hosts which stats are recorded into InputFiles
+	TsStart      time.Time
+	TsEnd        time.Time
+	OrderColName string
+	OrderDesc    bool
+	Filter       *stat.FilterExpr // Filter of rows, compiled against columns of the report
+	RowLimit     int
+	TruncLimit   int
+	Rate         time.Duration
+	Workers      int
+	Follow       bool          // Keep reading stats appended to the file by recorder
+	Rollup       time.Duration // Length of time windows where deltas are aggregated, deltas are printed as-is if zero
+	Top          int           // Number of rows with the largest totals over the whole interval, deltas are printed if zero
+	TopBy        string        // Name of the column used for ranking rows by totals
+	Format       string        // Output format: aligned table if empty, 'csv' or 'jsonl'
+	Compare      []Window      // Two windows which rates are compared, the first one is the baseline
+	CompareFile  string        // File with stats of the second compared window, InputFile is used if empty
 }
 
 const (
@@ -37,11 +50,22 @@ const (
 
 // RunMain is the main entry point for 'pgcenter report' sub-command.
 func RunMain(c Config) error {
-	app := newApp(c)
+	reports := c.reportTypes()
 
-	// Print report description if requested.
+	// Print reports description if requested.
 	if c.Describe {
-		return describeReport(app.writer, c.ReportType)
+		for _, report := range reports {
+			err := describeReport(os.Stdout, report)
+			if err != nil {
+				return err
+			}
+		}
+		return nil
+	}
+
+	// Several files are merged in order of time.
+	if len(c.InputFiles) > 1 {
+		return runMergedReports(c)
 	}
 
 	// Open file with statistics.
@@ -57,136 +81,225 @@ func RunMain(c Config) error {
 		}
 	}()
 
-	// Print report header.
-	err = printReportHeader(app.writer, app.config)
+	// Initialize reader of statistics file, compared windows could be read from different files.
+	var r statReader
+	if len(c.Compare) > 0 {
+		var f2 *os.File
+		if c.CompareFile != "" {
+			f2, err = os.Open(c.CompareFile)
+			if err != nil {
+				return err
+			}
+			defer func() { _ = f2.Close() }()
+		}
+		r, err = newCompareStatReader(f, f2, c)
+	} else {
+		r, err = newStatReader(f, c)
+	}
 	if err != nil {
 		return err
 	}
 
-	// Initialize tar reader.
-	tr := tar.NewReader(f)
-
-	// Start printing report.
-	return app.doReport(tr)
+	// Start printing reports.
+	return runReports(r, c, os.Stdout)
 }
 
-// app defines application container with runtime dependencies.
-type app struct {
-	config Config
-	view   view.View
-	writer io.Writer
-}
+// runMergedReports builds reports from several statistics files merged in order of time.
+func runMergedReports(c Config) error {
+	readers := make([]statReader, len(c.InputFiles))
+	for i, name := range c.InputFiles {
+		f, err := os.Open(name)
+		if err != nil {
+			return err
+		}
 
-// newApp creates new 'pgcenter record' app.
-func newApp(config Config) *app {
-	views := view.New()
-	v := views[config.ReportType]
+		defer func() {
+			err := f.Close()
+			if err != nil {
+				fmt.Printf("close file descriptor failed: %s, ignore", err)
+			}
+		}()
 
-	return &app{
-		config: config,
-		view:   v,
-		writer: os.Stdout,
+		readers[i], err = newStatReader(f, c)
+		if err != nil {
+			return fmt.Errorf("%s: %s", name, err)
+		}
 	}
-}
-
-// Read statistics file and create a report based on report settings
-func (app *app) doReport(r *tar.Reader) error {
-	var prevStat stat.PGresult
-	var prevTs time.Time
-	var linesPrinted = repeatHeaderAfter // initial value means print header at the beginning of all output
-	var orderConfigured = false          // flag tells about order is not configured.
 
-	c := app.config
-	v := app.view
+	r, err := newMergeStatReader(readers)
+	if err != nil {
+		return err
+	}
 
-	// read files headers continuously, read stats files requested by user and skip others.
-	for {
-		hdr, err := r.Next()
-		if err == io.EOF {
-			break
-		} else if err != nil {
-			return fmt.Errorf("advance read position failed: %s", err)
-		}
+	return runReports(r, c, os.Stdout)
+}
 
-		// Check filename - it has valid format and corresponds to requested report type.
-		err = isFilenameOK(hdr.Name, c.ReportType)
-		if err != nil {
-			continue
-		}
+// reportTypes returns types of requested reports.
+func (c Config) reportTypes() []string {
+	if len(c.ReportTypes) == 0 {
+		return []string{c.ReportType}
+	}
+	return c.ReportTypes
+}
 
-		// Check timestamp in filename, is it correct and is in requested report interval.
-		ts, err := isFilenameTimestampOK(hdr.Name, c.TsStart, c.TsEnd)
-		if err != nil {
-			continue
-		}
+// runReports builds reports of all requested types from single pass over statistics file. Every report has its own
+// diff state and output: separate file in the output directory, or section of passed output. Sections are printed in
+// order of requested types, the first section is printed while the report is built.
+func runReports(r statReader, c Config, w io.Writer) error {
+	reports := c.reportTypes()
 
-		// Read stats from file.
-		currStat, err := readFileStat(r, hdr.Size)
-		if err != nil {
-			return err
+	outputs := make([]*os.File, len(reports))
+	defer func() {
+		for _, f := range outputs {
+			if f == nil {
+				continue
+			}
+			_ = f.Close()
+			if c.OutputDir == "" {
+				_ = os.Remove(f.Name())
+			}
 		}
+	}()
 
-		// if previous stats snapshot is not defined, copy current to previous.
-		// Usually this occurs when reading first stat sample at startup.
-		if !prevStat.Valid {
-			prevStat = currStat
-			prevTs = ts
-			continue
-		}
+	streams := map[string]*reportStream{}
+	apps := make([]*app, len(reports))
+	for i, report := range reports {
+		config := c
+		config.ReportType = report
 
-		// Calculate time interval.
-		interval := ts.Sub(prevTs)
-		if c.Rate > interval {
-			_, err := fmt.Fprintf(
-				app.writer,
-				"WARNING: specified rate longer than stats snapshots interval, adjusting it to %s\n",
-				interval.String(),
-			)
+		apps[i] = newApp(config)
+		switch {
+		case c.OutputDir != "":
+			f, err := os.Create(filepath.Join(c.OutputDir, report+exportFileExt(c.Format)))
 			if err != nil {
 				return err
 			}
-			c.Rate = interval
+			outputs[i], apps[i].writer = f, f
+		case i == 0:
+			apps[i].writer = w
+		default:
+			f, err := ioutil.TempFile("", "pgcenter-report-")
+			if err != nil {
+				return err
+			}
+			outputs[i], apps[i].writer = f, f
 		}
 
-		// When first data read, list of columns is known and it is possible to set up order.
-		if c.OrderColName != "" && !orderConfigured {
-			if idx, ok := getColumnIndex(currStat.Cols, c.OrderColName); ok {
-				v.OrderKey = idx
-				v.OrderDesc = c.OrderDesc
-				orderConfigured = true
+		streams[report] = newReportStream()
+	}
+
+	go demultiplex(r, streams)
+
+	// Build reports concurrently.
+	errs := make([]error, len(reports))
+	var wg sync.WaitGroup
+	for i := range reports {
+		wg.Add(1)
+		go func(i int, app *app) {
+			defer wg.Done()
+			s := streams[app.config.ReportType]
+			defer close(s.done)
+
+			// Print report header.
+			err := printReportHeader(app.writer, app.config)
+			if err != nil {
+				errs[i] = err
+				return
 			}
-		}
 
-		// Calculate delta between current and previous stats snapshots.
-		diffStat, err := countDiff(currStat, prevStat, int(interval/c.Rate), v)
+			errs[i] = app.doReport(s)
+		}(i, apps[i])
+	}
+	wg.Wait()
+
+	for i, err := range errs {
 		if err != nil {
+			if len(reports) > 1 {
+				return fmt.Errorf("report %s failed: %s", reports[i], err)
+			}
 			return err
 		}
+	}
 
-		// Format the stat
-		formatStatSample(&diffStat, &v, c)
+	if c.OutputDir != "" {
+		return nil
+	}
 
-		// print header after every Nth lines
-		linesPrinted, err = printStatHeader(app.writer, linesPrinted, v)
+	// Print buffered sections.
+	for _, f := range outputs[1:] {
+		_, err := f.Seek(0, io.SeekStart)
 		if err != nil {
 			return err
 		}
 
-		// print the stats - calculated delta between previous and current stats snapshots
-		n, err := printStatSample(app.writer, &diffStat, v, c, ts)
+		_, err = fmt.Fprintln(w)
 		if err != nil {
 			return err
 		}
-		linesPrinted += n
 
-		// Swap previous with current
-		prevStat = currStat
-		prevTs = ts
-	} //end for
+		_, err = io.Copy(w, f)
+		if err != nil {
+			return err
+		}
+	}
 
 	return nil
 }
 
+// app defines application container with runtime dependencies.
+type app struct {
+	config Config
+	view   view.View
+	writer io.Writer
+}
+
+// newApp creates new 'pgcenter record' app.
+func newApp(config Config) *app {
+	views := view.New()
+	v := views[config.ReportType]
+
+	return &app{
+		config: config,
+		view:   v,
+		writer: os.Stdout,
+	}
+}
+
+// Read statistics file and create a report based on report settings. Report is built by pipeline: snapshots are read
+// sequentially, decoded by parallel workers, differences between consecutive snapshots are calculated in order of
+// snapshots, optionally aggregated in time windows, formatted by parallel workers and printed in order of snapshots.
+func (app *app) doReport(r statReader) error {
+	workers := app.config.Workers
+	if workers < 1 {
+		workers = runtime.NumCPU()
+	}
+
+	// Closing 'done' stops all stages of the pipeline.
+	done := make(chan struct{})
+	defer close(done)
+
+	entries := app.readStats(r, workers, done)
+	decoded := parallelStage(entries, workers, done, app.decodeStat)
+
+	// Totals of the whole interval and comparison of windows are printed as the single table.
+	if app.config.Top > 0 {
+		formatted := parallelStage(app.topStats(decoded, done), 1, done, app.formatStat)
+		return app.printStats(formatted, done)
+	}
+	if len(app.config.Compare) > 0 {
+		formatted := parallelStage(app.compareStats(decoded, done), 1, done, app.formatStat)
+		return app.printStats(formatted, done)
+	}
+
+	diffs := app.diffStats(decoded, done)
+	if app.config.Rollup > 0 {
+		diffs = app.rollupStats(diffs, done)
+	}
+	formatted := parallelStage(diffs, workers, done, app.formatStat)
+
+	return app.printStats(formatted, done)
+}
+
 // isFilenameOK checks filename format.
 func isFilenameOK(name string, report string) error {
 	s := strings.Split(name, ".")
@@ -214,7 +327,7 @@ func isFilenameTimestampOK(name string, start, end time.Time) (time.Time, error)
 	}
 
 	// Calculate timestamp when stats were recorded, parse timestamp considering it is in local timezone.
-	ts, err := time.ParseInLocation("20060102T150405", s[1], time.Now().Location())
+	ts, err := parseFilenameTimestamp(s[1])
 	if err != nil {
 		return time.Time{}, err
 	}
@@ -227,29 +340,58 @@ func isFilenameTimestampOK(name string, start, end time.Time) (time.Time, error)
 	return ts, nil
 }
 
-// readFileStat reads content of tar file, unmarshal data and return stat object.
-func readFileStat(r *tar.Reader, bufsz int64) (stat.PGresult, error) {
+// isFilenameAfter checks timestamp in the file name and returns true if stats have been recorded after passed time.
+func isFilenameAfter(name string, end time.Time) bool {
+	s := strings.Split(name, ".")
+	if len(s) != 3 {
+		return false
+	}
+
+	ts, err := parseFilenameTimestamp(s[1])
+	if err != nil {
+		return false
+	}
+
+	return ts.After(end)
+}
+
+// parseFilenameTimestamp parses timestamp used in file names, timestamp is considered in local timezone.
+func parseFilenameTimestamp(s string) (time.Time, error) {
+	return time.ParseInLocation("20060102T150405", s, time.Now().Location())
+}
+
+// readFileData reads content of tar file.
+func readFileData(r *tar.Reader, bufsz int64) ([]byte, error) {
 	data := make([]byte, bufsz)
 
 	if _, err := io.ReadFull(r, data); err != nil {
-		return stat.PGresult{}, err
+		return nil, err
 	}
 
-	// initialize an empty struct and unmarshal data from the buffer
-	res := stat.PGresult{}
-	err := json.Unmarshal(data, &res)
-	if err != nil {
-		return stat.PGresult{}, err
+	return data, nil
+}
+
+// newRowIndex creates index of stat sample rows if sample has to be compared with the next one.
+func newRowIndex(res stat.PGresult, v view.View) *stat.RowIndex {
+	// Samples without diff are not compared and don't need index.
+	if v.DiffIntvl == [2]int{0, 0} {
+		return nil
 	}
 
-	return res, nil
+	return stat.NewRowIndex(res, v.UniqueKey)
 }
 
-// countDiff compares two stat samples and produce differential sample.
-func countDiff(curr, prev stat.PGresult, interval int, v view.View) (stat.PGresult, error) {
+// rateInterval returns number of rate intervals elapsed between two snapshots, deltas are divided by this number.
+func rateInterval(interval, rate time.Duration) float64 {
+	return interval.Seconds() / rate.Seconds()
+}
+
+// countDiff compares two stat samples and produce differential sample, deltas are divided by passed number of rate
+// intervals elapsed between samples.
+func countDiff(curr, prev stat.PGresult, prevIdx *stat.RowIndex, interval float64, v view.View, filter *stat.Filter) (stat.PGresult, error) {
 	var diff stat.PGresult
 
-	diff, err := stat.Compare(curr, prev, interval, v.DiffIntvl, v.OrderKey, v.OrderDesc, v.UniqueKey)
+	diff, err := stat.Compare(curr, prev, prevIdx, interval, v.DiffIntvl, v.OrderKey, v.OrderDesc, v.UniqueKey, filter)
 	if err != nil {
 		return stat.PGresult{}, err
 	}
@@ -271,9 +413,9 @@ func getColumnIndex(cols []string, colname string) (int, bool) {
 	return -1, false
 }
 
-// formatStatSample does formatting of stat sample.
+// formatStatSample does formatting of stat sample. Exported stats are not aligned.
 func formatStatSample(d *stat.PGresult, view *view.View, c Config) {
-	if view.Aligned {
+	if view.Aligned || c.Format != formatTable {
 		return
 	}
 
@@ -284,18 +426,36 @@ func formatStatSample(d *stat.PGresult, view *view.View, c Config) {
 	view.Aligned = true
 }
 
-// printReportHeader prints report header.
+// printReportHeader prints report header. Exported reports have no header.
 func printReportHeader(w io.Writer, c Config) error {
+	if c.Format != formatTable {
+		return nil
+	}
+
 	tmpl := "INFO: reading from %s\n" +
 		"INFO: report %s\n" +
 		"INFO: start from: %s, to: %s, with rate: %s\n"
+	input := c.InputFile
+	if len(c.InputFiles) > 1 {
+		input = strings.Join(c.InputFiles, ", ")
+	}
+
 	msg := fmt.Sprintf(tmpl,
-		c.InputFile,
+		input,
 		c.ReportType,
 		c.TsStart.Format("2006-01-02 15:04:05 MST"),
 		c.TsEnd.Format("2006-01-02 15:04:05 MST"),
 		c.Rate.String(),
 	)
+	if c.Rollup > 0 {
+		msg += fmt.Sprintf("INFO: rollup deltas in %s windows\n", c.Rollup.String())
+	}
+	if c.Top > 0 {
+		msg += fmt.Sprintf("INFO: top %d by totals of %s\n", c.Top, c.TopBy)
+	}
+	if len(c.Compare) == 2 {
+		msg += fmt.Sprintf("INFO: compare rates of %s with %s\n", c.Compare[1], c.Compare[0])
+	}
 
 	_, err := fmt.Fprint(w, msg)
 	if err != nil {
@@ -310,105 +470,50 @@ func printStatHeader(w io.Writer, printedNum int, v view.View) (int, error) {
 		return printedNum, nil
 	}
 
-	_, err := fmt.Fprintf(w, "         ")
-	if err != nil {
-		return 0, err
-	}
+	t := align.NewTable(true)
+	t.SetWidths(v.ColsWidth, len(v.Cols))
 
+	t.AppendString("         ")
 	for i, name := range v.Cols {
-		_, err := fmt.Fprintf(w, "\033[%d;%dm%-*s\033[0m", 37, 1, v.ColsWidth[i]+2, name)
-		if err != nil {
-			return 0, err
-		}
+		t.AppendString("\033[37;1m")
+		t.AppendHeader(i, name)
+		t.AppendString("\033[0m")
 	}
+	t.AppendString("\n")
 
-	_, err = fmt.Fprintf(w, "\n")
+	_, err := t.WriteTo(w)
 	if err != nil {
 		return 0, err
 	}
 	return 0, nil
 }
 
-// printStatSample prints given stats
-func printStatSample(w io.Writer, res *stat.PGresult, view view.View, c Config, ts time.Time) (int, error) {
-	// print stats values
-	var printFirst = true // every first line in the snapshot should begin with timestamp when stats were taken
-	var linesPrinted int  // count lines printed per snapshot (for limiting purposes)
-	var printedNum int
-
-	// loop through the rows, check for filtered values and print if values are satisfied
-	for colnum, rownum := 0, 0; rownum < res.Nrows; rownum, colnum = rownum+1, 0 {
-		var doPrint = true // assume the filtering is disabled by default and row should be printed
-
-		// if filtering (grep) is enabled, a target column should be found and check values
-		// if value doesn't match, skip it and proceed to next row
-		if c.FilterColName != "" {
-			// if filter enabled, use pessimistic approach and considering the value will not match
-			doPrint = false
-			for idx, colname := range res.Cols {
-				if colname == c.FilterColName {
-					if c.FilterRE.MatchString(res.Values[rownum][idx].String) {
-						doPrint = true // value matched, so print the whole row
-						break
-					}
-				}
-			}
-		}
+// renderStatSample renders given stats into the table and returns number of rendered lines.
+func renderStatSample(t *align.Table, res *stat.PGresult, view view.View, c Config, ts time.Time) int {
+	var printedNum int // count lines printed per snapshot (for limiting purposes)
 
-		// print the row
-		if doPrint {
-			if printFirst {
-				_, err := fmt.Fprintf(w, "%s ", ts.Format("15:04:05"))
-				if err != nil {
-					return 0, err
-				}
-				printFirst = false
-			} else {
-				_, err := fmt.Fprintf(w, "         ")
-				if err != nil {
-					return 0, err
-				}
-			}
+	t.SetWidths(view.ColsWidth, len(res.Cols))
+	t.SetTruncLimit(c.TruncLimit)
 
-			for i := range res.Cols {
-				// truncate values that longer than column width
-				valuelen := len(res.Values[rownum][colnum].String)
-				if valuelen > view.ColsWidth[i] {
-					width := view.ColsWidth[i]
-					// truncate value up to column width and replace last character with '~' symbol
-					res.Values[rownum][colnum].String = res.Values[rownum][colnum].String[:width-1] + "~"
-				}
-
-				// last col with no truncation of not specified otherwise
-				if i != len(res.Cols)-1 {
-					_, err := fmt.Fprintf(w, "%-*s", view.ColsWidth[i]+2, res.Values[rownum][colnum].String)
-					if err != nil {
-						return 0, err
-					}
-				} else {
-					_, err := fmt.Fprintf(w, "%s", res.Values[rownum][colnum].String)
-					if err != nil {
-						return 0, err
-					}
-				}
-
-				colnum++
-			}
+	// loop through the rows and print them, rows are already filtered when delta is calculated
+	for rownum := 0; rownum < res.Nrows; rownum++ {
+		// every first line in the snapshot should begin with timestamp when stats were taken
+		if rownum == 0 {
+			t.AppendString(ts.Format("15:04:05") + " ")
+		} else {
+			t.AppendString("         ")
+		}
 
-			_, err := fmt.Fprintf(w, "\n")
-			if err != nil {
-				return 0, err
-			}
-			printedNum++
+		// values longer than column width are truncated, last column is not padded
+		t.AppendRow(res, rownum)
 
-			// check number of printed lines, if limit is reached skip remaining rows and proceed to a next stats file
-			if linesPrinted++; c.RowLimit > 0 && linesPrinted >= c.RowLimit {
-				break
-			}
-		} // end if
-	} // end for
+		// check number of printed lines, if limit is reached skip remaining rows and proceed to a next stats file
+		if printedNum++; c.RowLimit > 0 && printedNum >= c.RowLimit {
+			break
+		}
+	}
 
-	return printedNum, nil
+	return printedNum
 }
 
 // doDescribe shows detailed description of the requested stats
@@ -421,6 +526,7 @@ func describeReport(w io.Writer, report string) error {
 		"indexes":            pgStatIndexesDescription,
 		"functions":          pgStatFunctionsDescription,
 		"sizes":              pgStatSizesDescription,
+		"cpustat":            pgcenterCpuStatDescription,
 		"progress_vacuum":    pgStatProgressVacuumDescription,
 		"progress_cluster":   pgStatProgressClusterDescription,
 		"progress_index":     pgStatProgressCreateIndexDescription,
@@ -6,13 +6,16 @@ import (
 	"database/sql"
 	"fmt"
 	"github.com/lesovsky/pgcenter/internal/align"
+	"github.com/lesovsky/pgcenter/internal/snapshot"
 	"github.com/lesovsky/pgcenter/internal/stat"
 	"github.com/lesovsky/pgcenter/internal/view"
 	"github.com/stretchr/testify/assert"
 	"io"
 	"io/ioutil"
 	"os"
+	"path/filepath"
 	"regexp"
+	"strings"
 	"testing"
 	"time"
 )
@@ -116,7 +119,7 @@ func Test_app_doReport(t *testing.T) {
 		},
 		{ // start, end times within report interval, grep by query:UPDATE
 			start: "2021-01-23 15:31:26", end: "2021-01-23 15:31:27",
-			config:   Config{ReportType: "activity", FilterColName: "query", FilterRE: regexp.MustCompile("UPDATE"), TruncLimit: 32, Rate: time.Second},
+			config:   Config{ReportType: "activity", Filter: stat.NewMatchFilter("query", regexp.MustCompile("UPDATE")), TruncLimit: 32, Rate: time.Second},
 			wantFile: "testdata/report_activity_grep.golden",
 		},
 		{ // start, end times within report interval, limit by number of rows
@@ -131,6 +134,9 @@ func Test_app_doReport(t *testing.T) {
 		},
 	}
 
+	binaryStats := newBinaryTestStats(t, "testdata/pgcenter.stat.golden.tar", false)
+	deltaStats := newBinaryTestStats(t, "testdata/pgcenter.stat.golden.tar", true)
+
 	for _, tc := range testcases {
 		ts, err := time.ParseInLocation("2006-01-02 15:04:05", tc.start, time.Now().Location())
 		assert.NoError(t, err)
@@ -144,18 +150,125 @@ func Test_app_doReport(t *testing.T) {
 		var buf bytes.Buffer
 		app.writer = &buf
 
-		f, err := os.Open("testdata/pgcenter.stat.golden.tar")
+		want, err := ioutil.ReadFile(tc.wantFile)
 		assert.NoError(t, err)
-		tr := tar.NewReader(f)
 
-		err = app.doReport(tr)
+		f, err := os.Open("testdata/pgcenter.stat.golden.tar")
+		assert.NoError(t, err)
+		r, err := newStatReader(f, tc.config)
 		assert.NoError(t, err)
 
-		want, err := ioutil.ReadFile(tc.wantFile)
+		err = app.doReport(r)
 		assert.NoError(t, err)
+		assert.NoError(t, f.Close())
 
 		assert.Equal(t, string(want), buf.String())
+
+		// Reports built from the same stats in binary format should be the same.
+		for _, data := range [][]byte{binaryStats, deltaStats} {
+			app = newApp(tc.config)
+			buf.Reset()
+			app.writer = &buf
+
+			r, err = newStatReader(bytes.NewReader(data), tc.config)
+			assert.NoError(t, err)
+
+			err = app.doReport(r)
+			assert.NoError(t, err)
+
+			assert.Equal(t, string(want), buf.String())
+		}
+	}
+}
+
+// newBinaryTestStats converts stats from tar archive with JSON files into binary snapshot format.
+func newBinaryTestStats(t *testing.T, filename string, delta bool) []byte {
+	f, err := os.Open(filepath.Clean(filename))
+	assert.NoError(t, err)
+	defer func() { _ = f.Close() }()
+
+	buf := bytes.NewBufferString(snapshot.Magic)
+	w := snapshot.NewWriter(buf)
+	if delta {
+		ukeys := map[string]int{}
+		for name, v := range view.New() {
+			ukeys[name] = v.UniqueKey
+		}
+		w.EnableDelta(ukeys)
 	}
+
+	tr := tar.NewReader(f)
+	for {
+		hdr, err := tr.Next()
+		if err == io.EOF {
+			break
+		}
+		assert.NoError(t, err)
+
+		ts, err := isFilenameTimestampOK(hdr.Name, time.Time{}, time.Now())
+		assert.NoError(t, err)
+
+		data, err := readFileData(tr, hdr.Size)
+		assert.NoError(t, err)
+		e := statEntry{data: data}
+		assert.NoError(t, e.decode())
+
+		assert.NoError(t, w.Write(strings.Split(hdr.Name, ".")[0], ts, e.res))
+	}
+
+	return buf.Bytes()
+}
+
+func Test_runReports(t *testing.T) {
+	reports := []string{"databases", "tables", "statements_timings"}
+	config := Config{InputFile: "testdata/pgcenter.stat.golden.tar", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now()}
+
+	run := func(c Config, w io.Writer) error {
+		f, err := os.Open(c.InputFile)
+		assert.NoError(t, err)
+		defer func() { _ = f.Close() }()
+
+		r, err := newStatReader(f, c)
+		assert.NoError(t, err)
+		return runReports(r, c, w)
+	}
+
+	// Reports built separately.
+	want := make([]string, len(reports))
+	for i, report := range reports {
+		c := config
+		c.ReportType = report
+		var buf bytes.Buffer
+		assert.NoError(t, run(c, &buf))
+		assert.Contains(t, buf.String(), "INFO: report "+report)
+		want[i] = buf.String()
+	}
+
+	// Reports built from single pass are printed in sections.
+	config.ReportTypes = reports
+	var buf bytes.Buffer
+	assert.NoError(t, run(config, &buf))
+	assert.Equal(t, strings.Join(want, "\n"), buf.String())
+
+	// Reports built from single pass are written into separate files.
+	dir, err := ioutil.TempDir("", "pgcenter-report-testing")
+	assert.NoError(t, err)
+	defer func() { _ = os.RemoveAll(dir) }()
+
+	config.OutputDir = dir
+	buf.Reset()
+	assert.NoError(t, run(config, &buf))
+	assert.Equal(t, "", buf.String())
+	for i, report := range reports {
+		got, err := ioutil.ReadFile(filepath.Join(dir, report+".txt"))
+		assert.NoError(t, err)
+		assert.Equal(t, want[i], string(got))
+	}
+
+	// Reading error is returned.
+	config.OutputDir = ""
+	err = runReports(&testStatReader{err: fmt.Errorf("read failed")}, config, &buf)
+	assert.Error(t, err)
 }
 
 func Test_isFilenameOK(t *testing.T) {
@@ -212,7 +325,7 @@ func Test_isFilenameTimestampOK(t *testing.T) {
 	}
 }
 
-func Test_readFileStat(t *testing.T) {
+func Test_statEntry_decode(t *testing.T) {
 	testcases := []struct {
 		valid    bool
 		filename string
@@ -236,14 +349,17 @@ func Test_readFileStat(t *testing.T) {
 					assert.Fail(t, "unexpected error", err)
 				}
 
-				got, err := readFileStat(r, hdr.Size)
+				data, err := readFileData(r, hdr.Size)
+				assert.NoError(t, err)
+
+				e := statEntry{data: data}
+				err = e.decode()
 				if tc.valid {
 					assert.NoError(t, err)
-					assert.NotNil(t, got.Values)
-					assert.NotNil(t, got.Cols)
+					assert.NotNil(t, e.res.Columns)
+					assert.NotNil(t, e.res.Cols)
 				} else {
 					assert.Error(t, err)
-					assert.Equal(t, stat.PGresult{}, got)
 				}
 			}
 		})
@@ -251,13 +367,12 @@ func Test_readFileStat(t *testing.T) {
 }
 
 func Test_countDiff(t *testing.T) {
-	prev := stat.PGresult{
-		Valid: true, Ncols: 18, Nrows: 1,
-		Cols: []string{
+	prev := stat.NewPGresultFromValues(
+		[]string{
 			"datname", "commits", "rollbacks", "reads", "hits", "returned", "fetched", "inserts", "updates", "deletes",
 			"conflicts", "deadlocks", "csum_fails", "temp_files", "temp_bytes", "read_t", "write_t", "stats_age",
 		},
-		Values: [][]sql.NullString{
+		[][]sql.NullString{
 			{
 				{String: "example_db", Valid: true}, {String: "1000", Valid: true}, {String: "10", Valid: true}, {String: "4000", Valid: true},
 				{String: "20000", Valid: true}, {String: "2000", Valid: true}, {String: "6000", Valid: true}, {String: "8000", Valid: true},
@@ -266,14 +381,13 @@ func Test_countDiff(t *testing.T) {
 				{String: "5", Valid: true}, {String: "11 days 10:10:10", Valid: true},
 			},
 		},
-	}
-	curr := stat.PGresult{
-		Valid: true, Ncols: 18, Nrows: 1,
-		Cols: []string{
+	)
+	curr := stat.NewPGresultFromValues(
+		[]string{
 			"datname", "commits", "rollbacks", "reads", "hits", "returned", "fetched", "inserts", "updates", "deletes",
 			"conflicts", "deadlocks", "csum_fails", "temp_files", "temp_bytes", "read_t", "write_t", "stats_age",
 		},
-		Values: [][]sql.NullString{
+		[][]sql.NullString{
 			{
 				{String: "example_db", Valid: true}, {String: "1500", Valid: true}, {String: "15", Valid: true}, {String: "6000", Valid: true},
 				{String: "30000", Valid: true}, {String: "3000", Valid: true}, {String: "9000", Valid: true}, {String: "12000", Valid: true},
@@ -282,15 +396,14 @@ func Test_countDiff(t *testing.T) {
 				{String: "8", Valid: true}, {String: "11 days 10:10:11", Valid: true},
 			},
 		},
-	}
+	)
 
-	want := stat.PGresult{
-		Valid: true, Ncols: 18, Nrows: 1,
-		Cols: []string{
+	want := stat.NewPGresultFromValues(
+		[]string{
 			"datname", "commits", "rollbacks", "reads", "hits", "returned", "fetched", "inserts", "updates", "deletes",
 			"conflicts", "deadlocks", "csum_fails", "temp_files", "temp_bytes", "read_t", "write_t", "stats_age",
 		},
-		Values: [][]sql.NullString{
+		[][]sql.NullString{
 			{
 				{String: "example_db", Valid: true}, {String: "500", Valid: true}, {String: "5", Valid: true}, {String: "2000", Valid: true},
 				{String: "10000", Valid: true}, {String: "1000", Valid: true}, {String: "3000", Valid: true}, {String: "4000", Valid: true},
@@ -299,12 +412,12 @@ func Test_countDiff(t *testing.T) {
 				{String: "3", Valid: true}, {String: "11 days 10:10:11", Valid: true},
 			},
 		},
-	}
+	)
 
 	views := view.New()
 	v := views["databases"]
 
-	got, err := countDiff(curr, prev, 1, v)
+	got, err := countDiff(curr, prev, newRowIndex(prev, v), 1, v, nil)
 	assert.NoError(t, err)
 	assert.Equal(t, want, got)
 }
@@ -328,15 +441,12 @@ func Test_getColumnIndex(t *testing.T) {
 }
 
 func Test_formatStatSample(t *testing.T) {
-	res := &stat.PGresult{
-		Valid: true,
-		Ncols: 18,
-		Nrows: 2,
-		Cols: []string{
+	res := stat.NewPGresultFromValues(
+		[]string{
 			"datname", "commits", "rollbacks", "reads", "hits", "returned", "fetched", "inserts", "updates", "deletes",
 			"conflicts", "deadlocks", "csum_fails", "temp_files", "temp_bytes", "read_t", "write_t", "stats_age",
 		},
-		Values: [][]sql.NullString{
+		[][]sql.NullString{
 			{
 				{String: "example_db", Valid: true}, {String: "5423", Valid: true}, {String: "24", Valid: true}, {String: "8452", Valid: true},
 				{String: "8452145", Valid: true}, {String: "45214", Valid: true}, {String: "58452", Valid: true}, {String: "4521", Valid: true},
@@ -352,12 +462,12 @@ func Test_formatStatSample(t *testing.T) {
 				{String: "458.01", Valid: true}, {String: "10 days 10:10:10", Valid: true},
 			},
 		},
-	}
+	)
 
 	views := view.New()
 	v := views["databases"]
 
-	formatStatSample(res, &v, Config{})
+	formatStatSample(&res, &v, Config{})
 
 	assert.True(t, v.Aligned)
 	assert.NotNil(t, v.ColsWidth)
@@ -389,19 +499,18 @@ INFO: start from: 2021-01-18 05:00:00 +05, to: 2021-01-18 06:00:00 +05, with rat
 }
 
 func Test_printStatHeader(t *testing.T) {
-	res := &stat.PGresult{
-		Valid: true, Ncols: 18, Nrows: 0,
-		Cols: []string{
+	res := stat.NewPGresultFromValues(
+		[]string{
 			"datname", "commits", "rollbacks", "reads", "hits", "returned", "fetched", "inserts", "updates", "deletes",
 			"conflicts", "deadlocks", "csum_fails", "temp_files", "temp_bytes", "read_t", "write_t", "stats_age",
 		},
-		Values: [][]sql.NullString{},
-	}
+		[][]sql.NullString{},
+	)
 
 	views := view.New()
 	v := views["databases"]
 
-	widthes, cols := align.SetAlign(*res, 32, true)
+	widthes, cols := align.SetAlign(res, 32, true)
 	v.ColsWidth = widthes
 	v.Cols = cols
 	v.Aligned = true
@@ -421,19 +530,16 @@ func Test_printStatHeader(t *testing.T) {
 	assert.NoError(t, err)
 }
 
-func Test_printStatSample(t *testing.T) {
-	res := &stat.PGresult{
-		Valid: true,
-		Ncols: 18,
-		Nrows: 2,
-		Cols: []string{
+func Test_renderStatSample(t *testing.T) {
+	res := stat.NewPGresultFromValues(
+		[]string{
 			"datname", "commits", "rollbacks", "reads",
 			"hits", "returned", "fetched", "inserts",
 			"updates", "deletes", "conflicts", "deadlocks",
 			"csum_fails", "temp_files", "temp_bytes", "read_t",
 			"write_t", "stats_age",
 		},
-		Values: [][]sql.NullString{
+		[][]sql.NullString{
 			{
 				{String: "example_db", Valid: true}, {String: "5423", Valid: true}, {String: "24", Valid: true}, {String: "8452", Valid: true},
 				{String: "8452145", Valid: true}, {String: "45214", Valid: true}, {String: "58452", Valid: true}, {String: "4521", Valid: true},
@@ -449,43 +555,27 @@ func Test_printStatSample(t *testing.T) {
 				{String: "458.01", Valid: true}, {String: "10 days 10:10:10", Valid: true},
 			},
 		},
-	}
+	)
 
 	views := view.New()
 	v := views["databases"]
 
-	widthes, cols := align.SetAlign(*res, 32, true)
+	widthes, cols := align.SetAlign(res, 32, true)
 	v.ColsWidth = widthes
 	v.Cols = cols
 	v.Aligned = true
 
-	f, err := ioutil.TempFile("/tmp", "pgcenter-test-report-")
-	assert.NoError(t, err)
-	fname := f.Name()
-
-	// print report
-	n, err := printStatSample(f, res, v, Config{}, time.Time{})
-	assert.NoError(t, err)
+	// render report
+	tbl := align.NewTable(false)
+	n := renderStatSample(tbl, &res, v, Config{}, time.Time{})
 	assert.Equal(t, 2, n)
 
-	// rewind to beginning
-	_, err = f.Seek(0, io.SeekStart)
-	assert.NoError(t, err)
-
-	// read file
-	got, err := ioutil.ReadAll(f)
-	assert.NoError(t, err)
-
 	// read wanted
 	want, err := ioutil.ReadFile("testdata/report_entry_sample.golden")
 	assert.NoError(t, err)
 
-	// compare created and wanted
-	assert.Equal(t, want, got)
-
-	// cleanup
-	assert.NoError(t, f.Close())
-	assert.NoError(t, os.Remove(fname))
+	// compare rendered and wanted
+	assert.Equal(t, want, tbl.Bytes())
 }
 
 func Test_describeReport(t *testing.T) {
@@ -500,6 +590,7 @@ func Test_describeReport(t *testing.T) {
 		{report: "indexes", want: pgStatIndexesDescription},
 		{report: "functions", want: pgStatFunctionsDescription},
 		{report: "sizes", want: pgStatSizesDescription},
+		{report: "cpustat", want: pgcenterCpuStatDescription},
 		{report: "progress_vacuum", want: pgStatProgressVacuumDescription},
 		{report: "progress_cluster", want: pgStatProgressClusterDescription},
 		{report: "progress_index", want: pgStatProgressCreateIndexDescription},
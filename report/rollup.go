@@ -0,0 +1,243 @@
+package report
+
+import (
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/sketch"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/lesovsky/pgcenter/internal/view"
+	"sort"
+	"time"
+)
+
+// rollupAggregates defines names of aggregates calculated for diffed columns in every rollup window.
+var rollupAggregates = []string{"min", "max", "avg", "p50", "p95", "p99"}
+
+// rollupQuantiles defines quantiles corresponding to 'pNN' aggregates.
+var rollupQuantiles = []float64{0.5, 0.95, 0.99}
+
+// rollupRow keeps aggregated values of the single row, identified by the value of unique key, within rollup window.
+type rollupRow struct {
+	labels []string        // values of non-diffed columns, taken when row appears in the window
+	stats  []sketch.Sketch // sketches of values of diffed columns
+}
+
+// rollup aggregates deltas in time windows. Deltas are aggregated per unique key, every diffed column is aggregated
+// into streaming sketch, hence memory doesn't depend on number of deltas in the window.
+type rollup struct {
+	window    time.Duration
+	start     time.Time             // start of the current window
+	ukey      int                   // index of the column with unique key
+	diffCols  []int                 // indexes of diffed columns
+	labelCols []int                 // indexes of other columns
+	orderKey  int                   // index of diffed column which average is used for sorting rows, -1 if not sorted
+	orderDesc bool                  // use descending order
+	rows      map[string]*rollupRow // rows of the current window by unique key
+	order     []*rollupRow          // rows of the current window in order of their appearance
+	free      []*rollupRow          // rows of past windows kept for reuse
+}
+
+// newRollup creates rollup of deltas of the view with passed columns.
+func newRollup(window time.Duration, v view.View, cols []string) *rollup {
+	r := &rollup{
+		window:    window,
+		ukey:      v.UniqueKey,
+		orderKey:  -1,
+		orderDesc: v.OrderDesc,
+		rows:      map[string]*rollupRow{},
+	}
+
+	for i := range cols {
+		if i >= v.DiffIntvl[0] && i <= v.DiffIntvl[1] {
+			if i == v.OrderKey {
+				r.orderKey = len(r.diffCols)
+			}
+			r.diffCols = append(r.diffCols, i)
+		} else {
+			r.labelCols = append(r.labelCols, i)
+		}
+	}
+
+	return r
+}
+
+// add aggregates values of the delta into the current window.
+func (r *rollup) add(res *stat.PGresult) {
+	for row := 0; row < res.Nrows; row++ {
+		key := res.Value(row, r.ukey)
+		rr, ok := r.rows[key]
+		if !ok {
+			rr = r.newRow()
+			for _, col := range r.labelCols {
+				rr.labels = append(rr.labels, res.Value(row, col))
+			}
+			r.rows[key] = rr
+			r.order = append(r.order, rr)
+		}
+
+		for i, col := range r.diffCols {
+			if v, ok := res.Columns[col].Float64(row); ok {
+				rr.stats[i].Add(v)
+			}
+		}
+	}
+}
+
+// newRow returns empty row, rows of past windows are reused.
+func (r *rollup) newRow() *rollupRow {
+	if n := len(r.free); n > 0 {
+		rr := r.free[n-1]
+		r.free = r.free[:n-1]
+		return rr
+	}
+
+	return &rollupRow{stats: make([]sketch.Sketch, len(r.diffCols))}
+}
+
+// result returns aggregates of the current window: values of non-diffed columns of the row followed by name of diffed
+// column and its aggregates, rows are produced for every diffed column. Window is reset.
+func (r *rollup) result(cols []string) stat.PGresult {
+	if r.orderKey >= 0 {
+		sort.SliceStable(r.order, func(i, j int) bool {
+			a, b := r.order[i].stats[r.orderKey].Avg(), r.order[j].stats[r.orderKey].Avg()
+			if r.orderDesc {
+				return a > b
+			}
+			return a < b
+		})
+	}
+
+	res := stat.PGresult{Valid: true}
+	for _, col := range r.labelCols {
+		res.Cols = append(res.Cols, cols[col])
+	}
+	res.Cols = append(res.Cols, "metric")
+	res.Cols = append(res.Cols, rollupAggregates...)
+	res.Ncols = len(res.Cols)
+	res.Columns = make([]stat.Column, res.Ncols)
+
+	nlabels := len(r.labelCols)
+	for i := range res.Columns {
+		if i > nlabels {
+			res.Columns[i] = stat.Column{Type: stat.FloatColumn, Prec: 2}
+		}
+	}
+
+	for _, rr := range r.order {
+		for i, col := range r.diffCols {
+			s := &rr.stats[i]
+			if s.Count() == 0 {
+				continue
+			}
+
+			for j, label := range rr.labels {
+				res.Columns[j].Text = append(res.Columns[j].Text, label)
+			}
+			res.Columns[nlabels].Text = append(res.Columns[nlabels].Text, cols[col])
+
+			values := res.Columns[nlabels+1:]
+			values[0].Float = append(values[0].Float, s.Min())
+			values[1].Float = append(values[1].Float, s.Max())
+			values[2].Float = append(values[2].Float, s.Avg())
+			for k, q := range rollupQuantiles {
+				values[3+k].Float = append(values[3+k].Float, s.Quantile(q))
+			}
+			res.Nrows++
+		}
+	}
+
+	r.reset()
+	return res
+}
+
+// reset empties the window, rows are kept for reuse.
+func (r *rollup) reset() {
+	for _, rr := range r.order {
+		rr.labels = rr.labels[:0]
+		for i := range rr.stats {
+			rr.stats[i].Reset()
+		}
+		r.free = append(r.free, rr)
+	}
+	r.order = r.order[:0]
+	for k := range r.rows {
+		delete(r.rows, k)
+	}
+}
+
+// rollupStats aggregates deltas in time windows of configured length, aggregates of every window are sent when deltas
+// of the next window arrive, aggregates of the last window are sent at the end of deltas. Item with error is sent
+// as the last one.
+func (app *app) rollupStats(in <-chan *reportItem, done <-chan struct{}) <-chan *reportItem {
+	out := make(chan *reportItem, cap(in))
+
+	go func() {
+		defer close(out)
+
+		var r *rollup
+		var cols []string
+		var seq int
+
+		c := app.config
+		v := view.View{Name: app.view.Name, ColsWidth: map[int]int{}}
+
+		send := func(item *reportItem) bool {
+			item.seq = seq
+			seq++
+			select {
+			case out <- item:
+				return true
+			case <-done:
+				return false
+			}
+		}
+
+		// flush sends aggregates of the current window.
+		flush := func() bool {
+			res := r.result(cols)
+
+			// Columns are aligned using the first window.
+			formatStatSample(&res, &v, c)
+
+			return send(&reportItem{
+				entry: statEntry{report: c.ReportType, ts: r.start},
+				diff:  res,
+				view:  v,
+			})
+		}
+
+		for item := range in {
+			if item.err != nil {
+				send(item)
+				return
+			}
+
+			if r == nil {
+				if app.view.DiffIntvl == [2]int{0, 0} {
+					item.err = fmt.Errorf("rollup is not supported by %s report, it has no diffed columns", c.ReportType)
+					send(item)
+					return
+				}
+
+				cols = item.diff.Cols
+				r = newRollup(c.Rollup, item.view, cols)
+				r.start = item.entry.ts.Truncate(c.Rollup)
+			}
+
+			// Delta of the next window.
+			if start := item.entry.ts.Truncate(r.window); !start.Equal(r.start) {
+				if len(r.order) > 0 && !flush() {
+					return
+				}
+				r.start = start
+			}
+
+			r.add(&item.diff)
+		}
+
+		if r != nil && len(r.order) > 0 {
+			flush()
+		}
+	}()
+
+	return out
+}
@@ -0,0 +1,98 @@
+package report
+
+import (
+	"bytes"
+	"database/sql"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/lesovsky/pgcenter/internal/view"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"strings"
+	"testing"
+	"time"
+)
+
+func Test_rollup(t *testing.T) {
+	cols := []string{"name", "calls", "time"}
+	v := view.View{DiffIntvl: [2]int{1, 2}, UniqueKey: 0, OrderKey: 1, OrderDesc: true}
+	r := newRollup(time.Minute, v, cols)
+
+	for _, values := range [][][]sql.NullString{
+		{{{String: "b", Valid: true}, {String: "1", Valid: true}, {String: "5", Valid: true}}, {{String: "a", Valid: true}, {String: "10", Valid: true}, {String: "1", Valid: true}}},
+		{{{String: "b", Valid: true}, {String: "3", Valid: true}, {String: "", Valid: false}}, {{String: "a", Valid: true}, {String: "20", Valid: true}, {String: "2", Valid: true}}},
+		{{{String: "a", Valid: true}, {String: "30", Valid: true}, {String: "3", Valid: true}}},
+	} {
+		res := stat.NewPGresultFromValues(cols, values)
+		r.add(&res)
+	}
+
+	got := r.result(cols)
+	assert.Equal(t, []string{"name", "metric", "min", "max", "avg", "p50", "p95", "p99"}, got.Cols)
+	assert.Equal(t, 4, got.Nrows)
+
+	// Rows are ordered by average of the order column, NULLs are not aggregated.
+	want := []struct {
+		name, metric string
+		min, max     float64
+		avg, p50     float64
+	}{
+		{name: "a", metric: "calls", min: 10, max: 30, avg: 20, p50: 20},
+		{name: "a", metric: "time", min: 1, max: 3, avg: 2, p50: 2},
+		{name: "b", metric: "calls", min: 1, max: 3, avg: 2, p50: 1},
+		{name: "b", metric: "time", min: 5, max: 5, avg: 5, p50: 5},
+	}
+	for i, w := range want {
+		assert.Equal(t, w.name, got.Value(i, 0))
+		assert.Equal(t, w.metric, got.Value(i, 1))
+		assert.Equal(t, w.min, got.Columns[2].Float[i])
+		assert.Equal(t, w.max, got.Columns[3].Float[i])
+		assert.Equal(t, w.avg, got.Columns[4].Float[i])
+		assert.InDelta(t, w.p50, got.Columns[5].Float[i], w.p50*0.01)
+	}
+
+	// Window is reset, rows are reused.
+	assert.Len(t, r.order, 0)
+	assert.Len(t, r.free, 2)
+	res := stat.NewPGresultFromValues(cols, [][]sql.NullString{{{String: "c", Valid: true}, {String: "7", Valid: true}, {String: "1", Valid: true}}})
+	r.add(&res)
+	got = r.result(cols)
+	assert.Equal(t, 2, got.Nrows)
+	assert.Equal(t, "c", got.Value(0, 0))
+	assert.Equal(t, "7.00", got.Value(0, 2))
+}
+
+func Test_app_doReport_rollup(t *testing.T) {
+	config := Config{ReportType: "tables", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now(), Workers: 2}
+	entries := readTestEntries(t, config)
+	assert.Greater(t, len(entries), 2)
+
+	// Windows longer than recording produce single window, windows equal to rate produce window per delta.
+	for _, tc := range []struct {
+		rollup  time.Duration
+		windows int
+	}{
+		{rollup: 24 * time.Hour, windows: 1},
+		{rollup: time.Second, windows: len(entries) - 1},
+	} {
+		config.Rollup = tc.rollup
+		app := newApp(config)
+		var buf bytes.Buffer
+		app.writer = &buf
+
+		assert.NoError(t, app.doReport(&testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF}))
+
+		var windows int
+		for _, line := range strings.Split(buf.String(), "\n") {
+			if line != "" && !strings.HasPrefix(line, " ") {
+				windows++
+			}
+		}
+		assert.Equal(t, tc.windows, windows)
+	}
+
+	// Report without diffed columns can't be rolled up.
+	config = Config{ReportType: "activity", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now(), Rollup: time.Minute}
+	app := newApp(config)
+	app.writer = &bytes.Buffer{}
+	assert.Error(t, app.doReport(&testStatReader{entries: readTestEntries(t, config), err: io.EOF}))
+}
@@ -0,0 +1,260 @@
+package report
+
+import (
+	"container/heap"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/lesovsky/pgcenter/internal/view"
+)
+
+// topKey keeps totals of the single row, identified by the value of unique key, accumulated over all snapshots.
+type topKey struct {
+	key    string
+	labels []string  // values of non-accumulated columns, taken from the last snapshot where row has been seen
+	last   []float64 // values of accumulated columns in the last snapshot where row has been seen
+	total  []float64 // totals of accumulated columns
+}
+
+// topTotals accumulates totals of counters over snapshots. Difference between consecutive values of the counter is
+// added to the total; when the value decreases, the counter has been reset and its value is added as is. Values of rows
+// present in the first snapshot are considered as the start point, rows appeared later are counted from zero.
+type topTotals struct {
+	ukey      int                // index of the column with unique key
+	diffCols  []int              // indexes of accumulated columns
+	labelCols []int              // indexes of other columns
+	keys      map[string]*topKey // totals by unique key
+	first     bool               // the first snapshot is being accumulated
+}
+
+// newTopTotals creates totals of the view with passed columns.
+func newTopTotals(v view.View, cols []string) *topTotals {
+	t := &topTotals{ukey: v.UniqueKey, keys: map[string]*topKey{}, first: true}
+
+	for i := range cols {
+		if i >= v.DiffIntvl[0] && i <= v.DiffIntvl[1] {
+			t.diffCols = append(t.diffCols, i)
+		} else {
+			t.labelCols = append(t.labelCols, i)
+		}
+	}
+
+	return t
+}
+
+// add accumulates values of the snapshot.
+func (t *topTotals) add(res *stat.PGresult) {
+	for row := 0; row < res.Nrows; row++ {
+		key := res.Value(row, t.ukey)
+		k, ok := t.keys[key]
+		if !ok {
+			n := len(t.diffCols)
+			values := make([]float64, 2*n)
+			k = &topKey{key: key, labels: make([]string, len(t.labelCols)), last: values[:n], total: values[n:]}
+			t.keys[key] = k
+		}
+
+		for i, col := range t.labelCols {
+			k.labels[i] = res.Value(row, col)
+		}
+
+		for i, col := range t.diffCols {
+			v, ok := res.Columns[col].Float64(row)
+			if !ok {
+				continue
+			}
+
+			switch {
+			case t.first:
+			case v >= k.last[i]:
+				k.total[i] += v - k.last[i]
+			default:
+				k.total[i] += v
+			}
+			k.last[i] = v
+		}
+	}
+
+	t.first = false
+}
+
+// topHeap is the min-heap of keys ordered by totals of the column, keys with the same totals are ordered by key.
+type topHeap struct {
+	keys []*topKey
+	col  int // index of the total used for ordering
+}
+
+func (h *topHeap) Len() int { return len(h.keys) }
+
+func (h *topHeap) Less(i, j int) bool {
+	a, b := h.keys[i], h.keys[j]
+	if a.total[h.col] != b.total[h.col] {
+		return a.total[h.col] < b.total[h.col]
+	}
+	return a.key > b.key
+}
+
+func (h *topHeap) Swap(i, j int) { h.keys[i], h.keys[j] = h.keys[j], h.keys[i] }
+
+func (h *topHeap) Push(x interface{}) { h.keys = append(h.keys, x.(*topKey)) }
+
+func (h *topHeap) Pop() interface{} {
+	n := len(h.keys)
+	k := h.keys[n-1]
+	h.keys = h.keys[:n-1]
+	return k
+}
+
+// result returns N rows with the largest totals of the column, in descending order. Columns of the result are the same
+// as columns of snapshots, accumulated columns contain totals. Rows which don't satisfy the filter are skipped. Only N
+// rows are kept in the heap, hence selecting doesn't depend on number of keys.
+func (t *topTotals) result(res *stat.PGresult, n int, col int, filter *stat.Filter) stat.PGresult {
+	var idx int
+	for i, c := range t.diffCols {
+		if c == col {
+			idx = i
+		}
+	}
+
+	// Row used for checking the filter.
+	row := t.newResult(res, 1)
+
+	h := &topHeap{keys: make([]*topKey, 0, n+1), col: idx}
+	for _, k := range t.keys {
+		if filter != nil {
+			row.Nrows = 0
+			t.appendRow(&row, k)
+			if !filter.Match(&row, 0) {
+				continue
+			}
+		}
+
+		heap.Push(h, k)
+		if h.Len() > n {
+			heap.Pop(h)
+		}
+	}
+
+	top := make([]*topKey, h.Len())
+	for i := len(top) - 1; i >= 0; i-- {
+		top[i] = heap.Pop(h).(*topKey)
+	}
+
+	out := t.newResult(res, len(top))
+	for _, k := range top {
+		t.appendRow(&out, k)
+	}
+
+	return out
+}
+
+// newResult creates empty result with columns of the snapshot. Accumulated columns are floats formatted with precision
+// of snapshot's values, integers are formatted without fractional part.
+func (t *topTotals) newResult(res *stat.PGresult, size int) stat.PGresult {
+	out := stat.PGresult{Cols: res.Cols, Ncols: res.Ncols, Valid: true, Columns: make([]stat.Column, res.Ncols)}
+	for _, col := range t.labelCols {
+		out.Columns[col].Text = make([]string, 0, size)
+	}
+	for _, col := range t.diffCols {
+		c := &out.Columns[col]
+		c.Type = stat.FloatColumn
+		c.Float = make([]float64, 0, size)
+		switch res.Columns[col].Type {
+		case stat.FloatColumn:
+			c.Prec = res.Columns[col].Prec
+		case stat.TextColumn:
+			c.Prec = 2
+		}
+	}
+	return out
+}
+
+// appendRow appends totals of the key into the result.
+func (t *topTotals) appendRow(res *stat.PGresult, k *topKey) {
+	if res.Nrows == 0 {
+		for i := range res.Columns {
+			res.Columns[i].Text = res.Columns[i].Text[:0]
+			res.Columns[i].Float = res.Columns[i].Float[:0]
+		}
+	}
+
+	for i, col := range t.labelCols {
+		res.Columns[col].Text = append(res.Columns[col].Text, k.labels[i])
+	}
+	for i, col := range t.diffCols {
+		res.Columns[col].Float = append(res.Columns[col].Float, k.total[i])
+	}
+	res.Nrows++
+}
+
+// topStats accumulates totals over all snapshots and sends the single item with N rows with the largest totals of the
+// requested column. Item with error is sent as the last one.
+func (app *app) topStats(in <-chan *reportItem, done <-chan struct{}) <-chan *reportItem {
+	out := make(chan *reportItem, 1)
+
+	go func() {
+		defer close(out)
+
+		c := app.config
+		v := app.view
+
+		send := func(item *reportItem) {
+			select {
+			case out <- item:
+			case <-done:
+			}
+		}
+
+		var totals *topTotals
+		var filter *stat.Filter
+		var last *reportItem
+		var col int
+
+		for items := range reorder(in, done) {
+			for _, item := range items {
+				if item.err != nil {
+					item.seq = 0
+					send(item)
+					return
+				}
+
+				// When first data read, list of columns is known and it is possible to check the column.
+				if totals == nil {
+					var ok bool
+					col, ok = getColumnIndex(item.entry.res.Cols, c.TopBy)
+					if !ok || col < v.DiffIntvl[0] || col > v.DiffIntvl[1] || v.DiffIntvl == [2]int{0, 0} {
+						item.err = fmt.Errorf("column %s is not a counter of %s report, totals can't be accumulated", c.TopBy, c.ReportType)
+						item.seq = 0
+						send(item)
+						return
+					}
+
+					// Filter is checked against totals, hence all conditions are checked without diff.
+					filter, item.err = c.Filter.Compile(item.entry.res.Cols, [2]int{0, 0})
+					if item.err != nil {
+						item.seq = 0
+						send(item)
+						return
+					}
+
+					totals = newTopTotals(v, item.entry.res.Cols)
+				}
+
+				totals.add(&item.entry.res)
+				last = item
+			}
+		}
+
+		if totals == nil {
+			return
+		}
+
+		res := totals.result(&last.entry.res, c.Top, col, filter)
+
+		v.Aligned = false
+		formatStatSample(&res, &v, c)
+
+		send(&reportItem{entry: statEntry{report: c.ReportType, ts: last.entry.ts}, diff: res, view: v})
+	}()
+
+	return out
+}
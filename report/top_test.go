@@ -0,0 +1,109 @@
+package report
+
+import (
+	"bytes"
+	"database/sql"
+	"fmt"
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/lesovsky/pgcenter/internal/view"
+	"github.com/stretchr/testify/assert"
+	"io"
+	"strings"
+	"testing"
+	"time"
+)
+
+func Test_topTotals(t *testing.T) {
+	cols := []string{"name", "calls"}
+	v := view.View{DiffIntvl: [2]int{1, 1}, UniqueKey: 0}
+	totals := newTopTotals(v, cols)
+
+	for _, values := range [][][]sql.NullString{
+		{{{String: "a", Valid: true}, {String: "100", Valid: true}}, {{String: "b", Valid: true}, {String: "50", Valid: true}}},
+		// 'c' appears and is counted from zero.
+		{{{String: "a", Valid: true}, {String: "150", Valid: true}}, {{String: "b", Valid: true}, {String: "60", Valid: true}}, {{String: "c", Valid: true}, {String: "10", Valid: true}}},
+		// 'a' is reset, 'b' disappears.
+		{{{String: "a", Valid: true}, {String: "20", Valid: true}}, {{String: "c", Valid: true}, {String: "30", Valid: true}}},
+		// 'b' appears again.
+		{{{String: "a", Valid: true}, {String: "40", Valid: true}}, {{String: "b", Valid: true}, {String: "70", Valid: true}}, {{String: "c", Valid: true}, {String: "", Valid: false}}},
+	} {
+		res := stat.NewPGresultFromValues(cols, values)
+		totals.add(&res)
+	}
+
+	last := stat.NewPGresultFromValues(cols, [][]sql.NullString{{{String: "a", Valid: true}, {String: "40", Valid: true}}})
+
+	got := totals.result(&last, 2, 1, nil)
+	assert.Equal(t, 2, got.Nrows)
+	assert.Equal(t, []string{"a", "c"}, got.Columns[0].Text)
+	assert.Equal(t, []float64{90, 30}, got.Columns[1].Float)
+	assert.Equal(t, "90", got.Value(0, 1))
+
+	// Filter is checked against totals.
+	e, err := stat.ParseFilter("name != a AND calls < 100")
+	assert.NoError(t, err)
+	f, err := e.Compile(cols, [2]int{0, 0})
+	assert.NoError(t, err)
+
+	got = totals.result(&last, 10, 1, f)
+	assert.Equal(t, []string{"c", "b"}, got.Columns[0].Text)
+	assert.Equal(t, []float64{30, 20}, got.Columns[1].Float)
+}
+
+func Test_app_doReport_top(t *testing.T) {
+	config := Config{ReportType: "tables", TruncLimit: 32, Rate: time.Second, TsEnd: time.Now(), Workers: 2, Top: 3, TopBy: "seq_scan"}
+	entries := readTestEntries(t, config)
+	assert.Greater(t, len(entries), 2)
+
+	app := newApp(config)
+	var buf bytes.Buffer
+	app.writer = &buf
+	assert.NoError(t, app.doReport(&testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF}))
+
+	// Header and three rows ordered by totals.
+	lines := strings.Split(strings.TrimSuffix(buf.String(), "\n"), "\n")
+	assert.Len(t, lines, 4)
+	assert.Contains(t, lines[0], "seq_scan")
+	assert.True(t, strings.HasPrefix(lines[1], entries[len(entries)-1].ts.Format("15:04:05")))
+
+	var prev float64 = -1
+	for _, line := range lines[1:] {
+		var v float64
+		_, err := fmt.Sscan(strings.Fields(line[9:])[1], &v)
+		assert.NoError(t, err)
+		if prev >= 0 {
+			assert.GreaterOrEqual(t, prev, v)
+		}
+		prev = v
+	}
+
+	// Column which is not a counter.
+	config.TopBy = "relation"
+	app = newApp(config)
+	app.writer = &bytes.Buffer{}
+	assert.Error(t, app.doReport(&testStatReader{entries: append([]statEntry{}, entries...), err: io.EOF}))
+}
+
+// BenchmarkTopTotals accumulates 100k keys over 10 snapshots and selects top 10 of them.
+func BenchmarkTopTotals(b *testing.B) {
+	cols := []string{"queryid", "calls"}
+	snapshots := make([]stat.PGresult, 10)
+	for i := range snapshots {
+		values := make([][]sql.NullString, 100000)
+		for j := range values {
+			values[j] = []sql.NullString{{String: fmt.Sprintf("q%d", j), Valid: true}, {String: fmt.Sprint(j * (i + 1)), Valid: true}}
+		}
+		snapshots[i] = stat.NewPGresultFromValues(cols, values)
+	}
+	v := view.View{DiffIntvl: [2]int{1, 1}, UniqueKey: 0}
+	b.ReportAllocs()
+	b.ResetTimer()
+
+	for i := 0; i < b.N; i++ {
+		totals := newTopTotals(v, cols)
+		for j := range snapshots {
+			totals.add(&snapshots[j])
+		}
+		_ = totals.result(&snapshots[len(snapshots)-1], 10, 1, nil)
+	}
+}
@@ -1,6 +1,7 @@
 package top
 
 import (
+	"github.com/lesovsky/pgcenter/internal/align"
 	"github.com/lesovsky/pgcenter/internal/query"
 	"github.com/lesovsky/pgcenter/internal/stat"
 	"github.com/lesovsky/pgcenter/internal/view"
@@ -16,6 +17,7 @@ type config struct {
 	dialog       dialogType     // Remember current user-started dialog, used for selecting needed dialog handler.
 	menu         menuStyle      // When working with menus, keep properties of the menu.
 	procMask     int            // Process mask used for selecting group of process.
+	table        *align.Table   // Table used for rendering stats, its buffer is reused between refreshes.
 }
 
 // newConfig creates 'top' initial configuration.
@@ -25,5 +27,6 @@ func newConfig() *config {
 	return &config{
 		views:  views,
 		viewCh: make(chan view.View),
+		table:  align.NewTable(true),
 	}
 }
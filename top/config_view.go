@@ -5,7 +5,6 @@ import (
 	"github.com/jroimartin/gocui"
 	"github.com/lesovsky/pgcenter/internal/math"
 	"github.com/lesovsky/pgcenter/internal/query"
-	"github.com/lesovsky/pgcenter/internal/view"
 	"regexp"
 	"strconv"
 	"time"
@@ -79,22 +78,35 @@ func switchSortOrder(config *config) func(g *gocui.Gui, _ *gocui.View) error {
 	}
 }
 
-// setFilter adds pattern for filtering values in the current column.
-func setFilter(answer string, view view.View) string {
+// setFilter adds pattern for filtering values in the current column. Filters are applied by stats collector, hence
+// filters are replaced instead of modifying them in place.
+func setFilter(answer string, config *config) string {
+	filters := make(map[int]*regexp.Regexp, len(config.view.Filters)+1)
+	for k, v := range config.view.Filters {
+		filters[k] = v
+	}
+
+	var message string
+
 	// Clear used pattern if empty string is entered.
 	if answer == "\n" || answer == "" {
-		delete(view.Filters, view.OrderKey)
-		return "Filters: regular expression cleared"
-	}
+		delete(filters, config.view.OrderKey)
+		message = "Filters: regular expression cleared"
+	} else {
+		// Compile regexp and store to filters.
+		re, err := regexp.Compile(answer)
+		if err != nil {
+			return fmt.Sprintf("Filters: %s", err)
+		}
 
-	// Compile regexp and store to filters.
-	re, err := regexp.Compile(answer)
-	if err != nil {
-		return fmt.Sprintf("Filters: %s", err)
+		filters[config.view.OrderKey] = re
+		message = "Filters: ok"
 	}
 
-	view.Filters[view.OrderKey] = re
-	return "Filters: ok"
+	config.view.Filters = filters
+	config.viewCh <- config.view
+
+	return message
 }
 
 // switchViewTo switches from current view to requested using high-level logic.
@@ -285,18 +297,18 @@ func changeRefresh(answer string, config *config) string {
 		return "Refresh: do nothing"
 	}
 
-	interval, err := strconv.Atoi(answer)
+	interval, err := strconv.ParseFloat(answer, 64)
 	if err != nil {
 		return "Refresh: do nothing, invalid input"
 	}
 
-	if interval < 1 || interval > 300 {
-		return "Refresh: input value should be between 1 and 300"
+	if interval < 0.1 || interval > 300 {
+		return "Refresh: input value should be between 0.1 and 300"
 	}
 
 	// Set refresh interval, send it to stats channel and reset interval in the view.
 	// Refresh interval should not be saved as a per-view setting. It's used as a setting for stats goroutine.
-	config.view.Refresh = time.Duration(interval) * time.Second
+	config.view.Refresh = time.Duration(interval * float64(time.Second))
 	config.viewCh <- config.view
 	config.view.Refresh = 0
 
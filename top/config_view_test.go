@@ -3,6 +3,7 @@ package top
 import (
 	"fmt"
 	"github.com/stretchr/testify/assert"
+	"strings"
 	"sync"
 	"testing"
 	"time"
@@ -176,8 +177,9 @@ func Test_setFilter(t *testing.T) {
 	testcases := []struct {
 		answer string
 		want   string
+		set    bool
 	}{
-		{answer: "example", want: "Filters: ok"},
+		{answer: "example", want: "Filters: ok", set: true},
 		{answer: "", want: "Filters: regular expression cleared"},
 		{answer: "\n", want: "Filters: regular expression cleared"},
 		{answer: "[0-", want: "Filters: error parsing regexp: missing closing ]: `[0-`"},
@@ -188,7 +190,26 @@ func Test_setFilter(t *testing.T) {
 	config.view.OrderKey = 0
 
 	for _, tc := range testcases {
-		assert.Equal(t, tc.want, setFilter(tc.answer, config.view))
+		filters := config.view.Filters
+		valid := !strings.HasPrefix(tc.want, "Filters: error")
+
+		wg := sync.WaitGroup{}
+		if valid {
+			wg.Add(1)
+			go func() {
+				v := <-config.viewCh
+				assert.Equal(t, tc.set, v.Filters[0] != nil)
+				wg.Done()
+			}()
+		}
+
+		assert.Equal(t, tc.want, setFilter(tc.answer, config))
+		wg.Wait()
+
+		// Filters sent to collector are not modified in place.
+		if valid {
+			assert.NotEqual(t, fmt.Sprintf("%p", filters), fmt.Sprintf("%p", config.view.Filters))
+		}
 	}
 }
 
@@ -440,18 +461,36 @@ func Test_changeRefresh(t *testing.T) {
 		close(config.viewCh)
 	})
 
+	t.Run("sub-second", func(t *testing.T) {
+		config := newConfig()
+		config.view = config.views["activity"]
+		wg := sync.WaitGroup{}
+
+		wg.Add(1)
+		go func() {
+			v := <-config.viewCh
+			assert.Equal(t, v.Refresh, 250*time.Millisecond)
+			wg.Done()
+		}()
+
+		assert.Equal(t, "Refresh: ok", changeRefresh("0.25", config))
+		wg.Wait()
+		close(config.viewCh)
+	})
+
 	// test invalid input
 	t.Run("invalid input", func(t *testing.T) {
 		config := newConfig()
 		config.view = config.views["activity"]
 
 		testcases := map[string]string{
-			"":    "Refresh: do nothing",
-			"a":   "Refresh: do nothing, invalid input",
-			"0.5": "Refresh: do nothing, invalid input",
-			"-1":  "Refresh: input value should be between 1 and 300",
-			"0":   "Refresh: input value should be between 1 and 300",
-			"301": "Refresh: input value should be between 1 and 300",
+			"":     "Refresh: do nothing",
+			"a":    "Refresh: do nothing, invalid input",
+			"1s":   "Refresh: do nothing, invalid input",
+			"-1":   "Refresh: input value should be between 0.1 and 300",
+			"0":    "Refresh: input value should be between 0.1 and 300",
+			"0.05": "Refresh: input value should be between 0.1 and 300",
+			"301":  "Refresh: input value should be between 0.1 and 300",
 		}
 		for k, v := range testcases {
 			config.view.Refresh = 1 * time.Second
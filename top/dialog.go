@@ -36,7 +36,7 @@ func dialogPrompts(t dialogType) string {
 		dialogSetMask:          "Set state mask for group backends [a: active, i: idle, x: idle_xact, w: waiting, o: others]: ",
 		dialogChangeAge:        "Enter new min age, format: HH:MM:SS[.NN]: ",
 		dialogQueryReport:      "Enter the queryid: ",
-		dialogChangeRefresh:    "Change refresh (min 1, max 300) to ",
+		dialogChangeRefresh:    "Change refresh (min 0.1, max 300) to ",
 	}
 
 	return prompts[t]
@@ -118,7 +118,7 @@ func dialogFinish(app *app) func(g *gocui.Gui, v *gocui.View) error {
 		case dialogPgReload:
 			message = doReload(answer, app.db)
 		case dialogFilter:
-			message = setFilter(answer, app.config.view)
+			message = setFilter(answer, app.config)
 		case dialogCancelQuery:
 			message = killSingle(app.db, "cancel", answer)
 		case dialogTerminateBackend:
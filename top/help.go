@@ -20,7 +20,7 @@ general actions:
     l                 open log file with pager.
 
 extra stats actions:
-    B,N,L       'B' diskstat, 'N' nicstat, 'L' logtail.
+    B,N,L,U     'B' diskstat, 'N' nicstat, 'L' logtail, 'U' per-CPU stat.
 
 activity actions:
     -,_         '-' cancel backend by pid, '_' terminate backend by pid.
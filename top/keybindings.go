@@ -45,6 +45,7 @@ func keybindings(app *app) error {
 		{"sysstat", 'B', showExtra(app, stat.CollectDiskstats)},
 		{"sysstat", 'N', showExtra(app, stat.CollectNetdev)},
 		{"sysstat", 'L', showExtra(app, stat.CollectLogtail)},
+		{"sysstat", 'U', showExtra(app, stat.CollectCpustats)},
 		{"sysstat", 'R', dialogOpen(app, dialogPgReload)},
 		{"sysstat", '/', dialogOpen(app, dialogFilter)},
 		{"sysstat", '-', dialogOpen(app, dialogCancelQuery)},
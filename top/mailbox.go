@@ -0,0 +1,140 @@
+// Stats mailbox decouples collecting of stats from rendering them in UI. Collector publishes every snapshot into a
+// single-slot mailbox, a snapshot which has not been rendered yet is replaced by the newer one. UI takes snapshots from
+// the mailbox when it is signalled about unread snapshot, hence slow redraws don't stall collecting and slow collecting
+// doesn't stall UI.
+
+package top
+
+import (
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// frameMetrics describes how snapshots are passed from collector to UI.
+type frameMetrics struct {
+	published uint64 // number of snapshots published by collector
+	coalesced uint64 // number of snapshots replaced by newer ones before they have been rendered
+	dropped   uint64 // number of frames skipped because redraw of the previous frame has not been finished
+	missed    uint64 // number of collections skipped because previous collecting took longer than refresh interval
+}
+
+// statMailbox is the single-slot mailbox for stats snapshots.
+type statMailbox struct {
+	mu        sync.Mutex
+	stat      stat.Stat
+	unread    bool
+	ready     chan struct{} // signals about unread snapshot which could be taken
+	rendering int32         // non-zero when redraw of the taken snapshot is in progress
+	metrics   frameMetrics
+}
+
+// newStatMailbox creates new empty mailbox.
+func newStatMailbox() *statMailbox {
+	return &statMailbox{ready: make(chan struct{}, 1)}
+}
+
+// put publishes snapshot, unread snapshot is replaced. Never blocks.
+func (m *statMailbox) put(s stat.Stat) {
+	m.mu.Lock()
+	if m.unread {
+		m.metrics.coalesced++
+	}
+	m.stat = s
+	m.unread = true
+	m.metrics.published++
+	m.mu.Unlock()
+
+	m.signal()
+}
+
+// signal signals about unread snapshot, pending signal is not duplicated. Never blocks.
+func (m *statMailbox) signal() {
+	select {
+	case m.ready <- struct{}{}:
+	default:
+	}
+}
+
+// take returns unread snapshot, false is returned if there is no unread snapshot or redraw of the previously taken
+// snapshot is still in progress. In the latter case the frame is accounted as dropped and snapshot is left unread.
+func (m *statMailbox) take() (stat.Stat, bool) {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+
+	if !m.unread {
+		return stat.Stat{}, false
+	}
+
+	if atomic.LoadInt32(&m.rendering) != 0 {
+		m.metrics.dropped++
+		return stat.Stat{}, false
+	}
+
+	m.unread = false
+	atomic.StoreInt32(&m.rendering, 1)
+	return m.stat, true
+}
+
+// rendered marks redraw of the taken snapshot finished. Snapshot which has been left unread during redraw is signalled
+// again.
+func (m *statMailbox) rendered() {
+	atomic.StoreInt32(&m.rendering, 0)
+
+	m.mu.Lock()
+	unread := m.unread
+	m.mu.Unlock()
+
+	if unread {
+		m.signal()
+	}
+}
+
+// addMissed accounts collections skipped by collector.
+func (m *statMailbox) addMissed(n int) {
+	if n <= 0 {
+		return
+	}
+	m.mu.Lock()
+	m.metrics.missed += uint64(n)
+	m.mu.Unlock()
+}
+
+// frameMetrics returns current metrics of the mailbox.
+func (m *statMailbox) frameMetrics() frameMetrics {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	return m.metrics
+}
+
+// schedule defines collecting times aligned to the start of collecting, hence time spent on collecting doesn't
+// accumulate into a drift.
+type schedule struct {
+	start    time.Time
+	interval time.Duration
+	slot     int64 // number of the next collection since the start
+}
+
+// reset starts schedule with passed interval.
+func (s *schedule) reset(now time.Time, interval time.Duration) {
+	s.start, s.interval, s.slot = now, interval, 0
+}
+
+// next returns time left until the next collection and the number of collections which have been missed because
+// previous collecting took longer than interval.
+func (s *schedule) next(now time.Time) (time.Duration, int) {
+	if s.interval <= 0 {
+		return 0, 0
+	}
+
+	s.slot++
+
+	var missed int
+	if n := int64(now.Sub(s.start)/s.interval) + 1; n > s.slot {
+		missed = int(n - s.slot)
+		s.slot = n
+	}
+
+	return s.start.Add(time.Duration(s.slot) * s.interval).Sub(now), missed
+}
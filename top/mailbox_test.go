@@ -0,0 +1,87 @@
+package top
+
+import (
+	"github.com/lesovsky/pgcenter/internal/stat"
+	"github.com/stretchr/testify/assert"
+	"testing"
+	"time"
+)
+
+func Test_statMailbox(t *testing.T) {
+	mb := newStatMailbox()
+
+	// empty mailbox
+	_, ok := mb.take()
+	assert.False(t, ok)
+
+	// unread snapshot is replaced by the newer one
+	mb.put(newTestStat(1))
+	mb.put(newTestStat(2))
+	assert.Len(t, mb.ready, 1)
+
+	s, ok := mb.take()
+	assert.True(t, ok)
+	assert.Equal(t, 2.0, s.LoadAvg.One)
+	_, ok = mb.take()
+	assert.False(t, ok)
+
+	// snapshot is not taken until redraw of the previous one is finished, then it is signalled again
+	mb.put(newTestStat(3))
+	<-mb.ready
+	_, ok = mb.take()
+	assert.False(t, ok)
+	assert.Len(t, mb.ready, 0)
+
+	mb.rendered()
+	assert.Len(t, mb.ready, 1)
+	<-mb.ready
+	s, ok = mb.take()
+	assert.True(t, ok)
+	assert.Equal(t, 3.0, s.LoadAvg.One)
+
+	// nothing is signalled if there is no unread snapshot
+	mb.rendered()
+	assert.Len(t, mb.ready, 0)
+
+	mb.addMissed(2)
+	mb.addMissed(0)
+	assert.Equal(t, frameMetrics{published: 3, coalesced: 1, dropped: 1, missed: 2}, mb.frameMetrics())
+}
+
+func Test_schedule(t *testing.T) {
+	start := time.Date(2021, 1, 23, 15, 31, 0, 0, time.UTC)
+
+	var s schedule
+	s.reset(start, time.Second)
+
+	// time spent on collecting doesn't accumulate
+	wait, missed := s.next(start.Add(300 * time.Millisecond))
+	assert.Equal(t, 700*time.Millisecond, wait)
+	assert.Equal(t, 0, missed)
+
+	wait, missed = s.next(start.Add(1200 * time.Millisecond))
+	assert.Equal(t, 800*time.Millisecond, wait)
+	assert.Equal(t, 0, missed)
+
+	// collecting took longer than interval
+	wait, missed = s.next(start.Add(4500 * time.Millisecond))
+	assert.Equal(t, 500*time.Millisecond, wait)
+	assert.Equal(t, 2, missed)
+
+	wait, missed = s.next(start.Add(5100 * time.Millisecond))
+	assert.Equal(t, 900*time.Millisecond, wait)
+	assert.Equal(t, 0, missed)
+
+	// zero interval
+	s.reset(start, 0)
+	wait, missed = s.next(start.Add(time.Second))
+	assert.Equal(t, time.Duration(0), wait)
+	assert.Equal(t, 0, missed)
+}
+
+// newTestStat creates stats snapshot with passed load average.
+func newTestStat(la float64) stat.Stat {
+	var s stat.Stat
+	s.LoadAvg.One = la
+	return s
+}
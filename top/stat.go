@@ -10,19 +10,21 @@ import (
 	"github.com/lesovsky/pgcenter/internal/postgres"
 	"github.com/lesovsky/pgcenter/internal/stat"
 	"github.com/lesovsky/pgcenter/internal/view"
+	"io"
 	"os"
-	"regexp"
 	"strconv"
 	"time"
 )
 
-// collectStat
-func collectStat(ctx context.Context, db *postgres.DB, statCh chan<- stat.Stat, viewCh <-chan view.View) {
+// collectStat collects stats in loop and publishes them into the mailbox. Stats are collected on schedule aligned to
+// the start of collecting, independently of rendering.
+func collectStat(ctx context.Context, db *postgres.DB, mb *statMailbox, viewCh <-chan view.View) {
 	c, err := stat.NewCollector(db)
 	if err != nil {
 		fmt.Println(err)
 		return
 	}
+	defer func() { _ = c.Close() }()
 
 	// Get current view.
 	v := <-viewCh
@@ -47,26 +49,38 @@ func collectStat(ctx context.Context, db *postgres.DB, statCh chan<- stat.Stat,
 	// Set settings related to extra stats.
 	extra := v.ShowExtra
 
-	// Collect stat in loop and send it to stat channel.
+	var sched schedule
+	sched.reset(time.Now(), refresh)
+
+	// Collect stat in loop and publish it into mailbox.
 	for {
 		// Collect stats.
 		stats, err := c.Update(db, v, refresh)
 		if err != nil {
 			stats.Error = err
 		}
-		statCh <- stats
+		mb.put(stats)
+
+		// Waiting for receiving new view until the next scheduled collecting. When new view has been received, use
+		// its settings to adjust collector's behavior and start schedule again.
+		wait, missed := sched.next(time.Now())
+		mb.addMissed(missed)
 
-		// Waiting for receiving new view until refresh interval expired. When new view has been received, use its
-		// settings to adjust collector's behavior.
-		ticker := time.NewTicker(refresh)
+		timer := time.NewTimer(wait)
 		select {
 		case v = <-viewCh:
+			timer.Stop()
+
 			// Update refresh interval if it is changed.
 			if refresh != v.Refresh && v.Refresh > 0 {
 				refresh = v.Refresh
+				sched.reset(time.Now(), refresh)
 				continue
 			}
 
+			// Stats are collected immediately after the view change, schedule starts from now.
+			sched.reset(time.Now(), refresh)
+
 			// Update settings related to collecting extra stats (enable, disable or switch)
 			if extra != v.ShowExtra {
 				extra = v.ShowExtra
@@ -74,34 +88,34 @@ func collectStat(ctx context.Context, db *postgres.DB, statCh chan<- stat.Stat,
 				continue
 			}
 
-			// When view has been updated, stop the ticker and re-initialize stats.
-			ticker.Stop()
-
+			// When view has been updated, re-initialize stats.
 			c.Reset()
 			_, err = c.Update(db, v, refresh)
 			if err != nil {
-				statCh <- stat.Stat{Error: err}
+				mb.put(stat.Stat{Error: err})
 			}
 
 			continue
 		case <-ctx.Done():
-			ticker.Stop()
+			timer.Stop()
 			return
-		case <-ticker.C:
+		case <-timer.C:
 			continue
 		}
 	}
 }
 
-// printStat prints collected stats in UI.
-func printStat(app *app, s stat.Stat, props stat.PostgresProperties) {
+// printStat prints collected stats in UI. Mailbox is notified when redraw is finished.
+func printStat(app *app, mb *statMailbox, s stat.Stat, props stat.PostgresProperties) {
 	app.ui.Update(func(g *gocui.Gui) error {
+		defer mb.rendered()
+
 		v, err := g.View("sysstat")
 		if err != nil {
 			return fmt.Errorf("set focus on sysstat view failed: %s", err)
 		}
 		v.Clear()
-		err = printSysstat(v, s)
+		err = printSysstat(v, s, mb.frameMetrics())
 		if err != nil {
 			return fmt.Errorf("print sysstat failed: %s", err)
 		}
@@ -146,6 +160,13 @@ func printStat(app *app, s stat.Stat, props stat.PostgresProperties) {
 				if err != nil {
 					return err
 				}
+			case stat.CollectCpustats:
+				v.Clear()
+				_, y := v.Size()
+				err := printCpustat(v, s.CpuStats, y-1)
+				if err != nil {
+					return err
+				}
 			case stat.CollectLogtail:
 				size, buf, err := readLogfileRecent(v, app.config.logtail)
 				if err != nil {
@@ -176,13 +197,13 @@ func printStat(app *app, s stat.Stat, props stat.PostgresProperties) {
 }
 
 // printSysstat prints system stats on UI.
-func printSysstat(v *gocui.View, s stat.Stat) error {
+func printSysstat(v io.Writer, s stat.Stat, m frameMetrics) error {
 	var err error
 
-	/* line1: current time and load average */
-	_, err = fmt.Fprintf(v, "pgcenter: %s, load average: %.2f, %.2f, %.2f\n",
+	/* line1: current time, load average and frames lost on the way from collector to UI, if any */
+	_, err = fmt.Fprintf(v, "pgcenter: %s, load average: %.2f, %.2f, %.2f%s\n",
 		time.Now().Format("2006-01-02 15:04:05"),
-		s.LoadAvg.One, s.LoadAvg.Five, s.LoadAvg.Fifteen)
+		s.LoadAvg.One, s.LoadAvg.Five, s.LoadAvg.Fifteen, formatFrameMetrics(m))
 	if err != nil {
 		return err
 	}
@@ -214,6 +235,15 @@ func printSysstat(v *gocui.View, s stat.Stat) error {
 	return nil
 }
 
+// formatFrameMetrics returns string with number of dropped, coalesced and missed frames, empty string is returned
+// when no frames have been lost.
+func formatFrameMetrics(m frameMetrics) string {
+	if m.dropped == 0 && m.coalesced == 0 && m.missed == 0 {
+		return ""
+	}
+	return fmt.Sprintf(", frames: %d dropped, %d coalesced, %d missed", m.dropped, m.coalesced, m.missed)
+}
+
 // printPgstat prints summary Postgres stats on UI.
 func printPgstat(v *gocui.View, s stat.Stat, props stat.PostgresProperties, db *postgres.DB) error {
 	// line1: details of used connection, version, uptime and recovery status
@@ -289,19 +319,14 @@ func printDbstat(v *gocui.View, config *config, s stat.Stat) error {
 		config.view.Aligned = true
 	}
 
-	// Print header.
-	err := printStatHeader(v, s, config)
-	if err != nil {
-		return err
-	}
+	// Render header and data, and print them at once.
+	config.table.Reset()
+	config.table.SetWidths(config.view.ColsWidth, s.Result.Ncols)
+	printStatHeader(config.table, s, config)
+	printStatData(config.table, s)
 
-	// Print data.
-	err = printStatData(v, s, config, isFilterRequired(config.view.Filters))
-	if err != nil {
-		return err
-	}
-
-	return nil
+	_, err := config.table.WriteTo(v)
+	return err
 }
 
 // formatError returns formatted error string depending on its type.
@@ -319,7 +344,7 @@ func formatError(err error) string {
 }
 
 // printStatHeader prints stats header.
-func printStatHeader(v *gocui.View, s stat.Stat, config *config) error {
+func printStatHeader(t *align.Table, s stat.Stat, config *config) {
 	var pname string
 	for i := 0; i < s.Result.Ncols; i++ {
 		name := s.Result.Cols[i]
@@ -333,74 +358,22 @@ func printStatHeader(v *gocui.View, s stat.Stat, config *config) error {
 
 		// mark ordered column with foreground color
 		if i != config.view.OrderKey {
-			_, err := fmt.Fprintf(v, "\033[%d;%dm%-*s\033[0m", 30, 47, config.view.ColsWidth[i]+2, pname)
-			if err != nil {
-				return err
-			}
+			t.AppendString("\033[30;47m")
 		} else {
-			_, err := fmt.Fprintf(v, "\033[%d;%dm%-*s\033[0m", 47, 1, config.view.ColsWidth[i]+2, pname)
-			if err != nil {
-				return err
-			}
+			t.AppendString("\033[47;1m")
 		}
+		t.AppendHeader(i, pname)
+		t.AppendString("\033[0m")
 	}
-	_, err := fmt.Fprintf(v, "\n")
-	if err != nil {
-		return err
-	}
-
-	return nil
+	t.AppendString("\n")
 }
 
-// printStatData prints stats data.
-func printStatData(v *gocui.View, s stat.Stat, config *config, filter bool) error {
-	var doPrint bool
-	for colnum, rownum := 0, 0; rownum < s.Result.Nrows; rownum, colnum = rownum+1, 0 {
-		// be optimistic, we want to print the row.
-		doPrint = true
-
-		// apply filters using regexp
-		if filter {
-			for i := 0; i < s.Result.Ncols; i++ {
-				if config.view.Filters[i] != nil {
-					if config.view.Filters[i].MatchString(s.Result.Values[rownum][i].String) {
-						doPrint = true
-						break
-					} else {
-						doPrint = false
-					}
-				}
-			}
-		}
-
-		// print values
-		for i := range s.Result.Cols {
-			if doPrint {
-				// truncate values that longer than column width
-				valuelen := len(s.Result.Values[rownum][colnum].String)
-				if valuelen > config.view.ColsWidth[i] {
-					width := config.view.ColsWidth[i]
-					// truncate value up to column width and replace last character with '~' symbol
-					s.Result.Values[rownum][colnum].String = s.Result.Values[rownum][colnum].String[:width-1] + "~"
-				}
-
-				// print value
-				_, err := fmt.Fprintf(v, "%-*s", config.view.ColsWidth[i]+2, s.Result.Values[rownum][colnum].String)
-				if err != nil {
-					return err
-				}
-				colnum++
-			}
-		}
-		if doPrint {
-			_, err := fmt.Fprintf(v, "\n")
-			if err != nil {
-				return err
-			}
-		}
+// printStatData prints stats data. Rows are filtered by collector, hence all received rows are printed.
+func printStatData(t *align.Table, s stat.Stat) {
+	for rownum := 0; rownum < s.Result.Nrows; rownum++ {
+		// print values, values longer than column width are truncated
+		t.AppendRow(&s.Result, rownum)
 	}
-
-	return nil
 }
 
 // printIostat prints extra 'iostat' - block IO devices stats.
@@ -460,6 +433,38 @@ func printNetdev(v *gocui.View, s stat.Netdevs) error {
 	return nil
 }
 
+const (
+	cpuHotspots    = 3  // number of the most utilized CPUs which are highlighted
+	cpuHotspotBusy = 50 // minimal utilization of highlighted CPU, percents
+)
+
+// printCpustat prints per-CPU stats. CPUs are printed in order of descending utilization, limited by passed number of
+// rows; the most utilized CPUs are highlighted.
+func printCpustat(v io.Writer, s stat.CpuStats, rows int) error {
+	// print header
+	_, err := fmt.Fprintf(v, "\033[30;47m    CPU:     %%us     %%sy     %%ni     %%wa     %%hi     %%si     %%st   %%busy\033[0m\n")
+	if err != nil {
+		return err
+	}
+
+	for n, i := range s.Hottest(rows) {
+		color := ""
+		if n < cpuHotspots && s[i].Busy() >= cpuHotspotBusy {
+			color = "\033[31;1m"
+		}
+
+		// print stats
+		_, err := fmt.Fprintf(v, "%s%8s%8.1f%8.1f%8.1f%8.1f%8.1f%8.1f%8.1f%8.1f\033[0m\n",
+			color, s[i].Entry,
+			s[i].User, s[i].Sys, s[i].Nice, s[i].Iowait, s[i].Irq, s[i].Softirq, s[i].Steal, s[i].Busy(),
+		)
+		if err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
 // readLogfileRecent reads necessary number of recent lines in logfile and return them.
 func readLogfileRecent(v *gocui.View, logfile stat.Logfile) (int64, []byte, error) {
 	// Calculate necessary number of lines and buffer size depending on size available screen.
@@ -505,13 +510,3 @@ func printLogtail(v *gocui.View, path string, buf []byte) error {
 
 	return nil
 }
-
-// isFilterRequired returns true if at least one filter regexp is specified.
-func isFilterRequired(f map[int]*regexp.Regexp) bool {
-	for _, v := range f {
-		if v != nil {
-			return true
-		}
-	}
-	return false
-}
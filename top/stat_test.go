@@ -1,11 +1,14 @@
 package top
 
 import (
+	"bytes"
 	"fmt"
 	"github.com/jackc/pgconn"
 	"github.com/jackc/pgx/v4"
 	"github.com/lesovsky/pgcenter/internal/postgres"
+	"github.com/lesovsky/pgcenter/internal/stat"
 	"github.com/stretchr/testify/assert"
+	"strings"
 	"testing"
 )
 
@@ -47,3 +50,24 @@ func Test_formatError(t *testing.T) {
 		assert.Equal(t, tc.want, got)
 	}
 }
+
+func Test_formatFrameMetrics(t *testing.T) {
+	assert.Equal(t, "", formatFrameMetrics(frameMetrics{published: 10}))
+	assert.Equal(t, ", frames: 1 dropped, 2 coalesced, 3 missed", formatFrameMetrics(frameMetrics{published: 10, dropped: 1, coalesced: 2, missed: 3}))
+}
+
+func Test_printCpustat(t *testing.T) {
+	s := stat.CpuStats{
+		{Entry: "cpu0", User: 5, Idle: 95, Total: 100},
+		{Entry: "cpu1", User: 80, Sys: 10, Idle: 10, Total: 100},
+		{Entry: "cpu2", User: 20, Idle: 80, Total: 100},
+	}
+
+	var buf bytes.Buffer
+	assert.NoError(t, printCpustat(&buf, s, 2))
+
+	lines := strings.Split(strings.TrimSuffix(buf.String(), "\n"), "\n")
+	assert.Len(t, lines, 3) // header and two the most utilized CPUs
+	assert.True(t, strings.HasPrefix(lines[1], "\033[31;1m    cpu1"))
+	assert.True(t, strings.HasPrefix(lines[2], "    cpu2"))
+}
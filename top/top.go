@@ -65,6 +65,13 @@ func (app *app) setup() error {
 		return err
 	}
 
+	// Resources usage of local backends is added into activity stats, its columns are sortable as well.
+	if app.db.Local {
+		v := app.config.views["activity"]
+		v.Ncols += len(stat.BackendColumns)
+		app.config.views["activity"] = v
+	}
+
 	// Set default view.
 	app.config.view = app.config.views["activity"]
 
@@ -68,14 +68,15 @@ func mainLoop(ctx context.Context, app *app) error {
 	}
 }
 
+// doWork runs stats collector and renders collected stats when they are published into the mailbox. Snapshots collected
+// while UI is busy are coalesced in the mailbox, only the latest one is rendered.
 func doWork(ctx context.Context, app *app) {
 	var wg sync.WaitGroup
-	statCh := make(chan stat.Stat)
+	mb := newStatMailbox()
 
 	wg.Add(1)
 	go func() {
-		collectStat(ctx, app.db, statCh, app.config.viewCh)
-		close(statCh)
+		collectStat(ctx, app.db, mb, app.config.viewCh)
 		wg.Done()
 	}()
 
@@ -91,10 +92,15 @@ func doWork(ctx context.Context, app *app) {
 		case <-app.uiExit:
 			// used for exit from UI (not the program) in case when need to open $PAGER or $EDITOR programs.
 			return
-		case s := <-statCh:
-			printStat(app, s, app.postgresProps)
+		case <-mb.ready:
+			// Snapshot is left unread if redraw of the previous one is in progress, it is signalled again when redraw
+			// is finished.
+			s, ok := mb.take()
+			if !ok {
+				continue
+			}
+			printStat(app, mb, s, app.postgresProps)
 		case <-ctx.Done():
-			close(statCh)
 			wg.Wait()
 			return
 		}